@@ -289,4 +289,482 @@ uint32_t ble_lbs_c_handles_assign(ble_lbs_c_t    * p_ble_lbs_c,
         p_ble_lbs_c->peer_lbs_db = *p_peer_handles;
     }
     return nrf_ble_gq_conn_handle_register(p_ble_lbs_c->p_gatt_queue, conn_handle);
-}
\ No newline at end of file
+}
+
+
+/**@brief Function for writing the waiting result batches to the peer.
+ *
+ * @details Writes without response until the SoftDevice runs out of buffers, the rest is written
+ *          on @ref BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ */
+static void rtt_batches_send(ble_rtt_c_t * p_ble_rtt_c)
+{
+    while (p_ble_rtt_c->tx_count > 0)
+    {
+        ble_gattc_write_params_t write_params;
+
+        memset(&write_params, 0, sizeof(write_params));
+
+        write_params.write_op = BLE_GATT_OP_WRITE_CMD;
+        write_params.handle   = p_ble_rtt_c->peer_rtt_db.result_handle;
+        write_params.offset   = 0;
+        write_params.len      = p_ble_rtt_c->tx_len[p_ble_rtt_c->tx_head];
+        write_params.p_value  = p_ble_rtt_c->tx_batches[p_ble_rtt_c->tx_head];
+
+        uint32_t err_code = sd_ble_gattc_write(p_ble_rtt_c->conn_handle, &write_params);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            return;
+        }
+        // The write is copied by the SoftDevice, other errors drop the batch.
+
+        p_ble_rtt_c->tx_head = (p_ble_rtt_c->tx_head + 1) % BLE_RTT_C_TX_QUEUE_LEN;
+        p_ble_rtt_c->tx_count--;
+    }
+}
+
+
+/**@brief Function for intercepting the errors of the BLE GATT Queue for the Ranging Service client. */
+static void rtt_gatt_error_handler(uint32_t   nrf_error,
+                                   void     * p_ctx,
+                                   uint16_t   conn_handle)
+{
+    ble_rtt_c_t * p_ble_rtt_c = (ble_rtt_c_t *)p_ctx;
+
+    if (p_ble_rtt_c->error_handler != NULL)
+    {
+        p_ble_rtt_c->error_handler(nrf_error);
+    }
+}
+
+
+/**@brief Function for handling configuration and single-shot request notifications from the peer. */
+static void rtt_on_hvx(ble_rtt_c_t * p_ble_rtt_c, ble_evt_t const * p_ble_evt)
+{
+    ble_gattc_evt_hvx_t const * p_hvx = &p_ble_evt->evt.gattc_evt.params.hvx;
+    ble_rtt_c_evt_t             evt;
+
+    if (p_ble_rtt_c->conn_handle != p_ble_evt->evt.gattc_evt.conn_handle)
+    {
+        return;
+    }
+
+    if ((p_hvx->handle == p_ble_rtt_c->peer_rtt_db.range_now_handle) &&
+        (p_hvx->len == BLE_RTT_RANGE_REQUEST_LEN))
+    {
+        evt.evt_type          = BLE_RTT_C_EVT_RANGE_REQUEST;
+        evt.conn_handle       = p_ble_rtt_c->conn_handle;
+        evt.params.request_id = p_hvx->data[0];
+        p_ble_rtt_c->evt_handler(p_ble_rtt_c, &evt);
+        return;
+    }
+
+    if (p_hvx->handle != p_ble_rtt_c->peer_rtt_db.config_handle)
+    {
+        return;
+    }
+
+    // The peer has checked the configuration, but it may use a newer format.
+    if (rtt_config_decode(p_hvx->data, p_hvx->len, &evt.params.config) == NRF_SUCCESS)
+    {
+        evt.evt_type    = BLE_RTT_C_EVT_CONFIG_NOTIFICATION;
+        evt.conn_handle = p_ble_rtt_c->conn_handle;
+        p_ble_rtt_c->evt_handler(p_ble_rtt_c, &evt);
+    }
+}
+
+
+/**@brief Function for handling the answer to a configuration write. */
+static void rtt_on_write_rsp(ble_rtt_c_t * p_ble_rtt_c, ble_evt_t const * p_ble_evt)
+{
+    ble_rtt_c_evt_t evt;
+
+    if ((p_ble_rtt_c->conn_handle != p_ble_evt->evt.gattc_evt.conn_handle) ||
+        (p_ble_evt->evt.gattc_evt.params.write_rsp.handle != p_ble_rtt_c->peer_rtt_db.config_handle))
+    {
+        return;
+    }
+
+    evt.evt_type           = BLE_RTT_C_EVT_CONFIG_WRITTEN;
+    evt.conn_handle        = p_ble_rtt_c->conn_handle;
+    evt.params.gatt_status = p_ble_evt->evt.gattc_evt.gatt_status;
+    p_ble_rtt_c->evt_handler(p_ble_rtt_c, &evt);
+}
+
+
+/**@brief Function for handling the Disconnected event for the Ranging Service client. */
+static void rtt_on_disconnected(ble_rtt_c_t * p_ble_rtt_c, ble_evt_t const * p_ble_evt)
+{
+    if (p_ble_rtt_c->conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
+    {
+        p_ble_rtt_c->conn_handle                    = BLE_CONN_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.result_handle      = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.config_handle      = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.config_cccd_handle = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.range_now_handle      = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.range_now_cccd_handle = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.stats_handle          = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->peer_rtt_db.control_handle        = BLE_GATT_HANDLE_INVALID;
+        p_ble_rtt_c->max_batch_len             = BLE_GATT_ATT_MTU_DEFAULT - 3;
+        p_ble_rtt_c->tx_count                  = 0;
+    }
+}
+
+
+void ble_rtt_c_on_db_disc_evt(ble_rtt_c_t * p_ble_rtt_c, ble_db_discovery_evt_t const * p_evt)
+{
+    // Check if the Ranging Service was discovered.
+    if (p_evt->evt_type == BLE_DB_DISCOVERY_COMPLETE &&
+        p_evt->params.discovered_db.srv_uuid.uuid == RTT_UUID_SERVICE &&
+        p_evt->params.discovered_db.srv_uuid.type == p_ble_rtt_c->uuid_type)
+    {
+        ble_rtt_c_evt_t evt;
+
+        evt.evt_type    = BLE_RTT_C_EVT_DISCOVERY_COMPLETE;
+        evt.conn_handle = p_evt->conn_handle;
+        evt.params.peer_db.result_handle      = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.config_handle      = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.config_cccd_handle = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.range_now_handle      = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.range_now_cccd_handle = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.stats_handle          = BLE_GATT_HANDLE_INVALID;
+        evt.params.peer_db.control_handle        = BLE_GATT_HANDLE_INVALID;
+
+        for (uint32_t i = 0; i < p_evt->params.discovered_db.char_count; i++)
+        {
+            const ble_gatt_db_char_t * p_char = &(p_evt->params.discovered_db.charateristics[i]);
+            switch (p_char->characteristic.uuid.uuid)
+            {
+                case RTT_UUID_RESULT_CHAR:
+                    evt.params.peer_db.result_handle = p_char->characteristic.handle_value;
+                    break;
+                case RTT_UUID_CONFIG_CHAR:
+                    evt.params.peer_db.config_handle      = p_char->characteristic.handle_value;
+                    evt.params.peer_db.config_cccd_handle = p_char->cccd_handle;
+                    break;
+                case RTT_UUID_RANGE_NOW_CHAR:
+                    evt.params.peer_db.range_now_handle      = p_char->characteristic.handle_value;
+                    evt.params.peer_db.range_now_cccd_handle = p_char->cccd_handle;
+                    break;
+                case RTT_UUID_STATS_CHAR:
+                    evt.params.peer_db.stats_handle = p_char->characteristic.handle_value;
+                    break;
+                case RTT_UUID_CONTROL_CHAR:
+                    evt.params.peer_db.control_handle = p_char->characteristic.handle_value;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        //If the instance was assigned prior to db_discovery, assign the db_handles
+        if (p_ble_rtt_c->conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            if ((p_ble_rtt_c->peer_rtt_db.result_handle == BLE_GATT_HANDLE_INVALID) &&
+                (p_ble_rtt_c->peer_rtt_db.config_handle == BLE_GATT_HANDLE_INVALID))
+            {
+                p_ble_rtt_c->peer_rtt_db = evt.params.peer_db;
+            }
+        }
+
+        p_ble_rtt_c->evt_handler(p_ble_rtt_c, &evt);
+    }
+}
+
+
+uint32_t ble_rtt_c_init(ble_rtt_c_t * p_ble_rtt_c, ble_rtt_c_init_t * p_ble_rtt_c_init)
+{
+    uint32_t      err_code;
+    ble_uuid_t    rtt_uuid;
+    ble_uuid128_t rtt_base_uuid = {LBS_UUID_BASE};
+
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c_init);
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c_init->evt_handler);
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c_init->p_gatt_queue);
+
+    p_ble_rtt_c->peer_rtt_db.result_handle      = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.config_handle      = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.config_cccd_handle = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.range_now_handle      = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.range_now_cccd_handle = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.stats_handle          = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->peer_rtt_db.control_handle        = BLE_GATT_HANDLE_INVALID;
+    p_ble_rtt_c->conn_handle                    = BLE_CONN_HANDLE_INVALID;
+    p_ble_rtt_c->evt_handler                    = p_ble_rtt_c_init->evt_handler;
+    p_ble_rtt_c->p_gatt_queue                   = p_ble_rtt_c_init->p_gatt_queue;
+    p_ble_rtt_c->error_handler                  = p_ble_rtt_c_init->error_handler;
+    p_ble_rtt_c->max_batch_len                  = BLE_GATT_ATT_MTU_DEFAULT - 3;
+    p_ble_rtt_c->tx_head                        = 0;
+    p_ble_rtt_c->tx_count                       = 0;
+
+    // The Ranging Service shares the base UUID of the LED Button Service, the SoftDevice returns the same type.
+    err_code = sd_ble_uuid_vs_add(&rtt_base_uuid, &p_ble_rtt_c->uuid_type);
+    VERIFY_SUCCESS(err_code);
+
+    rtt_uuid.type = p_ble_rtt_c->uuid_type;
+    rtt_uuid.uuid = RTT_UUID_SERVICE;
+
+    return ble_db_discovery_evt_register(&rtt_uuid);
+}
+
+
+void ble_rtt_c_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    if ((p_context == NULL) || (p_ble_evt == NULL))
+    {
+        return;
+    }
+
+    ble_rtt_c_t * p_ble_rtt_c = (ble_rtt_c_t *)p_context;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTC_EVT_HVX:
+            rtt_on_hvx(p_ble_rtt_c, p_ble_evt);
+            break;
+
+        case BLE_GATTC_EVT_WRITE_RSP:
+            rtt_on_write_rsp(p_ble_rtt_c, p_ble_evt);
+            break;
+
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+            if (p_ble_rtt_c->conn_handle == p_ble_evt->evt.gattc_evt.conn_handle)
+            {
+                rtt_batches_send(p_ble_rtt_c);
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            rtt_on_disconnected(p_ble_rtt_c, p_ble_evt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+uint32_t ble_rtt_c_handles_assign(ble_rtt_c_t    * p_ble_rtt_c,
+                                  uint16_t         conn_handle,
+                                  rtt_db_t const * p_peer_handles)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+
+    p_ble_rtt_c->conn_handle = conn_handle;
+    if (p_peer_handles != NULL)
+    {
+        p_ble_rtt_c->peer_rtt_db = *p_peer_handles;
+    }
+    return nrf_ble_gq_conn_handle_register(p_ble_rtt_c->p_gatt_queue, conn_handle);
+}
+
+
+/**@brief Function for enabling notification of a Ranging Service characteristic.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] cccd_handle Handle of the CCCD of the characteristic.
+ */
+static uint32_t rtt_notif_enable(ble_rtt_c_t * p_ble_rtt_c, uint16_t cccd_handle)
+{
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (cccd_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    nrf_ble_gq_req_t cccd_req;
+    uint8_t          cccd[WRITE_MESSAGE_LENGTH];
+
+    cccd[0] = LSB_16(BLE_GATT_HVX_NOTIFICATION);
+    cccd[1] = MSB_16(BLE_GATT_HVX_NOTIFICATION);
+
+    memset(&cccd_req, 0, sizeof(nrf_ble_gq_req_t));
+
+    cccd_req.type                        = NRF_BLE_GQ_REQ_GATTC_WRITE;
+    cccd_req.error_handler.cb            = rtt_gatt_error_handler;
+    cccd_req.error_handler.p_ctx         = p_ble_rtt_c;
+    cccd_req.params.gattc_write.handle   = cccd_handle;
+    cccd_req.params.gattc_write.len      = WRITE_MESSAGE_LENGTH;
+    cccd_req.params.gattc_write.offset   = 0;
+    cccd_req.params.gattc_write.p_value  = cccd;
+    cccd_req.params.gattc_write.write_op = BLE_GATT_OP_WRITE_REQ;
+
+    return nrf_ble_gq_item_add(p_ble_rtt_c->p_gatt_queue, &cccd_req, p_ble_rtt_c->conn_handle);
+}
+
+
+uint32_t ble_rtt_c_config_notif_enable(ble_rtt_c_t * p_ble_rtt_c)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+
+    return rtt_notif_enable(p_ble_rtt_c, p_ble_rtt_c->peer_rtt_db.config_cccd_handle);
+}
+
+
+uint32_t ble_rtt_c_range_now_notif_enable(ble_rtt_c_t * p_ble_rtt_c)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+
+    return rtt_notif_enable(p_ble_rtt_c, p_ble_rtt_c->peer_rtt_db.range_now_cccd_handle);
+}
+
+
+uint32_t ble_rtt_c_config_send(ble_rtt_c_t * p_ble_rtt_c, rtt_config_t const * p_config)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    VERIFY_PARAM_NOT_NULL(p_config);
+
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_rtt_c->peer_rtt_db.config_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    nrf_ble_gq_req_t write_req;
+    uint8_t          encoded[RTT_CONFIG_ENCODED_LEN];
+
+    memset(&write_req, 0, sizeof(nrf_ble_gq_req_t));
+
+    // The GATT Queue copies the value, so it can live on the stack.
+    write_req.type                        = NRF_BLE_GQ_REQ_GATTC_WRITE;
+    write_req.error_handler.cb            = rtt_gatt_error_handler;
+    write_req.error_handler.p_ctx         = p_ble_rtt_c;
+    write_req.params.gattc_write.handle   = p_ble_rtt_c->peer_rtt_db.config_handle;
+    write_req.params.gattc_write.len      = rtt_config_encode(p_config, encoded);
+    write_req.params.gattc_write.p_value  = encoded;
+    write_req.params.gattc_write.offset   = 0;
+    write_req.params.gattc_write.write_op = BLE_GATT_OP_WRITE_REQ;
+
+    return nrf_ble_gq_item_add(p_ble_rtt_c->p_gatt_queue, &write_req, p_ble_rtt_c->conn_handle);
+}
+
+
+uint32_t ble_rtt_c_range_result_send(ble_rtt_c_t * p_ble_rtt_c, ble_rtt_range_result_t const * p_result)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    VERIFY_PARAM_NOT_NULL(p_result);
+
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_rtt_c->peer_rtt_db.range_now_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    nrf_ble_gq_req_t write_req;
+    uint8_t          encoded[BLE_RTT_RANGE_RESULT_LEN];
+    uint16_t         len = 0;
+
+    encoded[len++] = p_result->request_id;
+    len           += uint16_encode((uint16_t)p_result->distance_cm, &encoded[len]);
+    encoded[len++] = p_result->quality;
+    len           += uint32_encode(p_result->initiator_us, &encoded[len]);
+
+    memset(&write_req, 0, sizeof(nrf_ble_gq_req_t));
+
+    write_req.type                        = NRF_BLE_GQ_REQ_GATTC_WRITE;
+    write_req.error_handler.cb            = rtt_gatt_error_handler;
+    write_req.error_handler.p_ctx         = p_ble_rtt_c;
+    write_req.params.gattc_write.handle   = p_ble_rtt_c->peer_rtt_db.range_now_handle;
+    write_req.params.gattc_write.len      = len;
+    write_req.params.gattc_write.p_value  = encoded;
+    write_req.params.gattc_write.offset   = 0;
+    write_req.params.gattc_write.write_op = BLE_GATT_OP_WRITE_CMD;
+
+    return nrf_ble_gq_item_add(p_ble_rtt_c->p_gatt_queue, &write_req, p_ble_rtt_c->conn_handle);
+}
+
+
+uint32_t ble_rtt_c_stats_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t const * p_data, uint16_t len)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    VERIFY_PARAM_NOT_NULL(p_data);
+
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_rtt_c->peer_rtt_db.stats_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    nrf_ble_gq_req_t write_req;
+
+    memset(&write_req, 0, sizeof(nrf_ble_gq_req_t));
+
+    write_req.type                        = NRF_BLE_GQ_REQ_GATTC_WRITE;
+    write_req.error_handler.cb            = rtt_gatt_error_handler;
+    write_req.error_handler.p_ctx         = p_ble_rtt_c;
+    write_req.params.gattc_write.handle   = p_ble_rtt_c->peer_rtt_db.stats_handle;
+    write_req.params.gattc_write.len      = len;
+    write_req.params.gattc_write.p_value  = p_data;
+    write_req.params.gattc_write.offset   = 0;
+    write_req.params.gattc_write.write_op = BLE_GATT_OP_WRITE_CMD;
+
+    return nrf_ble_gq_item_add(p_ble_rtt_c->p_gatt_queue, &write_req, p_ble_rtt_c->conn_handle);
+}
+
+
+uint32_t ble_rtt_c_control_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t command)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_rtt_c->peer_rtt_db.control_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    nrf_ble_gq_req_t write_req;
+
+    memset(&write_req, 0, sizeof(nrf_ble_gq_req_t));
+
+    write_req.type                        = NRF_BLE_GQ_REQ_GATTC_WRITE;
+    write_req.error_handler.cb            = rtt_gatt_error_handler;
+    write_req.error_handler.p_ctx         = p_ble_rtt_c;
+    write_req.params.gattc_write.handle   = p_ble_rtt_c->peer_rtt_db.control_handle;
+    write_req.params.gattc_write.len      = BLE_RTT_CONTROL_LEN;
+    write_req.params.gattc_write.p_value  = &command;
+    write_req.params.gattc_write.offset   = 0;
+    write_req.params.gattc_write.write_op = BLE_GATT_OP_WRITE_CMD;
+
+    return nrf_ble_gq_item_add(p_ble_rtt_c->p_gatt_queue, &write_req, p_ble_rtt_c->conn_handle);
+}
+
+
+void ble_rtt_c_mtu_set(ble_rtt_c_t * p_ble_rtt_c, uint16_t att_mtu)
+{
+    p_ble_rtt_c->max_batch_len = MIN(att_mtu - 3, BLE_RTT_BATCH_MAX_LEN);
+}
+
+
+uint32_t ble_rtt_c_results_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t const * p_batch, uint16_t len)
+{
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    VERIFY_PARAM_NOT_NULL(p_batch);
+
+    if ((p_ble_rtt_c->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (p_ble_rtt_c->peer_rtt_db.result_handle == BLE_GATT_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (len > p_ble_rtt_c->max_batch_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_ble_rtt_c->tx_count == BLE_RTT_C_TX_QUEUE_LEN)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    uint8_t tail = (p_ble_rtt_c->tx_head + p_ble_rtt_c->tx_count) % BLE_RTT_C_TX_QUEUE_LEN;
+
+    memcpy(p_ble_rtt_c->tx_batches[tail], p_batch, len);
+    p_ble_rtt_c->tx_len[tail] = len;
+    p_ble_rtt_c->tx_count++;
+
+    rtt_batches_send(p_ble_rtt_c);
+
+    return NRF_SUCCESS;
+}
@@ -52,6 +52,8 @@
 #include "ble_srv_common.h"
 #include "nrf_ble_gq.h"
 #include "nrf_sdh_ble.h"
+#include "rtt_config.h"
+#include "rtt_stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,12 +82,100 @@ NRF_SDH_BLE_OBSERVERS(_name ## _obs,
                       ble_lbs_c_on_ble_evt, &_name, _cnt)
 
 
+/**@brief   Macro for defining a ble_rtt_c instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_RTT_C_DEF(_name)                                                                        \
+static ble_rtt_c_t _name;                                                                           \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_RTT_C_BLE_OBSERVER_PRIO,                                                   \
+                     ble_rtt_c_on_ble_evt, &_name)
+
+/**@brief   Macro for defining multiple ble_rtt_c instances.
+ *
+ * @param   _name   Name of the array of instances.
+ * @param   _cnt    Number of instances to define.
+ * @hideinitializer
+ */
+#define BLE_RTT_C_ARRAY_DEF(_name, _cnt)                                                            \
+static ble_rtt_c_t _name[_cnt];                                                                     \
+NRF_SDH_BLE_OBSERVERS(_name ## _obs,                                                                \
+                      BLE_RTT_C_BLE_OBSERVER_PRIO,                                                  \
+                      ble_rtt_c_on_ble_evt, &_name, _cnt)
+
+
 #define LBS_UUID_BASE        {0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15, \
                               0xDE, 0xEF, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00}
 #define LBS_UUID_SERVICE     0x1523
 #define LBS_UUID_BUTTON_CHAR 0x1524
 #define LBS_UUID_LED_CHAR    0x1525
 
+#define RTT_UUID_SERVICE     0x1530
+#define RTT_UUID_RESULT_CHAR 0x1531
+#define RTT_UUID_CONFIG_CHAR 0x1532
+#define RTT_UUID_RANGE_NOW_CHAR 0x1533
+#define RTT_UUID_STATS_CHAR  0x1534
+#define RTT_UUID_CONTROL_CHAR 0x1535
+
+#ifndef BLE_RTT_C_BLE_OBSERVER_PRIO
+#define BLE_RTT_C_BLE_OBSERVER_PRIO 2
+#endif
+
+/**@brief Ranging result batches
+ *
+ * @details Batches of result records are written to the Result characteristic of the responder,
+ *          which notifies them to its gateways. A batch is a one byte sequence number followed
+ *          by records of BLE_RTT_RECORD_LEN bytes, little endian:
+ *
+ *          | Offset | Size | Field                                                      |
+ *          |--------|------|------------------------------------------------------------|
+ *          | 0      | 4    | Timestamp, milliseconds since the initiator started         |
+ *          | 4      | 2    | Distance in centimeters, signed. BLE_RTT_DISTANCE_INVALID if none |
+ *          | 6      | 1    | Quality, percentage of exchanges that got a valid response |
+ *          | 7      | 1    | Peer, index of the responder                               |
+ */
+#define BLE_RTT_BATCH_HEADER_LEN  1
+#define BLE_RTT_RECORD_LEN        8
+#define BLE_RTT_BATCH_MAX_LEN     (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< ATT payload: MTU less opcode and handle. */
+#define BLE_RTT_DISTANCE_INVALID  INT16_MIN
+#define BLE_RTT_C_TX_QUEUE_LEN    4  /**< Number of batches waiting to be written. */
+
+/**@brief Single-shot ranging
+ *
+ * @details A gateway writes a one byte request id to the Range Now characteristic of the
+ *          responder, which notifies the request id to the initiator. The initiator runs one
+ *          burst and writes the result back without response, BLE_RTT_RANGE_RESULT_LEN bytes,
+ *          little endian:
+ *
+ *          | Offset | Size | Field                                                      |
+ *          |--------|------|------------------------------------------------------------|
+ *          | 0      | 1    | Request id                                                 |
+ *          | 1      | 2    | Distance in centimeters, signed. BLE_RTT_DISTANCE_INVALID if none |
+ *          | 3      | 1    | Quality, percentage of exchanges that got a valid response |
+ *          | 4      | 4    | Initiator time in microseconds, from the request to the result |
+ */
+#define BLE_RTT_RANGE_REQUEST_LEN 1
+#define BLE_RTT_RANGE_RESULT_LEN  8
+
+/**@brief Ranging statistics
+ *
+ * @details A statistics snapshot encoded as described in rtt_stats.h is written without response
+ *          to the Statistics characteristic of the responder, which notifies it to a gateway.
+ */
+#define BLE_RTT_STATS_LEN RTT_STATS_ENCODED_LEN
+
+/**@brief Ranging control
+ *
+ * @details One of these commands is written without response to the Control characteristic of
+ *          the responder when a ranging session starts and when it stops, so the responder only
+ *          listens while it is ranged with.
+ */
+#define BLE_RTT_CONTROL_LEN   1
+#define BLE_RTT_CONTROL_STOP  0x00 /**< Ranging has stopped. */
+#define BLE_RTT_CONTROL_START 0x01 /**< Ranging has started. */
+
 /**@brief LBS Client event type. */
 typedef enum
 {
@@ -119,6 +209,80 @@ typedef struct
     } params;
 } ble_lbs_c_evt_t;
 
+/**@brief Ranging Service Client event type. */
+typedef enum
+{
+    BLE_RTT_C_EVT_DISCOVERY_COMPLETE = 1,  /**< Event indicating that the Ranging Service was discovered at the peer. */
+    BLE_RTT_C_EVT_CONFIG_NOTIFICATION,     /**< Event indicating that a gateway has written a new configuration to the peer. */
+    BLE_RTT_C_EVT_CONFIG_WRITTEN,          /**< Event indicating that the peer has answered a configuration write. */
+    BLE_RTT_C_EVT_RANGE_REQUEST            /**< Event indicating that a gateway has asked the peer for a single-shot distance. */
+} ble_rtt_c_evt_type_t;
+
+/**@brief Structure containing the handles related to the Ranging Service found on the peer. */
+typedef struct
+{
+    uint16_t result_handle;         /**< Handle of the Result characteristic as provided by the SoftDevice. */
+    uint16_t config_handle;         /**< Handle of the Config characteristic as provided by the SoftDevice. */
+    uint16_t config_cccd_handle;    /**< Handle of the CCCD of the Config characteristic as provided by the SoftDevice. */
+    uint16_t range_now_handle;      /**< Handle of the Range Now characteristic as provided by the SoftDevice. */
+    uint16_t range_now_cccd_handle; /**< Handle of the CCCD of the Range Now characteristic as provided by the SoftDevice. */
+    uint16_t stats_handle;          /**< Handle of the Statistics characteristic as provided by the SoftDevice. */
+    uint16_t control_handle;        /**< Handle of the Control characteristic as provided by the SoftDevice. */
+} rtt_db_t;
+
+/**@brief Result of a single-shot ranging request. */
+typedef struct
+{
+    uint8_t  request_id;   /**< Request id notified by the peer. */
+    int16_t  distance_cm;  /**< Distance in centimeters, BLE_RTT_DISTANCE_INVALID if none. */
+    uint8_t  quality;      /**< Percentage of exchanges that got a valid response. */
+    uint32_t initiator_us; /**< Time from the request notification until the result was written. */
+} ble_rtt_range_result_t;
+
+/**@brief Ranging Service Client event structure. */
+typedef struct
+{
+    ble_rtt_c_evt_type_t evt_type;    /**< Type of the event. */
+    uint16_t             conn_handle; /**< Connection handle on which the event occured.*/
+    union
+    {
+        rtt_db_t     peer_db;         /**< Handles related to the Ranging Service found on the peer device. This is filled if the evt_type is @ref BLE_RTT_C_EVT_DISCOVERY_COMPLETE.*/
+        rtt_config_t config;          /**< Configuration notified by the peer. This is filled if the evt_type is @ref BLE_RTT_C_EVT_CONFIG_NOTIFICATION.*/
+        uint16_t     gatt_status;     /**< GATT status of the configuration write. This is filled if the evt_type is @ref BLE_RTT_C_EVT_CONFIG_WRITTEN.*/
+        uint8_t      request_id;      /**< Id of the single-shot request. This is filled if the evt_type is @ref BLE_RTT_C_EVT_RANGE_REQUEST.*/
+    } params;
+} ble_rtt_c_evt_t;
+
+// Forward declaration of the ble_rtt_c_t type.
+typedef struct ble_rtt_c_s ble_rtt_c_t;
+
+/**@brief   Ranging Service Client event handler type. */
+typedef void (* ble_rtt_c_evt_handler_t) (ble_rtt_c_t * p_ble_rtt_c, ble_rtt_c_evt_t * p_evt);
+
+/**@brief Ranging Service Client structure. */
+struct ble_rtt_c_s
+{
+    uint16_t                  conn_handle;      /**< Connection handle as provided by the SoftDevice. */
+    rtt_db_t                  peer_rtt_db;      /**< Handles related to the Ranging Service on the peer. */
+    ble_rtt_c_evt_handler_t   evt_handler;      /**< Application event handler to be called when there is an event related to the Ranging Service. */
+    ble_srv_error_handler_t   error_handler;    /**< Function to be called in case of an error. */
+    nrf_ble_gq_t            * p_gatt_queue;     /**< Pointer to the BLE GATT Queue instance. */
+    uint8_t                   uuid_type;        /**< UUID type. */
+    uint16_t                  max_batch_len;    /**< Longest batch that fits the ATT MTU of the link. */
+    uint8_t                   tx_batches[BLE_RTT_C_TX_QUEUE_LEN][BLE_RTT_BATCH_MAX_LEN]; /**< Batches waiting to be written. */
+    uint16_t                  tx_len[BLE_RTT_C_TX_QUEUE_LEN];                            /**< Length of each waiting batch. */
+    uint8_t                   tx_head;          /**< Index of the next batch to write. */
+    uint8_t                   tx_count;         /**< Number of batches waiting. */
+};
+
+/**@brief Ranging Service Client initialization structure. */
+typedef struct
+{
+    ble_rtt_c_evt_handler_t   evt_handler;   /**< Event handler to be called by the Ranging Service Client module when there is an event related to the Ranging Service. */
+    nrf_ble_gq_t            * p_gatt_queue;  /**< Pointer to the BLE GATT Queue instance. */
+    ble_srv_error_handler_t   error_handler; /**< Function to be called in case of an error. */
+} ble_rtt_c_init_t;
+
 // Forward declaration of the ble_lbs_c_t type.
 typedef struct ble_lbs_c_s ble_lbs_c_t;
 
@@ -242,6 +406,168 @@ uint32_t ble_lbs_c_handles_assign(ble_lbs_c_t *    p_ble_lbs_c,
 uint32_t ble_lbs_led_status_send(ble_lbs_c_t * p_ble_lbs_c, uint8_t status);
 
 
+/**@brief Function for initializing the Ranging Service client module.
+ *
+ * @details This function registers with the Database Discovery module for the Ranging Service.
+ *
+ * @param[in] p_ble_rtt_c      Pointer to the Ranging Service client structure.
+ * @param[in] p_ble_rtt_c_init Pointer to the Ranging Service initialization structure.
+ *
+ * @retval    NRF_SUCCESS On successful initialization.
+ * @retval    err_code    Otherwise, this function propagates the error code returned by the Database Discovery module API
+ *                        @ref ble_db_discovery_evt_register.
+ */
+uint32_t ble_rtt_c_init(ble_rtt_c_t * p_ble_rtt_c, ble_rtt_c_init_t * p_ble_rtt_c_init);
+
+
+/**@brief Function for handling BLE events from the SoftDevice.
+ *
+ * @param[in] p_ble_evt     Pointer to the BLE event.
+ * @param[in] p_context     Pointer to the Ranging Service client structure.
+ */
+void ble_rtt_c_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Function for handling events from the Database Discovery module.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] p_evt       Pointer to the event received from the Database Discovery module.
+ */
+void ble_rtt_c_on_db_disc_evt(ble_rtt_c_t * p_ble_rtt_c, ble_db_discovery_evt_t const * p_evt);
+
+
+/**@brief     Function for assigning handles to this instance of rtt_c.
+ *
+ * @param[in] p_ble_rtt_c    Pointer to the Ranging Service client structure instance for associating the link.
+ * @param[in] conn_handle    Connection handle to associate with the given Ranging Service Client Instance.
+ * @param[in] p_peer_handles Ranging Service handles found on the peer (from @ref BLE_RTT_C_EVT_DISCOVERY_COMPLETE event).
+ *
+ * @retval NRF_SUCCESS If the handles were assigned.
+ */
+uint32_t ble_rtt_c_handles_assign(ble_rtt_c_t    * p_ble_rtt_c,
+                                  uint16_t         conn_handle,
+                                  rtt_db_t const * p_peer_handles);
+
+
+/**@brief Function for setting the ATT MTU of the link.
+ *
+ * @details Call this function on @ref NRF_BLE_GATT_EVT_ATT_MTU_UPDATED so that batches are not
+ *          longer than the link can carry in one write.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] att_mtu     Effective ATT MTU of the link.
+ */
+void ble_rtt_c_mtu_set(ble_rtt_c_t * p_ble_rtt_c, uint16_t att_mtu);
+
+
+/**@brief Function for requesting the peer to notify configurations written by its gateways.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ *
+ * @retval NRF_SUCCESS If the CCCD write was queued.
+ * @retval err_code    Otherwise, this API propagates the error code returned by function
+ *                     @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_config_notif_enable(ble_rtt_c_t * p_ble_rtt_c);
+
+
+/**@brief GATT status of a configuration write whose radio link the peer cannot serve next to
+ *        those of its other initiators. Another link can be written. */
+#define BLE_RTT_C_STATUS_CONFIG_LINK (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 4)
+
+
+/**@brief Function for writing a ranging configuration to the peer.
+ *
+ * @details The peer stages the configuration and takes it into use at its next timeslot
+ *          request. The answer is reported with @ref BLE_RTT_C_EVT_CONFIG_WRITTEN.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] p_config    Configuration to write.
+ *
+ * @retval NRF_SUCCESS             If the write was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the Ranging Service has not been discovered on the peer.
+ * @retval err_code                Otherwise, this API propagates the error code returned by function
+ *                                 @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_config_send(ble_rtt_c_t * p_ble_rtt_c, rtt_config_t const * p_config);
+
+
+/**@brief Function for requesting the peer to notify single-shot ranging requests from its gateways.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ *
+ * @retval NRF_SUCCESS             If the CCCD write was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the peer has no Range Now characteristic.
+ * @retval err_code                Otherwise, this API propagates the error code returned by function
+ *                                 @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_range_now_notif_enable(ble_rtt_c_t * p_ble_rtt_c);
+
+
+/**@brief Function for writing the result of a single-shot ranging request to the peer.
+ *
+ * @details The result is written without response through the GATT Queue, and the peer
+ *          notifies it to the gateway that asked for it.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] p_result    Result to write.
+ *
+ * @retval NRF_SUCCESS             If the write was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the peer has no Range Now characteristic.
+ * @retval err_code                Otherwise, this API propagates the error code returned by function
+ *                                 @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_range_result_send(ble_rtt_c_t * p_ble_rtt_c, ble_rtt_range_result_t const * p_result);
+
+
+/**@brief Function for writing a statistics snapshot to the connected server.
+ *
+ * @details The snapshot is written without response through the GATT Queue.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] p_data      Snapshot encoded by rtt_stats_encode.
+ * @param[in] len         Length of the snapshot.
+ *
+ * @retval NRF_SUCCESS             If the write was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the peer has no Statistics characteristic.
+ * @retval err_code                Otherwise, this API propagates the error code returned by function
+ *                                 @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_stats_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t const * p_data, uint16_t len);
+
+
+/**@brief Function for writing a ranging control command to the connected server.
+ *
+ * @details The command is written without response through the GATT Queue.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] command     BLE_RTT_CONTROL_START or BLE_RTT_CONTROL_STOP.
+ *
+ * @retval NRF_SUCCESS             If the write was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the peer has no Control characteristic.
+ * @retval err_code                Otherwise, this API propagates the error code returned by function
+ *                                 @ref nrf_ble_gq_item_add.
+ */
+uint32_t ble_rtt_c_control_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t command);
+
+
+/**@brief Function for writing a batch of result records to the connected server.
+ *
+ * @details The batch is copied and written without response. Batches the SoftDevice can not take
+ *          yet are kept and written when an earlier write has completed.
+ *
+ * @param[in] p_ble_rtt_c Pointer to the Ranging Service client structure.
+ * @param[in] p_batch     Batch, a sequence number followed by records.
+ * @param[in] len         Length of the batch.
+ *
+ * @retval NRF_SUCCESS             If the batch was queued.
+ * @retval NRF_ERROR_INVALID_STATE If the Ranging Service has not been discovered on the peer.
+ * @retval NRF_ERROR_INVALID_LENGTH If the batch is longer than @ref ble_rtt_c_t::max_batch_len.
+ * @retval NRF_ERROR_NO_MEM        If the queue of batches is full.
+ */
+uint32_t ble_rtt_c_results_send(ble_rtt_c_t * p_ble_rtt_c, uint8_t const * p_batch, uint16_t len);
+
+
 #ifdef __cplusplus
 }
 #endif
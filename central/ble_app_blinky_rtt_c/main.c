@@ -25,11 +25,13 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
 #include "nrf_sdh_soc.h"
 #include "nrf_pwr_mgmt.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "boards.h"
 #include "bsp.h"
 #include "bsp_btn_ble.h"
@@ -37,6 +39,7 @@
 #include "ble_hci.h"
 #include "ble_advertising.h"
 #include "ble_conn_params.h"
+#include "ble_conn_state.h"
 #include "ble_db_discovery.h"
 #include "ble_rtt_c.h"
 #include "nrf_ble_gatt.h"
@@ -46,6 +49,17 @@
 #include "nrf_log_default_backends.h"
 #include "radio_001.h"
 #include "timeslot.h"
+#include "rtt_session.h"
+#include "rtt_results.h"
+#include "rtt_stream.h"
+#include "rtt_telemetry.h"
+#include "rtt_stats.h"
+#include "rtt_profiler.h"
+#include "rtt_config.h"
+#include "rtt_calibration.h"
+#include "rtt_peers.h"
+#include "rtt_anchors.h"
+#include "rtt_position.h"
 #include "rtt_parameters.h"
 
 #define CENTRAL_SCANNING_LED            BSP_BOARD_LED_0                     /**< Scanning LED will be on when the device is scanning. */
@@ -58,16 +72,36 @@
 #define APP_BLE_CONN_CFG_TAG            1                                   /**< A tag identifying the SoftDevice BLE configuration. */
 #define APP_BLE_OBSERVER_PRIO           3                                   /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 
+#define RATE_REPORT_INTERVAL            APP_TIMER_TICKS(RATE_REPORT_INTERVAL_MS)  /**< Interval between reports of the achieved ranging rate (in number of timer ticks). */
+
+#define SCHED_MAX_EVENT_DATA_SIZE       0                                   /**< Maximum size of scheduler events. The burst queue carries the data. */
+#define SCHED_QUEUE_SIZE                (RTT_BURST_QUEUE_SIZE + 2)          /**< Maximum number of events in the scheduler queue. One for the result flush timer and one for a failed single-shot burst. */
+
 NRF_BLE_SCAN_DEF(m_scan);                                       /**< Scanning module instance. */
-BLE_LBS_C_DEF(m_ble_lbs_c);                                     /**< Main structure used by the LBS client module. */
+BLE_LBS_C_ARRAY_DEF(m_ble_lbs_c, NRF_SDH_BLE_CENTRAL_LINK_COUNT);           /**< LBS client instances, one per link. */
+BLE_RTT_C_ARRAY_DEF(m_ble_rtt_c, NRF_SDH_BLE_CENTRAL_LINK_COUNT);           /**< Ranging Service client instances, one per link. */
 NRF_BLE_GATT_DEF(m_gatt);                                       /**< GATT module instance. */
-BLE_DB_DISCOVERY_DEF(m_db_disc);                                /**< DB discovery module instance. */
+BLE_DB_DISCOVERY_ARRAY_DEF(m_db_disc, NRF_SDH_BLE_CENTRAL_LINK_COUNT);      /**< DB discovery module instances, one per link. */
 NRF_BLE_GQ_DEF(m_ble_gatt_queue,                                /**< BLE GATT Queue instance. */
                NRF_SDH_BLE_CENTRAL_LINK_COUNT,
                NRF_BLE_GQ_QUEUE_SIZE);
 
+APP_TIMER_DEF(m_rate_timer_id);                                 /**< Ranging rate report timer. */
+
 static char const m_target_periph_name[] = "Nordic_RTT";     /**< Name of the device we try to connect to. This name is searched in the scan report data*/
 
+/* The peer index of a responder is its connection handle, and every link is to a responder */
+STATIC_ASSERT(RTT_PEERS_MAX == NRF_SDH_BLE_CENTRAL_LINK_COUNT);
+
+static uint8_t  m_peer_config[RTT_PEERS_MAX][RTT_CONFIG_ENCODED_LEN]; /**< Last ranging configuration written to each responder. */
+static bool     m_peer_config_synced[RTT_PEERS_MAX];            /**< The responder has acknowledged m_peer_config. */
+static uint8_t  m_peer_link_renewals[RTT_PEERS_MAX];            /**< Links drawn again since the responder last acknowledged a configuration. */
+static uint32_t m_configs_pending         = 0;                  /**< Responders whose answer to a configuration write is awaited, one bit each. */
+static bool     m_start_on_config_written = false;              /**< Start a session when the last responder answers the configuration write. */
+static volatile bool m_start_when_idle = false;                 /**< Start a session when the last timeslot of the previous one has ended. */
+static timeslot_schedule_t m_schedule;                          /**< Schedule of the session being started. */
+static rtt_stats_t m_peer_last[RTT_PEERS_MAX];                 /**< Session counters of each responder at the last rate report. */
+
 uint32_t ts_time_total = 0;
 
 /**@brief Function to handle asserts in the SoftDevice.
@@ -104,16 +138,6 @@ static void leds_init(void)
     bsp_board_init(BSP_INIT_LEDS);
 }
 
-/**@brief Function for the pins initialization.
- */
-static void pins_init(void)
-{
-    nrf_gpio_cfg_output(DATAPIN_1);
-    nrf_gpio_cfg_output(DATAPIN_2);
-    nrf_gpio_cfg_output(DATAPIN_3);
-    nrf_gpio_cfg_output(DATAPIN_4);
-}
-
 /**@brief Function to start scanning.
  */
 static void scan_start(void)
@@ -123,7 +147,6 @@ static void scan_start(void)
     err_code = nrf_ble_scan_start(&m_scan);
     APP_ERROR_CHECK(err_code);
 
-    bsp_board_led_off(CENTRAL_CONNECTED_LED);
     bsp_board_led_on(CENTRAL_SCANNING_LED);
 }
 
@@ -138,7 +161,7 @@ static void lbs_c_evt_handler(ble_lbs_c_t * p_lbs_c, ble_lbs_c_evt_t * p_lbs_c_e
         {
             ret_code_t err_code;
 
-            err_code = ble_lbs_c_handles_assign(&m_ble_lbs_c,
+            err_code = ble_lbs_c_handles_assign(p_lbs_c,
                                                 p_lbs_c_evt->conn_handle,
                                                 &p_lbs_c_evt->params.peer_db);
             NRF_LOG_INFO("LED Button service discovered on conn_handle 0x%x.", p_lbs_c_evt->conn_handle);
@@ -158,6 +181,365 @@ static void lbs_c_evt_handler(ble_lbs_c_t * p_lbs_c, ble_lbs_c_evt_t * p_lbs_c_e
 }
 
 
+/**@brief Start a ranging session with the configuration in use.
+ */
+static uint32_t ranging_session_start(void)
+{
+    rtt_config_t const * p_config = rtt_config_get();
+    rtt_session_config_t config   = RTT_SESSION_CONFIG_DEFAULT;
+
+    config.schedule           = m_schedule;
+    config.schedule.rate_hz   = p_config->rate_hz;
+    config.schedule.exchanges = p_config->exchanges;
+    config.averaging          = p_config->averaging;
+
+    return rtt_session_start(&config);
+}
+
+
+/**@brief Get the ranging configuration of one responder.
+ *
+ * @details The configuration in use, with the responder's address, the period of its bursts in
+ *          the frame, the share of the bursts it asked for and the radio link of its connection.
+ */
+static void peer_config_get(uint8_t peer, rtt_config_t * p_config)
+{
+    rtt_link_t link;
+
+    rtt_peers_link_get(peer, &link);
+
+    *p_config                = *rtt_config_get();
+    p_config->address        = RTT_CONFIG_PEER_ADDRESS(peer);
+    p_config->period_bursts  = rtt_peers_period_get(peer);
+    p_config->weight         = rtt_peers_weight_get(peer);
+    p_config->access_address = link.access_address;
+    p_config->hop_seed       = link.hop_seed;
+}
+
+
+/**@brief Get the radio link a responder listens on, the one in the configuration it acknowledged.
+ */
+static void peer_link_get(uint8_t peer, rtt_link_t * p_link)
+{
+    rtt_config_t config;
+
+    if (m_peer_config_synced[peer] &&
+        (rtt_config_decode(m_peer_config[peer], RTT_CONFIG_ENCODED_LEN, &config) == NRF_SUCCESS))
+    {
+        rtt_config_link_get(&config, p_link);
+    }
+    else
+    {
+        rtt_config_link_get(rtt_config_get(), p_link);
+    }
+}
+
+
+/**@brief Start ranging at a session boundary.
+ *
+ * @details A staged configuration is taken into use first, and the bursts are shared among the
+ *          connected responders. Every responder that has not acknowledged its configuration is
+ *          written the configuration and the session starts when the last one answers, so all
+ *          peers change configuration between the same two sessions.
+ *
+ * @retval NRF_ERROR_BUSY The last timeslot of the previous session has not ended yet.
+ */
+static uint32_t ranging_start(void)
+{
+    uint32_t err_code;
+
+    if (rtt_config_is_staged())
+    {
+        if (!timeslot_is_idle())
+        {
+            return NRF_ERROR_BUSY;
+        }
+        (void)rtt_config_apply();
+        NRF_LOG_INFO("Ranging configuration %u in use.", rtt_config_get()->id);
+    }
+
+    memset(&m_schedule, 0, sizeof(m_schedule));
+    err_code = rtt_peers_frame_build(RTT_PEERS_DEFAULT_POLICY, &m_schedule);
+    if (err_code == NRF_ERROR_INVALID_PARAM)
+    {
+        NRF_LOG_WARNING("Responder weights do not fit a frame, sharing the bursts evenly.");
+        err_code = rtt_peers_frame_build(RTT_PEERS_POLICY_ROUND_ROBIN, &m_schedule);
+    }
+    // Without a responder, range to any responder as before.
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_NOT_FOUND))
+    {
+        return err_code;
+    }
+
+    m_configs_pending = 0;
+    for (uint8_t peer = 0; peer < RTT_PEERS_MAX; peer++)
+    {
+        rtt_config_t config;
+        uint8_t      encoded[RTT_CONFIG_ENCODED_LEN];
+
+        if (!rtt_peers_is_connected(peer))
+        {
+            continue;
+        }
+
+        peer_config_get(peer, &config);
+        (void)rtt_config_encode(&config, encoded);
+        if (m_peer_config_synced[peer] && (memcmp(encoded, m_peer_config[peer], sizeof(encoded)) == 0))
+        {
+            rtt_config_link_get(&config, &m_schedule.links[peer]);
+            continue;
+        }
+
+        err_code = ble_rtt_c_config_send(&m_ble_rtt_c[peer], &config);
+        if (err_code == NRF_SUCCESS)
+        {
+            memcpy(m_peer_config[peer], encoded, sizeof(encoded));
+            m_peer_config_synced[peer] = false;
+            m_configs_pending         |= (1UL << peer);
+        }
+        // Without the Ranging Service on the peer, range as before, on the shared link.
+        else if (err_code == NRF_ERROR_INVALID_STATE)
+        {
+            rtt_config_link_get(rtt_config_get(), &m_schedule.links[peer]);
+            continue;
+        }
+        else
+        {
+            return err_code;
+        }
+
+        rtt_config_link_get(&config, &m_schedule.links[peer]);
+    }
+
+    if (m_configs_pending != 0)
+    {
+        m_start_on_config_written = true;
+        return NRF_SUCCESS;
+    }
+
+    return ranging_session_start();
+}
+
+
+/**@brief Start ranging now, or once the previous session or single-shot burst has ended.
+ */
+static uint32_t ranging_start_or_defer(void)
+{
+    uint32_t err_code;
+
+    err_code = ranging_start();
+    if ((err_code == NRF_ERROR_BUSY) || (err_code == NRF_ERROR_INVALID_STATE))
+    {
+        m_start_when_idle = true;
+        err_code          = NRF_SUCCESS;
+    }
+
+    return err_code;
+}
+
+
+/**@brief Start the session put off by ranging_start_or_defer() when the radio is idle again.
+ *
+ * @details Polled from the main loop, which the SoftDevice event of the radio session going
+ *          idle and the end of a single-shot burst both wake.
+ */
+static void ranging_start_when_idle(void)
+{
+    uint32_t err_code;
+
+    if (!m_start_when_idle || !timeslot_is_idle() ||
+        (rtt_session_state_get() != RTT_SESSION_STATE_IDLE))
+    {
+        return;
+    }
+
+    m_start_when_idle = false;
+    NRF_LOG_INFO("Previous session ended, starting ranging.");
+    err_code = ranging_start_or_defer();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Restart a running session, so its frame covers the responders connected now.
+ *
+ * @details When the last timeslot of the stopped session has not ended yet, the session starts
+ *          again from the main loop once it has.
+ */
+static void ranging_restart(void)
+{
+    uint32_t err_code;
+
+    if (m_start_on_config_written)
+    {
+        // The frame is built again when the configurations have been written.
+        m_start_on_config_written = false;
+    }
+    else if ((rtt_session_state_get() == RTT_SESSION_STATE_RUNNING) ||
+             (rtt_session_state_get() == RTT_SESSION_STATE_PAUSED))
+    {
+        err_code = rtt_session_stop();
+        APP_ERROR_CHECK(err_code);
+    }
+    else
+    {
+        return;
+    }
+
+    err_code = ranging_start_or_defer();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Serve a single-shot ranging request forwarded by a responder.
+ *
+ * @details A staged configuration is left for the next session, so the burst uses the
+ *          configuration the responder already has.
+ */
+static void range_now(uint8_t peer, uint8_t request_id)
+{
+    uint32_t   err_code;
+    rtt_link_t link;
+
+    rtt_results_range_now_start(peer, request_id);
+
+    peer_link_get(peer, &link);
+    err_code = rtt_session_single_shot(peer, &link, rtt_config_get()->exchanges);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("Single-shot request %u of responder %u not served, error 0x%x.",
+                        request_id, peer, err_code);
+        rtt_results_range_now_done(peer, NULL);
+    }
+}
+
+
+/**@brief Handles events coming from the Ranging Service client module.
+ */
+static void rtt_c_evt_handler(ble_rtt_c_t * p_rtt_c, ble_rtt_c_evt_t * p_rtt_c_evt)
+{
+    switch (p_rtt_c_evt->evt_type)
+    {
+        case BLE_RTT_C_EVT_DISCOVERY_COMPLETE:
+        {
+            ret_code_t err_code;
+
+            err_code = ble_rtt_c_handles_assign(p_rtt_c,
+                                                p_rtt_c_evt->conn_handle,
+                                                &p_rtt_c_evt->params.peer_db);
+            APP_ERROR_CHECK(err_code);
+            NRF_LOG_INFO("Ranging service discovered on conn_handle 0x%x.", p_rtt_c_evt->conn_handle);
+
+            // Configurations written by gateways are forwarded by the responder.
+            err_code = ble_rtt_c_config_notif_enable(p_rtt_c);
+            APP_ERROR_CHECK(err_code);
+
+            // So are single-shot requests, by responders that take them.
+            err_code = ble_rtt_c_range_now_notif_enable(p_rtt_c);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+
+            // A responder connecting while ranging joins the frame.
+            ranging_restart();
+        } break; // BLE_RTT_C_EVT_DISCOVERY_COMPLETE
+
+        case BLE_RTT_C_EVT_RANGE_REQUEST:
+            range_now((uint8_t)p_rtt_c_evt->conn_handle, p_rtt_c_evt->params.request_id);
+            break; // BLE_RTT_C_EVT_RANGE_REQUEST
+
+        case BLE_RTT_C_EVT_CONFIG_NOTIFICATION:
+        {
+            uint8_t      peer   = (uint8_t)p_rtt_c_evt->conn_handle;
+            rtt_config_t config = p_rtt_c_evt->params.config;
+            ret_code_t   err_code;
+
+            // The responder took the gateway's configuration, which it is written over with its own.
+            m_peer_config_synced[peer] = false;
+
+            // The weight is the responder's own. The rest is shared by every responder, so one
+            // responder's gateway only changes it while that responder is the only one; the others
+            // get the configuration in use written back. The address and period are given by the
+            // frame, and the link by the connection.
+            (void)rtt_peers_weight_set(peer, config.weight);
+            if (rtt_peers_count() > 1)
+            {
+                NRF_LOG_INFO("Weight %u of configuration %u from responder %u taken, the rest is shared.",
+                             config.weight, config.id, peer);
+                break;
+            }
+
+            config.address        = RTT_CONFIG_ADDRESS_ANY;
+            config.period_bursts  = 1;
+            config.weight         = 1;
+            config.access_address = RTT_CONFIG_ACCESS_ADDRESS_DEFAULT;
+            config.hop_seed       = 0;
+
+            err_code = rtt_config_stage(&config);
+            if (err_code == NRF_SUCCESS)
+            {
+                NRF_LOG_INFO("Ranging configuration %u from responder %u staged for the next session.",
+                             config.id, peer);
+            }
+        } break; // BLE_RTT_C_EVT_CONFIG_NOTIFICATION
+
+        case BLE_RTT_C_EVT_CONFIG_WRITTEN:
+        {
+            uint8_t    peer = (uint8_t)p_rtt_c_evt->conn_handle;
+            ret_code_t err_code;
+
+            m_configs_pending &= ~(1UL << peer);
+
+            // The responder serves another initiator on this link, try another one.
+            if ((p_rtt_c_evt->params.gatt_status == BLE_RTT_C_STATUS_CONFIG_LINK) &&
+                m_start_on_config_written &&
+                (m_peer_link_renewals[peer] < RTT_LINK_RENEWALS_MAX) &&
+                (rtt_peers_link_renew(peer) == NRF_SUCCESS))
+            {
+                rtt_config_t config;
+
+                m_peer_link_renewals[peer]++;
+                peer_config_get(peer, &config);
+                NRF_LOG_INFO("Responder %u cannot serve this link, writing another.", peer);
+
+                err_code = ble_rtt_c_config_send(&m_ble_rtt_c[peer], &config);
+                if (err_code == NRF_SUCCESS)
+                {
+                    (void)rtt_config_encode(&config, m_peer_config[peer]);
+                    rtt_config_link_get(&config, &m_schedule.links[peer]);
+                    m_configs_pending |= (1UL << peer);
+                    break;
+                }
+            }
+
+            if (p_rtt_c_evt->params.gatt_status != BLE_GATT_STATUS_SUCCESS)
+            {
+                NRF_LOG_WARNING("Responder %u rejected ranging configuration %u, status 0x%x.",
+                                peer, rtt_config_get()->id, p_rtt_c_evt->params.gatt_status);
+                m_start_on_config_written = false;
+                break;
+            }
+
+            m_peer_config_synced[peer] = true;
+            m_peer_link_renewals[peer] = 0;
+            if (m_start_on_config_written && (m_configs_pending == 0))
+            {
+                m_start_on_config_written = false;
+                err_code = ranging_session_start();
+                if (err_code != NRF_ERROR_INVALID_STATE)
+                {
+                    APP_ERROR_CHECK(err_code);
+                }
+            }
+        } break; // BLE_RTT_C_EVT_CONFIG_WRITTEN
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
 /**@brief Function for handling BLE events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -175,24 +557,88 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
         // discovery, update LEDs status and resume scanning if necessary. */
         case BLE_GAP_EVT_CONNECTED:
         {
-            NRF_LOG_INFO("Connected.");
-            err_code = ble_lbs_c_handles_assign(&m_ble_lbs_c, p_gap_evt->conn_handle, NULL);
+            NRF_LOG_INFO("Connected to responder %u.", p_gap_evt->conn_handle);
+            // The per-responder state is indexed by connection handle.
+            if (p_gap_evt->conn_handle >= RTT_PEERS_MAX)
+            {
+                NRF_LOG_WARNING("No room for responder %u, disconnecting.", p_gap_evt->conn_handle);
+                err_code = sd_ble_gap_disconnect(p_gap_evt->conn_handle,
+                                                 BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+                APP_ERROR_CHECK(err_code);
+                break;
+            }
+
+            err_code = ble_lbs_c_handles_assign(&m_ble_lbs_c[p_gap_evt->conn_handle], p_gap_evt->conn_handle, NULL);
             APP_ERROR_CHECK(err_code);
 
-            err_code = ble_db_discovery_start(&m_db_disc, p_gap_evt->conn_handle);
+            err_code = ble_rtt_c_handles_assign(&m_ble_rtt_c[p_gap_evt->conn_handle], p_gap_evt->conn_handle, NULL);
+            APP_ERROR_CHECK(err_code);
+
+            // Calibrations are looked up by the low 32 bits of the responder's address.
+            err_code = rtt_peers_add((uint8_t)p_gap_evt->conn_handle,
+                                     uint32_decode(p_gap_evt->params.connected.peer_addr.addr));
+            if (err_code != NRF_SUCCESS)
+            {
+                NRF_LOG_WARNING("No room to range with responder %u.", p_gap_evt->conn_handle);
+            }
+            else
+            {
+                // The responder may have been given another configuration since the last connection.
+                m_peer_config_synced[p_gap_evt->conn_handle] = false;
+                m_peer_link_renewals[p_gap_evt->conn_handle] = 0;
+            }
+
+            // Result batches are sent at the 2 Mbps PHY when the peer supports it.
+            ble_gap_phys_t const phys =
+            {
+                .rx_phys = BLE_GAP_PHY_2MBPS,
+                .tx_phys = BLE_GAP_PHY_2MBPS,
+            };
+            err_code = sd_ble_gap_phy_update(p_gap_evt->conn_handle, &phys);
+            APP_ERROR_CHECK(err_code);
+
+            err_code = ble_db_discovery_start(&m_db_disc[p_gap_evt->conn_handle], p_gap_evt->conn_handle);
             APP_ERROR_CHECK(err_code);
 
             // Update LEDs status, and check if we should be looking for more
             // peripherals to connect to.
             bsp_board_led_on(CENTRAL_CONNECTED_LED);
-            bsp_board_led_off(CENTRAL_SCANNING_LED);
+            if (ble_conn_state_central_conn_count() < NRF_SDH_BLE_CENTRAL_LINK_COUNT)
+            {
+                scan_start();
+            }
+            else
+            {
+                bsp_board_led_off(CENTRAL_SCANNING_LED);
+            }
         } break;
 
-        // Upon disconnection, reset the connection handle of the peer which disconnected, update
-        // the LEDs status and start scanning again.
+        // Upon disconnection, leave the responder out of the frame, update the LEDs status and
+        // start scanning again.
         case BLE_GAP_EVT_DISCONNECTED:
         {
-            NRF_LOG_INFO("Disconnected.");
+            uint8_t peer = (uint8_t)p_gap_evt->conn_handle;
+
+            NRF_LOG_INFO("Responder %u disconnected.", peer);
+            if (peer < RTT_PEERS_MAX)
+            {
+                rtt_peers_remove(peer);
+                m_configs_pending &= ~(1UL << peer);
+                if (rtt_results_range_now_pending(peer))
+                {
+                    rtt_results_range_now_done(peer, NULL);
+                }
+                // The last responder keeps its bursts, as with a single link.
+                if (rtt_peers_count() > 0)
+                {
+                    ranging_restart();
+                }
+            }
+
+            if (ble_conn_state_central_conn_count() == 0)
+            {
+                bsp_board_led_off(CENTRAL_CONNECTED_LED);
+            }
             scan_start();
         } break;
 
@@ -205,14 +651,6 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
             }
         } break;
 
-        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
-        {
-            // Accept parameters requested by peer.
-            err_code = sd_ble_gap_conn_param_update(p_gap_evt->conn_handle,
-                                        &p_gap_evt->params.conn_param_update_request.conn_params);
-            APP_ERROR_CHECK(err_code);
-        } break;
-
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
             NRF_LOG_DEBUG("PHY update request.");
@@ -225,6 +663,13 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
             APP_ERROR_CHECK(err_code);
         } break;
 
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+            NRF_LOG_INFO("PHY updated: tx 0x%x, rx 0x%x.",
+                         p_gap_evt->params.phy_update.tx_phy,
+                         p_gap_evt->params.phy_update.rx_phy);
+        } break;
+
         case BLE_GATTC_EVT_TIMEOUT:
         {
             // Disconnect on GATT Client timeout event.
@@ -261,7 +706,6 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
 static void ble_evt_dispatch(ble_evt_t const * p_ble_evt, void * p_context)
 {
     ble_evt_handler(p_ble_evt);
-    nrf_evt_signal_handler((uint32_t) p_ble_evt->header.evt_id);
 }
 
 /**@brief LED Button client initialization.
@@ -275,7 +719,32 @@ static void lbs_c_init(void)
     lbs_c_init_obj.p_gatt_queue  = &m_ble_gatt_queue;
     lbs_c_init_obj.error_handler = lbs_error_handler;
 
-    err_code = ble_lbs_c_init(&m_ble_lbs_c, &lbs_c_init_obj);
+    for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
+    {
+        err_code = ble_lbs_c_init(&m_ble_lbs_c[i], &lbs_c_init_obj);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Ranging Service client initialization.
+ */
+static void rtt_c_init(void)
+{
+    ret_code_t       err_code;
+    ble_rtt_c_init_t rtt_c_init_obj;
+
+    rtt_c_init_obj.evt_handler   = rtt_c_evt_handler;
+    rtt_c_init_obj.p_gatt_queue  = &m_ble_gatt_queue;
+    rtt_c_init_obj.error_handler = lbs_error_handler;
+
+    for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
+    {
+        err_code = ble_rtt_c_init(&m_ble_rtt_c[i], &rtt_c_init_obj);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = rtt_results_init(m_ble_rtt_c, RTT_PEERS_MAX);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -317,16 +786,19 @@ static void button_event_handler(uint8_t pin_no, uint8_t button_action)
     switch (pin_no)
     {
         case LEDBUTTON_BUTTON_PIN:
-            err_code = ble_lbs_led_status_send(&m_ble_lbs_c, button_action);
-            if (err_code != NRF_SUCCESS &&
-                err_code != BLE_ERROR_INVALID_CONN_HANDLE &&
-                err_code != NRF_ERROR_INVALID_STATE)
-            {
-                APP_ERROR_CHECK(err_code);
-            }
-            if (err_code == NRF_SUCCESS)
+            for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
             {
-                NRF_LOG_INFO("LBS write LED state %d", button_action);
+                err_code = ble_lbs_led_status_send(&m_ble_lbs_c[i], button_action);
+                if (err_code != NRF_SUCCESS &&
+                    err_code != BLE_ERROR_INVALID_CONN_HANDLE &&
+                    err_code != NRF_ERROR_INVALID_STATE)
+                {
+                    APP_ERROR_CHECK(err_code);
+                }
+                if (err_code == NRF_SUCCESS)
+                {
+                    NRF_LOG_INFO("LBS write LED state %d to responder %u", button_action, i);
+                }
             }
             break;
 
@@ -334,7 +806,40 @@ static void button_event_handler(uint8_t pin_no, uint8_t button_action)
             APP_ERROR_HANDLER(pin_no);
             break;
     }
-    request_next_event_earliest();
+
+    /* Each press starts or stops a ranging session */
+    if (button_action == APP_BUTTON_PUSH)
+    {
+        if (m_start_on_config_written)
+        {
+            /* Still waiting for the responders, do not start when they answer */
+            m_start_on_config_written = false;
+            err_code                  = NRF_SUCCESS;
+        }
+        else if (m_start_when_idle)
+        {
+            /* Still waiting for the previous session to end, do not start when it has */
+            m_start_when_idle = false;
+            err_code          = NRF_SUCCESS;
+        }
+        else if (rtt_session_state_get() == RTT_SESSION_STATE_IDLE)
+        {
+            err_code = ranging_start_or_defer();
+            if (m_start_when_idle)
+            {
+                NRF_LOG_INFO("Previous session still ending, ranging starts when it has.");
+            }
+        }
+        else
+        {
+            err_code = rtt_session_stop();
+        }
+
+        if (err_code != NRF_ERROR_INVALID_STATE)
+        {
+            APP_ERROR_CHECK(err_code);
+        }
+    }
 }
 
 
@@ -386,7 +891,8 @@ static void buttons_init(void)
  */
 static void db_disc_handler(ble_db_discovery_evt_t * p_evt)
 {
-    ble_lbs_on_db_disc_evt(&m_ble_lbs_c, p_evt);
+    ble_lbs_on_db_disc_evt(&m_ble_lbs_c[p_evt->conn_handle], p_evt);
+    ble_rtt_c_on_db_disc_evt(&m_ble_rtt_c[p_evt->conn_handle], p_evt);
 }
 
 
@@ -417,12 +923,263 @@ static void log_init(void)
 }
 
 
+#if RTT_POSITION_ENABLED
+/**@brief Function for adding the distance of a burst to the position solver.
+ *
+ * @details The distance is weighted by the share of valid exchanges of the burst. Responders
+ *          without coordinates are left out, and every position solved is written to the
+ *          binary stream.
+ *
+ * @param[in] p_sample  Distance measured by the burst.
+ */
+static void position_update(rtt_session_sample_t const * p_sample)
+{
+    rtt_position_t position;
+    int32_t        distance_mm;
+
+    if (isnan(p_sample->distance_m) || (p_sample->exchanges == 0))
+    {
+        return;
+    }
+
+    // A distance just short of zero is an anchor within the noise.
+    distance_mm = (p_sample->distance_m > 0.0f) ? (int32_t)lroundf(p_sample->distance_m * 1000.0f) : 0;
+    if (rtt_position_update(rtt_peers_id_get(p_sample->peer), distance_mm,
+                            (uint8_t)((p_sample->valid * 100UL) / p_sample->exchanges),
+                            p_sample->timestamp, &position) == NRF_SUCCESS)
+    {
+        rtt_stream_position_write(&position);
+    }
+}
+#endif
+
+
+/**@brief Tell every connected responder that ranging has started or stopped.
+ *
+ * @details A responder only listens for the bursts while one of its initiators ranges.
+ *
+ * @param[in] command  BLE_RTT_CONTROL_START or BLE_RTT_CONTROL_STOP.
+ */
+static void peers_control_send(uint8_t command)
+{
+    for (uint8_t peer = 0; peer < RTT_PEERS_MAX; peer++)
+    {
+        if (rtt_peers_is_connected(peer))
+        {
+            // A responder without the Control characteristic stops when it no longer hears the bursts.
+            (void)ble_rtt_c_control_send(&m_ble_rtt_c[peer], command);
+        }
+    }
+}
+
+
+/**@brief Function for handling ranging session events.
+ *
+ * @param[in] p_evt  Session event.
+ */
+static void rtt_session_evt_handler(rtt_session_evt_t const * p_evt)
+{
+    switch (p_evt->type)
+    {
+        case RTT_SESSION_EVT_STARTED:
+            NRF_LOG_INFO("Ranging session started.");
+            peers_control_send(BLE_RTT_CONTROL_START);
+            break;
+
+        case RTT_SESSION_EVT_PAUSED:
+            peers_control_send(BLE_RTT_CONTROL_STOP);
+            break;
+
+        case RTT_SESSION_EVT_RESUMED:
+            peers_control_send(BLE_RTT_CONTROL_START);
+            break;
+
+        case RTT_SESSION_EVT_SAMPLE:
+            rtt_results_add(&p_evt->sample);
+            rtt_stream_sample_write(&p_evt->sample);
+#if RTT_POSITION_ENABLED
+            position_update(&p_evt->sample);
+#endif
+            break;
+
+        case RTT_SESSION_EVT_RESULT:
+            rtt_stream_result_write(&p_evt->result);
+            NRF_LOG_INFO(NRF_LOG_FLOAT_MARKER, NRF_LOG_FLOAT(p_evt->result.distance_m));
+            break;
+
+        case RTT_SESSION_EVT_STOPPED:
+            NRF_LOG_INFO("Ranging session stopped.");
+            peers_control_send(BLE_RTT_CONTROL_STOP);
+            // Single-shot requests waiting for their burst when the session stopped are not served.
+            for (uint8_t peer = 0; peer < RTT_PEERS_MAX; peer++)
+            {
+                if (rtt_results_range_now_pending(peer))
+                {
+                    rtt_results_range_now_done(peer, NULL);
+                }
+            }
+            break;
+
+        case RTT_SESSION_EVT_SINGLE_SHOT:
+            rtt_results_range_now_done(p_evt->sample.peer, &p_evt->sample);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+/**@brief Report the statistics and telemetry of each responder.
+ *
+ * @details Writes them to the binary stream and the statistics to the responder. While ranging,
+ *          also logs the throughput to each responder since the last report.
+ */
+static void peers_report(bool ranging)
+{
+    for (uint8_t peer = 0; peer < RTT_PEERS_MAX; peer++)
+    {
+        rtt_telemetry_t telemetry;
+        rtt_stats_t     session;
+        rtt_stats_t     lifetime;
+        uint8_t         stats[RTT_STATS_ENCODED_LEN];
+        uint16_t        stats_len;
+
+        if (!rtt_peers_is_connected(peer))
+        {
+            continue;
+        }
+
+        rtt_telemetry_get(peer, &telemetry);
+        if (telemetry.valid != 0)
+        {
+            rtt_stream_telemetry_write(peer, &telemetry);
+        }
+
+        rtt_stats_peer_get(peer, &session, &lifetime);
+        rtt_stream_peer_write(peer, rtt_peers_weight_get(peer), rtt_peers_period_get(peer), &session);
+
+        stats_len = rtt_stats_encode(RTT_STATS_ROLE_INITIATOR, &session, &lifetime, stats);
+        (void)ble_rtt_c_stats_send(&m_ble_rtt_c[peer], stats, stats_len);
+
+        if (ranging && (session.bursts >= m_peer_last[peer].bursts))
+        {
+            uint32_t bursts = session.bursts - m_peer_last[peer].bursts;
+            uint32_t valid  = (session.rx_crc_ok - session.rx_ignored) -
+                              (m_peer_last[peer].rx_crc_ok - m_peer_last[peer].rx_ignored);
+
+            NRF_LOG_INFO("Responder %u: %u bursts/s, %u valid exchanges/s, 1 in %u bursts.", peer,
+                         (bursts * 1000UL) / RATE_REPORT_INTERVAL_MS,
+                         (valid * 1000UL) / RATE_REPORT_INTERVAL_MS, rtt_peers_period_get(peer));
+            if (telemetry.valid == ((1UL << RTT_TELEMETRY_FIELDS) - 1))
+            {
+                NRF_LOG_INFO("Responder %u: %u received, %u CRC errors, %u sent, RSSI %d dBm.", peer,
+                             telemetry.values[RTT_TELEMETRY_RX_OK], telemetry.values[RTT_TELEMETRY_RX_CRC_ERROR],
+                             telemetry.values[RTT_TELEMETRY_TX], (int32_t)telemetry.values[RTT_TELEMETRY_RSSI]);
+                NRF_LOG_INFO("Responder %u temperature " NRF_LOG_FLOAT_MARKER " C.", peer,
+                             NRF_LOG_FLOAT((int32_t)telemetry.values[RTT_TELEMETRY_TEMPERATURE] / 4.0f));
+            }
+        }
+        // A new session starts the counters again.
+        m_peer_last[peer] = session;
+    }
+}
+
+
+/**@brief Function for handling the ranging rate report timer.
+ *
+ * @details Writes the counters, the statistics of all responders together and of each
+ *          responder, the responder telemetry and, if enabled, the profile of the exchanges to
+ *          the binary stream, and the statistics to the responders. While ranging, also logs the
+ *          achieved burst rate against the rate requested from the scheduler, the slot start
+ *          latency and estimated current under the power policy, the session statistics and the
+ *          throughput and telemetry of each responder.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void rate_timer_handler(void * p_context)
+{
+    timeslot_schedule_t    schedule;
+    timeslot_power_stats_t power;
+    rtt_stream_counters_t  counters;
+    rtt_stats_t            session;
+    rtt_stats_t            lifetime;
+#if RTT_PROFILER_ENABLED
+    rtt_profile_t          profile;
+#endif
+#if RTT_POSITION_ENABLED
+    rtt_position_t         position;
+#endif
+    uint32_t               achieved_mhz;
+    bool                   per_slot;
+
+    timeslot_rate_get(&counters.bursts, &counters.blocked);
+    timeslot_grant_stats_get(&counters.requests, &counters.grants);
+    counters.bursts_dropped = timeslot_dropped_get();
+    rtt_results_stats_get(&counters.records_sent, &counters.records_dropped);
+    rtt_stream_counters_write(&counters);
+
+    rtt_stats_get(&session, &lifetime);
+    rtt_stream_stats_write(&session, &lifetime);
+
+    peers_report(timeslot_is_running());
+
+#if RTT_PROFILER_ENABLED
+    rtt_profiler_get(&profile);
+    rtt_stream_profile_write(&profile);
+    for (uint32_t i = 0; i < RTT_PROFILER_PHASES; i++)
+    {
+        if (profile.phases[i].count > 0)
+        {
+            NRF_LOG_INFO("Phase %u: %u times, %u/%u/%u cycles (min/avg/max).", i, profile.phases[i].count,
+                         profile.phases[i].min, profile.phases[i].sum / profile.phases[i].count,
+                         profile.phases[i].max);
+        }
+    }
+#endif
+
+    timeslot_power_stats_get(&power, RATE_REPORT_INTERVAL_MS * 1000UL);
+    if (!timeslot_is_running())
+    {
+        return;
+    }
+
+    timeslot_schedule_get(&schedule);
+    achieved_mhz = (uint32_t)(((uint64_t)counters.bursts * 1000000UL) / RATE_REPORT_INTERVAL_MS);
+    per_slot     = (timeslot_power_policy_get() == TIMESLOT_POWER_POLICY_PER_SLOT) ||
+                   ((timeslot_power_policy_get() == TIMESLOT_POWER_POLICY_AUTO) && (schedule.rate_hz != 0));
+
+    NRF_LOG_INFO("Ranging rate: requested %u Hz, achieved %u.%03u Hz, %u blocked, %u responders.",
+                 schedule.rate_hz, achieved_mhz / 1000, achieved_mhz % 1000, counters.blocked,
+                 rtt_peers_count());
+    NRF_LOG_INFO("Power policy %s: slot start latency %u/%u/%u us (min/avg/max), %u cold HFXO starts.",
+                 per_slot ? "per slot" : "per session",
+                 power.latency_min_us, power.latency_avg_us, power.latency_max_us, power.hfxo_cold_starts);
+    NRF_LOG_INFO("Estimated ranging current %u uA (HFXO %u us, radio %u us, CPU %u us).",
+                 power.current_ua, power.hfxo_on_us, power.radio_on_us, power.cpu_on_us);
+    NRF_LOG_INFO("Session: %u bursts, %u sent, %u valid, %u CRC errors, %u timeouts.",
+                 session.bursts, session.tx, session.rx_crc_ok - session.rx_ignored,
+                 session.rx_crc_error, session.rx_timeouts);
+#if RTT_POSITION_ENABLED
+    if (rtt_position_get(&position))
+    {
+        NRF_LOG_INFO("Position %d, %d, %d mm from %u anchors, RMS residual %u mm.", position.x_mm,
+                     position.y_mm, position.z_mm, position.anchors, position.rms_residual_mm);
+    }
+#endif
+}
+
+
 /**@brief Function for initializing the timer.
  */
 static void timer_init(void)
 {
     ret_code_t err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_rate_timer_id, APP_TIMER_MODE_REPEATED, rate_timer_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -457,21 +1214,60 @@ static void scan_init(void)
 }
 
 
+/**@brief Function for handling events from the GATT library.
+ *
+ * @details Result batches are sized to the ATT MTU negotiated on the link.
+ */
+static void gatt_evt_handler(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt)
+{
+    switch (p_evt->evt_id)
+    {
+        case NRF_BLE_GATT_EVT_ATT_MTU_UPDATED:
+            NRF_LOG_INFO("ATT MTU updated to %u bytes.", p_evt->params.att_mtu_effective);
+            if (p_evt->conn_handle < NRF_SDH_BLE_CENTRAL_LINK_COUNT)
+            {
+                ble_rtt_c_mtu_set(&m_ble_rtt_c[p_evt->conn_handle], p_evt->params.att_mtu_effective);
+            }
+            break;
+
+        case NRF_BLE_GATT_EVT_DATA_LENGTH_UPDATED:
+            NRF_LOG_INFO("Data length updated to %u bytes.", p_evt->params.data_length);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
 /**@brief Function for initializing the GATT module.
  */
 static void gatt_init(void)
 {
-    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, NULL);
+    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, gatt_evt_handler);
     APP_ERROR_CHECK(err_code);
 }
 
 
+/**@brief Function for initializing the event scheduler.
+ */
+static void scheduler_init(void)
+{
+    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+}
+
+
 /**@brief Function for handling the idle state (main loop).
  *
- * @details Handle any pending log operation(s), then sleep until the next event occurs.
+ * @details Handle any pending scheduled events, a ranging start waiting for the radio, trace events and log operation(s), then sleep until the next event occurs.
  */
 static void idle_state_handle(void)
 {
+    app_sched_execute();
+    ranging_start_when_idle();
+#if RTT_TRACE_ENABLED
+    rtt_stream_trace_write();
+#endif
     NRF_LOG_FLUSH();
     nrf_pwr_mgmt_run();
 }
@@ -481,9 +1277,9 @@ int main(void)
 {
     // Initialize.
     log_init();
+    scheduler_init();
     timer_init();
     leds_init();
-    pins_init();
     buttons_init();
     power_management_init();
     ble_stack_init();
@@ -491,8 +1287,40 @@ int main(void)
     gatt_init();
     db_discovery_init();
     lbs_c_init();
+    rtt_c_init();
 
-    timeslot_sd_init();
+#if RTT_PROFILER_ENABLED
+    rtt_profiler_init();
+#endif
+
+    ret_code_t err_code = rtt_stream_init();
+    APP_ERROR_CHECK(err_code);
+
+    if (rtt_calibration_init())
+    {
+        rtt_config_t config = *rtt_config_get();
+
+        /* Trim the dwell time the calibration was fitted with */
+        config.bin_offset = rtt_calibration_get()->bin_offset;
+        err_code = rtt_config_stage(&config);
+        APP_ERROR_CHECK(err_code);
+        (void)rtt_config_apply();
+        NRF_LOG_INFO("Calibration %u in use.", rtt_calibration_get()->id);
+    }
+
+#if RTT_POSITION_ENABLED
+    rtt_position_config_t position_config = RTT_POSITION_CONFIG_DEFAULT;
+
+    NRF_LOG_INFO("%u anchors with coordinates.", rtt_anchors_init());
+    err_code = rtt_position_init(&position_config);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    err_code = rtt_session_init(rtt_session_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_rate_timer_id, RATE_REPORT_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
 
     // Start execution.
     NRF_LOG_INFO("Blinky CENTRAL example started.");
@@ -36,40 +36,39 @@
 #include <stdlib.h>
 #include "nrf_clock.h"
 #include "rtt_parameters.h"
-#include <math.h>
+#include "rtt_config.h"
+#include "rtt_telemetry.h"
+#include "rtt_profiler.h"
+#include "rtt_trace.h"
+#include <string.h>
 
 #define GPIO_NUMBER_LED0       13 /* Pin number for LED0 */
 #define GPIO_NUMBER_LED1       14 /* Pin number for LED1 */
-#define DATABASE               0x20001000 /* Base address for measurement database */
-#define NUM_BINS               128 /* Number of bins in database */
 #define TIMER2_PRESCALE_VAL    0 /* 16 MHz */
-#define OFFSET                 69.96 /* Offset found by linear regression */
 
 static uint8_t  test_frame[255] = {0x00, 0x04, 0xFF, 0xC1, 0xFB, 0xE8};
-static uint32_t tx_pkt_counter = 0;
-static uint32_t radio_freq = 78;
-static uint32_t telp;
-static uint32_t rx_pkt_counter = 0;
-static uint32_t rx_pkt_counter_crcok = 0;
-static uint32_t rx_timeouts = 0;
-static uint32_t rx_ignored = 0;
 static uint8_t  rx_test_frame[256];
-static uint32_t highper=0;
-static uint32_t txcntw=0;
-static uint32_t database[NUM_BINS] __attribute__((section(".ARM.__at_DATABASE")));
-static uint32_t dbptr=0;
-static uint32_t bincnt[NUM_BINS];
 
-volatile static int count_mean;
-volatile static float tot_mean_val;
-volatile static float calculated_distance;
+/* Responder telemetry field being received, see rtt_telemetry.h */
+static uint8_t  m_telemetry_field;
+static uint8_t  m_telemetry_next = 0; /* Index of the next byte expected, 0 when waiting for a first byte */
+static uint32_t m_telemetry_value;
+
 
 /**
  * @brief Initializes the radio
+ *
+ * Access address and channel are those of the link, output power is taken from the runtime
+ * configuration.
  */
-void nrf_radio_init(void)
+void nrf_radio_init(rtt_link_t const * p_link)
 {
-    uint32_t aa_address = 0x71764129;
+    uint32_t aa_address;
+    uint8_t  channel;
+    rtt_config_t const * p_config = rtt_config_get();
+
+    rtt_config_link_resolve(p_link, &aa_address, &channel);
+
     NRF_RADIO->POWER                = (RADIO_POWER_POWER_Enabled << RADIO_POWER_POWER_Pos);
     NRF_RADIO->SHORTS = (RADIO_SHORTS_READY_START_Enabled << RADIO_SHORTS_READY_START_Pos) |
                         (RADIO_SHORTS_END_DISABLE_Enabled << RADIO_SHORTS_END_DISABLE_Pos);
@@ -86,9 +85,9 @@ void nrf_radio_init(void)
     NRF_RADIO->CRCINIT = 0x555555;
     NRF_RADIO->CRCCNF = 0x103;
     NRF_RADIO->FREQUENCY = (RADIO_FREQUENCY_MAP_Default << RADIO_FREQUENCY_MAP_Pos)  +
-                         ((radio_freq << RADIO_FREQUENCY_FREQUENCY_Pos) & RADIO_FREQUENCY_FREQUENCY_Msk);
+                         ((channel << RADIO_FREQUENCY_FREQUENCY_Pos) & RADIO_FREQUENCY_FREQUENCY_Msk);
     NRF_RADIO->PACKETPTR = (uint32_t)test_frame;
-    NRF_RADIO->TXPOWER=RADIO_TXPOWER_TXPOWER_Pos8dBm;
+    NRF_RADIO->TXPOWER = ((uint8_t)p_config->tx_power_dbm << RADIO_TXPOWER_TXPOWER_Pos) & RADIO_TXPOWER_TXPOWER_Msk;
 }
 
 /**
@@ -102,7 +101,9 @@ void timer2_capture_init(uint32_t prescaler)
     NRF_TIMER2->BITMODE = (TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos);
     NRF_TIMER2->TASKS_STOP = 1;
     NRF_TIMER2->CC[0] = 0x0000;
+    NRF_TIMER2->CC[1] = RTT_RX_TIMEOUT_US * 16; /* Response timeout, counted from the address of the request */
     NRF_TIMER2->EVENTS_COMPARE[0] = 0;
+    NRF_TIMER2->EVENTS_COMPARE[1] = 0;
     NRF_TIMER2->TASKS_CLEAR = 1;
     NRF_TIMER2->SHORTS = 0;
     NRF_TIMER2->PRESCALER = prescaler << TIMER_PRESCALER_PRESCALER_Pos;
@@ -111,14 +112,16 @@ void timer2_capture_init(uint32_t prescaler)
 
 /**
  * @brief Initializing TIMER4 to keep track of when the timeslot is about to end.
+ *
+ * @param[in] Measurement length in microseconds
  */
-void timer4_compare_init()
+void timer4_compare_init(uint32_t length_us)
 {
     NRF_TIMER4->TASKS_STOP          = 1;
     NRF_TIMER4->TASKS_CLEAR         = 1;
     NRF_TIMER4->MODE                = (TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos);
     NRF_TIMER4->EVENTS_COMPARE[0]   = 0;
-    NRF_TIMER4->CC[0]               = (DO_RTT_LENGTH_US);
+    NRF_TIMER4->CC[0]               = length_us;
     NRF_TIMER4->BITMODE             = (TIMER_BITMODE_BITMODE_24Bit << TIMER_BITMODE_BITMODE_Pos);
     NRF_TIMER4->PRESCALER           = 4;
     NRF_TIMER4->TASKS_START         = 1;
@@ -139,37 +142,33 @@ void nrf_ppi_config (void)
 }
 
 /**
- * @brief Calculates and returns distance in meters
- * 
- * @return Distance [m]
- * 
- * Must be called after do_rtt_measurement.
+ * @brief Powers down the radio
+ *
+ * Resets all radio registers. The radio must be initialized again before use.
  */
-float calc_dist(void)
+void radio_power_down(void)
 {
-    float val = 0;
-    int sum = 0;
-    for(int i = 0; i < NUM_BINS; i++)
-    {
-        val += database[i]*(i+1);
-        sum += database[i];
-    }
-    val = val/sum;
-    val = 0.5*18.737*val - OFFSET;
-    return val;
+    NRF_RADIO->POWER = (RADIO_POWER_POWER_Disabled << RADIO_POWER_POWER_Pos);
 }
 
 /**
  * @brief Disables the radio, PPI and timers
+ *
+ * @param[in] power_down Power down the radio. Otherwise it is left disabled but powered.
  */
-void end_rtt()
+void end_rtt(bool power_down)
 {
     NRF_RADIO->TASKS_DISABLE = 1;
     NRF_RADIO->SHORTS = 0;
     NRF_RADIO->INTENCLR = 0xFFFFFFFF;
     NRF_RADIO->EVENTS_DISABLED = 0;
     while ((NRF_RADIO->EVENTS_DISABLED == 0) && !(NRF_TIMER4->EVENTS_COMPARE[0]))
-    NRF_RADIO->POWER = (RADIO_POWER_POWER_Disabled << RADIO_POWER_POWER_Pos);
+    {
+    }
+    if (power_down)
+    {
+        radio_power_down();
+    }
 
     NRF_PPI->CHENCLR =  (1 << 6) | (1 << 7);
 
@@ -179,36 +178,107 @@ void end_rtt()
 }
 
 
+/**
+ * @brief Collects the telemetry byte of a valid response
+ *
+ * @param[in]  tag     Telemetry tag of the response
+ * @param[in]  value   Telemetry byte of the response
+ * @param[out] p_burst Burst the completed fields are added to
+ *
+ * A field is only completed when its bytes arrive in order, otherwise it is dropped.
+ */
+static void telemetry_receive(uint8_t tag, uint8_t value, rtt_burst_t * p_burst)
+{
+    uint8_t field = RTT_TELEMETRY_TAG_FIELD(tag);
+    uint8_t byte  = RTT_TELEMETRY_TAG_BYTE(tag);
+
+    if (byte == 0)
+    {
+        m_telemetry_field = field;
+        m_telemetry_value = 0;
+    }
+    else if ((field != m_telemetry_field) || (byte != m_telemetry_next))
+    {
+        m_telemetry_next = 0;
+        return;
+    }
+
+    m_telemetry_value |= (uint32_t)value << (8 * byte);
+    m_telemetry_next   = byte + 1;
+
+    if (m_telemetry_next == RTT_TELEMETRY_FIELD_LEN)
+    {
+        if (field < RTT_TELEMETRY_FIELDS)
+        {
+            p_burst->telemetry.values[field] = m_telemetry_value;
+            p_burst->telemetry.valid        |= (1UL << field);
+        }
+        m_telemetry_next = 0;
+    }
+}
+
 /**
  * @brief Do RTT measurements
+ *
+ * @param[in]  length_us     Time available for the measurements
+ * @param[in]  max_exchanges Number of exchanges after which to stop early
+ * @param[in]  address       Address of the responder to range with, carried in every request
+ * @param[in]  p_link        Radio link of the responder
+ * @param[out] p_burst       Histogram of the round trip times
+ * @param[in]  power_down    Power down the radio when done
+ *
+ * @return Time from the start of the measurement until the radio was first ready to send [us]
+ *
+ * Only collects the histogram and the exchange counts. The distance is calculated outside the
+ * timeslot by calc_dist. An exchange without a response is given up after RTT_RX_TIMEOUT_US.
  */
-void do_rtt_measurement(void)
+uint32_t do_rtt_measurement(uint32_t length_us, uint32_t max_exchanges, uint8_t address, rtt_link_t const * p_link,
+                            rtt_burst_t * p_burst, bool power_down)
 {
-    uint32_t attempts,tempval, tempval1;
-    int j, binNum;
+    uint32_t attempts,tempval, tempval1, telp;
+    uint32_t tx_pkt_counter = 0;
+    bool expired;
+    int binNum;
+    int bin_offset = rtt_config_get()->bin_offset;
+    int bins       = MIN(rtt_config_get()->bins, RTT_NUM_BINS);
 
-    tx_pkt_counter = 0;
     attempts = 0;
 
+    RTT_PROFILER_START(&p_burst->profile);
+
     /* Configure PPI */
     nrf_ppi_config();
 
     /* Initialize the radio */
-    nrf_radio_init();
+    nrf_radio_init(p_link);
 
     /* Configure the timers */
     timer2_capture_init(TIMER2_PRESCALE_VAL);
-    timer4_compare_init();
+    timer4_compare_init(length_us);
+
+    /* Puts zeros into the histogram */
+    memset(p_burst->bins, 0, sizeof p_burst->bins);
+    p_burst->valid        = 0;
+    p_burst->rx_crc_error = 0;
+    p_burst->rx_ignored   = 0;
+    p_burst->rx_timeouts  = 0;
+    p_burst->telemetry.valid = 0;
+    p_burst->bin_offset   = (uint16_t)bin_offset;
+
+    /* Only the responder with this address answers, the others let the requests pass */
+    test_frame[4] = address;
 
-    /* Puts zeros into bincnt */
-    memset(bincnt, 0, sizeof bincnt);
+    /* Responses between bursts are not seen, so a field is not continued across bursts */
+    m_telemetry_next = 0;
 
     /* Wait to make sure radio_002 is ready */
     nrf_delay_us(CATCH_UP_DELAY_US);
 
-    while (!(NRF_TIMER4->EVENTS_COMPARE[0]))
+    RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_SETUP);
+
+    while (!(NRF_TIMER4->EVENTS_COMPARE[0]) && (attempts < max_exchanges))
     {
-        nrf_gpio_pin_set(DATAPIN_4);
+        RTT_TRACE(RTT_TRACE_EXCHANGE_START);
 
         NRF_RADIO->PACKETPTR = (uint32_t) test_frame; /* Switch to tx buffer */
 
@@ -218,6 +288,7 @@ void do_rtt_measurement(void)
         
         NRF_TIMER2->TASKS_STOP = 1;
         NRF_TIMER2->TASKS_CLEAR = 1;
+        NRF_TIMER2->EVENTS_COMPARE[1] = 0;
 
         /* Start Tx */
         NRF_RADIO->EVENTS_READY = 0;
@@ -228,6 +299,14 @@ void do_rtt_measurement(void)
         {
         }
 
+        RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_TX_RAMP_UP);
+
+        if (attempts == 0)
+        {
+            /* Start-up latency of the measurement */
+            NRF_TIMER4->TASKS_CAPTURE[1] = 1;
+        }
+
         NRF_RADIO->EVENTS_END = 0;
         NRF_RADIO->TASKS_START = 1U;
 
@@ -236,20 +315,9 @@ void do_rtt_measurement(void)
         {
         }
 
+        RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_TX);
+
         tx_pkt_counter++;
-        txcntw++;
-        
-        if(txcntw > 50)
-        {
-            txcntw = 0;
-            if(rx_timeouts > 10)
-                // PER>=20pct
-                highper = 1;
-            else
-                highper=0;
-            
-            rx_timeouts = 0;
-        }
 
         /** 
          * Packet sent, switch to Rx asap 
@@ -265,45 +333,68 @@ void do_rtt_measurement(void)
         }
         NRF_RADIO->EVENTS_END = 0U;
 
-        /* Start listening and wait for end event */
+        RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_TURNAROUND);
+
+        /* Start listening and wait for end event or the response timeout */
         NRF_RADIO->TASKS_START = 1U;
-        while ((NRF_RADIO->EVENTS_END == 0) && !(NRF_TIMER4->EVENTS_COMPARE[0]))
+        while ((NRF_RADIO->EVENTS_END == 0) && !(NRF_TIMER4->EVENTS_COMPARE[0]) &&
+               !(NRF_TIMER2->EVENTS_COMPARE[1]))
         {
         }
 
-        if(!(NRF_TIMER4->EVENTS_COMPARE[0]))
+        RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_RX_WAIT);
+
+        expired = (NRF_TIMER4->EVENTS_COMPARE[0] != 0);
+        if (expired)
+        {
+            /* The burst ran out of time, the exchange is not counted */
+            RTT_TRACE(RTT_TRACE_EXCHANGE_EXPIRED);
+        }
+        else if (NRF_RADIO->EVENTS_END == 0)
         {
-            rx_pkt_counter++;
-            if(NRF_RADIO->CRCSTATUS>0)
+            p_burst->rx_timeouts++;
+            RTT_TRACE(RTT_TRACE_EXCHANGE_TIMEOUT);
+        }
+        else if (NRF_RADIO->CRCSTATUS == 0)
+        {
+            p_burst->rx_crc_error++;
+            RTT_TRACE(RTT_TRACE_EXCHANGE_CRC_ERROR);
+        }
+        else
+        {
+            /**
+             * Process the received packet
+             * Check the sequence number in the received packet against our tx packet counter
+             */
+            tempval = ((rx_test_frame[2] << 8) + (rx_test_frame[3]));
+            tempval1 = tx_pkt_counter-1;
+            if(tempval != (tempval1&0x0000FFFF))
+            {
+                p_burst->rx_ignored++;
+                RTT_TRACE(RTT_TRACE_EXCHANGE_IGNORED);
+            }
+            else
             {
-                /**
-                 * Process the received packet
-                 * Check the sequence number in the received packet against our tx packet counter
-                 */
-                rx_pkt_counter_crcok++;
-                tempval = ((rx_test_frame[2] << 8) + (rx_test_frame[3]));
-                tempval1 = tx_pkt_counter-1;
-                if(tempval != (tempval1&0x0000FFFF))
-                {
-                    rx_ignored++;
-                }
-                else
-                {
-                    /* Packet is good, update stats */
-                    NRF_TIMER2->TASKS_STOP = 1;
-                    telp = NRF_TIMER2->CC[0];  
-                    binNum = telp - 4150; /* Magic number to trim away dwell time in device B, etc */
-                    
-                    if((binNum >= 0) && (binNum < NUM_BINS))
-                            bincnt[binNum]++;
-                    
-                    dbptr++;
-                    NRF_TIMER2->TASKS_CLEAR = 1;
-                }
+                /* Packet is good, update stats */
+                NRF_TIMER2->TASKS_STOP = 1;
+                telp = NRF_TIMER2->CC[0];  
+                binNum = telp - bin_offset; /* Trim away dwell time in device B, etc */
+                
+                if((binNum >= 0) && (binNum < bins))
+                        p_burst->bins[binNum]++;
+                
+                p_burst->valid++;
+                RTT_TRACE(RTT_TRACE_EXCHANGE_VALID);
+                NRF_TIMER2->TASKS_CLEAR = 1;
+
+                telemetry_receive(rx_test_frame[4], rx_test_frame[5], p_burst);
             }
         }
 
-        attempts++;
+        if (!expired)
+        {
+            attempts++;
+        }
 
         NRF_RADIO->EVENTS_DISABLED = 0U;
         NRF_RADIO->TASKS_DISABLE = 1U;
@@ -312,32 +403,12 @@ void do_rtt_measurement(void)
         {
         }
 
-        nrf_gpio_pin_clear(DATAPIN_4);
+        RTT_PROFILER_MARK(&p_burst->profile, RTT_PROFILER_PROCESSING);
     }
 
-    dbptr = 0;
-    end_rtt();
+    end_rtt(power_down);
 
-    /* Loading measurements in to database */
-    for(j = 0; j < NUM_BINS; j++)
-    {
-        database[j] = bincnt[j];
-        bincnt[j] = 0;
-    }
-
-    calculated_distance = calc_dist();
-    if (!isnan(calculated_distance) && calculated_distance >= 0) {
-        count_mean++;
-        tot_mean_val += calculated_distance;
-    }
+    p_burst->exchanges = attempts;
 
-    if (count_mean > 100) {
-        float mean_dist = (float) (tot_mean_val/(float)count_mean);
-
-        /* Print the result.*/
-        NRF_LOG_INFO(NRF_LOG_FLOAT_MARKER, NRF_LOG_FLOAT(mean_dist));
-
-        count_mean = 0;
-        tot_mean_val = 0;
-    }
+    return (attempts > 0) ? NRF_TIMER4->CC[1] : length_us;
 }
\ No newline at end of file
@@ -25,8 +25,16 @@
 #ifndef RADIO_001_H
 #define RADIO_001_H
 
-void do_rtt_measurement(void);
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_estimator.h"
+#include "rtt_config.h"
 
-float calc_dist(void);
+#define RTT_EXCHANGES_UNLIMITED UINT32_MAX /* Run exchanges until the measurement length has elapsed */
+
+uint32_t do_rtt_measurement(uint32_t length_us, uint32_t max_exchanges, uint8_t address, rtt_link_t const * p_link,
+                            rtt_burst_t * p_burst, bool power_down);
+
+void radio_power_down(void);
 
 #endif // RADIO_001_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "crc16.h"
+#include "rtt_calibration.h"
+#include "rtt_anchors.h"
+
+STATIC_ASSERT(RTT_CALIBRATION_BLOBS_MAX * RTT_CALIBRATION_BLOB_LEN <= RTT_ANCHORS_PAGE_OFFSET);
+
+static rtt_anchor_t m_anchors[RTT_ANCHORS_MAX];
+static uint32_t     m_anchor_count = 0; /* Valid blobs in m_anchors */
+
+
+uint32_t rtt_anchors_decode(uint8_t const * p_buf, uint16_t len, rtt_anchor_t * p_anchor)
+{
+    if (len != RTT_ANCHORS_BLOB_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (uint32_decode(&p_buf[0]) != RTT_ANCHORS_MAGIC)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_buf[4] != RTT_ANCHORS_VERSION)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (crc16_compute(p_buf, RTT_ANCHORS_CRC_OFFSET, NULL) != uint16_decode(&p_buf[RTT_ANCHORS_CRC_OFFSET]))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    p_anchor->id   = uint32_decode(&p_buf[8]);
+    p_anchor->x_mm = (int32_t)uint32_decode(&p_buf[12]);
+    p_anchor->y_mm = (int32_t)uint32_decode(&p_buf[16]);
+    p_anchor->z_mm = (int32_t)uint32_decode(&p_buf[20]);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t rtt_anchors_init(void)
+{
+    /* The last page of flash, kept out of the application by the linker script */
+    uint8_t const * p_page = (uint8_t const *)((NRF_FICR->CODESIZE - 1) * NRF_FICR->CODEPAGESIZE)
+                           + RTT_ANCHORS_PAGE_OFFSET;
+
+    m_anchor_count = 0;
+    while ((m_anchor_count < RTT_ANCHORS_MAX) &&
+           (rtt_anchors_decode(&p_page[m_anchor_count * RTT_ANCHORS_BLOB_LEN], RTT_ANCHORS_BLOB_LEN,
+                               &m_anchors[m_anchor_count]) == NRF_SUCCESS))
+    {
+        m_anchor_count++;
+    }
+
+    return m_anchor_count;
+}
+
+
+uint32_t rtt_anchors_count(void)
+{
+    return m_anchor_count;
+}
+
+
+rtt_anchor_t const * rtt_anchors_find(uint32_t id)
+{
+    for (uint32_t i = 0; i < m_anchor_count; i++)
+    {
+        if (m_anchors[i].id == id)
+        {
+            return &m_anchors[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_ANCHORS_H__
+#define RTT_ANCHORS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+
+/**@brief Anchor coordinates
+ *
+ * @details The position solver (rtt_position.h) needs the coordinates of every responder it
+ *          ranges with, its anchors. They are surveyed once, written by host/rtt_trilaterate,
+ *          and programmed into the page of flash that holds the calibration (rtt_calibration.h),
+ *          from RTT_ANCHORS_PAGE_OFFSET, as blobs of RTT_ANCHORS_BLOB_LEN bytes, little endian:
+ *
+ *          | Offset | Size | Field                                               |
+ *          |--------|------|-----------------------------------------------------|
+ *          | 0      | 4    | Magic, RTT_ANCHORS_MAGIC                            |
+ *          | 4      | 1    | Format version, RTT_ANCHORS_VERSION                 |
+ *          | 5      | 3    | Reserved, 0                                         |
+ *          | 8      | 4    | id                                                  |
+ *          | 12     | 4    | x, mm, signed                                       |
+ *          | 16     | 4    | y, mm, signed                                       |
+ *          | 20     | 4    | z, mm, signed                                       |
+ *          | 24     | 4    | Reserved, 0                                         |
+ *          | 28     | 2    | CRC-16/CCITT-FALSE of the bytes before it           |
+ *          | 30     | 2    | Reserved, 0xFFFF                                    |
+ *
+ *          Up to RTT_ANCHORS_MAX blobs are stacked, up to the first slot without a valid blob.
+ *          An anchor is the responder whose id, the low 32 bits of its Bluetooth device address,
+ *          is that of the blob. The coordinates are in millimetres in any right-handed frame,
+ *          with z up.
+ */
+typedef struct
+{
+    int32_t  x_mm;
+    int32_t  y_mm;
+    int32_t  z_mm;
+    uint32_t id;   /**< Low 32 bits of the device address of the responder. */
+} rtt_anchor_t;
+
+#define RTT_ANCHORS_MAGIC           0x434E4152UL /**< "RANC" */
+#define RTT_ANCHORS_VERSION         1
+#define RTT_ANCHORS_BLOB_LEN        32
+#define RTT_ANCHORS_CRC_OFFSET      28
+#define RTT_ANCHORS_MAX             8      /**< Blobs read from the page. */
+#define RTT_ANCHORS_PAGE_OFFSET     0x800  /**< Offset of the first blob in the page, after the calibration blobs. */
+
+
+/**@brief Load the anchor blobs from the last page of flash.
+ *
+ * @return Number of anchors found.
+ */
+uint32_t rtt_anchors_init(void);
+
+
+/**@brief Decode and check an anchor blob.
+ *
+ * @retval NRF_SUCCESS              Decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH The length does not match the format.
+ * @retval NRF_ERROR_NOT_FOUND      No blob: wrong magic, or erased flash.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Unknown format version.
+ * @retval NRF_ERROR_INVALID_DATA   Wrong CRC.
+ */
+uint32_t rtt_anchors_decode(uint8_t const * p_buf, uint16_t len, rtt_anchor_t * p_anchor);
+
+
+/**@brief Get the number of anchors loaded.
+ */
+uint32_t rtt_anchors_count(void);
+
+
+/**@brief Get the anchor with an id.
+ *
+ * @param[in] id The low 32 bits of the responder's device address.
+ *
+ * @return The anchor, or NULL if the responder has no coordinates.
+ */
+rtt_anchor_t const * rtt_anchors_find(uint32_t id);
+
+#endif // RTT_ANCHORS_H__
@@ -0,0 +1,121 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "crc16.h"
+#include "rtt_parameters.h"
+#include "rtt_calibration.h"
+
+static rtt_calibration_t m_calibrations[RTT_CALIBRATION_BLOBS_MAX] = {RTT_CALIBRATION_DEFAULT};
+static uint32_t          m_calibration_count = 0; /* Valid blobs in m_calibrations */
+
+
+static float float_decode(uint8_t const * p_buf)
+{
+    uint32_t bits = uint32_decode(p_buf);
+    float    value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+uint32_t rtt_calibration_decode(uint8_t const * p_buf, uint16_t len, rtt_calibration_t * p_calibration)
+{
+    rtt_calibration_t calibration;
+
+    if (len != RTT_CALIBRATION_BLOB_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (uint32_decode(&p_buf[0]) != RTT_CALIBRATION_MAGIC)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_buf[4] != RTT_CALIBRATION_VERSION)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (crc16_compute(p_buf, RTT_CALIBRATION_CRC_OFFSET, NULL) != uint16_decode(&p_buf[RTT_CALIBRATION_CRC_OFFSET]))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    calibration.bin_offset = uint16_decode(&p_buf[6]);
+    calibration.scale_m    = float_decode(&p_buf[8]);
+    calibration.offset_m   = float_decode(&p_buf[12]);
+    calibration.id         = uint32_decode(&p_buf[16]);
+
+    /* Also false for NaN */
+    if (!(calibration.scale_m > 0.0f) || !isfinite(calibration.offset_m))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    *p_calibration = calibration;
+    return NRF_SUCCESS;
+}
+
+
+bool rtt_calibration_init(void)
+{
+    /* The last page of flash, kept out of the application by the linker script */
+    uint8_t const * p_page = (uint8_t const *)((NRF_FICR->CODESIZE - 1) * NRF_FICR->CODEPAGESIZE);
+
+    m_calibration_count = 0;
+    while ((m_calibration_count < RTT_CALIBRATION_BLOBS_MAX) &&
+           (rtt_calibration_decode(&p_page[m_calibration_count * RTT_CALIBRATION_BLOB_LEN], RTT_CALIBRATION_BLOB_LEN,
+                                   &m_calibrations[m_calibration_count]) == NRF_SUCCESS))
+    {
+        m_calibration_count++;
+    }
+
+    return m_calibration_count != 0;
+}
+
+
+rtt_calibration_t const * rtt_calibration_get(void)
+{
+    return &m_calibrations[0];
+}
+
+
+rtt_calibration_t const * rtt_calibration_find(uint32_t id)
+{
+    for (uint32_t i = 0; i < m_calibration_count; i++)
+    {
+        if (m_calibrations[i].id == id)
+        {
+            return &m_calibrations[i];
+        }
+    }
+
+    return rtt_calibration_get();
+}
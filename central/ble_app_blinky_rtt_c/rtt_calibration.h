@@ -0,0 +1,123 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_CALIBRATION_H__
+#define RTT_CALIBRATION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+
+/**@brief Calibration of the distance estimate
+ *
+ * @details calc_dist turns the mean bin of a burst histogram into a distance with
+ *          distance = scale_m * (mean bin + burst bin_offset - bin_offset) - offset_m,
+ *          so the estimate stays right when the configuration trims a different bin_offset
+ *          than the one calibrated for.
+ *
+ *          The calibration of a board pair is fitted on the host from bursts recorded at
+ *          surveyed distances (host/rtt_calibrate) and programmed into the last page of flash
+ *          as a blob of RTT_CALIBRATION_BLOB_LEN bytes, little endian:
+ *
+ *          | Offset | Size | Field                                               |
+ *          |--------|------|-----------------------------------------------------|
+ *          | 0      | 4    | Magic, RTT_CALIBRATION_MAGIC                        |
+ *          | 4      | 1    | Format version, RTT_CALIBRATION_VERSION             |
+ *          | 5      | 1    | Reserved, 0                                         |
+ *          | 6      | 2    | bin_offset                                          |
+ *          | 8      | 4    | scale_m, IEEE 754 single precision                  |
+ *          | 12     | 4    | offset_m, IEEE 754 single precision                 |
+ *          | 16     | 4    | id                                                  |
+ *          | 20     | 4    | Time of the fit, seconds since 1970                 |
+ *          | 24     | 2    | RMS residual of the fit, mm                         |
+ *          | 26     | 2    | Reserved, 0                                         |
+ *          | 28     | 2    | CRC-16/CCITT-FALSE of the bytes before it           |
+ *          | 30     | 2    | Reserved, 0xFFFF                                    |
+ *
+ *          Without a valid blob the defaults below are used, which are the constants the
+ *          estimator was built with before.
+ *
+ *          Every responder ranged with needs its own calibration. Up to
+ *          RTT_CALIBRATION_BLOBS_MAX blobs are stacked from the start of the page, up to the
+ *          first slot without a valid blob. A responder uses the blob whose id is the low 32 bits
+ *          of its Bluetooth device address, and otherwise the first blob. The coordinates of the
+ *          anchors follow later in the page, see rtt_anchors.h.
+ */
+typedef struct
+{
+    float    scale_m;    /**< Metres of distance for each tick of the round trip. */
+    float    offset_m;   /**< Subtracted from the scaled round trip. */
+    uint16_t bin_offset; /**< Round trip ticks trimmed away before binning, the responder dwell time. */
+    uint32_t id;         /**< Low 32 bits of the device address of the responder calibrated with, or chosen by the fitter. */
+} rtt_calibration_t;
+
+#define RTT_CALIBRATION_MAGIC       0x4C414352UL /**< "RCAL" */
+#define RTT_CALIBRATION_VERSION     1
+#define RTT_CALIBRATION_BLOB_LEN    32
+#define RTT_CALIBRATION_CRC_OFFSET  28
+#define RTT_CALIBRATION_BLOBS_MAX   8  /**< Blobs read from the page. */
+
+/**@brief Calibration found by linear regression, used without a valid blob
+ */
+#define RTT_CALIBRATION_DEFAULT                             \
+{                                                           \
+    .scale_m    = 0.5f * 18.737f,                           \
+    .offset_m   = 69.96f,                                   \
+    .bin_offset = RTT_DEFAULT_BIN_OFFSET,                   \
+    .id         = 0                                         \
+}
+
+
+/**@brief Load the calibration blobs from the last page of flash.
+ *
+ * @return True if a valid blob was found, else the defaults are in use.
+ */
+bool rtt_calibration_init(void);
+
+
+/**@brief Decode and check a calibration blob.
+ *
+ * @retval NRF_SUCCESS              Decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH The length does not match the format.
+ * @retval NRF_ERROR_NOT_FOUND      No blob: wrong magic, or erased flash.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Unknown format version.
+ * @retval NRF_ERROR_INVALID_DATA   Wrong CRC, or a scale that is not positive.
+ */
+uint32_t rtt_calibration_decode(uint8_t const * p_buf, uint16_t len, rtt_calibration_t * p_calibration);
+
+
+/**@brief Get the calibration of the first blob, or the defaults without a valid blob.
+ */
+rtt_calibration_t const * rtt_calibration_get(void);
+
+
+/**@brief Get the calibration with an id.
+ *
+ * @param[in] id Id of the calibration, the low 32 bits of the responder's device address.
+ *
+ * @return The calibration with the id, else rtt_calibration_get().
+ */
+rtt_calibration_t const * rtt_calibration_find(uint32_t id);
+
+#endif // RTT_CALIBRATION_H__
@@ -0,0 +1,305 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ble.h"
+#include "ble_gap.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "app_timer.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_log.h"
+#include "rtt_conn_params.h"
+#include "rtt_parameters.h"
+#include "timeslot.h"
+
+/* Parameters of one link, indexed by connection handle */
+typedef struct
+{
+    bool                  connected;
+    ble_gap_conn_params_t normal_params;  /* Parameters of the link outside ranging mode */
+    ble_gap_conn_params_t current_params; /* Parameters currently in use by the link */
+} link_t;
+
+static link_t                m_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];
+static bool                  m_ranging     = false;     /* Ranging mode requested */
+
+/* Timeslot grant counters at the last parameter change */
+static uint32_t              m_requests_start;
+static uint32_t              m_grants_start;
+static uint32_t              m_ticks_start;
+
+static ble_gap_conn_params_t const m_ranging_params =
+{
+    .min_conn_interval = (uint16_t)RANGING_MIN_CONNECTION_INTERVAL,
+    .max_conn_interval = (uint16_t)RANGING_MAX_CONNECTION_INTERVAL,
+    .slave_latency     = RANGING_SLAVE_LATENCY,
+    .conn_sup_timeout  = (uint16_t)RANGING_SUPERVISION_TIMEOUT
+};
+
+NRF_SDH_BLE_OBSERVER(m_rtt_conn_params_obs, RTT_CONN_PARAMS_BLE_OBSERVER_PRIO, rtt_conn_params_on_ble_evt, NULL);
+
+/**@brief Restart the grant rate measurement.
+ */
+static void grant_measurement_start(void)
+{
+    timeslot_grant_stats_get(&m_requests_start, &m_grants_start);
+    m_ticks_start = app_timer_cnt_get();
+}
+
+
+/**@brief Log the timeslot grant rate measured under the parameters used until now.
+ *
+ * @param[in] p_link Link whose parameters are changing.
+ */
+static void grant_measurement_report(link_t const * p_link)
+{
+    uint32_t requests;
+    uint32_t grants;
+    uint32_t elapsed_ms;
+    uint32_t grant_pct;
+
+    timeslot_grant_stats_get(&requests, &grants);
+    requests  -= m_requests_start;
+    grants    -= m_grants_start;
+    elapsed_ms = (uint32_t)(((uint64_t)app_timer_cnt_diff_compute(app_timer_cnt_get(), m_ticks_start) * 1000UL) /
+                            APP_TIMER_CLOCK_FREQ);
+
+    if ((requests == 0) || (elapsed_ms == 0))
+    {
+        return;
+    }
+
+    grant_pct = (grants * 100UL) / requests;
+
+    NRF_LOG_INFO("Interval %u x 1.25 ms, latency %u: %u of %u timeslots granted (%u %%) in %u ms.",
+                 p_link->current_params.max_conn_interval, p_link->current_params.slave_latency,
+                 grants, requests, grant_pct, elapsed_ms);
+}
+
+
+/**@brief Enable or disable connection event extension.
+ *
+ * @details With extension disabled, a connection event ends after the minimum exchange
+ *          instead of running to the end of the configured event length.
+ */
+static void conn_evt_ext_set(bool enable)
+{
+    ble_opt_t opt;
+
+    memset(&opt, 0, sizeof(opt));
+    opt.common_opt.conn_evt_ext.enable = enable ? 1 : 0;
+
+    ret_code_t err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Check whether any link is connected.
+ */
+static bool links_connected(void)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_links); i++)
+    {
+        if (m_links[i].connected)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**@brief Request the given parameters unless the link already uses them.
+ */
+static uint32_t conn_params_request(uint16_t conn_handle, ble_gap_conn_params_t const * p_params)
+{
+    link_t const * p_link = &m_links[conn_handle];
+
+    if ((p_link->current_params.max_conn_interval >= p_params->min_conn_interval) &&
+        (p_link->current_params.max_conn_interval <= p_params->max_conn_interval) &&
+        (p_link->current_params.slave_latency     == p_params->slave_latency))
+    {
+        return NRF_SUCCESS;
+    }
+
+    return sd_ble_gap_conn_param_update(conn_handle, (ble_gap_conn_params_t *)p_params);
+}
+
+
+#if RANGING_CONN_PARAMS_ENABLED
+/**@brief Request the parameters of the current mode on every link.
+ *
+ * @return The first error, after trying every link.
+ */
+static uint32_t links_update(void)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    for (uint16_t conn_handle = 0; conn_handle < ARRAY_SIZE(m_links); conn_handle++)
+    {
+        uint32_t err_code;
+
+        if (!m_links[conn_handle].connected)
+        {
+            continue;
+        }
+
+        err_code = conn_params_request(conn_handle, m_ranging ? &m_ranging_params : &m_links[conn_handle].normal_params);
+        if (result == NRF_SUCCESS)
+        {
+            result = err_code;
+        }
+    }
+
+    return result;
+}
+#endif
+
+
+uint32_t rtt_conn_params_ranging_enter(void)
+{
+    if (!links_connected())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (m_ranging)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_ranging = true;
+
+#if RANGING_CONN_PARAMS_ENABLED
+    conn_evt_ext_set(false);
+    return links_update();
+#else
+    return NRF_SUCCESS;
+#endif
+}
+
+
+uint32_t rtt_conn_params_ranging_exit(void)
+{
+    if (!m_ranging)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_ranging = false;
+
+    if (!links_connected())
+    {
+        return NRF_SUCCESS;
+    }
+
+#if RANGING_CONN_PARAMS_ENABLED
+    conn_evt_ext_set(true);
+    return links_update();
+#else
+    return NRF_SUCCESS;
+#endif
+}
+
+
+bool rtt_conn_params_ranging_active(void)
+{
+    return m_ranging;
+}
+
+
+void rtt_conn_params_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ret_code_t                    err_code;
+    ble_gap_evt_t const         * p_gap_evt = &p_ble_evt->evt.gap_evt;
+    ble_gap_conn_params_t const * p_reply;
+    link_t                      * p_link;
+
+    /* Only events of a link are handled, with a handle below the link count */
+    if (p_gap_evt->conn_handle >= ARRAY_SIZE(m_links))
+    {
+        return;
+    }
+    p_link = &m_links[p_gap_evt->conn_handle];
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_link->connected      = true;
+            p_link->current_params = p_gap_evt->params.connected.conn_params;
+            p_link->normal_params  = p_link->current_params;
+            grant_measurement_start();
+#if RANGING_CONN_PARAMS_ENABLED
+            if (m_ranging)
+            {
+                (void)conn_params_request(p_gap_evt->conn_handle, &m_ranging_params);
+            }
+#endif
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            p_link->connected = false;
+            if (m_ranging && !links_connected())
+            {
+                m_ranging = false;
+#if RANGING_CONN_PARAMS_ENABLED
+                conn_evt_ext_set(true);
+#endif
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            grant_measurement_report(p_link);
+
+            p_link->current_params = p_gap_evt->params.conn_param_update.conn_params;
+            if (!m_ranging)
+            {
+                p_link->normal_params = p_link->current_params;
+            }
+
+            grant_measurement_start();
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+            // Accept parameters requested by peer, unless ranging.
+            p_reply = &p_gap_evt->params.conn_param_update_request.conn_params;
+#if RANGING_CONN_PARAMS_ENABLED
+            if (m_ranging)
+            {
+                p_reply = &m_ranging_params;
+            }
+#endif
+            err_code = sd_ble_gap_conn_param_update(p_gap_evt->conn_handle, (ble_gap_conn_params_t *)p_reply);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
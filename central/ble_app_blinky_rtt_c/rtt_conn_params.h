@@ -0,0 +1,80 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_CONN_PARAMS_H__
+#define RTT_CONN_PARAMS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "nrf_sdh_ble.h"
+
+#define RTT_CONN_PARAMS_BLE_OBSERVER_PRIO 3
+
+/**@brief Ranging-aware connection parameter handling
+ *
+ * @details Every connection event takes radio time from the timeslot sessions. While ranging,
+ *          the link is moved to a long connection interval with slave latency and without
+ *          connection event extension. The parameters the link had before ranging are restored
+ *          afterwards. Connection parameter update requests from the peer are answered with
+ *          the parameters of the current mode.
+ *
+ *          The mode applies to all links. A link connected while ranging is moved to the
+ *          ranging parameters at once.
+ *
+ *          The timeslot grant rate is logged each time the link changes parameters, so the
+ *          cost of each setting on the ranging can be compared.
+ */
+
+
+/**@brief Function for handling BLE events.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ * @param[in] p_context  Unused.
+ */
+void rtt_conn_params_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Switch the links to the ranging connection parameters.
+ *
+ * @retval NRF_SUCCESS             The parameter updates were requested, or are not needed.
+ * @retval NRF_ERROR_INVALID_STATE Not connected.
+ * @retval err_code                Otherwise, the first error returned by sd_ble_gap_conn_param_update.
+ */
+uint32_t rtt_conn_params_ranging_enter(void);
+
+
+/**@brief Restore the connection parameters the links had before ranging.
+ *
+ * @retval NRF_SUCCESS             The parameter updates were requested, or are not needed.
+ * @retval err_code                Otherwise, the first error returned by sd_ble_gap_conn_param_update.
+ */
+uint32_t rtt_conn_params_ranging_exit(void);
+
+
+/**@brief Check whether the links are in ranging mode.
+ */
+bool rtt_conn_params_ranging_active(void);
+
+#endif // RTT_CONN_PARAMS_H__
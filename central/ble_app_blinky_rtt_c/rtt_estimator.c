@@ -0,0 +1,70 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "rtt_estimator.h"
+#include "rtt_parameters.h"
+
+#define DATABASE               0x20001000 /* Base address for measurement database */
+
+#if RTT_ESTIMATOR_DATABASE_ENABLED
+static uint32_t database[RTT_NUM_BINS] __attribute__((section(".ARM.__at_DATABASE")));
+#endif
+
+/**
+ * @brief Calculates and returns distance in meters
+ * 
+ * @param[in] p_burst       Burst histogram
+ * @param[in] p_calibration Scale, offset and the bin offset they were fitted with
+ *
+ * @return Distance [m]
+ * 
+ * The histogram is kept in the measurement database until the next call, if
+ * RTT_ESTIMATOR_DATABASE_ENABLED. The estimate itself only reads the burst.
+ */
+float calc_dist(rtt_burst_t const * p_burst, rtt_calibration_t const * p_calibration)
+{
+    float val = 0;
+    int sum = 0;
+
+#if RTT_ESTIMATOR_DATABASE_ENABLED
+    /* Loading measurements in to database */
+    for(int i = 0; i < RTT_NUM_BINS; i++)
+    {
+        database[i] = p_burst->bins[i];
+    }
+#endif
+
+    for(int i = 0; i < RTT_NUM_BINS; i++)
+    {
+        val += p_burst->bins[i]*(i+1);
+        sum += p_burst->bins[i];
+    }
+    val = val/sum;
+
+    /* Back to the bin offset of the calibration, if the burst trimmed a different one */
+    val += (float)((int32_t)p_burst->bin_offset - (int32_t)p_calibration->bin_offset);
+    val = p_calibration->scale_m*val - p_calibration->offset_m;
+    return val;
+}
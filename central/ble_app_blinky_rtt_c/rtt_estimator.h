@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_ESTIMATOR_H__
+#define RTT_ESTIMATOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_telemetry.h"
+#include "rtt_profiler.h"
+#include "rtt_calibration.h"
+
+#define RTT_NUM_BINS 128 /* Number of bins in the RTT histogram */
+
+/**@brief Raw result of one burst of RTT exchanges
+ *
+ * @details Bin i counts the exchanges whose round trip, after the responder dwell time is
+ *          trimmed away, took i ticks of the 16 MHz capture timer.
+ */
+typedef struct
+{
+    uint32_t        exchanges;          /**< Number of exchanges attempted, not counting one cut short by the end of the burst. */
+    uint32_t        valid;              /**< Number of responses with the expected sequence number. */
+    uint32_t        rx_crc_error;       /**< Number of responses received with a CRC error. */
+    uint32_t        rx_ignored;         /**< Number of responses with a valid CRC and an unexpected sequence number. */
+    uint32_t        rx_timeouts;        /**< Number of exchanges without a response. */
+    uint32_t        timestamp;          /**< Time the burst ended, in ticks of the 32768 Hz RTC. */
+    uint16_t        bin_offset;         /**< Round trip ticks trimmed away before binning. */
+    uint8_t         peer;               /**< Responder ranged with, the index of its link. */
+    bool            single_shot;        /**< Run for a single-shot request, outside the schedule. */
+    uint16_t        bins[RTT_NUM_BINS]; /**< Round trip histogram. */
+    rtt_telemetry_t telemetry;          /**< Responder telemetry fields completed during the burst. */
+#if RTT_PROFILER_ENABLED
+    rtt_profile_t   profile;            /**< Time spent in each phase of the exchanges. */
+#endif
+} rtt_burst_t;
+
+
+/**@brief Calculates the distance measured by a burst
+ *
+ * @param[in] p_burst       Burst histogram
+ * @param[in] p_calibration Calibration of the board pair, see rtt_calibration.h
+ *
+ * @return Distance [m], NAN if the histogram is empty
+ */
+float calc_dist(rtt_burst_t const * p_burst, rtt_calibration_t const * p_calibration);
+
+#endif // RTT_ESTIMATOR_H__
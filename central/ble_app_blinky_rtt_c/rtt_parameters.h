@@ -22,30 +22,104 @@
  * SOFTWARE.
  */
 
-#define DATAPIN_1 NRF_GPIO_PIN_MAP(1, 1)  /* Debug pin 1 */
-#define DATAPIN_2 NRF_GPIO_PIN_MAP(1, 3)  /* Debug pin 2 */
-#define DATAPIN_3 NRF_GPIO_PIN_MAP(1, 10) /* Debug pin 3 */
-#define DATAPIN_4 NRF_GPIO_PIN_MAP(1, 12) /* Debug pin 4 */
-
 /* BLE defines */
 #define SCAN_INTERVAL                   0x00A0                              /**< Determines scan interval in units of 0.625 millisecond. */
 #define SCAN_WINDOW                     0x0050                              /**< Determines scan window in units of 0.625 millisecond. */
 #define SCAN_DURATION                   0x0000                              /**< Timout when scanning. 0x0000 disables timeout. */
 
-#define MIN_CONNECTION_INTERVAL         MSEC_TO_UNITS(7.5, UNIT_1_25_MS)    /**< Determines minimum connection interval in milliseconds. */
-#define MAX_CONNECTION_INTERVAL         MSEC_TO_UNITS(30, UNIT_1_25_MS)     /**< Determines maximum connection interval in milliseconds. */
+#define MIN_CONNECTION_INTERVAL         MSEC_TO_UNITS(15, UNIT_1_25_MS)     /**< Determines minimum connection interval in milliseconds. */
+#define MAX_CONNECTION_INTERVAL         MSEC_TO_UNITS(15, UNIT_1_25_MS)     /**< Determines maximum connection interval in milliseconds. A single-shot request waits for up to two intervals. */
 #define SLAVE_LATENCY                   0                                   /**< Determines slave latency in terms of connection events. */
 #define SUPERVISION_TIMEOUT             MSEC_TO_UNITS(4000, UNIT_10_MS)     /**< Determines supervision time-out in units of 10 milliseconds. */
 
+/* Connection parameters while ranging. Within the responder's preferred 15-200 ms so it does not request them back. */
+#define RANGING_CONN_PARAMS_ENABLED     1                                   /**< Renegotiate the connection when ranging starts. Set to 0 to only measure grant rate. */
+#define RANGING_MIN_CONNECTION_INTERVAL MSEC_TO_UNITS(200, UNIT_1_25_MS)    /**< Minimum connection interval while ranging. */
+#define RANGING_MAX_CONNECTION_INTERVAL MSEC_TO_UNITS(200, UNIT_1_25_MS)    /**< Maximum connection interval while ranging. */
+#define RANGING_SLAVE_LATENCY           4                                   /**< Slave latency while ranging. */
+#define RANGING_SUPERVISION_TIMEOUT     SUPERVISION_TIMEOUT                 /**< Supervision time-out while ranging. Must exceed 2 * (1 + latency) * interval. */
+
 /* Timeslot API defines */
 #define TS_TOT_EXT_LENGTH_US    (1000000UL) /* Desired total timeslot length */
-#define TS_LEN_US               (10000UL)   /* Initial timeslot length */
-#define TS_LEN_EXTENSION_US     TS_LEN_US   /* Extension timeslot length */
+#define TS_LEN_US               (10000UL)   /* Default initial and extension timeslot length in continuous ranging */
 #define TS_SAFETY_MARGIN_US     (250UL)     /* The timeslot activity should be finished with this much to spare. */
 #define TS_EXTEND_MARGIN_US     (500UL)     /* The timeslot activity should request an extension this long before end of timeslot. */
 
+/* Ranging schedule defines */
+#define TS_DEFAULT_RATE_HZ      (10UL)      /* Default burst rate. A rate of 0 selects continuous extension bursts. */
+#define TS_DEFAULT_EXCHANGES    (16UL)      /* Default number of exchanges in each burst */
+#define TS_MAX_RATE_HZ          (50UL)      /* Highest burst rate accepted by the scheduler */
+#define TS_MAX_EXCHANGES        (128UL)     /* Highest number of exchanges per burst accepted by the scheduler */
+#define TS_BURST_END_MARGIN_US  (500UL)     /* Default time a scheduled burst should finish its exchanges before the timeslot ends. */
+#define TS_SINGLE_SHOT_TIMEOUT_US (20000UL) /* A single-shot burst not granted within this time is given up */
+#define RTT_EXCHANGE_US         (600UL)     /* Approximate duration of one exchange: Tx ramp-up and packet, Rx ramp-up and response */
+#define RATE_REPORT_INTERVAL_MS (5000UL)    /* Interval between reports of achieved ranging rate */
+#define RTT_BURST_QUEUE_SIZE    8           /* Number of burst histograms waiting for the main loop. Must be a power of two. */
+
+/* Power policy defines. Currents are nRF52840 datasheet figures at 3 V with the LDO, used to estimate the average current. */
+#define TS_DEFAULT_POWER_POLICY TIMESLOT_POWER_POLICY_AUTO /* Clock and radio power policy, see timeslot_power_policy_t */
+#define POWER_HFXO_STARTUP_US   (360UL)     /* HFXO start-up time when started by the SoftDevice for a timeslot */
+#define POWER_HFXO_UA           (250UL)     /* HFXO running */
+#define POWER_RADIO_UA          (10700UL)   /* Radio, mean of Tx at +8 dBm (14.8 mA) and Rx at 2 Mbps (6.6 mA) */
+#define POWER_CPU_UA            (3300UL)    /* CPU running from flash, busy waiting during a burst */
+
+/* Multi-responder defines */
+#define RTT_PEERS_MAX           (4U)        /* Responders ranged with at the same time. Must not exceed NRF_SDH_BLE_CENTRAL_LINK_COUNT. */
+#define RTT_PEERS_FRAME_MAX     (16U)       /* Longest TDMA frame of bursts shared between the responders */
+#define RTT_PEERS_DEFAULT_POLICY RTT_PEERS_POLICY_ROUND_ROBIN /* How the bursts are shared, see rtt_peers_policy_t */
+#define RTT_LINK_PER_CONNECTION_ENABLED 1   /* Give every connection its own access address and channel. 0 ranges with all on RADIO_DEFAULT_ACCESS_ADDRESS. */
+#define RTT_LINK_RENEWALS_MAX   (4U)        /* Links drawn again for a responder that serves another initiator on the one written */
+
+/* Ranging session defines */
+#define RTT_SESSION_DEFAULT_AVERAGING (100UL) /* Default number of bursts with a valid distance averaged into each result */
+#define RTT_SESSION_DEFAULT_RESULTS   (0UL)   /* Default number of results after which a session stops. 0 runs until stopped. */
+
+/* Result streaming defines */
+#define RESULTS_FLUSH_INTERVAL_MS     (100UL) /* A partly filled result batch is written after this long */
+
+/* Binary stream defines. The stream takes the UART of the board's virtual COM port. */
+#define STREAM_TX_PIN                 NRF_GPIO_PIN_MAP(0, 6)      /* UART TX pin */
+#define STREAM_BAUDRATE               NRF_UARTE_BAUDRATE_1000000  /* UART baud rate */
+#define STREAM_BUFFER_SIZE            2048    /* Encoded frames waiting for the UART. Must be a power of two. */
+
+/* Radio defines. Defaults of the runtime configuration in rtt_config.h, which must match the responder. */
+#define RADIO_DEFAULT_CHANNEL       (78U)   /* Radio channel, 2478 MHz */
+#define RADIO_DEFAULT_TX_POWER_DBM  (8)     /* Radio output power */
+#define RADIO_DEFAULT_ACCESS_ADDRESS (0x71764129UL) /* Access address of links without their own */
+
+/* Profiler defines */
+#define RTT_PROFILER_ENABLED    0           /* Time the phases of every exchange with the DWT cycle counter, see rtt_profiler.h */
+
+/* Estimator defines */
+#ifndef RTT_ESTIMATOR_DATABASE_ENABLED
+#define RTT_ESTIMATOR_DATABASE_ENABLED 1    /* Keep the last histogram in the measurement database for the debugger. Host tools turn it off, calc_dist is then reentrant. */
+#endif
+
+/* Positioning defines, see rtt_position.h */
+#define RTT_POSITION_ENABLED    1           /* Solve the position from the distances to anchors with coordinates in flash */
+#ifndef RTT_POSITION_FIXED_POINT_ENABLED
+#define RTT_POSITION_FIXED_POINT_ENABLED 0  /* Solve in integers instead of single precision floats, for a CPU without an FPU. Host tools build both. */
+#endif
+#define RTT_POSITION_DEFAULT_DIMENSIONS (2U)    /* 2 solves x and y at the initiator's height, 3 also z */
+#define RTT_POSITION_DEFAULT_TAG_Z_MM   (1000)  /* Height of the initiator in 2D, and the first guess of it in 3D */
+#define RTT_POSITION_DEFAULT_SIGMA_MM   (500U)  /* Standard deviation of the distance of a burst with every exchange valid */
+#define RTT_POSITION_DEFAULT_MAX_AGE_MS (2000U) /* Distances older than this are left out */
+#define RTT_POSITION_ITERATIONS_MAX     (5U)    /* Gauss-Newton iterations of one update, bounds its time */
+#define RTT_POSITION_STEP_MIN_MM        (10)    /* The iterations stop at a step shorter than this */
+
+/* Trace defines */
+#define RTT_TRACE_ENABLED       1           /* Write timeslot and exchange events to a ring in RAM, see rtt_trace.h */
+#define RTT_TRACE_SIZE          (512UL)     /* Events in the ring. Must be a power of two. */
+
 /* RTT defines */
-#define DO_RTT_END_MARGIN_US    1000UL + TS_EXTEND_MARGIN_US /* The RTT measurements should stop this long before the timeslot extend margin */
-#define DO_RTT_LENGTH_US        TS_LEN_US - DO_RTT_END_MARGIN_US /* The duration of the RTT measurements */
+#define DO_RTT_END_MARGIN_US    (1000UL + TS_EXTEND_MARGIN_US) /* The RTT measurements should stop this long before the timeslot extend margin */
 #define CATCH_UP_DELAY_US       100
-#define TIMEOUT_IT              256
\ No newline at end of file
+#define RTT_RX_TIMEOUT_US       (400UL)     /* An exchange without a response is given up this long after the request was sent */
+#define RTT_DEFAULT_BINS        (128U)      /* Default number of histogram bins in use, at most RTT_NUM_BINS */
+#define RTT_DEFAULT_BIN_OFFSET  (4150U)     /* Default round trip ticks trimmed away before binning: responder dwell time, etc */
+
+/* The duration of the RTT measurements in a continuous ranging timeslot of the given length */
+#define DO_RTT_LENGTH_US(slot_us)           ((slot_us) - DO_RTT_END_MARGIN_US)
+
+/* Length of a scheduled timeslot carrying n exchanges */
+#define TS_BURST_LENGTH_US(n, margin_us)    (CATCH_UP_DELAY_US + (n) * RTT_EXCHANGE_US + (margin_us))
\ No newline at end of file
@@ -0,0 +1,355 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+#include "rtt_config.h"
+#include "rtt_peers.h"
+
+STATIC_ASSERT(RTT_PEERS_FRAME_MAX <= RTT_CONFIG_PERIOD_MAX);
+
+typedef struct
+{
+    bool                      connected;
+    uint32_t                  id;            /* Low 32 bits of the responder's device address */
+    uint8_t                   weight;        /* Share of the bursts asked for */
+    uint8_t                   period_bursts; /* Period of its bursts in the last frame built */
+    rtt_link_t                link;          /* Radio link of the connection */
+    rtt_calibration_t const * p_calibration;
+} peer_t;
+
+static peer_t m_peers[RTT_PEERS_MAX];
+
+
+#if RTT_LINK_PER_CONNECTION_ENABLED
+/**@brief Mix the bits of a 32-bit value, the finalizer of MurmurHash3.
+ */
+static uint32_t mix(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x85EBCA6BUL;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35UL;
+    value ^= value >> 16;
+
+    return value;
+}
+
+
+/**@brief Check whether an access address can be the link of a connection.
+ */
+static bool link_access_address_is_valid(uint32_t access_address)
+{
+    return (access_address != RTT_CONFIG_ACCESS_ADDRESS_DEFAULT) &&
+           (access_address != RADIO_DEFAULT_ACCESS_ADDRESS) &&
+           rtt_config_access_address_is_valid(access_address);
+}
+
+
+/**@brief Derive the part of the link shared by all initiators of a responder.
+ *
+ * @details A responder serves several initiators on the same channel, and on access addresses
+ *          that only differ in the top octet, see rtt_initiators.h on the responder. The low
+ *          three octets and the hop seed are therefore derived from the responder's id, and
+ *          every initiator gets the same. The base is one that at least two top octets make
+ *          valid, so a link can always be renewed.
+ */
+static void link_base_get(uint32_t id, uint32_t * p_base, uint8_t * p_hop_seed)
+{
+    uint32_t hash = mix(id);
+    uint32_t base;
+    uint32_t valid;
+
+    do
+    {
+        hash  = mix(hash + 0x9E3779B9UL);
+        base  = hash & 0x00FFFFFFUL;
+        valid = 0;
+        for (uint32_t prefix = 0; (prefix <= 0xFF) && (valid < 2); prefix++)
+        {
+            if (link_access_address_is_valid((prefix << 24) | base))
+            {
+                valid++;
+            }
+        }
+    } while (valid < 2);
+
+    *p_base     = base;
+    *p_hop_seed = (uint8_t)(1 + (hash >> 24) % 255);
+}
+
+
+/**@brief Draw the top octet of the access address of a connection's link.
+ *
+ * @details The octet comes from the SoftDevice's random number generator. When its pool is
+ *          empty it is mixed from the device id and a counter, which still differs between
+ *          initiators and between connections.
+ */
+static void link_generate(uint32_t id, rtt_link_t * p_link)
+{
+    static uint32_t counter = 0;
+    uint32_t        base;
+    uint8_t         hop_seed;
+    uint8_t         prefix;
+    uint32_t        access_address;
+
+    link_base_get(id, &base, &hop_seed);
+
+    do
+    {
+        if (sd_rand_application_vector_get(&prefix, sizeof(prefix)) != NRF_SUCCESS)
+        {
+            counter++;
+            prefix = (uint8_t)(mix(NRF_FICR->DEVICEID[0] ^ id) + counter * 167UL);
+        }
+        access_address = ((uint32_t)prefix << 24) | base;
+    } while (!link_access_address_is_valid(access_address) ||
+             (access_address == p_link->access_address));
+
+    p_link->access_address = access_address;
+    p_link->hop_seed       = hop_seed;
+}
+#endif
+
+
+uint32_t rtt_peers_add(uint8_t peer, uint32_t id)
+{
+    if (peer >= RTT_PEERS_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_peers[peer].connected     = true;
+    m_peers[peer].id            = id;
+    m_peers[peer].weight        = 1;
+    m_peers[peer].period_bursts = 1;
+    m_peers[peer].p_calibration = rtt_calibration_find(id);
+
+    memset(&m_peers[peer].link, 0, sizeof(m_peers[peer].link));
+#if RTT_LINK_PER_CONNECTION_ENABLED
+    link_generate(id, &m_peers[peer].link);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+
+void rtt_peers_remove(uint8_t peer)
+{
+    if (peer < RTT_PEERS_MAX)
+    {
+        m_peers[peer].connected = false;
+    }
+}
+
+
+bool rtt_peers_is_connected(uint8_t peer)
+{
+    return (peer < RTT_PEERS_MAX) && m_peers[peer].connected;
+}
+
+
+uint32_t rtt_peers_link_renew(uint8_t peer)
+{
+    if ((peer >= RTT_PEERS_MAX) || !m_peers[peer].connected)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+#if RTT_LINK_PER_CONNECTION_ENABLED
+    link_generate(m_peers[peer].id, &m_peers[peer].link);
+    return NRF_SUCCESS;
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
+uint32_t rtt_peers_count(void)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < RTT_PEERS_MAX; i++)
+    {
+        count += m_peers[i].connected ? 1 : 0;
+    }
+
+    return count;
+}
+
+
+uint32_t rtt_peers_weight_set(uint8_t peer, uint8_t weight)
+{
+    if (!rtt_peers_is_connected(peer) || (weight == 0) || (weight > RTT_CONFIG_WEIGHT_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_peers[peer].weight = weight;
+
+    return NRF_SUCCESS;
+}
+
+
+uint8_t rtt_peers_weight_get(uint8_t peer)
+{
+    return m_peers[peer].weight;
+}
+
+
+/**@brief Take the bursts offset, offset + period, ... of the frame if they are all free.
+ *
+ * @return True if the bursts were free and are now taken by the peer.
+ */
+static bool frame_place(uint8_t * p_frame, bool * p_used, uint32_t len, uint32_t period,
+                        uint32_t offset, uint8_t peer)
+{
+    for (uint32_t i = offset; i < len; i += period)
+    {
+        if (p_used[i])
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = offset; i < len; i += period)
+    {
+        p_frame[i] = peer;
+        p_used[i]  = true;
+    }
+
+    return true;
+}
+
+
+uint32_t rtt_peers_frame_build(rtt_peers_policy_t policy, timeslot_schedule_t * p_schedule)
+{
+    uint8_t  order[RTT_PEERS_MAX];  /* Connected peers, largest weight first */
+    uint8_t  weights[RTT_PEERS_MAX];
+    uint8_t  frame[RTT_PEERS_FRAME_MAX];
+    bool     used[RTT_PEERS_FRAME_MAX];
+    uint32_t count = 0;
+    uint32_t len   = 0;
+
+    for (uint8_t peer = 0; peer < RTT_PEERS_MAX; peer++)
+    {
+        uint32_t i;
+
+        if (!m_peers[peer].connected)
+        {
+            continue;
+        }
+
+        weights[peer] = (policy == RTT_PEERS_POLICY_WEIGHTED) ? m_peers[peer].weight : 1;
+        len          += weights[peer];
+
+        for (i = count; (i > 0) && (weights[order[i - 1]] < weights[peer]); i--)
+        {
+            order[i] = order[i - 1];
+        }
+        order[i] = peer;
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (len > RTT_PEERS_FRAME_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* The most frequent responders are placed first, while there is most room */
+    memset(used, 0, sizeof(used));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t  peer   = order[i];
+        uint32_t period = len / weights[peer];
+        uint32_t offset;
+
+        if ((len % weights[peer]) != 0)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        for (offset = 0; offset < period; offset++)
+        {
+            if (frame_place(frame, used, len, period, offset, peer))
+            {
+                break;
+            }
+        }
+        if (offset == period)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_peers[order[i]].period_bursts = (uint8_t)(len / weights[order[i]]);
+    }
+
+    p_schedule->frame_len = (uint8_t)len;
+    memcpy(p_schedule->frame, frame, len);
+
+    return NRF_SUCCESS;
+}
+
+
+uint8_t rtt_peers_period_get(uint8_t peer)
+{
+    return m_peers[peer].period_bursts;
+}
+
+
+void rtt_peers_link_get(uint8_t peer, rtt_link_t * p_link)
+{
+    if (rtt_peers_is_connected(peer))
+    {
+        *p_link = m_peers[peer].link;
+    }
+    else
+    {
+        memset(p_link, 0, sizeof(*p_link));
+    }
+}
+
+
+rtt_calibration_t const * rtt_peers_calibration_get(uint8_t peer)
+{
+    return rtt_peers_is_connected(peer) ? m_peers[peer].p_calibration : rtt_calibration_get();
+}
+
+
+uint32_t rtt_peers_id_get(uint8_t peer)
+{
+    return rtt_peers_is_connected(peer) ? m_peers[peer].id : 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_PEERS_H__
+#define RTT_PEERS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+#include "rtt_calibration.h"
+#include "timeslot.h"
+
+/**@brief Responders ranged with by the initiator
+ *
+ * @details The initiator connects to up to RTT_PEERS_MAX responders and shares its bursts
+ *          between them in a TDMA frame that the timeslot module repeats. A responder is
+ *          known by its peer index, the index of its link, and answers only the requests
+ *          carrying RTT_CONFIG_PEER_ADDRESS() of it.
+ *
+ *          With RTT_LINK_PER_CONNECTION_ENABLED every connection also gets a radio link of its
+ *          own, written to the responder with its configuration, so a responder does not hear
+ *          the bursts of other initiators. A responder can serve several initiators at once if
+ *          their links share the channel and the low three octets of the access address, so
+ *          those are derived from the responder's id, and only the top octet is random.
+ *
+ *          A responder tracks the initiator's bursts with a fixed period, so each responder
+ *          must get evenly spaced bursts. With weights w the frame is the sum S of the weights
+ *          long, and a responder with weight w gets every S/w-th burst. Every weight must
+ *          divide S, for example 2, 1 and 1, but not 2 and 1.
+ */
+typedef enum
+{
+    RTT_PEERS_POLICY_ROUND_ROBIN, /**< Every responder gets the same share of the bursts. */
+    RTT_PEERS_POLICY_WEIGHTED,    /**< Every responder gets the share its weight asks for. */
+} rtt_peers_policy_t;
+
+
+/**@brief Add a connected responder.
+ *
+ * @param[in] peer Peer index.
+ * @param[in] id   Low 32 bits of the responder's device address, to find its calibration.
+ *
+ * @retval NRF_SUCCESS             Added.
+ * @retval NRF_ERROR_INVALID_PARAM The peer index is not below RTT_PEERS_MAX.
+ */
+uint32_t rtt_peers_add(uint8_t peer, uint32_t id);
+
+
+/**@brief Remove a disconnected responder. It is left out of the next frame built.
+ */
+void rtt_peers_remove(uint8_t peer);
+
+
+/**@brief Check whether a responder is connected.
+ */
+bool rtt_peers_is_connected(uint8_t peer);
+
+
+/**@brief Get the number of connected responders.
+ */
+uint32_t rtt_peers_count(void);
+
+
+/**@brief Set the share of the bursts a responder asks for.
+ *
+ * @retval NRF_SUCCESS             Set.
+ * @retval NRF_ERROR_INVALID_PARAM Unknown responder, or a weight of 0 or above RTT_CONFIG_WEIGHT_MAX.
+ */
+uint32_t rtt_peers_weight_set(uint8_t peer, uint8_t weight);
+
+
+/**@brief Get the share of the bursts a responder asks for.
+ */
+uint8_t rtt_peers_weight_get(uint8_t peer);
+
+
+/**@brief Build the TDMA frame of the connected responders into a schedule.
+ *
+ * @details The period of each responder's bursts is kept for rtt_peers_period_get().
+ *
+ * @param[in]    policy     How the bursts are shared.
+ * @param[inout] p_schedule Schedule whose frame is set.
+ *
+ * @retval NRF_SUCCESS             Frame built.
+ * @retval NRF_ERROR_NOT_FOUND     No responder is connected.
+ * @retval NRF_ERROR_INVALID_PARAM The weights do not give every responder evenly spaced bursts
+ *                                 in a frame of at most RTT_PEERS_FRAME_MAX bursts.
+ */
+uint32_t rtt_peers_frame_build(rtt_peers_policy_t policy, timeslot_schedule_t * p_schedule);
+
+
+/**@brief Get the period of a responder's bursts in the last frame built, in bursts.
+ */
+uint8_t rtt_peers_period_get(uint8_t peer);
+
+
+/**@brief Get the radio link of a responder. A responder that is not connected gets the shared link.
+ */
+void rtt_peers_link_get(uint8_t peer, rtt_link_t * p_link);
+
+
+/**@brief Draw another top octet of the access address of a responder's link, when the responder
+ *        already serves another initiator on it.
+ *
+ * @retval NRF_SUCCESS             Link renewed.
+ * @retval NRF_ERROR_INVALID_PARAM The responder is not connected.
+ * @retval NRF_ERROR_NOT_SUPPORTED Connections share the link, RTT_LINK_PER_CONNECTION_ENABLED is 0.
+ */
+uint32_t rtt_peers_link_renew(uint8_t peer);
+
+
+/**@brief Get the calibration of a responder, the blob with its id or else the first blob.
+ */
+rtt_calibration_t const * rtt_peers_calibration_get(uint8_t peer);
+
+
+/**@brief Get the id of a responder, the low 32 bits of its device address, or 0 if it is not connected.
+ */
+uint32_t rtt_peers_id_get(uint8_t peer);
+
+#endif // RTT_PEERS_H__
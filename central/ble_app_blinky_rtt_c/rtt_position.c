@@ -0,0 +1,552 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "nrf_error.h"
+#include "rtt_anchors.h"
+#include "rtt_position.h"
+
+#if RTT_POSITION_FIXED_POINT_ENABLED == 0
+#include <math.h>
+#endif
+
+#if RTT_PROFILER_ENABLED
+#include "nrf.h"
+#endif
+
+#define RTC_FREQUENCY_HZ     32768
+#define TIMESTAMP_MASK       0x00FFFFFFUL  /* The RTC counter is 24 bits */
+#define COORDINATE_MAX_MM    (1L << 24)    /* Positions further out than 16 km have diverged */
+#define SIGMA_MAX_MM         10000U        /* Keeps the fixed point covariance within 64 bits */
+#define VARIANCE_MAX_MM2     (1LL << 36)
+
+/* Normal matrix normalised by the sum of the qualities, whose determinant is below this has no
+   usable solution. The anchors are then close to a line, or in 3D to a plane. */
+#define DET_MIN              1.0e-4f
+#define DET_MIN_Q32          429497LL      /* DET_MIN * 2^32 */
+
+/* Latest distance to an anchor */
+typedef struct
+{
+    rtt_anchor_t const * p_anchor;
+    int32_t              distance_mm;
+    uint8_t              quality;
+    uint32_t             timestamp;
+} measurement_t;
+
+/* Solution of one set of distances */
+typedef struct
+{
+    int32_t  position_mm[3];
+    int32_t  covariance_mm2[6];
+    uint16_t rms_residual_mm;
+    uint8_t  iterations;
+} solution_t;
+
+static rtt_position_config_t m_config = RTT_POSITION_CONFIG_DEFAULT;
+static uint32_t              m_max_age_ticks;
+static measurement_t         m_measurements[RTT_ANCHORS_MAX];
+static uint32_t              m_measurement_count = 0;
+static rtt_position_t        m_position;
+static bool                  m_position_valid    = false;
+
+
+#if RTT_POSITION_FIXED_POINT_ENABLED
+
+static int32_t saturate(int64_t value)
+{
+    if (value > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (value < -INT32_MAX)
+    {
+        return -INT32_MAX;
+    }
+    return (int32_t)value;
+}
+
+
+static bool out_of_range(int32_t const * p_position_mm)
+{
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        if ((p_position_mm[i] > COORDINATE_MAX_MM) || (p_position_mm[i] < -COORDINATE_MAX_MM))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Integer square root, rounded down */
+static uint64_t isqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit  = 1ULL << 62;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root   = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+
+/* Division rounded to nearest, den > 0 */
+static int64_t div_round(int64_t num, int64_t den)
+{
+    return (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+
+/* Gauss-Newton in integers. Positions and residuals are millimetres, the unit vectors and the
+   normalised normal matrix Q16, its inverse a Q16 adjugate over a Q32 determinant. */
+static uint32_t solve(measurement_t const * const * pp_meas, uint32_t n, solution_t * p_solution)
+{
+    uint32_t const dims  = m_config.dimensions;
+    int32_t *      p_pos = p_solution->position_mm;
+    int64_t        cof[6];
+    int64_t        det;
+    uint64_t       mean_square;
+    int64_t        sum_q;
+
+    p_solution->iterations = 0;
+    do
+    {
+        int64_t a[6]     = {0};
+        int64_t b[3]     = {0};
+        int64_t delta[3] = {0};
+        int64_t sum_qr2  = 0;
+
+        sum_q = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            rtt_anchor_t const * p_anchor = pp_meas[i]->p_anchor;
+            int64_t              q        = pp_meas[i]->quality;
+            int64_t              d[3]     = {(int64_t)p_pos[0] - p_anchor->x_mm,
+                                             (int64_t)p_pos[1] - p_anchor->y_mm,
+                                             (int64_t)p_pos[2] - p_anchor->z_mm};
+            int64_t              range    = (int64_t)isqrt64((uint64_t)(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+            int64_t              residual = (int64_t)pp_meas[i]->distance_mm - range;
+            int64_t              u[3];
+
+            if (range == 0)
+            {
+                range = 1;
+            }
+            if (residual > COORDINATE_MAX_MM)
+            {
+                residual = COORDINATE_MAX_MM;
+            }
+            else if (residual < -COORDINATE_MAX_MM)
+            {
+                residual = -COORDINATE_MAX_MM;
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                u[k] = div_round(d[k] * 65536, range);
+            }
+
+            a[0]    += q * ((u[0] * u[0]) >> 16);
+            a[1]    += q * ((u[0] * u[1]) >> 16);
+            a[2]    += q * ((u[0] * u[2]) >> 16);
+            a[3]    += q * ((u[1] * u[1]) >> 16);
+            a[4]    += q * ((u[1] * u[2]) >> 16);
+            a[5]    += q * ((u[2] * u[2]) >> 16);
+            b[0]    += q * u[0] * residual;
+            b[1]    += q * u[1] * residual;
+            b[2]    += q * u[2] * residual;
+            sum_q   += q;
+            sum_qr2 += q * residual * residual;
+        }
+        for (uint32_t k = 0; k < 6; k++)
+        {
+            a[k] /= sum_q;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            b[k] /= sum_q;
+        }
+        mean_square = (uint64_t)(sum_qr2 / sum_q);
+
+        if (dims == 2)
+        {
+            det    = a[0] * a[3] - a[1] * a[1];
+            cof[0] = a[3];
+            cof[1] = -a[1];
+            cof[2] = 0;
+            cof[3] = a[0];
+            cof[4] = 0;
+            cof[5] = 0;
+        }
+        else
+        {
+            cof[0] = a[3] * a[5] - a[4] * a[4];
+            cof[1] = a[2] * a[4] - a[1] * a[5];
+            cof[2] = a[1] * a[4] - a[2] * a[3];
+            cof[3] = a[0] * a[5] - a[2] * a[2];
+            cof[4] = a[1] * a[2] - a[0] * a[4];
+            cof[5] = a[0] * a[3] - a[1] * a[1];
+            det    = (a[0] * cof[0] + a[1] * cof[1] + a[2] * cof[2]) >> 16;
+            for (uint32_t k = 0; k < 6; k++)
+            {
+                cof[k] >>= 16;
+            }
+        }
+        if (det < DET_MIN_Q32)
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+
+        delta[0] = div_round(cof[0] * b[0] + cof[1] * b[1] + cof[2] * b[2], det);
+        delta[1] = div_round(cof[1] * b[0] + cof[3] * b[1] + cof[4] * b[2], det);
+        delta[2] = div_round(cof[2] * b[0] + cof[4] * b[1] + cof[5] * b[2], det);
+        for (uint32_t k = 0; k < dims; k++)
+        {
+            p_pos[k] = saturate((int64_t)p_pos[k] + delta[k]);
+        }
+        p_solution->iterations++;
+
+        if (out_of_range(p_pos))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        if (delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2] <
+            (int64_t)RTT_POSITION_STEP_MIN_MM * RTT_POSITION_STEP_MIN_MM)
+        {
+            break;
+        }
+    } while (p_solution->iterations < RTT_POSITION_ITERATIONS_MAX);
+
+    /* Variance of a distance with quality 100, from sigma or from the residuals if larger */
+    uint64_t variance = 100ULL * m_config.sigma_mm * m_config.sigma_mm / (uint64_t)sum_q;
+    if ((n > dims) && (mean_square / (n - dims) > variance))
+    {
+        variance = mean_square / (n - dims);
+    }
+    if (variance > VARIANCE_MAX_MM2)
+    {
+        variance = VARIANCE_MAX_MM2;
+    }
+    for (uint32_t k = 0; k < 6; k++)
+    {
+        p_solution->covariance_mm2[k] = saturate((cof[k] * (int64_t)variance * 256) / (det >> 8));
+    }
+    p_solution->rms_residual_mm = (uint16_t)((mean_square > (uint64_t)UINT16_MAX * UINT16_MAX) ? UINT16_MAX : isqrt64(mean_square));
+
+    return NRF_SUCCESS;
+}
+
+#else
+
+/* Gauss-Newton in single precision floating point, with positions in millimetres */
+static uint32_t solve(measurement_t const * const * pp_meas, uint32_t n, solution_t * p_solution)
+{
+    uint32_t const dims   = m_config.dimensions;
+    float          pos[3] = {(float)p_solution->position_mm[0],
+                             (float)p_solution->position_mm[1],
+                             (float)p_solution->position_mm[2]};
+    float          inv[6];
+    float          mean_square;
+    float          sum_q;
+
+    p_solution->iterations = 0;
+    do
+    {
+        float a[6]     = {0};
+        float b[3]     = {0};
+        float delta[3] = {0};
+        float sum_qr2  = 0;
+        float det;
+
+        sum_q = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            rtt_anchor_t const * p_anchor = pp_meas[i]->p_anchor;
+            float                q        = pp_meas[i]->quality;
+            float                d[3]     = {pos[0] - (float)p_anchor->x_mm,
+                                             pos[1] - (float)p_anchor->y_mm,
+                                             pos[2] - (float)p_anchor->z_mm};
+            float                range    = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            float                residual = (float)pp_meas[i]->distance_mm - range;
+            float                u[3];
+
+            if (range < 1.0f)
+            {
+                range = 1.0f;
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                u[k] = d[k] / range;
+            }
+
+            a[0]    += q * u[0] * u[0];
+            a[1]    += q * u[0] * u[1];
+            a[2]    += q * u[0] * u[2];
+            a[3]    += q * u[1] * u[1];
+            a[4]    += q * u[1] * u[2];
+            a[5]    += q * u[2] * u[2];
+            b[0]    += q * u[0] * residual;
+            b[1]    += q * u[1] * residual;
+            b[2]    += q * u[2] * residual;
+            sum_q   += q;
+            sum_qr2 += q * residual * residual;
+        }
+        for (uint32_t k = 0; k < 6; k++)
+        {
+            a[k] /= sum_q;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            b[k] /= sum_q;
+        }
+        mean_square = sum_qr2 / sum_q;
+
+        if (dims == 2)
+        {
+            det    = a[0] * a[3] - a[1] * a[1];
+            inv[0] = a[3];
+            inv[1] = -a[1];
+            inv[2] = 0;
+            inv[3] = a[0];
+            inv[4] = 0;
+            inv[5] = 0;
+        }
+        else
+        {
+            inv[0] = a[3] * a[5] - a[4] * a[4];
+            inv[1] = a[2] * a[4] - a[1] * a[5];
+            inv[2] = a[1] * a[4] - a[2] * a[3];
+            inv[3] = a[0] * a[5] - a[2] * a[2];
+            inv[4] = a[1] * a[2] - a[0] * a[4];
+            inv[5] = a[0] * a[3] - a[1] * a[1];
+            det    = a[0] * inv[0] + a[1] * inv[1] + a[2] * inv[2];
+        }
+        if (!(det >= DET_MIN))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        for (uint32_t k = 0; k < 6; k++)
+        {
+            inv[k] /= det;
+        }
+
+        delta[0] = inv[0] * b[0] + inv[1] * b[1] + inv[2] * b[2];
+        delta[1] = inv[1] * b[0] + inv[3] * b[1] + inv[4] * b[2];
+        delta[2] = inv[2] * b[0] + inv[4] * b[1] + inv[5] * b[2];
+        for (uint32_t k = 0; k < dims; k++)
+        {
+            pos[k] += delta[k];
+            if (!(fabsf(pos[k]) <= (float)COORDINATE_MAX_MM))
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+        }
+        p_solution->iterations++;
+
+        if (delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2] <
+            (float)RTT_POSITION_STEP_MIN_MM * RTT_POSITION_STEP_MIN_MM)
+        {
+            break;
+        }
+    } while (p_solution->iterations < RTT_POSITION_ITERATIONS_MAX);
+
+    /* Variance of a distance with quality 100, from sigma or from the residuals if larger */
+    float variance = 100.0f * (float)m_config.sigma_mm * (float)m_config.sigma_mm / sum_q;
+    if ((n > dims) && (mean_square / (float)(n - dims) > variance))
+    {
+        variance = mean_square / (float)(n - dims);
+    }
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        p_solution->position_mm[k] = (int32_t)lrintf(pos[k]);
+    }
+    for (uint32_t k = 0; k < 6; k++)
+    {
+        float covariance = inv[k] * variance;
+        p_solution->covariance_mm2[k] = (fabsf(covariance) >= (float)INT32_MAX) ?
+                                        ((covariance > 0) ? INT32_MAX : -INT32_MAX) : (int32_t)lrintf(covariance);
+    }
+    p_solution->rms_residual_mm = (mean_square >= (float)UINT16_MAX * UINT16_MAX) ?
+                                  UINT16_MAX : (uint16_t)lrintf(sqrtf(mean_square));
+
+    return NRF_SUCCESS;
+}
+
+#endif // RTT_POSITION_FIXED_POINT_ENABLED
+
+
+uint32_t rtt_position_init(rtt_position_config_t const * p_config)
+{
+    if (((p_config->dimensions != 2) && (p_config->dimensions != 3)) ||
+        (p_config->sigma_mm == 0) || (p_config->sigma_mm > SIGMA_MAX_MM) ||
+        (p_config->tag_z_mm > COORDINATE_MAX_MM) || (p_config->tag_z_mm < -COORDINATE_MAX_MM))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_config        = *p_config;
+    m_max_age_ticks = (uint32_t)(((uint64_t)p_config->max_age_ms * RTC_FREQUENCY_HZ) / 1000);
+    if (m_max_age_ticks > TIMESTAMP_MASK / 2)
+    {
+        m_max_age_ticks = TIMESTAMP_MASK / 2;
+    }
+    rtt_position_reset();
+
+    return NRF_SUCCESS;
+}
+
+
+void rtt_position_reset(void)
+{
+    m_measurement_count = 0;
+    m_position_valid    = false;
+}
+
+
+uint32_t rtt_position_update(uint32_t id, int32_t distance_mm, uint8_t quality, uint32_t timestamp,
+                             rtt_position_t * p_position)
+{
+#if RTT_PROFILER_ENABLED
+    uint32_t const        start    = DWT->CYCCNT;
+#endif
+    rtt_anchor_t const *  p_anchor = rtt_anchors_find(id);
+    measurement_t const * fresh[RTT_ANCHORS_MAX];
+    uint32_t              n        = 0;
+    uint32_t              i;
+
+    if (p_anchor == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if ((distance_mm < 0) || (distance_mm > COORDINATE_MAX_MM) || (quality == 0) || (quality > 100))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* Keep the latest distance to every anchor */
+    i = 0;
+    while ((i < m_measurement_count) && (m_measurements[i].p_anchor != p_anchor))
+    {
+        i++;
+    }
+    if (i == m_measurement_count)
+    {
+        m_measurement_count++;
+    }
+    m_measurements[i].p_anchor    = p_anchor;
+    m_measurements[i].distance_mm = distance_mm;
+    m_measurements[i].quality     = quality;
+    m_measurements[i].timestamp   = timestamp;
+
+    for (i = 0; i < m_measurement_count; i++)
+    {
+        if (((timestamp - m_measurements[i].timestamp) & TIMESTAMP_MASK) <= m_max_age_ticks)
+        {
+            fresh[n++] = &m_measurements[i];
+        }
+    }
+    if (n < m_config.dimensions + 1U)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    /* Start from the previous position, or from above the middle of the anchors */
+    solution_t solution;
+    if (m_position_valid)
+    {
+        solution.position_mm[0] = m_position.x_mm;
+        solution.position_mm[1] = m_position.y_mm;
+        solution.position_mm[2] = m_position.z_mm;
+    }
+    else
+    {
+        int64_t sum[2] = {0};
+        for (i = 0; i < n; i++)
+        {
+            sum[0] += fresh[i]->p_anchor->x_mm;
+            sum[1] += fresh[i]->p_anchor->y_mm;
+        }
+        solution.position_mm[0] = (int32_t)(sum[0] / (int64_t)n);
+        solution.position_mm[1] = (int32_t)(sum[1] / (int64_t)n);
+        solution.position_mm[2] = m_config.tag_z_mm;
+    }
+    if (m_config.dimensions == 2)
+    {
+        solution.position_mm[2] = m_config.tag_z_mm;
+    }
+
+    uint32_t err_code = solve(fresh, n, &solution);
+    if (err_code != NRF_SUCCESS)
+    {
+        m_position_valid = false;
+        return err_code;
+    }
+
+    m_position.x_mm            = solution.position_mm[0];
+    m_position.y_mm            = solution.position_mm[1];
+    m_position.z_mm            = solution.position_mm[2];
+    memcpy(m_position.covariance_mm2, solution.covariance_mm2, sizeof(m_position.covariance_mm2));
+    m_position.timestamp       = timestamp;
+    m_position.rms_residual_mm = solution.rms_residual_mm;
+    m_position.anchors         = (uint8_t)n;
+    m_position.iterations      = solution.iterations;
+#if RTT_PROFILER_ENABLED
+    m_position.cycles          = DWT->CYCCNT - start;
+#else
+    m_position.cycles          = 0;
+#endif
+    m_position_valid           = true;
+
+    *p_position = m_position;
+    return NRF_SUCCESS;
+}
+
+
+bool rtt_position_get(rtt_position_t * p_position)
+{
+    if (m_position_valid)
+    {
+        *p_position = m_position;
+    }
+    return m_position_valid;
+}
@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_POSITION_H__
+#define RTT_POSITION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+#include "rtt_anchors.h"
+
+/**@brief Position solver
+ *
+ * @details The initiator keeps the latest distance to every anchor, a responder with
+ *          coordinates in rtt_anchors.h, and solves its own position by weighted least squares
+ *          with Gauss-Newton iterations. Every new distance updates the position: the iterations
+ *          start from the previous position, so one or two are usually enough, and at most
+ *          RTT_POSITION_ITERATIONS_MAX are run. The first position starts from the mean of the
+ *          anchors.
+ *
+ *          A distance is weighted by the share of valid exchanges of its burst: its variance
+ *          is sigma_mm^2 * 100 / quality. The covariance of the position is the inverse of the
+ *          weighted normal matrix, scaled up by the residuals when they are larger than sigma
+ *          explains. It is only as good as the geometry: anchors close to a line, or in 3D
+ *          close to a plane, give a large or no covariance.
+ *
+ *          A 2D solution needs 3 anchors and keeps the initiator at tag_z_mm. A 3D solution
+ *          needs 4. Distances older than max_age_ms are left out.
+ *
+ *          With RTT_POSITION_FIXED_POINT_ENABLED the solver only uses 32- and 64-bit integers,
+ *          with positions in millimetres and unit vectors in Q16, for CPUs without an FPU. The
+ *          results agree with the floating point solver to a few millimetres.
+ *
+ *          An update is a few thousand operations per iteration with eight anchors, well within
+ *          a millisecond on a Cortex-M4 at 64 MHz. With RTT_PROFILER_ENABLED the cycles of every
+ *          update are counted, and host/rtt_trilaterate checks the solver on simulated distances.
+ */
+
+/**@brief Solver configuration
+ */
+typedef struct
+{
+    uint8_t  dimensions; /**< 2 or 3. */
+    int32_t  tag_z_mm;   /**< Height of the initiator in 2D, and the first guess of it in 3D. */
+    uint32_t sigma_mm;   /**< Standard deviation of a distance with every exchange valid. */
+    uint32_t max_age_ms; /**< Distances older than this are left out. */
+} rtt_position_config_t;
+
+#define RTT_POSITION_CONFIG_DEFAULT                 \
+{                                                   \
+    .dimensions = RTT_POSITION_DEFAULT_DIMENSIONS,  \
+    .tag_z_mm   = RTT_POSITION_DEFAULT_TAG_Z_MM,    \
+    .sigma_mm   = RTT_POSITION_DEFAULT_SIGMA_MM,    \
+    .max_age_ms = RTT_POSITION_DEFAULT_MAX_AGE_MS   \
+}
+
+/**@brief Position of the initiator
+ */
+typedef struct
+{
+    int32_t  x_mm;
+    int32_t  y_mm;
+    int32_t  z_mm;
+    int32_t  covariance_mm2[6]; /**< xx, xy, xz, yy, yz and zz, mm^2. The z terms are 0 in 2D. Limited to INT32_MAX. */
+    uint32_t timestamp;         /**< Time of the newest distance, in ticks of the 32768 Hz RTC. */
+    uint16_t rms_residual_mm;   /**< Weighted RMS of the distance residuals. */
+    uint8_t  anchors;           /**< Distances used. */
+    uint8_t  iterations;        /**< Iterations run. */
+    uint32_t cycles;            /**< CPU cycles of the update, 0 without RTT_PROFILER_ENABLED. */
+} rtt_position_t;
+
+#define RTT_POSITION_COV_XX 0
+#define RTT_POSITION_COV_XY 1
+#define RTT_POSITION_COV_XZ 2
+#define RTT_POSITION_COV_YY 3
+#define RTT_POSITION_COV_YZ 4
+#define RTT_POSITION_COV_ZZ 5
+
+
+/**@brief Function for initializing the solver, without any distance.
+ *
+ * @retval NRF_SUCCESS             Initialized.
+ * @retval NRF_ERROR_INVALID_PARAM The dimensions are not 2 or 3, or sigma is 0.
+ */
+uint32_t rtt_position_init(rtt_position_config_t const * p_config);
+
+
+/**@brief Forget the distances and the position, for example when the initiator has moved
+ *        without ranging.
+ */
+void rtt_position_reset(void);
+
+
+/**@brief Add the distance to an anchor and update the position.
+ *
+ * @param[in]  id          Id of the anchor, the low 32 bits of the responder's device address.
+ * @param[in]  distance_mm Distance measured.
+ * @param[in]  quality     Percentage of exchanges of the burst that got a valid response.
+ * @param[in]  timestamp   Time of the burst, in ticks of the 32768 Hz RTC.
+ * @param[out] p_position  Position. Only written on success.
+ *
+ * @retval NRF_SUCCESS             Position updated.
+ * @retval NRF_ERROR_NOT_FOUND     The responder is not an anchor.
+ * @retval NRF_ERROR_INVALID_PARAM Negative distance or no valid exchange.
+ * @retval NRF_ERROR_INVALID_STATE Too few anchors with a recent distance.
+ * @retval NRF_ERROR_INVALID_DATA  The anchors are too close to a line or a plane, or the
+ *                                 iterations diverged. The next update starts afresh.
+ */
+uint32_t rtt_position_update(uint32_t id, int32_t distance_mm, uint8_t quality, uint32_t timestamp,
+                             rtt_position_t * p_position);
+
+
+/**@brief Get the last position.
+ *
+ * @return True if a position has been solved since the last reset.
+ */
+bool rtt_position_get(rtt_position_t * p_position);
+
+#endif // RTT_POSITION_H__
@@ -0,0 +1,94 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "rtt_profiler.h"
+
+#if RTT_PROFILER_ENABLED
+
+static rtt_profile_t m_profile; /* Bursts added since the previous get, only updated from the main loop */
+
+
+/**@brief Clear the profile of the main loop. Must be called in a critical region.
+ */
+static void profile_clear(void)
+{
+    for (uint32_t i = 0; i < RTT_PROFILER_PHASES; i++)
+    {
+        m_profile.phases[i] = (rtt_profiler_stats_t){.min = UINT32_MAX};
+    }
+}
+
+
+void rtt_profiler_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    CRITICAL_REGION_ENTER();
+    profile_clear();
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_profiler_burst_add(rtt_profile_t const * p_profile)
+{
+    CRITICAL_REGION_ENTER();
+    for (uint32_t i = 0; i < RTT_PROFILER_PHASES; i++)
+    {
+        rtt_profiler_stats_t const * p_burst = &p_profile->phases[i];
+        rtt_profiler_stats_t       * p_total = &m_profile.phases[i];
+
+        if (p_burst->count == 0)
+        {
+            continue;
+        }
+
+        p_total->count += p_burst->count;
+        p_total->sum   += p_burst->sum;
+        p_total->min    = MIN(p_total->min, p_burst->min);
+        p_total->max    = MAX(p_total->max, p_burst->max);
+
+        for (uint32_t j = 0; j < RTT_PROFILER_BUCKETS; j++)
+        {
+            /* Saturate rather than wrap when the profile is not read for a long time */
+            p_total->buckets[j] = (uint16_t)MIN((uint32_t)p_total->buckets[j] + p_burst->buckets[j], UINT16_MAX);
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_profiler_get(rtt_profile_t * p_profile)
+{
+    CRITICAL_REGION_ENTER();
+    *p_profile = m_profile;
+    profile_clear();
+    CRITICAL_REGION_EXIT();
+}
+
+#endif // RTT_PROFILER_ENABLED
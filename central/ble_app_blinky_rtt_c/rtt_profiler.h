@@ -0,0 +1,137 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_PROFILER_H__
+#define RTT_PROFILER_H__
+
+#include <stdint.h>
+#include "rtt_parameters.h"
+
+/**@brief Phase profiler for the exchanges of a burst
+ *
+ * @details When RTT_PROFILER_ENABLED is set, do_rtt_measurement stamps the end of every phase
+ *          of an exchange with the DWT cycle counter, and the time since the previous stamp is
+ *          added to the statistics of that phase: count, sum, min, max and a histogram of
+ *          power-of-two buckets. Bucket i counts the phases that took from 2^i to 2^(i+1) - 1
+ *          cycles, the last bucket also everything longer.
+ *
+ *          The statistics of a burst travel with its histogram to the main loop, are added up
+ *          there, and are written to the binary stream at every rate report. When the profiler
+ *          is disabled the stamps compile to nothing and rtt_burst_t has no profile.
+ */
+typedef enum
+{
+    RTT_PROFILER_SETUP,       /**< Radio, timer and PPI setup and the catch-up delay, once per burst. */
+    RTT_PROFILER_TX_RAMP_UP,  /**< From the end of the previous exchange until the radio is ready to send. */
+    RTT_PROFILER_TX,          /**< Sending the request. */
+    RTT_PROFILER_TURNAROUND,  /**< From the end of the request until the radio is ready to receive. */
+    RTT_PROFILER_RX_WAIT,     /**< Waiting for the end of the response, or the response timeout. */
+    RTT_PROFILER_PROCESSING,  /**< Checking the response, binning, telemetry and disabling the radio. */
+    RTT_PROFILER_PHASES
+} rtt_profiler_phase_t;
+
+#define RTT_PROFILER_BUCKETS 16
+
+/**@brief Statistics of one phase, in CPU cycles */
+typedef struct
+{
+    uint32_t count;
+    uint32_t sum;
+    uint32_t min;
+    uint32_t max;
+    uint16_t buckets[RTT_PROFILER_BUCKETS];
+} rtt_profiler_stats_t;
+
+/**@brief Statistics of all phases */
+typedef struct
+{
+    rtt_profiler_stats_t phases[RTT_PROFILER_PHASES];
+    uint32_t             last; /**< Cycle counter at the previous stamp. */
+} rtt_profile_t;
+
+#if RTT_PROFILER_ENABLED
+
+#include "nrf.h"
+
+/**@brief Clear a profile and take the first stamp. Called at the start of a burst.
+ */
+static inline void rtt_profiler_start(rtt_profile_t * p_profile)
+{
+    for (uint32_t i = 0; i < RTT_PROFILER_PHASES; i++)
+    {
+        p_profile->phases[i] = (rtt_profiler_stats_t){.min = UINT32_MAX};
+    }
+    p_profile->last = DWT->CYCCNT;
+}
+
+/**@brief Add the time since the previous stamp to a phase.
+ */
+static inline void rtt_profiler_mark(rtt_profile_t * p_profile, rtt_profiler_phase_t phase)
+{
+    uint32_t               now     = DWT->CYCCNT;
+    uint32_t               cycles  = now - p_profile->last;
+    uint32_t               bucket  = 31 - __CLZ(cycles | 1);
+    rtt_profiler_stats_t * p_stats = &p_profile->phases[phase];
+
+    p_profile->last = now;
+
+    p_stats->count++;
+    p_stats->sum += cycles;
+    if (cycles < p_stats->min)
+    {
+        p_stats->min = cycles;
+    }
+    if (cycles > p_stats->max)
+    {
+        p_stats->max = cycles;
+    }
+    p_stats->buckets[(bucket < RTT_PROFILER_BUCKETS) ? bucket : (RTT_PROFILER_BUCKETS - 1)]++;
+}
+
+#define RTT_PROFILER_START(p_profile)       rtt_profiler_start(p_profile)
+#define RTT_PROFILER_MARK(p_profile, phase) rtt_profiler_mark((p_profile), (phase))
+
+
+/**@brief Start the DWT cycle counter.
+ */
+void rtt_profiler_init(void);
+
+
+/**@brief Add the profile of a burst. Called from the main loop for every burst.
+ */
+void rtt_profiler_burst_add(rtt_profile_t const * p_profile);
+
+
+/**@brief Get the profile of the bursts added since the previous call, and start a new one.
+ */
+void rtt_profiler_get(rtt_profile_t * p_profile);
+
+#else
+
+#define RTT_PROFILER_START(p_profile)       do { } while (0)
+#define RTT_PROFILER_MARK(p_profile, phase) do { } while (0)
+
+#endif // RTT_PROFILER_ENABLED
+
+#endif // RTT_PROFILER_H__
@@ -0,0 +1,89 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nrf.h"
+#include "rtt_queue.h"
+
+/* The indices run freely and wrap at 2^32. With a power of two size the element index is
+ * the low bits of the counter, and head - tail is the number of elements in the queue. */
+#define QUEUE_ELEMENT(_p_queue, _index) \
+    (&(_p_queue)->p_buffer[((_index) & ((_p_queue)->size - 1)) * (_p_queue)->element_size])
+
+void * rtt_queue_write_claim(rtt_queue_t * p_queue)
+{
+    uint32_t head = p_queue->head;
+
+    if ((head - p_queue->tail) >= p_queue->size)
+    {
+        return NULL;
+    }
+
+    /* The consumer has released the element before updating the tail */
+    __DMB();
+
+    return QUEUE_ELEMENT(p_queue, head);
+}
+
+
+void rtt_queue_write_commit(rtt_queue_t * p_queue)
+{
+    /* The element must be written before the consumer can see it */
+    __DMB();
+
+    p_queue->head = p_queue->head + 1;
+}
+
+
+void const * rtt_queue_read_peek(rtt_queue_t * p_queue)
+{
+    uint32_t tail = p_queue->tail;
+
+    if (p_queue->head == tail)
+    {
+        return NULL;
+    }
+
+    /* The element was written before the head was updated */
+    __DMB();
+
+    return QUEUE_ELEMENT(p_queue, tail);
+}
+
+
+void rtt_queue_read_release(rtt_queue_t * p_queue)
+{
+    /* Finish reading the element before the producer can overwrite it */
+    __DMB();
+
+    p_queue->tail = p_queue->tail + 1;
+}
+
+
+uint32_t rtt_queue_utilization_get(rtt_queue_t const * p_queue)
+{
+    return p_queue->head - p_queue->tail;
+}
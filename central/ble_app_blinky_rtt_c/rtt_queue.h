@@ -0,0 +1,98 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_QUEUE_H__
+#define RTT_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nordic_common.h"
+#include "app_util.h"
+
+/**@brief Lock-free single-producer, single-consumer queue
+ *
+ * @details The producer and the consumer may run at different interrupt priorities without
+ *          any critical region. Only the producer writes the head index and only the consumer
+ *          writes the tail index. Elements are written and read in place: the producer claims
+ *          the element at the head, fills it and commits it, and the consumer peeks at the
+ *          element at the tail and releases it when done.
+ */
+typedef struct
+{
+    uint8_t         * p_buffer;     /**< Element storage. */
+    size_t            element_size; /**< Size of one element in bytes. */
+    uint32_t          size;         /**< Number of elements. Must be a power of two. */
+    volatile uint32_t head;         /**< Number of elements committed by the producer. */
+    volatile uint32_t tail;         /**< Number of elements released by the consumer. */
+} rtt_queue_t;
+
+/**@brief Macro for defining a queue instance.
+ *
+ * @param _type Element type.
+ * @param _name Name of the queue instance.
+ * @param _size Number of elements. Must be a power of two.
+ */
+#define RTT_QUEUE_DEF(_type, _name, _size)                                  \
+    STATIC_ASSERT(((_size) != 0) && (((_size) & ((_size) - 1)) == 0));      \
+    static _type CONCAT_2(_name, _buffer)[(_size)];                         \
+    static rtt_queue_t _name =                                              \
+    {                                                                       \
+        .p_buffer     = (uint8_t *)CONCAT_2(_name, _buffer),                \
+        .element_size = sizeof(_type),                                      \
+        .size         = (_size),                                            \
+        .head         = 0,                                                  \
+        .tail         = 0                                                   \
+    }
+
+
+/**@brief Get the element at the head of the queue for writing. Producer only.
+ *
+ * @return Pointer to the element, or NULL if the queue is full.
+ */
+void * rtt_queue_write_claim(rtt_queue_t * p_queue);
+
+
+/**@brief Make the claimed element available to the consumer. Producer only.
+ */
+void rtt_queue_write_commit(rtt_queue_t * p_queue);
+
+
+/**@brief Get the element at the tail of the queue for reading. Consumer only.
+ *
+ * @return Pointer to the element, or NULL if the queue is empty.
+ */
+void const * rtt_queue_read_peek(rtt_queue_t * p_queue);
+
+
+/**@brief Give the element at the tail back to the producer. Consumer only.
+ */
+void rtt_queue_read_release(rtt_queue_t * p_queue);
+
+
+/**@brief Get the number of committed elements not yet released.
+ */
+uint32_t rtt_queue_utilization_get(rtt_queue_t const * p_queue);
+
+#endif // RTT_QUEUE_H__
@@ -0,0 +1,295 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "sdk_macros.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "app_util.h"
+#include "nrf_log.h"
+#include "rtt_results.h"
+#include "rtt_parameters.h"
+
+#define RTC_COUNTER_MASK    0x00FFFFFFUL  /* The app_timer RTC counter is 24 bits */
+
+APP_TIMER_DEF(m_flush_timer_id);
+
+/* Batch being filled for one responder */
+typedef struct
+{
+    uint8_t  data[BLE_RTT_BATCH_MAX_LEN];
+    uint16_t len;
+    uint8_t  sequence;
+} batch_t;
+
+/* Single-shot request of one responder being served */
+typedef struct
+{
+    bool     pending;
+    uint8_t  request_id;
+    uint32_t requested_at;  /* RTC counter when the request was notified */
+} range_request_t;
+
+static ble_rtt_c_t *   mp_ble_rtt_c;
+static uint32_t        m_peer_count;
+static batch_t         m_batches[RTT_PEERS_MAX];
+static range_request_t m_range[RTT_PEERS_MAX];
+static uint64_t        m_clock_ticks;     /* Ticks since initialization, at m_clock_last */
+static uint32_t        m_clock_last;      /* RTC counter at the last clock update */
+static uint32_t        m_records_sent    = 0;
+static uint32_t        m_records_dropped = 0;
+
+
+/**@brief Extend the 24-bit RTC counter value to milliseconds since initialization.
+ *
+ * @details The clock is moved forward when ticks is later than the last update. Samples are a
+ *          little older than the last update when the flush timer ran between the end of the
+ *          burst and its processing, those are counted back from the last update.
+ *
+ * @param[in] ticks RTC counter value.
+ */
+static uint32_t clock_ms(uint32_t ticks)
+{
+    uint32_t diff = (ticks - m_clock_last) & RTC_COUNTER_MASK;
+    uint64_t total;
+
+    if (diff <= (RTC_COUNTER_MASK >> 1))
+    {
+        m_clock_ticks += diff;
+        m_clock_last   = ticks;
+        total          = m_clock_ticks;
+    }
+    else
+    {
+        total = m_clock_ticks - (((m_clock_last - ticks) & RTC_COUNTER_MASK));
+    }
+
+    return (uint32_t)((total * 1000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**@brief Convert a distance to the centimeters of a result record.
+ */
+static int16_t distance_cm_get(float distance_m)
+{
+    float distance_cm = distance_m * 100.0f;
+
+    if (isnan(distance_cm) || (distance_cm >= INT16_MAX) || (distance_cm <= INT16_MIN))
+    {
+        return BLE_RTT_DISTANCE_INVALID;
+    }
+
+    return (int16_t)lroundf(distance_cm);
+}
+
+
+/**@brief Percentage of the exchanges of a burst that got a valid response.
+ */
+static uint8_t quality_get(rtt_session_sample_t const * p_sample)
+{
+    return (p_sample->exchanges == 0) ? 0 : (uint8_t)((p_sample->valid * 100) / p_sample->exchanges);
+}
+
+
+static void batch_reset(batch_t * p_batch)
+{
+    p_batch->data[0] = p_batch->sequence;
+    p_batch->len     = BLE_RTT_BATCH_HEADER_LEN;
+}
+
+
+/**@brief Write the current batch of a responder and start the next one. Must be called from the
+ *        main loop.
+ */
+static void batch_flush(uint8_t peer)
+{
+    batch_t  * p_batch = &m_batches[peer];
+    uint32_t err_code;
+    uint32_t records   = (p_batch->len - BLE_RTT_BATCH_HEADER_LEN) / BLE_RTT_RECORD_LEN;
+
+    if (records == 0)
+    {
+        return;
+    }
+
+    err_code = ble_rtt_c_results_send(&mp_ble_rtt_c[peer], p_batch->data, p_batch->len);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_records_sent += records;
+    }
+    else
+    {
+        m_records_dropped += records;
+    }
+
+    /* The gateways see a gap in the sequence numbers for every dropped batch */
+    p_batch->sequence++;
+    batch_reset(p_batch);
+}
+
+
+void rtt_results_flush(void)
+{
+    for (uint8_t peer = 0; peer < m_peer_count; peer++)
+    {
+        batch_flush(peer);
+    }
+}
+
+
+/**@brief Periodic flush. Also keeps the clock from missing an RTC overflow. Runs in the main loop.
+ */
+static void flush_evt_handler(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    (void)clock_ms(app_timer_cnt_get());
+    rtt_results_flush();
+}
+
+
+/**@brief Flush timer handler.
+ *
+ * @details Records are added from the main loop, so the batch is flushed there as well.
+ */
+static void flush_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    (void)app_sched_event_put(NULL, 0, flush_evt_handler);
+}
+
+
+void rtt_results_add(rtt_session_sample_t const * p_sample)
+{
+    int16_t   distance = distance_cm_get(p_sample->distance_m);
+    uint8_t   quality  = quality_get(p_sample);
+    batch_t * p_batch;
+
+    if (p_sample->peer >= m_peer_count)
+    {
+        m_records_dropped++;
+        return;
+    }
+    p_batch = &m_batches[p_sample->peer];
+
+    p_batch->len += uint32_encode(clock_ms(p_sample->timestamp), &p_batch->data[p_batch->len]);
+    p_batch->len += uint16_encode((uint16_t)distance, &p_batch->data[p_batch->len]);
+    p_batch->data[p_batch->len++] = quality;
+    p_batch->data[p_batch->len++] = p_sample->peer;
+
+    /* Write as soon as the next record would not fit the link */
+    if (p_batch->len + BLE_RTT_RECORD_LEN > mp_ble_rtt_c[p_sample->peer].max_batch_len)
+    {
+        batch_flush(p_sample->peer);
+    }
+}
+
+
+void rtt_results_range_now_start(uint8_t peer, uint8_t request_id)
+{
+    if (peer >= m_peer_count)
+    {
+        return;
+    }
+
+    m_range[peer].request_id   = request_id;
+    m_range[peer].requested_at = app_timer_cnt_get();
+    m_range[peer].pending      = true;
+}
+
+
+bool rtt_results_range_now_pending(uint8_t peer)
+{
+    return (peer < m_peer_count) && m_range[peer].pending;
+}
+
+
+void rtt_results_range_now_done(uint8_t peer, rtt_session_sample_t const * p_sample)
+{
+    ble_rtt_range_result_t result;
+    uint32_t               ticks;
+    uint32_t               err_code;
+
+    if (!rtt_results_range_now_pending(peer))
+    {
+        return;
+    }
+    m_range[peer].pending = false;
+
+    ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_range[peer].requested_at);
+
+    result.request_id   = m_range[peer].request_id;
+    result.distance_cm  = (p_sample == NULL) ? BLE_RTT_DISTANCE_INVALID : distance_cm_get(p_sample->distance_m);
+    result.quality      = (p_sample == NULL) ? 0 : quality_get(p_sample);
+    result.initiator_us = (uint32_t)(((uint64_t)ticks * 1000000UL) / APP_TIMER_CLOCK_FREQ);
+
+    /* Written ahead of the batches, which wait for the flush timer */
+    err_code = ble_rtt_c_range_result_send(&mp_ble_rtt_c[peer], &result);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("Single-shot result %u not written, error 0x%x.", result.request_id, err_code);
+        return;
+    }
+
+    NRF_LOG_INFO("Single-shot %u of peer %u: %d cm, quality %u %%, %u us after the request.",
+                 result.request_id, peer, result.distance_cm, result.quality, result.initiator_us);
+}
+
+
+void rtt_results_stats_get(uint32_t * p_sent, uint32_t * p_dropped)
+{
+    *p_sent    = m_records_sent;
+    *p_dropped = m_records_dropped;
+}
+
+
+uint32_t rtt_results_init(ble_rtt_c_t * p_ble_rtt_c, uint32_t count)
+{
+    uint32_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(p_ble_rtt_c);
+    if (count > RTT_PEERS_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    mp_ble_rtt_c  = p_ble_rtt_c;
+    m_peer_count  = count;
+    m_clock_ticks = 0;
+    m_clock_last  = app_timer_cnt_get();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        batch_reset(&m_batches[i]);
+    }
+
+    err_code = app_timer_create(&m_flush_timer_id, APP_TIMER_MODE_REPEATED, flush_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return app_timer_start(m_flush_timer_id, APP_TIMER_TICKS(RESULTS_FLUSH_INTERVAL_MS), NULL);
+}
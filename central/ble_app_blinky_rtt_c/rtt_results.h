@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_RESULTS_H__
+#define RTT_RESULTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_rtt_c.h"
+#include "rtt_session.h"
+
+/**@brief Result record streaming
+ *
+ * @details Every burst with a valid distance becomes one record (see ble_rtt_c.h for the
+ *          format). Records are packed into the largest batch the ATT MTU of the link allows,
+ *          and a batch is written to the responder as soon as it is full. A partly filled
+ *          batch is written after RESULTS_FLUSH_INTERVAL_MS, so slow schedules are not held
+ *          back waiting for a full batch. The result of a single-shot request is written on
+ *          its own as soon as its burst has been processed.
+ *
+ *          Every responder gets the records of its own distances, in batches with their own
+ *          sequence numbers, and the peer index of a record is that of the responder.
+ */
+
+
+/**@brief Function for initializing result streaming.
+ *
+ * @param[in] p_ble_rtt_c Ranging Service clients the batches are written through, indexed by
+ *                        peer index.
+ * @param[in] count       Number of clients, at most RTT_PEERS_MAX.
+ */
+uint32_t rtt_results_init(ble_rtt_c_t * p_ble_rtt_c, uint32_t count);
+
+
+/**@brief Add the distance measured by a burst to the batch of its responder. Called from the
+ *        main loop.
+ *
+ * @param[in] p_sample Sample from a RTT_SESSION_EVT_SAMPLE event.
+ */
+void rtt_results_add(rtt_session_sample_t const * p_sample);
+
+
+/**@brief Write the current batch of every responder, if it has any records.
+ *
+ * @details Must be called from the main loop, like rtt_results_add.
+ */
+void rtt_results_flush(void);
+
+
+/**@brief Start serving a single-shot request notified by a responder.
+ *
+ * @details The time until rtt_results_range_now_done is reported back with the result. A request
+ *          of the responder not yet answered is replaced.
+ *
+ * @param[in] peer       Responder that forwarded the request.
+ * @param[in] request_id Id of the request.
+ */
+void rtt_results_range_now_start(uint8_t peer, uint8_t request_id);
+
+
+/**@brief Check whether a single-shot request of a responder is waiting for its result.
+ */
+bool rtt_results_range_now_pending(uint8_t peer);
+
+
+/**@brief Write the result of the single-shot request to its responder. Called from the main loop.
+ *
+ * @param[in] peer     Responder that forwarded the request.
+ * @param[in] p_sample Sample from a RTT_SESSION_EVT_SINGLE_SHOT event, or NULL if the request
+ *                     could not be served.
+ */
+void rtt_results_range_now_done(uint8_t peer, rtt_session_sample_t const * p_sample);
+
+
+/**@brief Get the number of records written and dropped since initialization.
+ *
+ * @details Records are dropped when a link can not keep up with the measurements, or when
+ *          the responder does not have the Ranging Service. The counts are of all responders.
+ */
+void rtt_results_stats_get(uint32_t * p_sent, uint32_t * p_dropped);
+
+#endif // RTT_RESULTS_H__
@@ -0,0 +1,376 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "rtt_estimator.h"
+#include "rtt_peers.h"
+#include "rtt_telemetry.h"
+#include "rtt_stats.h"
+#include "rtt_profiler.h"
+#include "nrf_error.h"
+#include "app_util_platform.h"
+#include "rtt_session.h"
+#include "rtt_conn_params.h"
+#include "timeslot.h"
+
+static rtt_session_evt_handler_t    m_evt_handler;
+static rtt_session_config_t         m_config;
+static volatile rtt_session_state_t m_state = RTT_SESSION_STATE_IDLE;
+
+/* Partial result of each responder, only updated from the main loop while running */
+static float                        m_sum_m[RTT_PEERS_MAX];
+static uint32_t                     m_count[RTT_PEERS_MAX];
+static uint32_t                     m_results[RTT_PEERS_MAX];
+static uint32_t                     m_results_total;
+
+/**@brief Change state if the session is in one of the given states.
+ *
+ * @return True if the state was changed.
+ */
+static bool state_transition(rtt_session_state_t from_1, rtt_session_state_t from_2, rtt_session_state_t to)
+{
+    bool changed = false;
+
+    CRITICAL_REGION_ENTER();
+    if ((m_state == from_1) || (m_state == from_2))
+    {
+        m_state = to;
+        changed = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return changed;
+}
+
+
+/**@brief Send an event without data to the application.
+ */
+static void evt_send(rtt_session_evt_type_t type)
+{
+    rtt_session_evt_t evt;
+
+    if (m_evt_handler != NULL)
+    {
+        evt.type = type;
+        m_evt_handler(&evt);
+    }
+}
+
+
+/**@brief Stop ranging and restore the connection after a session has ended.
+ */
+static void session_end(void)
+{
+    timeslot_stop();
+    (void)rtt_conn_params_ranging_exit();
+    evt_send(RTT_SESSION_EVT_STOPPED);
+}
+
+
+/**@brief Report a burst as the answer to a single-shot request.
+ *
+ * @param[in] p_burst Histogram of the burst, without exchanges if no timeslot was granted.
+ */
+static void single_shot_send(rtt_burst_t const * p_burst)
+{
+    rtt_session_evt_t evt;
+    float             distance = NAN;
+
+    if (p_burst->valid > 0)
+    {
+        distance = calc_dist(p_burst, rtt_peers_calibration_get(p_burst->peer));
+        if (distance < 0)
+        {
+            distance = NAN;
+        }
+    }
+
+    if (m_evt_handler != NULL)
+    {
+        evt.type               = RTT_SESSION_EVT_SINGLE_SHOT;
+        evt.sample.distance_m  = distance;
+        evt.sample.exchanges   = p_burst->exchanges;
+        evt.sample.valid       = p_burst->valid;
+        evt.sample.timestamp   = p_burst->timestamp;
+        evt.sample.peer        = p_burst->peer;
+        evt.sample.p_burst     = p_burst;
+        m_evt_handler(&evt);
+    }
+}
+
+
+/**@brief Calculate the distance measured by a burst and add it to the result.
+ *
+ * @details The responder telemetry, the statistics and the profile of every burst are kept,
+ *          whatever the session state.
+ *
+ * @param[in] p_burst Histogram of the burst.
+ */
+static void burst_handler(rtt_burst_t const * p_burst)
+{
+    rtt_session_evt_t evt;
+    float             distance;
+    uint8_t           peer = p_burst->peer;
+
+    rtt_telemetry_update(peer, &p_burst->telemetry);
+    rtt_stats_burst_add(p_burst);
+#if RTT_PROFILER_ENABLED
+    rtt_profiler_burst_add(&p_burst->profile);
+#endif
+
+    if (p_burst->single_shot && (m_state == RTT_SESSION_STATE_SINGLE_SHOT))
+    {
+        m_state = RTT_SESSION_STATE_IDLE;
+        single_shot_send(p_burst);
+        return;
+    }
+
+    if (m_state != RTT_SESSION_STATE_RUNNING)
+    {
+        return;
+    }
+
+    /* A single-shot burst run during the session also counts as a burst of the session */
+    if (p_burst->single_shot)
+    {
+        single_shot_send(p_burst);
+
+        /* The application may have stopped the session from the single-shot event */
+        if (m_state != RTT_SESSION_STATE_RUNNING)
+        {
+            return;
+        }
+    }
+
+    distance = calc_dist(p_burst, rtt_peers_calibration_get(peer));
+
+    if (isnan(distance) || (distance < 0))
+    {
+        return;
+    }
+
+    if (m_evt_handler != NULL)
+    {
+        evt.type                = RTT_SESSION_EVT_SAMPLE;
+        evt.sample.distance_m   = distance;
+        evt.sample.exchanges    = p_burst->exchanges;
+        evt.sample.valid        = p_burst->valid;
+        evt.sample.timestamp    = p_burst->timestamp;
+        evt.sample.peer         = peer;
+        evt.sample.p_burst      = p_burst;
+        m_evt_handler(&evt);
+
+        /* The application may have stopped the session from the sample event */
+        if (m_state != RTT_SESSION_STATE_RUNNING)
+        {
+            return;
+        }
+    }
+
+    m_sum_m[peer] += distance;
+    m_count[peer]++;
+
+    if (m_count[peer] < m_config.averaging)
+    {
+        return;
+    }
+
+    evt.type              = RTT_SESSION_EVT_RESULT;
+    evt.result.distance_m = m_sum_m[peer] / (float)m_count[peer];
+    evt.result.bursts     = m_count[peer];
+    evt.result.index      = m_results[peer]++;
+    evt.result.peer       = peer;
+
+    m_sum_m[peer] = 0;
+    m_count[peer] = 0;
+    m_results_total++;
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(&evt);
+    }
+
+    if ((m_config.results != 0) && (m_results_total >= m_config.results))
+    {
+        /* The application may have stopped the session from the result event */
+        if (state_transition(RTT_SESSION_STATE_RUNNING, RTT_SESSION_STATE_RUNNING, RTT_SESSION_STATE_IDLE))
+        {
+            session_end();
+        }
+    }
+}
+
+
+uint32_t rtt_session_init(rtt_session_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+
+    return timeslot_sd_init(burst_handler);
+}
+
+
+uint32_t rtt_session_start(rtt_session_config_t const * p_config)
+{
+    uint32_t err_code;
+
+    if ((p_config == NULL) || (p_config->averaging == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* Claim the session before touching the schedule, so only one caller can get past here */
+    if (!state_transition(RTT_SESSION_STATE_IDLE, RTT_SESSION_STATE_IDLE, RTT_SESSION_STATE_STARTING))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = timeslot_schedule_set(&p_config->schedule);
+    if ((err_code == NRF_SUCCESS) && (p_config->power_policy != timeslot_power_policy_get()))
+    {
+        err_code = timeslot_power_policy_set(p_config->power_policy);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        m_state = RTT_SESSION_STATE_IDLE;
+        return err_code;
+    }
+
+    m_config        = *p_config;
+    m_results_total = 0;
+    memset(m_sum_m, 0, sizeof(m_sum_m));
+    memset(m_count, 0, sizeof(m_count));
+    memset(m_results, 0, sizeof(m_results));
+
+    rtt_stats_session_start();
+
+    err_code = rtt_conn_params_ranging_enter();
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_BUSY))
+    {
+        m_state = RTT_SESSION_STATE_IDLE;
+        return err_code;
+    }
+
+    m_state = RTT_SESSION_STATE_RUNNING;
+
+    err_code = timeslot_start();
+    if (err_code != NRF_SUCCESS)
+    {
+        m_state = RTT_SESSION_STATE_IDLE;
+        (void)rtt_conn_params_ranging_exit();
+        return err_code;
+    }
+
+    evt_send(RTT_SESSION_EVT_STARTED);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t rtt_session_stop(void)
+{
+    if (!state_transition(RTT_SESSION_STATE_RUNNING, RTT_SESSION_STATE_PAUSED, RTT_SESSION_STATE_IDLE))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    session_end();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t rtt_session_pause(void)
+{
+    if (!state_transition(RTT_SESSION_STATE_RUNNING, RTT_SESSION_STATE_RUNNING, RTT_SESSION_STATE_PAUSED))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    timeslot_stop();
+    evt_send(RTT_SESSION_EVT_PAUSED);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t rtt_session_resume(void)
+{
+    uint32_t err_code;
+
+    if (!state_transition(RTT_SESSION_STATE_PAUSED, RTT_SESSION_STATE_PAUSED, RTT_SESSION_STATE_RUNNING))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = timeslot_start();
+    if (err_code != NRF_SUCCESS)
+    {
+        m_state = RTT_SESSION_STATE_PAUSED;
+        return err_code;
+    }
+
+    evt_send(RTT_SESSION_EVT_RESUMED);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t rtt_session_single_shot(uint8_t peer, rtt_link_t const * p_link, uint32_t exchanges)
+{
+    uint32_t err_code;
+
+    if (peer >= RTT_PEERS_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_state == RTT_SESSION_STATE_RUNNING)
+    {
+        return timeslot_single_shot(peer, p_link, exchanges);
+    }
+
+    if (!state_transition(RTT_SESSION_STATE_IDLE, RTT_SESSION_STATE_IDLE, RTT_SESSION_STATE_SINGLE_SHOT))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = timeslot_single_shot(peer, p_link, exchanges);
+    if (err_code != NRF_SUCCESS)
+    {
+        m_state = RTT_SESSION_STATE_IDLE;
+    }
+
+    return err_code;
+}
+
+
+rtt_session_state_t rtt_session_state_get(void)
+{
+    return m_state;
+}
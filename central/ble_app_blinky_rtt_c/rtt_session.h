@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_SESSION_H__
+#define RTT_SESSION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timeslot.h"
+
+/**@brief Ranging session states
+ *
+ * @details A session is started from IDLE, and can be paused and resumed any number of times
+ *          before it is stopped. Every transition is made in a critical region, so a session
+ *          can only be started once however many callers ask for it.
+ */
+typedef enum
+{
+    RTT_SESSION_STATE_IDLE,        /**< No session. */
+    RTT_SESSION_STATE_STARTING,    /**< A session is being started. */
+    RTT_SESSION_STATE_RUNNING,     /**< Bursts are scheduled and results are reported. */
+    RTT_SESSION_STATE_PAUSED,      /**< No bursts are scheduled. The partial result is kept. */
+    RTT_SESSION_STATE_SINGLE_SHOT, /**< No session, a single-shot burst is in progress. */
+} rtt_session_state_t;
+
+/**@brief Ranging session event types
+ */
+typedef enum
+{
+    RTT_SESSION_EVT_STARTED,     /**< Session started. */
+    RTT_SESSION_EVT_SAMPLE,      /**< A burst measured a distance. */
+    RTT_SESSION_EVT_RESULT,      /**< A distance result is available. */
+    RTT_SESSION_EVT_PAUSED,      /**< Session paused. */
+    RTT_SESSION_EVT_RESUMED,     /**< Session resumed. */
+    RTT_SESSION_EVT_STOPPED,     /**< Session stopped, by the application or after the requested number of results. */
+    RTT_SESSION_EVT_SINGLE_SHOT, /**< A single-shot burst has ended. */
+} rtt_session_evt_type_t;
+
+/**@brief Distance result
+ */
+typedef struct
+{
+    float    distance_m; /**< Mean distance over the averaged bursts in meters. */
+    uint32_t bursts;     /**< Number of bursts averaged. */
+    uint32_t index;      /**< Result number of the responder within the session, starting at 0. */
+    uint8_t  peer;       /**< Responder ranged with. */
+} rtt_session_result_t;
+
+/**@brief Distance measured by a single burst
+ */
+typedef struct
+{
+    float               distance_m; /**< Distance in meters. */
+    uint32_t            exchanges;  /**< Number of exchanges attempted. */
+    uint32_t            valid;      /**< Number of exchanges that got a valid response. */
+    uint32_t            timestamp;  /**< Time the burst ended, in ticks of the 32768 Hz RTC. */
+    uint8_t             peer;       /**< Responder ranged with. */
+    rtt_burst_t const * p_burst;    /**< Histogram of the burst, only valid during the event. */
+} rtt_session_sample_t;
+
+/**@brief Ranging session event
+ */
+typedef struct
+{
+    rtt_session_evt_type_t type;
+    union
+    {
+        rtt_session_sample_t sample; /**< Valid for RTT_SESSION_EVT_SAMPLE and RTT_SESSION_EVT_SINGLE_SHOT. */
+        rtt_session_result_t result; /**< Valid for RTT_SESSION_EVT_RESULT. */
+    };
+} rtt_session_evt_t;
+
+/**@brief Ranging session event handler
+ *
+ * @details Sample, result and single-shot events, and the stop event after the last result, are called
+ *          from the main loop through app_scheduler. The other events are called from the context of the API
+ *          call that caused them.
+ */
+typedef void (*rtt_session_evt_handler_t)(rtt_session_evt_t const * p_evt);
+
+/**@brief Ranging session configuration
+ *
+ * @details With several responders the results of each are averaged on their own, and the
+ *          session stops after the given number of results from all of them together.
+ */
+typedef struct
+{
+    timeslot_schedule_t     schedule;     /**< Burst rate, exchanges per burst and the frame of responders. */
+    timeslot_power_policy_t power_policy; /**< Clock and radio power policy. */
+    uint32_t                averaging;    /**< Number of bursts with a valid distance averaged into each result. */
+    uint32_t                results;      /**< Number of results after which the session stops. 0 runs until stopped. */
+} rtt_session_config_t;
+
+/**@brief Default session configuration
+ */
+#define RTT_SESSION_CONFIG_DEFAULT                                  \
+{                                                                   \
+    .schedule     = {TS_DEFAULT_RATE_HZ, TS_DEFAULT_EXCHANGES, 0},  \
+    .power_policy = TS_DEFAULT_POWER_POLICY,                        \
+    .averaging    = RTT_SESSION_DEFAULT_AVERAGING,                  \
+    .results      = RTT_SESSION_DEFAULT_RESULTS                     \
+}
+
+
+/**@brief Function for initializing the ranging session module and the timeslot API.
+ *
+ * @param[in] evt_handler Handler for session events.
+ */
+uint32_t rtt_session_init(rtt_session_evt_handler_t evt_handler);
+
+
+/**@brief Start a ranging session.
+ *
+ * @param[in] p_config Session configuration.
+ *
+ * @retval NRF_SUCCESS             Session started.
+ * @retval NRF_ERROR_INVALID_STATE A session is already running or paused, or the power policy
+ *                                 cannot change while the last timeslot of the previous session ends.
+ * @retval NRF_ERROR_INVALID_PARAM Invalid configuration.
+ */
+uint32_t rtt_session_start(rtt_session_config_t const * p_config);
+
+
+/**@brief Stop the ranging session. The partial result is discarded.
+ *
+ * @retval NRF_SUCCESS             Session stopped.
+ * @retval NRF_ERROR_INVALID_STATE No session.
+ */
+uint32_t rtt_session_stop(void);
+
+
+/**@brief Pause the ranging session.
+ *
+ * @retval NRF_SUCCESS             Session paused.
+ * @retval NRF_ERROR_INVALID_STATE The session is not running.
+ */
+uint32_t rtt_session_pause(void);
+
+
+/**@brief Resume a paused ranging session.
+ *
+ * @retval NRF_SUCCESS             Session resumed.
+ * @retval NRF_ERROR_INVALID_STATE The session is not paused.
+ */
+uint32_t rtt_session_resume(void);
+
+
+/**@brief Measure the distance once, as soon as possible.
+ *
+ * @details One short burst is run, see timeslot_single_shot(), without changing the connection
+ *          parameters. A running session runs it ahead of its schedule, as soon as the timeslot
+ *          in progress ends, and also counts it as a burst of the session.
+ *          The burst is reported with RTT_SESSION_EVT_SINGLE_SHOT from the main loop, whether or
+ *          not it measured a distance. The distance is NAN when it did not.
+ *
+ * @param[in] peer      Responder to range with.
+ * @param[in] p_link    Radio link of the responder.
+ * @param[in] exchanges Number of exchanges in the burst.
+ *
+ * @retval NRF_SUCCESS             Burst requested.
+ * @retval NRF_ERROR_INVALID_STATE The session is paused or starting, or a single-shot burst is
+ *                                 already in progress.
+ * @retval NRF_ERROR_BUSY          The last timeslot of the previous session has not ended, or a
+ *                                 single-shot burst of the session is still waiting.
+ * @retval NRF_ERROR_INVALID_PARAM Invalid responder, link or number of exchanges.
+ */
+uint32_t rtt_session_single_shot(uint8_t peer, rtt_link_t const * p_link, uint32_t exchanges);
+
+
+/**@brief Get the session state.
+ */
+rtt_session_state_t rtt_session_state_get(void);
+
+#endif // RTT_SESSION_H__
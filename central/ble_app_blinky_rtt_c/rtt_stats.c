@@ -0,0 +1,136 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "rtt_stats.h"
+#include "timeslot.h"
+
+STATIC_ASSERT(RTT_STATS_ENCODED_LEN == 1 + 2 * RTT_STATS_COUNTERS * sizeof(uint32_t));
+
+static rtt_stats_t m_lifetime;      /* Burst counters since start-up, updated from the main loop */
+static rtt_stats_t m_session_start; /* Counters since start-up when the session started */
+
+static rtt_stats_t m_peer_lifetime[RTT_PEERS_MAX];      /* Burst counters of each responder since start-up */
+static rtt_stats_t m_peer_session_start[RTT_PEERS_MAX]; /* Counters of each responder when the session started */
+
+
+/**@brief Get the counters since start-up. Must be called in a critical region.
+ */
+static void lifetime_get(rtt_stats_t const * p_counters, rtt_stats_t * p_lifetime)
+{
+    *p_lifetime = *p_counters;
+    timeslot_grant_stats_get(&p_lifetime->slots_requested, &p_lifetime->slots_granted);
+}
+
+
+/**@brief Add the counts of a burst to a set of counters. Must be called in a critical region.
+ */
+static void counters_add(rtt_stats_t * p_counters, rtt_burst_t const * p_burst)
+{
+    p_counters->bursts++;
+    p_counters->tx           += p_burst->exchanges;
+    p_counters->rx_crc_ok    += p_burst->valid + p_burst->rx_ignored;
+    p_counters->rx_crc_error += p_burst->rx_crc_error;
+    p_counters->rx_ignored   += p_burst->rx_ignored;
+    p_counters->rx_timeouts  += p_burst->rx_timeouts;
+}
+
+
+/**@brief Get the counters since the start of the session and since start-up.
+ */
+static void counters_get(rtt_stats_t const * p_counters, rtt_stats_t const * p_session_start,
+                         rtt_stats_t * p_session, rtt_stats_t * p_lifetime)
+{
+    uint32_t const * p_start = (uint32_t const *)p_session_start;
+    uint32_t       * p_now   = (uint32_t *)p_lifetime;
+    uint32_t       * p_diff  = (uint32_t *)p_session;
+
+    CRITICAL_REGION_ENTER();
+    lifetime_get(p_counters, p_lifetime);
+    for (uint32_t i = 0; i < RTT_STATS_COUNTERS; i++)
+    {
+        p_diff[i] = p_now[i] - p_start[i];
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_stats_burst_add(rtt_burst_t const * p_burst)
+{
+    /* Single-shot requests that were not granted a timeslot have no exchanges */
+    if ((p_burst->exchanges == 0) || (p_burst->peer >= RTT_PEERS_MAX))
+    {
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    counters_add(&m_lifetime, p_burst);
+    counters_add(&m_peer_lifetime[p_burst->peer], p_burst);
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_stats_session_start(void)
+{
+    CRITICAL_REGION_ENTER();
+    lifetime_get(&m_lifetime, &m_session_start);
+    for (uint32_t i = 0; i < RTT_PEERS_MAX; i++)
+    {
+        lifetime_get(&m_peer_lifetime[i], &m_peer_session_start[i]);
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_stats_get(rtt_stats_t * p_session, rtt_stats_t * p_lifetime)
+{
+    counters_get(&m_lifetime, &m_session_start, p_session, p_lifetime);
+}
+
+
+void rtt_stats_peer_get(uint8_t peer, rtt_stats_t * p_session, rtt_stats_t * p_lifetime)
+{
+    counters_get(&m_peer_lifetime[peer], &m_peer_session_start[peer], p_session, p_lifetime);
+}
+
+
+uint16_t rtt_stats_encode(uint8_t role, rtt_stats_t const * p_session, rtt_stats_t const * p_lifetime, uint8_t * p_buf)
+{
+    uint32_t const * p_counters[] = {(uint32_t const *)p_session, (uint32_t const *)p_lifetime};
+    uint16_t         len          = 0;
+
+    p_buf[len++] = role;
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(p_counters); i++)
+    {
+        for (uint32_t j = 0; j < RTT_STATS_COUNTERS; j++)
+        {
+            len += uint32_encode(p_counters[i][j], &p_buf[len]);
+        }
+    }
+
+    return len;
+}
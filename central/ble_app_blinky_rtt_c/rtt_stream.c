@@ -0,0 +1,468 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "nrf_error.h"
+#include "nrfx_uarte.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "app_timer.h"
+#include "sdk_macros.h"
+#include "crc16.h"
+#include "rtt_stream.h"
+#include "rtt_parameters.h"
+
+#define BUFFER_MASK (STREAM_BUFFER_SIZE - 1)
+
+STATIC_ASSERT((STREAM_BUFFER_SIZE & BUFFER_MASK) == 0);
+STATIC_ASSERT(RTT_STREAM_HISTOGRAM_MAX_BINS == RTT_NUM_BINS);
+STATIC_ASSERT(RTT_STREAM_TELEMETRY_LEN == 6 + RTT_TELEMETRY_FIELDS * RTT_TELEMETRY_FIELD_LEN);
+STATIC_ASSERT(RTT_STREAM_STATS_LEN == 4 + RTT_STATS_ENCODED_LEN);
+STATIC_ASSERT(RTT_STREAM_PEER_LEN == 7 + RTT_STATS_COUNTERS * sizeof(uint32_t));
+STATIC_ASSERT(RTT_STREAM_STATS_COUNTERS == RTT_STATS_COUNTERS);
+STATIC_ASSERT(RTT_STREAM_PROFILE_BUCKETS == RTT_PROFILER_BUCKETS);
+STATIC_ASSERT(RTT_STREAM_TRACE_HEADER_LEN + 4 * RTT_STREAM_TRACE_MAX_EVENTS <= RTT_STREAM_MAX_RECORD_LEN);
+
+static nrfx_uarte_t const m_uarte = NRFX_UARTE_INSTANCE(0);
+
+/* Encoded frames waiting for the UART. Indices run freely and are masked when used. */
+static uint8_t           m_buffer[STREAM_BUFFER_SIZE];
+static volatile uint32_t m_head           = 0; /* End of the last frame written */
+static volatile uint32_t m_tail           = 0; /* Start of the transfer in progress */
+static volatile uint32_t m_tx_len         = 0; /* Length of the transfer in progress, 0 when idle */
+static uint16_t          m_sequence       = 0;
+static uint32_t          m_frames_dropped = 0;
+
+
+/**@brief Send the buffered frames up to the end of the buffer, unless a transfer is in progress.
+ *
+ * @details Called from the UARTE handler, or with the UARTE interrupt masked.
+ */
+static void tx_start(void)
+{
+    uint32_t used = m_head - m_tail;
+    uint32_t offset;
+    uint32_t len;
+
+    if ((m_tx_len != 0) || (used == 0))
+    {
+        return;
+    }
+
+    offset = m_tail & BUFFER_MASK;
+    len    = MIN(used, STREAM_BUFFER_SIZE - offset);
+
+    if (nrfx_uarte_tx(&m_uarte, &m_buffer[offset], len) == NRFX_SUCCESS)
+    {
+        m_tx_len = len;
+    }
+}
+
+
+static void uarte_evt_handler(nrfx_uarte_event_t const * p_event, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (p_event->type == NRFX_UARTE_EVT_TX_DONE)
+    {
+        m_tail  += m_tx_len;
+        m_tx_len = 0;
+        tx_start();
+    }
+}
+
+
+/**@brief COBS encode a frame and end it with the delimiter.
+ *
+ * @param[in]  p_frame   Frame.
+ * @param[in]  len       Frame length.
+ * @param[out] p_encoded Encoded frame, at least RTT_STREAM_ENCODED_LEN(len) bytes.
+ *
+ * @return Length of the encoded frame.
+ */
+static uint32_t cobs_encode(uint8_t const * p_frame, uint32_t len, uint8_t * p_encoded)
+{
+    uint32_t code_index = 0;
+    uint32_t out        = 1;
+    uint8_t  code       = 1;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (p_frame[i] != RTT_STREAM_DELIMITER)
+        {
+            p_encoded[out++] = p_frame[i];
+            code++;
+        }
+
+        if ((p_frame[i] == RTT_STREAM_DELIMITER) || (code == 0xFF))
+        {
+            p_encoded[code_index] = code;
+            code_index            = out++;
+            code                  = 1;
+        }
+    }
+
+    p_encoded[code_index] = code;
+    p_encoded[out++]      = RTT_STREAM_DELIMITER;
+
+    return out;
+}
+
+
+/**@brief Complete a frame and copy it to the buffer, or drop it if it does not fit.
+ *
+ * @details The sequence number is taken and the frame copied in one critical region, so frames
+ *          from the main loop and from timer handlers reach the buffer in sequence order.
+ *
+ * @param[in] type       Record type.
+ * @param[in] p_frame    Frame with the record from offset RTT_STREAM_HEADER_LEN and room for the CRC.
+ * @param[in] record_len Length of the record.
+ */
+static void frame_write(uint8_t type, uint8_t * p_frame, uint32_t record_len)
+{
+    uint8_t  encoded[RTT_STREAM_ENCODED_LEN(RTT_STREAM_MAX_FRAME_LEN)];
+    uint32_t len = RTT_STREAM_HEADER_LEN + record_len;
+    uint32_t encoded_len;
+    uint32_t offset;
+    uint32_t first;
+
+    CRITICAL_REGION_ENTER();
+
+    p_frame[0] = type;
+    (void)uint16_encode(m_sequence++, &p_frame[1]);
+    len += uint16_encode(crc16_compute(p_frame, len, NULL), &p_frame[len]);
+
+    encoded_len = cobs_encode(p_frame, len, encoded);
+
+    if ((STREAM_BUFFER_SIZE - (m_head - m_tail)) < encoded_len)
+    {
+        m_frames_dropped++;
+    }
+    else
+    {
+        offset = m_head & BUFFER_MASK;
+        first  = MIN(encoded_len, STREAM_BUFFER_SIZE - offset);
+
+        memcpy(&m_buffer[offset], encoded, first);
+        memcpy(&m_buffer[0], &encoded[first], encoded_len - first);
+        m_head += encoded_len;
+
+        tx_start();
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Convert a distance to the signed millimeters of the records.
+ */
+static int32_t distance_mm_get(float distance_m)
+{
+    float distance_mm = distance_m * 1000.0f;
+
+    if (isnan(distance_mm) || (distance_mm >= (float)INT32_MAX) || (distance_mm <= (float)INT32_MIN))
+    {
+        return RTT_STREAM_DISTANCE_INVALID;
+    }
+
+    return (int32_t)lroundf(distance_mm);
+}
+
+
+/**@brief Write the non-empty part of a burst histogram.
+ */
+static void histogram_write(rtt_burst_t const * p_burst)
+{
+    uint8_t  frame[RTT_STREAM_MAX_FRAME_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+    uint32_t first      = 0;
+    uint32_t last       = RTT_NUM_BINS;
+
+    while ((first < RTT_NUM_BINS) && (p_burst->bins[first] == 0))
+    {
+        first++;
+    }
+    while ((last > first) && (p_burst->bins[last - 1] == 0))
+    {
+        last--;
+    }
+
+    len += uint32_encode(p_burst->timestamp, &p_record[len]);
+    len += uint16_encode((uint16_t)p_burst->exchanges, &p_record[len]);
+    len += uint16_encode((uint16_t)p_burst->valid, &p_record[len]);
+    p_record[len++] = (uint8_t)((first < RTT_NUM_BINS) ? first : 0);
+    p_record[len++] = (uint8_t)(last - first);
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        len += uint16_encode(p_burst->bins[i], &p_record[len]);
+    }
+
+    frame_write(RTT_STREAM_RECORD_HISTOGRAM, frame, len);
+}
+
+
+void rtt_stream_sample_write(rtt_session_sample_t const * p_sample)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_DISTANCE_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(p_sample->timestamp, &p_record[len]);
+    len += uint32_encode((uint32_t)distance_mm_get(p_sample->distance_m), &p_record[len]);
+    len += uint16_encode((uint16_t)p_sample->exchanges, &p_record[len]);
+    len += uint16_encode((uint16_t)p_sample->valid, &p_record[len]);
+    p_record[len++] = p_sample->peer;
+
+    frame_write(RTT_STREAM_RECORD_DISTANCE, frame, len);
+
+    if (p_sample->p_burst != NULL)
+    {
+        histogram_write(p_sample->p_burst);
+    }
+}
+
+
+void rtt_stream_result_write(rtt_session_result_t const * p_result)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_RESULT_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+    len += uint32_encode(p_result->index, &p_record[len]);
+    len += uint32_encode((uint32_t)distance_mm_get(p_result->distance_m), &p_record[len]);
+    len += uint16_encode((uint16_t)MIN(p_result->bursts, UINT16_MAX), &p_record[len]);
+    p_record[len++] = p_result->peer;
+
+    frame_write(RTT_STREAM_RECORD_RESULT, frame, len);
+}
+
+
+void rtt_stream_counters_write(rtt_stream_counters_t const * p_counters)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_COUNTERS_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+    len += uint32_encode(p_counters->bursts, &p_record[len]);
+    len += uint32_encode(p_counters->blocked, &p_record[len]);
+    len += uint32_encode(p_counters->requests, &p_record[len]);
+    len += uint32_encode(p_counters->grants, &p_record[len]);
+    len += uint32_encode(p_counters->bursts_dropped, &p_record[len]);
+    len += uint32_encode(p_counters->records_sent, &p_record[len]);
+    len += uint32_encode(p_counters->records_dropped, &p_record[len]);
+    len += uint32_encode(m_frames_dropped, &p_record[len]);
+
+    frame_write(RTT_STREAM_RECORD_COUNTERS, frame, len);
+}
+
+
+void rtt_stream_telemetry_write(uint8_t peer, rtt_telemetry_t const * p_telemetry)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_TELEMETRY_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+    p_record[len++] = (uint8_t)p_telemetry->valid;
+
+    for (uint32_t i = 0; i < RTT_TELEMETRY_FIELDS; i++)
+    {
+        len += uint32_encode(p_telemetry->values[i], &p_record[len]);
+    }
+    p_record[len++] = peer;
+
+    frame_write(RTT_STREAM_RECORD_TELEMETRY, frame, len);
+}
+
+
+void rtt_stream_stats_write(rtt_stats_t const * p_session, rtt_stats_t const * p_lifetime)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_STATS_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+    len += rtt_stats_encode(RTT_STATS_ROLE_INITIATOR, p_session, p_lifetime, &p_record[len]);
+
+    frame_write(RTT_STREAM_RECORD_STATS, frame, len);
+}
+
+
+void rtt_stream_peer_write(uint8_t peer, uint8_t weight, uint8_t period_bursts, rtt_stats_t const * p_session)
+{
+    uint8_t        frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_PEER_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t        * p_record   = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t const * p_counters = (uint32_t const *)p_session;
+    uint32_t       len          = 0;
+
+    len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+    p_record[len++] = peer;
+    p_record[len++] = weight;
+    p_record[len++] = period_bursts;
+
+    for (uint32_t i = 0; i < RTT_STATS_COUNTERS; i++)
+    {
+        len += uint32_encode(p_counters[i], &p_record[len]);
+    }
+
+    frame_write(RTT_STREAM_RECORD_PEER, frame, len);
+}
+
+
+void rtt_stream_position_write(rtt_position_t const * p_position)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_POSITION_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t len        = 0;
+
+    len += uint32_encode(p_position->timestamp, &p_record[len]);
+    len += uint32_encode((uint32_t)p_position->x_mm, &p_record[len]);
+    len += uint32_encode((uint32_t)p_position->y_mm, &p_record[len]);
+    len += uint32_encode((uint32_t)p_position->z_mm, &p_record[len]);
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(p_position->covariance_mm2); i++)
+    {
+        len += uint32_encode((uint32_t)p_position->covariance_mm2[i], &p_record[len]);
+    }
+
+    len += uint16_encode(p_position->rms_residual_mm, &p_record[len]);
+    p_record[len++] = p_position->anchors;
+    p_record[len++] = p_position->iterations;
+    len += uint32_encode(p_position->cycles, &p_record[len]);
+
+    frame_write(RTT_STREAM_RECORD_POSITION, frame, len);
+}
+
+
+#if RTT_PROFILER_ENABLED
+void rtt_stream_profile_write(rtt_profile_t const * p_profile)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_PROFILE_LEN + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record  = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t timestamp   = app_timer_cnt_get();
+
+    for (uint32_t i = 0; i < RTT_PROFILER_PHASES; i++)
+    {
+        rtt_profiler_stats_t const * p_stats = &p_profile->phases[i];
+        uint32_t                     len     = 0;
+
+        if (p_stats->count == 0)
+        {
+            continue;
+        }
+
+        len += uint32_encode(timestamp, &p_record[len]);
+        p_record[len++] = (uint8_t)i;
+        p_record[len++] = (uint8_t)(SystemCoreClock / 1000000UL);
+        len += uint32_encode(p_stats->count, &p_record[len]);
+        len += uint32_encode(p_stats->min, &p_record[len]);
+        len += uint32_encode(p_stats->sum / p_stats->count, &p_record[len]);
+        len += uint32_encode(p_stats->max, &p_record[len]);
+
+        for (uint32_t j = 0; j < RTT_PROFILER_BUCKETS; j++)
+        {
+            len += uint16_encode(p_stats->buckets[j], &p_record[len]);
+        }
+
+        frame_write(RTT_STREAM_RECORD_PROFILE, frame, len);
+    }
+}
+#endif
+
+
+#if RTT_TRACE_ENABLED
+void rtt_stream_trace_write(void)
+{
+    uint8_t  frame[RTT_STREAM_HEADER_LEN + RTT_STREAM_TRACE_HEADER_LEN + 4 * RTT_STREAM_TRACE_MAX_EVENTS + RTT_STREAM_CRC_LEN];
+    uint8_t  * p_record = &frame[RTT_STREAM_HEADER_LEN];
+    uint32_t events[RTT_STREAM_TRACE_MAX_EVENTS];
+    uint32_t count;
+    uint32_t lost;
+
+    for (;;)
+    {
+        uint32_t len = 0;
+
+        /* Leave the events in the trace until a full record fits, rather than drop the record */
+        if ((STREAM_BUFFER_SIZE - (m_head - m_tail)) < RTT_STREAM_ENCODED_LEN(sizeof(frame)))
+        {
+            return;
+        }
+
+        count = rtt_trace_read(events, RTT_STREAM_TRACE_MAX_EVENTS, &lost);
+        if ((count == 0) && (lost == 0))
+        {
+            return;
+        }
+
+        len += uint32_encode(app_timer_cnt_get(), &p_record[len]);
+        len += uint32_encode(lost, &p_record[len]);
+        p_record[len++] = (uint8_t)count;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            len += uint32_encode(events[i], &p_record[len]);
+        }
+
+        frame_write(RTT_STREAM_RECORD_TRACE, frame, len);
+    }
+}
+#endif
+
+
+uint32_t rtt_stream_dropped_get(void)
+{
+    return m_frames_dropped;
+}
+
+
+uint32_t rtt_stream_init(void)
+{
+    nrfx_uarte_config_t config = NRFX_UARTE_DEFAULT_CONFIG;
+    uint32_t            err_code;
+
+    config.pseltxd            = STREAM_TX_PIN;
+    config.pselrxd            = NRF_UARTE_PSEL_DISCONNECTED;
+    config.pselcts            = NRF_UARTE_PSEL_DISCONNECTED;
+    config.pselrts            = NRF_UARTE_PSEL_DISCONNECTED;
+    config.hwfc               = NRF_UARTE_HWFC_DISABLED;
+    config.baudrate           = STREAM_BAUDRATE;
+    config.interrupt_priority = APP_IRQ_PRIORITY_LOW;
+
+    err_code = nrfx_uarte_init(&m_uarte, &config, uarte_evt_handler);
+    VERIFY_SUCCESS(err_code);
+
+    /* Ends whatever the receiver got before the reset, so the first frame is decoded */
+    m_buffer[0] = RTT_STREAM_DELIMITER;
+    m_head      = 1;
+    tx_start();
+
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_STREAM_H__
+#define RTT_STREAM_H__
+
+#include <stdint.h>
+#include "rtt_estimator.h"
+#include "rtt_session.h"
+#include "rtt_telemetry.h"
+#include "rtt_stats.h"
+#include "rtt_profiler.h"
+#include "rtt_trace.h"
+#include "rtt_position.h"
+#include "rtt_stream_format.h"
+
+/**@brief Binary record stream
+ *
+ * @details Distances, histograms, results and counters are written as binary records (see
+ *          rtt_stream_format.h) to a buffer that UARTE0 sends by EasyDMA without the CPU. The
+ *          stream takes the board's virtual COM port, so the log goes to RTT. A record that does
+ *          not fit the buffer is dropped and counted, and the receiver sees a gap in the
+ *          sequence numbers. host/rtt_stream_decode decodes the stream.
+ *
+ *          Records may be written from the main loop and from app_timer handlers.
+ */
+
+/**@brief Counters written to the stream by rtt_stream_counters_write
+ */
+typedef struct
+{
+    uint32_t bursts;          /**< Bursts completed in the report interval. */
+    uint32_t blocked;         /**< Bursts blocked in the report interval. */
+    uint32_t requests;        /**< Timeslot requests since start-up. */
+    uint32_t grants;          /**< Timeslot grants since start-up. */
+    uint32_t bursts_dropped;  /**< Bursts dropped before processing since start-up. */
+    uint32_t records_sent;    /**< Result records written to the responder since start-up. */
+    uint32_t records_dropped; /**< Result records dropped since start-up. */
+} rtt_stream_counters_t;
+
+
+/**@brief Function for initializing the stream and its UART.
+ */
+uint32_t rtt_stream_init(void);
+
+
+/**@brief Write the distance measured by a burst, followed by its histogram.
+ *
+ * @param[in] p_sample Sample from a RTT_SESSION_EVT_SAMPLE event.
+ */
+void rtt_stream_sample_write(rtt_session_sample_t const * p_sample);
+
+
+/**@brief Write an averaged session result.
+ *
+ * @param[in] p_result Result from a RTT_SESSION_EVT_RESULT event.
+ */
+void rtt_stream_result_write(rtt_session_result_t const * p_result);
+
+
+/**@brief Write the counters. The number of dropped stream frames is added.
+ */
+void rtt_stream_counters_write(rtt_stream_counters_t const * p_counters);
+
+
+/**@brief Write the latest telemetry of a responder.
+ */
+void rtt_stream_telemetry_write(uint8_t peer, rtt_telemetry_t const * p_telemetry);
+
+
+/**@brief Write a snapshot of the ranging statistics of this initiator.
+ */
+void rtt_stream_stats_write(rtt_stats_t const * p_session, rtt_stats_t const * p_lifetime);
+
+
+/**@brief Write the share of the bursts and the session statistics of a responder.
+ *
+ * @param[in] peer          Peer index of the responder.
+ * @param[in] weight        Weight asked for by the responder.
+ * @param[in] period_bursts Period of its bursts in the frame, in bursts.
+ * @param[in] p_session     Its counters since the start of the session.
+ */
+void rtt_stream_peer_write(uint8_t peer, uint8_t weight, uint8_t period_bursts, rtt_stats_t const * p_session);
+
+
+/**@brief Write a position solved from the distances to the anchors.
+ */
+void rtt_stream_position_write(rtt_position_t const * p_position);
+
+
+#if RTT_PROFILER_ENABLED
+/**@brief Write a profile record for every phase that was timed.
+ */
+void rtt_stream_profile_write(rtt_profile_t const * p_profile);
+#endif
+
+
+#if RTT_TRACE_ENABLED
+/**@brief Write trace records with the events in the trace, until it is empty. Called from the
+ *        main loop only.
+ */
+void rtt_stream_trace_write(void);
+#endif
+
+
+/**@brief Get the number of frames dropped because the buffer was full.
+ */
+uint32_t rtt_stream_dropped_get(void);
+
+#endif // RTT_STREAM_H__
@@ -0,0 +1,213 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_STREAM_FORMAT_H__
+#define RTT_STREAM_FORMAT_H__
+
+#include <stdint.h>
+
+/**@brief Binary record stream format
+ *
+ * @details The stream is a sequence of frames, each COBS encoded and ended by a zero byte, so a
+ *          receiver joining mid-stream or losing bytes resynchronizes at the next zero. A decoded
+ *          frame is a header, a record and a CRC. All fields are little endian.
+ *
+ *          Frame:
+ *          | Offset | Size | Field                                                      |
+ *          |--------|------|------------------------------------------------------------|
+ *          | 0      | 1    | Record type, RTT_STREAM_RECORD_*                           |
+ *          | 1      | 2    | Sequence number, incremented for every frame, also dropped |
+ *          | 3      | n    | Record                                                     |
+ *          | 3 + n  | 2    | CRC-16/CCITT-FALSE of the header and record                |
+ *
+ *          Timestamps are the 24-bit RTC counter, 32768 Hz, which wraps after 512 s. A counters
+ *          record is written at least every RATE_REPORT_INTERVAL_MS, so a receiver that sees
+ *          every report can extend the timestamps.
+ *
+ *          Records about one responder carry its peer index, the index of its link. Records
+ *          written before the initiator ranged with several responders end before the peer
+ *          index and are about responder 0.
+ *
+ *          Distance record, one for every burst with a valid distance:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp at the end of the burst             |
+ *          | 4      | 4    | Distance in millimeters, signed               |
+ *          | 8      | 2    | Exchanges attempted                           |
+ *          | 10     | 2    | Exchanges with a valid response               |
+ *          | 12     | 1    | Peer index                                    |
+ *
+ *          Result record, one for every averaged session result:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp when the result was calculated      |
+ *          | 4      | 4    | Result number of the responder in the session |
+ *          | 8      | 4    | Mean distance in millimeters, signed          |
+ *          | 12     | 2    | Bursts averaged                               |
+ *          | 14     | 1    | Peer index                                    |
+ *
+ *          Histogram record, the round trip histogram of the burst of the preceding distance
+ *          record. Only the bins from the first to the last non-empty bin are written:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp at the end of the burst             |
+ *          | 4      | 2    | Exchanges attempted                           |
+ *          | 6      | 2    | Exchanges with a valid response               |
+ *          | 8      | 1    | Index of the first bin written                |
+ *          | 9      | 1    | Number of bins written, n                     |
+ *          | 10     | 2n   | Bin counts                                    |
+ *
+ *          Counters record, written every RATE_REPORT_INTERVAL_MS. Bursts and blocked count
+ *          the report interval, the others are totals since start-up:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 4    | Bursts completed                              |
+ *          | 8      | 4    | Bursts blocked                                |
+ *          | 12     | 4    | Timeslot requests                             |
+ *          | 16     | 4    | Timeslot grants                               |
+ *          | 20     | 4    | Bursts dropped before processing              |
+ *          | 24     | 4    | Result records written to the responder       |
+ *          | 28     | 4    | Result records dropped                        |
+ *          | 32     | 4    | Stream frames dropped, buffer full            |
+ *
+ *          Telemetry record, the latest telemetry of a responder (see rtt_telemetry.h), written
+ *          with the counters once any field has been received from it:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 1    | Bit n is set if field n has been received     |
+ *          | 5      | 4    | Packets received with a valid CRC             |
+ *          | 9      | 4    | Packets received with a CRC error             |
+ *          | 13     | 4    | Responses sent                                |
+ *          | 17     | 4    | RSSI of the last valid packet, dBm, signed    |
+ *          | 21     | 4    | Die temperature, 0.25 degrees C, signed       |
+ *          | 25     | 1    | Peer index                                    |
+ *
+ *          Statistics record, a snapshot of the ranging statistics of all responders together
+ *          (see rtt_stats.h), written with the counters. The eight counters are, in order:
+ *          bursts, packets sent, packets received with a valid CRC, with a CRC error, with an
+ *          unexpected sequence number, exchanges without a response, timeslot requests and
+ *          timeslot grants:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 1    | Role, 0 initiator, 1 responder                |
+ *          | 5      | 32   | Counters since the start of the session       |
+ *          | 37     | 32   | Counters since start-up                       |
+ *
+ *          Peer record, the share of the bursts and the session statistics of one connected
+ *          responder, written with the counters. The counters are those of the statistics
+ *          record, with the timeslot counters shared by all responders:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 1    | Peer index                                    |
+ *          | 5      | 1    | Weight asked for by the responder             |
+ *          | 6      | 1    | Period of its bursts, in bursts               |
+ *          | 7      | 32   | Counters since the start of the session       |
+ *
+ *          Profile record, one for every phase of the exchanges that was timed since the
+ *          previous report (see rtt_profiler.h), written with the counters when the profiler is
+ *          enabled. Times are CPU cycles, bucket i counts the phases that took from 2^i to
+ *          2^(i+1) - 1 cycles, and the last bucket also everything longer:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 1    | Phase, RTT_PROFILER_* in rtt_profiler.h       |
+ *          | 5      | 1    | CPU clock, MHz                                |
+ *          | 6      | 4    | Times the phase was timed                     |
+ *          | 10     | 4    | Shortest                                      |
+ *          | 14     | 4    | Mean                                          |
+ *          | 18     | 4    | Longest                                       |
+ *          | 22     | 32   | 16 buckets of 2 bytes                         |
+ *
+ *          Trace record, the timeslot and exchange events traced since the previous trace record
+ *          (see rtt_trace.h), written from the main loop when the trace is enabled. An event is
+ *          the event ID in the top byte and the RTC counter when it happened below it:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp                                     |
+ *          | 4      | 4    | Events lost before the first event, ring full |
+ *          | 8      | 1    | Number of events, n                           |
+ *          | 9      | 4n   | Events, oldest first                          |
+ *
+ *          Position record, one for every position solved from the distances to the anchors
+ *          (see rtt_position.h). In 2D the z terms of the covariance are 0:
+ *          | Offset | Size | Field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 4    | Timestamp of the newest distance              |
+ *          | 4      | 12   | x, y and z in millimeters, signed             |
+ *          | 16     | 24   | Covariance xx, xy, xz, yy, yz and zz, mm^2    |
+ *          | 40     | 2    | Weighted RMS of the residuals, millimeters    |
+ *          | 42     | 1    | Anchors used                                  |
+ *          | 43     | 1    | Iterations                                    |
+ *          | 44     | 4    | CPU cycles of the update, 0 if not profiled   |
+ */
+
+#define RTT_STREAM_DELIMITER            0x00    /**< Ends every encoded frame. */
+
+#define RTT_STREAM_RECORD_DISTANCE      0x01
+#define RTT_STREAM_RECORD_RESULT        0x02
+#define RTT_STREAM_RECORD_HISTOGRAM     0x03
+#define RTT_STREAM_RECORD_COUNTERS      0x04
+#define RTT_STREAM_RECORD_TELEMETRY     0x05
+#define RTT_STREAM_RECORD_STATS         0x06
+#define RTT_STREAM_RECORD_PROFILE       0x07
+#define RTT_STREAM_RECORD_TRACE         0x08
+#define RTT_STREAM_RECORD_PEER          0x09
+#define RTT_STREAM_RECORD_POSITION      0x0A
+
+#define RTT_STREAM_HEADER_LEN           3
+#define RTT_STREAM_CRC_LEN              2
+#define RTT_STREAM_DISTANCE_LEN         13
+#define RTT_STREAM_DISTANCE_V1_LEN      12      /**< Without the peer index. */
+#define RTT_STREAM_RESULT_LEN           15
+#define RTT_STREAM_RESULT_V1_LEN        14      /**< Without the peer index. */
+#define RTT_STREAM_HISTOGRAM_HEADER_LEN 10
+#define RTT_STREAM_HISTOGRAM_MAX_BINS   128     /**< RTT_NUM_BINS */
+#define RTT_STREAM_COUNTERS_LEN         36
+#define RTT_STREAM_TELEMETRY_LEN        26
+#define RTT_STREAM_TELEMETRY_V1_LEN     25      /**< Without the peer index. */
+#define RTT_STREAM_STATS_LEN            69
+#define RTT_STREAM_STATS_COUNTERS       8
+#define RTT_STREAM_PROFILE_LEN          54
+#define RTT_STREAM_PROFILE_BUCKETS      16
+#define RTT_STREAM_TRACE_HEADER_LEN     9
+#define RTT_STREAM_TRACE_MAX_EVENTS     64
+#define RTT_STREAM_PEER_LEN             39
+#define RTT_STREAM_POSITION_LEN         48
+
+#define RTT_STREAM_DISTANCE_INVALID     INT32_MIN /**< Distance that could not be represented. */
+
+/**@brief Longest record */
+#define RTT_STREAM_MAX_RECORD_LEN       (RTT_STREAM_HISTOGRAM_HEADER_LEN + 2 * RTT_STREAM_HISTOGRAM_MAX_BINS)
+
+/**@brief Longest frame before encoding */
+#define RTT_STREAM_MAX_FRAME_LEN        (RTT_STREAM_HEADER_LEN + RTT_STREAM_MAX_RECORD_LEN + RTT_STREAM_CRC_LEN)
+
+/**@brief Longest encoding of a frame of n bytes, with the delimiter */
+#define RTT_STREAM_ENCODED_LEN(n)       ((n) + ((n) / 254) + 2)
+
+#endif // RTT_STREAM_FORMAT_H__
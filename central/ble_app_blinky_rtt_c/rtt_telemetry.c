@@ -0,0 +1,59 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "app_util_platform.h"
+#include "rtt_parameters.h"
+#include "rtt_telemetry.h"
+
+static rtt_telemetry_t m_latest[RTT_PEERS_MAX];
+
+
+void rtt_telemetry_update(uint8_t peer, rtt_telemetry_t const * p_telemetry)
+{
+    if ((p_telemetry->valid == 0) || (peer >= RTT_PEERS_MAX))
+    {
+        return;
+    }
+
+    /* The rate report reads the telemetry from a timer handler */
+    CRITICAL_REGION_ENTER();
+    for (uint32_t i = 0; i < RTT_TELEMETRY_FIELDS; i++)
+    {
+        if (p_telemetry->valid & (1UL << i))
+        {
+            m_latest[peer].values[i] = p_telemetry->values[i];
+        }
+    }
+    m_latest[peer].valid |= p_telemetry->valid;
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_telemetry_get(uint8_t peer, rtt_telemetry_t * p_telemetry)
+{
+    CRITICAL_REGION_ENTER();
+    *p_telemetry = m_latest[peer];
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,91 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_TELEMETRY_H__
+#define RTT_TELEMETRY_H__
+
+#include <stdint.h>
+
+/**@brief Responder telemetry carried in the ranging responses
+ *
+ * @details The response payload has two bytes after the echoed sequence number that used to be
+ *          fixed filler. They now carry one byte of one telemetry field, so the initiator sees
+ *          the responder's state without extra airtime or GATT traffic:
+ *
+ *          | Offset | Size | Field                                                 |
+ *          |--------|------|-------------------------------------------------------|
+ *          | 2      | 2    | Sequence number, big endian                           |
+ *          | 4      | 1    | Tag: field index in bits 7-4, byte index in bits 1-0  |
+ *          | 5      | 1    | Byte of the field value                               |
+ *
+ *          The responder takes a snapshot of a field when it sends its first byte, then sends
+ *          the four bytes least significant first in consecutive responses, and moves on to
+ *          the next field. The initiator only accepts a field whose four bytes arrive in order,
+ *          so a lost response costs at most one field value and values never tear.
+ *
+ *          A responder serving several initiators keeps the fields of each apart. The counters
+ *          and the RSSI are those of the initiator the response goes to, counted since it was
+ *          first served.
+ */
+typedef enum
+{
+    RTT_TELEMETRY_RX_OK,        /**< Packets received with a valid CRC. */
+    RTT_TELEMETRY_RX_CRC_ERROR, /**< Packets received with a CRC error. */
+    RTT_TELEMETRY_TX,           /**< Responses sent. */
+    RTT_TELEMETRY_RSSI,         /**< RSSI of the last packet with a valid CRC, dBm, signed. */
+    RTT_TELEMETRY_TEMPERATURE,  /**< Die temperature, 0.25 degrees Celsius, signed. */
+    RTT_TELEMETRY_FIELDS
+} rtt_telemetry_field_t;
+
+#define RTT_TELEMETRY_FIELD_LEN             4   /* Bytes in a field value */
+
+#define RTT_TELEMETRY_TAG(field, byte)      ((uint8_t)(((field) << 4) | ((byte) & 0x03)))
+#define RTT_TELEMETRY_TAG_FIELD(tag)        ((tag) >> 4)
+#define RTT_TELEMETRY_TAG_BYTE(tag)         ((tag) & 0x03)
+
+/**@brief Telemetry fields received from the responder
+ */
+typedef struct
+{
+    uint32_t valid;                          /**< Bit n is set if values[n] was received. */
+    uint32_t values[RTT_TELEMETRY_FIELDS];   /**< Field values, indexed by rtt_telemetry_field_t. */
+} rtt_telemetry_t;
+
+
+/**@brief Take the fields received during a burst into the latest telemetry of its responder.
+ *
+ * @details Called from the main loop for every burst.
+ *
+ * @param[in] peer        Responder ranged with in the burst, below RTT_PEERS_MAX.
+ * @param[in] p_telemetry Fields received during the burst.
+ */
+void rtt_telemetry_update(uint8_t peer, rtt_telemetry_t const * p_telemetry);
+
+
+/**@brief Get the latest value received from a responder of every field. Can be called from any
+ *        context.
+ */
+void rtt_telemetry_get(uint8_t peer, rtt_telemetry_t * p_telemetry);
+
+#endif // RTT_TELEMETRY_H__
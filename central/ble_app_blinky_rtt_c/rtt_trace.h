@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_TRACE_H__
+#define RTT_TRACE_H__
+
+#include <stdint.h>
+#include "rtt_parameters.h"
+
+/**@brief Event trace of the timeslots and exchanges
+ *
+ * @details When RTT_TRACE_ENABLED is set, the timeslot and radio code write an event to a ring
+ *          in RAM wherever the debug pins used to be toggled: at the start and end of every
+ *          timeslot, at every extension request and its outcome, and at the start and end of
+ *          every exchange. An event is one word, the event ID in the top byte and the 24-bit
+ *          RTC counter of app_timer, 32768 Hz, below it, the same clock as the timestamps of
+ *          the binary stream.
+ *
+ *          Events are written from the timeslot callback, which cannot be masked, and from the
+ *          timeslot interrupts. The index is claimed with an exclusive store, so a writer that
+ *          is interrupted takes the timestamp again and the events stay in time order. When
+ *          the ring is full the oldest events are overwritten, and the reader counts them as
+ *          lost. The initiator writes the events to the binary stream from the main loop. The
+ *          responder has no stream, and its ring is read with a debugger, see
+ *          host/rtt_trace_analyze.
+ */
+typedef enum
+{
+    RTT_TRACE_SLOT_START = 1,       /**< Timeslot started. */
+    RTT_TRACE_SLOT_END,             /**< Timeslot ended. */
+    RTT_TRACE_EXTEND_REQUEST,       /**< Timeslot extension requested. */
+    RTT_TRACE_EXTEND_SUCCEEDED,     /**< Timeslot extension granted. */
+    RTT_TRACE_EXTEND_FAILED,        /**< Timeslot extension refused. */
+    RTT_TRACE_EXCHANGE_START,       /**< Exchange started: request sent, or listening for a request. */
+    RTT_TRACE_EXCHANGE_VALID,       /**< Exchange ended with a valid packet. */
+    RTT_TRACE_EXCHANGE_CRC_ERROR,   /**< Exchange ended with a CRC error. */
+    RTT_TRACE_EXCHANGE_IGNORED,     /**< Exchange ended with a response to another request. */
+    RTT_TRACE_EXCHANGE_TIMEOUT,     /**< Exchange ended without a packet. */
+    RTT_TRACE_EXCHANGE_EXPIRED,     /**< Exchange cut short by the end of the burst. */
+    RTT_TRACE_EVENTS
+} rtt_trace_event_t;
+
+#define RTT_TRACE_TICKS_MASK    0x00FFFFFFUL    /**< RTC ticks of an event. */
+#define RTT_TRACE_EVENT_POS     24              /**< Position of the event ID. */
+
+#if RTT_TRACE_ENABLED
+
+/**@brief Write an event to the trace.
+ */
+void rtt_trace_write(rtt_trace_event_t event);
+
+
+/**@brief Read the oldest events from the trace. Called from the main loop only.
+ *
+ * @param[out] p_events   Events read.
+ * @param[in]  max_events Size of p_events.
+ * @param[out] p_lost     Events overwritten before they were read, since the previous call.
+ *
+ * @return Number of events read.
+ */
+uint32_t rtt_trace_read(uint32_t * p_events, uint32_t max_events, uint32_t * p_lost);
+
+#define RTT_TRACE(event)    rtt_trace_write(event)
+
+#else
+
+#define RTT_TRACE(event)    do { } while (0)
+
+#endif // RTT_TRACE_ENABLED
+
+#endif // RTT_TRACE_H__
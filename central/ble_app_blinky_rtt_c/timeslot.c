@@ -24,8 +24,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "nrf.h"
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "nrf_gpio.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
@@ -34,8 +36,13 @@
 #include "timeslot.h"
 #include "nrf_error.h"
 #include "nrf_sdm.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
 #include "radio_001.h"
 #include "rtt_parameters.h"
+#include "rtt_config.h"
+#include "rtt_queue.h"
+#include "rtt_trace.h"
 
 #define LED3 2
 #define LED4 3
@@ -46,31 +53,261 @@ static uint32_t             m_slot_length;
 static uint32_t             m_total_timeslot_length = 0;
 
 static nrf_radio_signal_callback_return_param_t signal_callback_return_param;
+static timeslot_burst_handler_t m_burst_handler;
+
+/* Bursts measured in the timeslot and waiting for the main loop */
+RTT_QUEUE_DEF(rtt_burst_t, m_burst_queue, RTT_BURST_QUEUE_SIZE);
+static rtt_burst_t          m_burst_scratch;                                    /* Used when the queue is full */
+static volatile uint32_t    m_bursts_dropped  = 0;
+
+/* Variables for the power policy */
+static timeslot_power_policy_t m_power_policy = TS_DEFAULT_POWER_POLICY;
+static bool                 m_hfxo_held       = false; /* The HFXO is requested from the SoftDevice for the session */
+static volatile bool        m_hfxo_warm       = false; /* A timeslot of the session has started the HFXO */
+static uint32_t             m_hfxo_held_since;         /* app_timer ticks when the HFXO was requested or last reported */
+static uint32_t             m_hfxo_held_ticks = 0;     /* app_timer ticks the HFXO was held before it was released */
+static volatile uint32_t    m_slot_start_us;           /* TIMER0 at the start of the timeslot or extension */
+static volatile uint32_t    m_slot_end_us;             /* TIMER0 at the end of the timeslot */
+static bool                 m_radio_powered   = false; /* The radio is kept powered between bursts */
+static uint32_t             m_radio_on_since_us;       /* TIMER0 when the radio was powered */
+
+/* Power statistics, only updated at TIMESLOT_BEGIN and TIMESLOT_END priority */
+static timeslot_power_stats_t m_power_stats = {.latency_min_us = UINT32_MAX};
+static uint32_t             m_latency_sum_us  = 0;
+
+/* Variables for the ranging schedule */
+static timeslot_schedule_t  m_schedule = {TS_DEFAULT_RATE_HZ, TS_DEFAULT_EXCHANGES, 0};  /* Schedule used by timeslot requests */
+static timeslot_schedule_t  m_schedule_pending;                                      /* Schedule to use from the next request */
+static volatile bool        m_schedule_pending_valid = false;
+static uint32_t             m_period_us;
+static uint32_t             m_burst_length_us;
+static uint8_t              m_frame_index     = 0; /* Position of the next burst in the frame */
+
+static volatile bool        m_running         = false; /* Ranging is wanted */
+static volatile bool        m_request_pending = false; /* A timeslot request is queued in the SoftDevice */
+static volatile bool        m_slot_active     = false; /* A timeslot is in progress */
+static volatile uint32_t    m_bursts          = 0;
+static volatile uint32_t    m_blocked         = 0;
+static volatile uint32_t    m_requests        = 0;
+static volatile uint32_t    m_grants          = 0;
+
+/* Variables for single-shot bursts */
+static volatile bool        m_single_shot     = false; /* The requested or active timeslot is a single-shot burst */
+static uint32_t             m_single_shot_exchanges;
+static uint8_t              m_single_shot_peer;
+static rtt_link_t           m_single_shot_link;
+static rtt_burst_t          m_single_shot_failed;      /* Reported when the single-shot timeslot is not granted */
+static volatile bool        m_single_shot_pending = false; /* A single-shot burst goes ahead of the schedule when the current timeslot ends */
+static volatile bool        m_preempting      = false; /* The session is closed to take back the timeslot requested for the schedule */
+static bool                 m_single_shot_alone   = false; /* Ranging was stopped, nothing follows the single-shot burst */
+static uint32_t             m_sched_end_ticks;         /* app_timer ticks at the end of the last scheduled timeslot */
+static uint32_t             m_sched_end_us;            /* TIMER0 at the end of the last scheduled timeslot */
+static uint32_t             m_phase_us        = 0;     /* Time from the start of the last scheduled timeslot to the single-shot one */
+
+static void soc_evt_handler(uint32_t evt_id, void * p_context);
+
+NRF_SDH_SOC_OBSERVER(m_timeslot_soc_observer, TIMESLOT_SOC_OBSERVER_PRIO, soc_evt_handler, NULL);
+
+/**@brief Pass the queued bursts to the burst handler. Runs in the main loop.
+ */
+static void burst_queue_process(void * p_event_data, uint16_t event_size)
+{
+    rtt_burst_t const * p_burst;
+
+    while ((p_burst = rtt_queue_read_peek(&m_burst_queue)) != NULL)
+    {
+        if (m_burst_handler != NULL)
+        {
+            m_burst_handler(p_burst);
+        }
+        rtt_queue_read_release(&m_burst_queue);
+    }
+}
+
+
+/**@brief Report a single-shot burst that did not get a timeslot. Runs in the main loop.
+ */
+static void single_shot_failed_process(void * p_event_data, uint16_t event_size)
+{
+    if (m_burst_handler != NULL)
+    {
+        m_burst_handler(&m_single_shot_failed);
+    }
+}
+
+
+/**@brief Check whether the power policy lets the SoftDevice start the HFXO for every timeslot
+ *        and powers the radio down after every burst, at a burst rate.
+ */
+static bool power_per_slot(uint32_t rate_hz)
+{
+    return (m_power_policy == TIMESLOT_POWER_POLICY_PER_SLOT) ||
+           ((m_power_policy == TIMESLOT_POWER_POLICY_AUTO) && (rate_hz != 0));
+}
+
+
+/**@brief Take the pending schedule into use. Must only be called when building a timeslot request.
+ */
+static void schedule_apply(void)
+{
+    if (m_schedule_pending_valid)
+    {
+        m_schedule               = m_schedule_pending;
+        m_schedule_pending_valid = false;
+        m_frame_index            = 0;
+    }
+
+    if (m_schedule.rate_hz != 0)
+    {
+        m_period_us       = 1000000UL / m_schedule.rate_hz;
+        m_burst_length_us = TS_BURST_LENGTH_US(m_schedule.exchanges, rtt_config_get()->burst_margin_us);
+    }
+}
+
+
+/**@brief Get the HFXO configuration for the next timeslot request.
+ *
+ * @details With the per-session policy the first timeslot waits for the crystal. The clock
+ *          request in timeslot_start() then keeps it running, so the following timeslots do not
+ *          need the SoftDevice to start it and wait for it to settle.
+ */
+static uint8_t hfclk_cfg_get(void)
+{
+    return m_hfxo_warm ? NRF_RADIO_HFCLK_CFG_NO_GUARANTEE : NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
+}
+
 
 /**@brief Request next timeslot event in earliest configuration
  */
 uint32_t request_next_event_earliest(void)
 {
-    m_slot_length                                  = TS_LEN_US;
+    uint32_t err_code;
+
+    schedule_apply();
+    configure_next_event_earliest();
+
+    err_code = sd_radio_request(&m_timeslot_request);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_request_pending = true;
+        m_requests++;
+    }
+    return err_code;
+}
+
+
+/**@brief Configure next timeslot event in earliest configuration
+ */
+void configure_next_event_earliest(void)
+{
+    m_slot_length                                  = (m_schedule.rate_hz == 0) ? rtt_config_get()->slot_length_us : m_burst_length_us;
     m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_EARLIEST;
-    m_timeslot_request.params.earliest.hfclk       = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
+    m_timeslot_request.params.earliest.hfclk       = hfclk_cfg_get();
     m_timeslot_request.params.earliest.priority    = NRF_RADIO_PRIORITY_HIGH;
     m_timeslot_request.params.earliest.length_us   = m_slot_length;
     m_timeslot_request.params.earliest.timeout_us  = NRF_RADIO_EARLIEST_TIMEOUT_MAX_US;
-    return sd_radio_request(&m_timeslot_request);
 }
 
 
-/**@brief Configure next timeslot event in earliest configuration
+/**@brief Configure a single-shot timeslot request
+ *
+ * @details One burst as soon as possible. The request is given up after
+ *          TS_SINGLE_SHOT_TIMEOUT_US rather than waiting behind the BLE activity.
  */
-void configure_next_event_earliest(void)
+static void configure_single_shot(void)
 {
-    m_slot_length                                  = TS_LEN_EXTENSION_US;
+    m_slot_length                                  = TS_BURST_LENGTH_US(m_single_shot_exchanges, rtt_config_get()->burst_margin_us);
     m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_EARLIEST;
-    m_timeslot_request.params.earliest.hfclk       = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
+    m_timeslot_request.params.earliest.hfclk       = hfclk_cfg_get();
     m_timeslot_request.params.earliest.priority    = NRF_RADIO_PRIORITY_HIGH;
     m_timeslot_request.params.earliest.length_us   = m_slot_length;
-    m_timeslot_request.params.earliest.timeout_us  = NRF_RADIO_EARLIEST_TIMEOUT_MAX_US;
+    m_timeslot_request.params.earliest.timeout_us  = TS_SINGLE_SHOT_TIMEOUT_US;
+}
+
+
+/**@brief Request the single-shot timeslot
+ */
+static uint32_t request_single_shot(void)
+{
+    uint32_t err_code;
+
+    m_single_shot = true;
+    configure_single_shot();
+
+    err_code = sd_radio_request(&m_timeslot_request);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_request_pending = true;
+        m_requests++;
+    }
+    else
+    {
+        m_single_shot = false;
+    }
+    return err_code;
+}
+
+
+/**@brief Configure next timeslot event in normal configuration
+ *
+ * @details The next burst starts one period after the start of the current timeslot. With the
+ *          per-slot power policy the SoftDevice only runs the HFXO for the duration of the
+ *          timeslot, so the crystal and the radio are both off between bursts.
+ */
+void configure_next_event_normal(void)
+{
+    m_slot_length                                  = m_burst_length_us;
+    m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_NORMAL;
+    m_timeslot_request.params.normal.hfclk         = hfclk_cfg_get();
+    m_timeslot_request.params.normal.priority      = NRF_RADIO_PRIORITY_HIGH;
+    m_timeslot_request.params.normal.distance_us   = m_period_us;
+    m_timeslot_request.params.normal.length_us     = m_slot_length;
+}
+
+
+/**@brief Configure the request following the current timeslot
+ *
+ * @details After a single-shot timeslot the next burst keeps the phase of the scheduled
+ *          timeslot before it, so the responders' listening windows still meet the bursts. A
+ *          burst of the schedule that would have started during the single-shot timeslot is
+ *          skipped, with its place in the frame.
+ */
+static void configure_next_event(void)
+{
+    /* Length of the timeslot now ending, including extensions */
+    uint32_t elapsed_us = m_slot_length + m_total_timeslot_length;
+    uint32_t distance_us;
+    uint32_t skipped;
+
+    schedule_apply();
+
+    distance_us = m_period_us;
+    if ((m_phase_us != 0) && (m_schedule.rate_hz != 0))
+    {
+        distance_us = m_period_us - (m_phase_us % m_period_us);
+        skipped     = m_phase_us / m_period_us;
+        if (distance_us <= elapsed_us)
+        {
+            distance_us += m_period_us;
+            skipped++;
+        }
+        if (m_schedule.frame_len != 0)
+        {
+            m_frame_index = (m_frame_index + skipped) % m_schedule.frame_len;
+        }
+    }
+    m_phase_us = 0;
+
+    /* A normal request must start after the current timeslot has ended */
+    if ((m_schedule.rate_hz == 0) || (elapsed_us >= distance_us))
+    {
+        configure_next_event_earliest();
+    }
+    else
+    {
+        configure_next_event_normal();
+        m_timeslot_request.params.normal.distance_us = distance_us;
+    }
 }
 
 /**@brief Timeslot signal handler
@@ -85,22 +322,83 @@ void nrf_evt_signal_handler(uint32_t evt_id)
             /* No implementation needed */
             break;
         case NRF_EVT_RADIO_SESSION_IDLE:
-            /* No implementation needed */
+            /* Ranging may have been started again while the last timeslot was ending */
+            if (m_running && !m_request_pending && !m_slot_active && !m_preempting)
+            {
+                err_code = request_next_event_earliest();
+                APP_ERROR_CHECK(err_code);
+            }
             break;
         case NRF_EVT_RADIO_SESSION_CLOSED:
-            /* No implementation needed, session ended */
+            if (!m_preempting)
+            {
+                /* No implementation needed, session ended */
+                break;
+            }
+
+            /* Closed by timeslot_single_shot(): the timeslot requested for the schedule is taken
+             * back, run the single-shot burst in its place */
+            m_preempting      = false;
+            m_request_pending = false;
+            err_code = sd_radio_session_open(radio_callback);
+            APP_ERROR_CHECK(err_code);
+            if (m_running)
+            {
+                /* A timeslot that started before the session closed has already taken the
+                 * single-shot burst from m_single_shot_pending, for the request on its end */
+                if (m_single_shot_pending || m_single_shot)
+                {
+                    m_single_shot_pending = false;
+                    err_code = request_single_shot();
+                }
+                else
+                {
+                    err_code = request_next_event_earliest();
+                }
+                APP_ERROR_CHECK(err_code);
+            }
             break;
         case NRF_EVT_RADIO_BLOCKED:
             /* Fall through */
         case NRF_EVT_RADIO_CANCELED:
-            err_code = request_next_event_earliest();
-            APP_ERROR_CHECK(err_code);
+            m_request_pending = false;
+            if (m_preempting)
+            {
+                /* The request taken back by closing the session */
+                break;
+            }
+            m_blocked++;
+            if (m_single_shot)
+            {
+                /* Not retried, the requester is waiting for an answer */
+                m_single_shot = false;
+                if (m_single_shot_alone)
+                {
+                    m_running = false;
+                }
+                m_single_shot_failed.timestamp = app_timer_cnt_get();
+                err_code = app_sched_event_put(NULL, 0, single_shot_failed_process);
+                APP_ERROR_CHECK(err_code);
+            }
+            if (m_running)
+            {
+                err_code = request_next_event_earliest();
+                APP_ERROR_CHECK(err_code);
+            }
             break;
         default:
             break;
     }
 }
 
+
+/**@brief SoftDevice SoC event handler
+ */
+static void soc_evt_handler(uint32_t evt_id, void * p_context)
+{
+    nrf_evt_signal_handler(evt_id);
+}
+
 /**@brief Timeslot event handler
  */
 nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
@@ -108,7 +406,37 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
     switch(signal_type)
     {
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_START:
-            nrf_gpio_pin_set(DATAPIN_1);
+            m_request_pending = false;
+            m_grants++;
+
+            if (!m_running)
+            {
+                /* Ranging was stopped after this timeslot was requested */
+                m_single_shot = false;
+                signal_callback_return_param.params.request.p_next = NULL;
+                signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
+                break;
+            }
+
+            m_slot_active   = true;
+            m_slot_start_us = 0;
+            if (m_single_shot && m_single_shot_alone)
+            {
+                /* Nothing follows a single-shot burst */
+                m_running = false;
+            }
+            else if (m_single_shot)
+            {
+                /* The schedule resumes at its phase after the single-shot burst */
+                m_phase_us = m_sched_end_us +
+                             (uint32_t)(((uint64_t)app_timer_cnt_diff_compute(app_timer_cnt_get(), m_sched_end_ticks) *
+                                         1000000UL) / APP_TIMER_CLOCK_FREQ);
+            }
+            if (m_hfxo_held)
+            {
+                m_hfxo_warm = true;
+            }
+            RTT_TRACE(RTT_TRACE_SLOT_START);
 
             /* TIMER0 is pre-configured for 1Mhz. */
             NRF_TIMER0->TASKS_STOP          = 1;
@@ -116,12 +444,22 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             NRF_TIMER0->MODE                = (TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos);
             NRF_TIMER0->EVENTS_COMPARE[0]   = 0;
             NRF_TIMER0->EVENTS_COMPARE[1]   = 0;
-    
-            NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos) | 
-                                   (TIMER_INTENSET_COMPARE1_Set << TIMER_INTENSET_COMPARE1_Pos);
 
-            NRF_TIMER0->CC[0]               = (TS_LEN_US - TS_SAFETY_MARGIN_US);
-            NRF_TIMER0->CC[1]               = (TS_LEN_US - TS_EXTEND_MARGIN_US);
+            if ((m_schedule.rate_hz == 0) && !m_single_shot)
+            {
+                /* Continuous ranging: extend the timeslot until TS_TOT_EXT_LENGTH_US */
+                NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos) | 
+                                       (TIMER_INTENSET_COMPARE1_Set << TIMER_INTENSET_COMPARE1_Pos);
+            }
+            else
+            {
+                /* Scheduled burst: a single timeslot without extensions */
+                NRF_TIMER0->INTENCLR = (TIMER_INTENCLR_COMPARE1_Clear << TIMER_INTENCLR_COMPARE1_Pos);
+                NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos);
+            }
+
+            NRF_TIMER0->CC[0]               = (m_slot_length - TS_SAFETY_MARGIN_US);
+            NRF_TIMER0->CC[1]               = (m_slot_length - TS_EXTEND_MARGIN_US);
             NRF_TIMER0->BITMODE             = (TIMER_BITMODE_BITMODE_24Bit << TIMER_BITMODE_BITMODE_Pos);
             NRF_TIMER0->TASKS_START         = 1;
     
@@ -131,6 +469,8 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
+
+            TIMESLOT_BEGIN_EGU->TASKS_TRIGGER[0] = 1;
             break;
 
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO:
@@ -143,45 +483,74 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             if (NRF_TIMER0->EVENTS_COMPARE[0] &&
                (NRF_TIMER0->INTENSET & (TIMER_INTENSET_COMPARE0_Enabled << TIMER_INTENCLR_COMPARE0_Pos)))
             {
-                /* End margin reached. End current timeslot and request new one. */
-                m_timeslot_request.params.earliest.length_us   = TS_LEN_US;
-                m_slot_length                                  = TS_LEN_US;
-
                 NRF_TIMER0->TASKS_STOP  = 1;
                 NRF_TIMER0->EVENTS_COMPARE[0] = 0;
                 (void)NRF_TIMER0->EVENTS_COMPARE[0];
 
-                /* Schedule next timeslot */
-                signal_callback_return_param.params.request.p_next = &m_timeslot_request;
-                signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+                /* The radio may have been kept powered between bursts */
+                radio_power_down();
+                m_slot_end_us = NRF_TIMER0->CC[0];
+                if (m_phase_us == 0)
+                {
+                    /* A scheduled timeslot. Timed at its end, out of the way of the burst. */
+                    m_sched_end_ticks = app_timer_cnt_get();
+                    m_sched_end_us    = m_slot_end_us;
+                }
+
+                if (m_running)
+                {
+                    /* End margin reached. End current timeslot and request the next one. */
+                    if (m_single_shot_pending)
+                    {
+                        /* A single-shot request goes ahead of the schedule */
+                        m_single_shot_pending = false;
+                        m_single_shot         = true;
+                        configure_single_shot();
+                    }
+                    else
+                    {
+                        configure_next_event();
+                    }
+
+                    signal_callback_return_param.params.request.p_next = &m_timeslot_request;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+                    m_request_pending = true;
+                    m_requests++;
+                }
+                else
+                {
+                    /* Ranging stopped. End current timeslot and let the session go idle. */
+                    signal_callback_return_param.params.request.p_next = NULL;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
+                }
+                m_slot_active = false;
 
                 TIMESLOT_END_EGU->TASKS_TRIGGER[0] = 1;
 
-                nrf_gpio_pin_clear(DATAPIN_1);
+                RTT_TRACE(RTT_TRACE_SLOT_END);
                 bsp_board_led_off(LED3);
             }
             else if (NRF_TIMER0->EVENTS_COMPARE[1] &&
                (NRF_TIMER0->INTENSET & (TIMER_INTENSET_COMPARE1_Enabled << TIMER_INTENCLR_COMPARE1_Pos)))
             {
                 /* Extend margin reached. Request extension. */
-                m_timeslot_request.params.earliest.length_us   = TS_LEN_EXTENSION_US;
-                m_slot_length                                  = TS_LEN_EXTENSION_US;
-
-                configure_next_event_earliest();
-
                 NRF_TIMER0->EVENTS_COMPARE[1] = 0;
                 (void)NRF_TIMER0->EVENTS_COMPARE[1];
             
                 /* This is the "try to extend timeslot" timeout */
-                if (m_total_timeslot_length < (TS_TOT_EXT_LENGTH_US - 5000UL - TS_LEN_EXTENSION_US))
+                if (m_running && !m_single_shot_pending &&
+                    (m_total_timeslot_length < (TS_TOT_EXT_LENGTH_US - 5000UL - m_slot_length)))
                 {
-                    /* Request timeslot extension if total length does not exceed TS_TOT_EXT_LENGTH_US */
-                    signal_callback_return_param.params.extend.length_us = TS_LEN_EXTENSION_US;
+                    /* Request timeslot extension if total length does not exceed TS_TOT_EXT_LENGTH_US. Extensions are as long as the first timeslot. */
+                    signal_callback_return_param.params.extend.length_us = m_slot_length;
                     signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND;
+                    RTT_TRACE(RTT_TRACE_EXTEND_REQUEST);
+                }
+                else
+                {
+                    signal_callback_return_param.params.request.p_next = NULL;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
                 }
-
-                nrf_gpio_pin_set(DATAPIN_2);
-                nrf_gpio_pin_set(DATAPIN_3);
             }
             else
             {
@@ -195,20 +564,22 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             
 
             /* Extension succeeded: update timer */
+            NRF_TIMER0->TASKS_CAPTURE[3]    = 1;
+            m_slot_start_us                 = NRF_TIMER0->CC[3];
             NRF_TIMER0->TASKS_STOP          = 1;
             NRF_TIMER0->EVENTS_COMPARE[0]   = 0;
             NRF_TIMER0->EVENTS_COMPARE[1]   = 0;
-            NRF_TIMER0->CC[0]               += (TS_LEN_EXTENSION_US - 25);
-            NRF_TIMER0->CC[1]               += (TS_LEN_EXTENSION_US - 25);
+            NRF_TIMER0->CC[0]               += (m_slot_length - 25);
+            NRF_TIMER0->CC[1]               += (m_slot_length - 25);
             NRF_TIMER0->TASKS_START         = 1;
     
             /* Keep track of total length */
-            m_total_timeslot_length += TS_LEN_EXTENSION_US;
+            m_total_timeslot_length += m_slot_length;
             
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
 
-            nrf_gpio_pin_clear(DATAPIN_3);
+            RTT_TRACE(RTT_TRACE_EXTEND_SUCCEEDED);
             bsp_board_led_on(LED3);
 
             TIMESLOT_BEGIN_EGU->TASKS_TRIGGER[0] = 1;
@@ -218,7 +589,7 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
 
-            nrf_gpio_pin_clear(DATAPIN_2);
+            RTT_TRACE(RTT_TRACE_EXTEND_FAILED);
             break;
         default:
             /* No implementation needed */
@@ -230,9 +601,9 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
 
 /**@brief Function for initializing the timeslot API.
  */
-uint32_t timeslot_sd_init()
+uint32_t timeslot_sd_init(timeslot_burst_handler_t burst_handler)
 {
-    uint32_t err_code;
+    m_burst_handler = burst_handler;
 
     TIMESLOT_BEGIN_EGU->INTENSET = (1 << 0);
     TIMESLOT_END_EGU->INTENSET = (1 << 0);
@@ -242,32 +613,406 @@ uint32_t timeslot_sd_init()
     NVIC_EnableIRQ(TIMESLOT_BEGIN_IRQn);
     NVIC_EnableIRQ(TIMESLOT_END_IRQn);
     
-    /* Open a session for radio timeslot requests */
-    err_code = sd_radio_session_open(radio_callback);
-    if (err_code != NRF_SUCCESS)
+    /* Open a session for radio timeslot requests. Timeslots are requested by timeslot_start(). */
+    return sd_radio_session_open(radio_callback);
+}
+
+
+/**@brief Start ranging according to the current schedule.
+ */
+uint32_t timeslot_start(void)
+{
+    uint32_t err_code;
+
+    if (m_running)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (!power_per_slot(m_schedule_pending_valid ? m_schedule_pending.rate_hz : m_schedule.rate_hz) && !m_hfxo_held)
+    {
+        /* Keep the HFXO running between timeslots until ranging stops */
+        err_code = sd_clock_hfclk_request();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        m_hfxo_held       = true;
+        m_hfxo_held_since = app_timer_cnt_get();
+    }
+
+    m_running = true;
+
+    /* If a timeslot is still in progress, its end will request the next one, and the session
+       being closed for a single-shot burst requests it when it has closed */
+    if (!m_request_pending && !m_slot_active && !m_preempting)
+    {
+        err_code = request_next_event_earliest();
+        if (err_code != NRF_SUCCESS)
+        {
+            m_running = false;
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Stop ranging. The timeslot in progress, if any, is completed.
+ */
+void timeslot_stop(void)
+{
+    m_running             = false;
+    m_single_shot_pending = false;
+
+    if (m_hfxo_held)
+    {
+        /* Timeslots still queued wait for the crystal again */
+        m_hfxo_warm = false;
+        m_hfxo_held = false;
+        m_hfxo_held_ticks += app_timer_cnt_diff_compute(app_timer_cnt_get(), m_hfxo_held_since);
+        (void)sd_clock_hfclk_release();
+    }
+}
+
+
+/**@brief Check whether ranging is running.
+ */
+bool timeslot_is_running(void)
+{
+    return m_running;
+}
+
+
+/**@brief Check whether ranging is stopped and no timeslot is in progress or requested.
+ */
+bool timeslot_is_idle(void)
+{
+    return !m_running && !m_request_pending && !m_slot_active && !m_preempting;
+}
+
+
+/**@brief Run one burst as soon as possible.
+ */
+uint32_t timeslot_single_shot(uint8_t peer, rtt_link_t const * p_link, uint32_t exchanges)
+{
+    uint32_t err_code;
+
+    if ((peer >= RTT_PEERS_MAX) || (exchanges == 0) || (exchanges > TS_MAX_EXCHANGES) ||
+        !rtt_config_access_address_is_valid(p_link->access_address))
     {
-        return err_code;
+        return NRF_ERROR_INVALID_PARAM;
     }
 
-    /* Request a timeslot */
-    err_code = request_next_event_earliest();
+    if (m_single_shot || m_single_shot_pending)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_single_shot_exchanges   = exchanges;
+    m_single_shot_peer        = peer;
+    m_single_shot_link        = *p_link;
+    m_single_shot_failed.peer = peer;
+    m_single_shot_failed.single_shot = true;
+
+    if (m_running)
+    {
+        /* Requested when the timeslot in progress ends. A timeslot requested for the schedule
+           cannot be withdrawn, so the session is closed to take it back and opened again. */
+        m_single_shot_alone   = false;
+        m_single_shot_pending = true;
+        if ((m_schedule.rate_hz != 0) && m_request_pending && !m_slot_active && !m_preempting)
+        {
+            m_preempting = true;
+            if (sd_radio_session_close() != NRF_SUCCESS)
+            {
+                /* Served when the timeslot requested ends instead */
+                m_preempting = false;
+            }
+        }
+        return NRF_SUCCESS;
+    }
+
+    if (!timeslot_is_idle())
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_single_shot_alone = true;
+    m_running           = true;
+
+    err_code = request_single_shot();
     if (err_code != NRF_SUCCESS)
     {
-        (void)sd_radio_session_close();
-        return err_code;
+        m_running = false;
+    }
+    return err_code;
+}
+
+
+/**@brief Set the ranging schedule. The schedule takes effect from the next timeslot request.
+ */
+uint32_t timeslot_schedule_set(timeslot_schedule_t const * p_schedule)
+{
+    if ((p_schedule->rate_hz > TS_MAX_RATE_HZ) ||
+        (p_schedule->exchanges == 0) ||
+        (p_schedule->exchanges > TS_MAX_EXCHANGES) ||
+        (p_schedule->frame_len > RTT_PEERS_FRAME_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
     }
 
+    for (uint32_t i = 0; i < p_schedule->frame_len; i++)
+    {
+        if (p_schedule->frame[i] >= RTT_PEERS_MAX)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    for (uint32_t i = 0; i < RTT_PEERS_MAX; i++)
+    {
+        if (!rtt_config_access_address_is_valid(p_schedule->links[i].access_address))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    /* Leave at least half of each period to the BLE link */
+    if ((p_schedule->rate_hz != 0) &&
+        (2 * TS_BURST_LENGTH_US(p_schedule->exchanges, rtt_config_get()->burst_margin_us) > (1000000UL / p_schedule->rate_hz)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* The timeslot handler only reads the pending schedule while the valid flag is set */
+    m_schedule_pending_valid = false;
+    m_schedule_pending       = *p_schedule;
+    __DMB();
+    m_schedule_pending_valid = true;
+
     return NRF_SUCCESS;
 }
 
+
+/**@brief Get the most recently set ranging schedule.
+ */
+void timeslot_schedule_get(timeslot_schedule_t * p_schedule)
+{
+    *p_schedule = m_schedule_pending_valid ? m_schedule_pending : m_schedule;
+}
+
+
+/**@brief Get and clear the number of completed and blocked bursts since the previous call.
+ */
+void timeslot_rate_get(uint32_t * p_bursts, uint32_t * p_blocked)
+{
+    CRITICAL_REGION_ENTER();
+    *p_bursts  = m_bursts;
+    *p_blocked = m_blocked;
+    m_bursts   = 0;
+    m_blocked  = 0;
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Get the total number of timeslot requests and grants.
+ *
+ * @details The counters are updated from the timeslot callback, which cannot be masked by
+ *          the application, so they are never cleared. Callers compare successive readings.
+ */
+void timeslot_grant_stats_get(uint32_t * p_requests, uint32_t * p_grants)
+{
+    *p_requests = m_requests;
+    *p_grants   = m_grants;
+}
+
+/**@brief Get the total number of bursts dropped because the burst queue was full.
+ */
+uint32_t timeslot_dropped_get(void)
+{
+    return m_bursts_dropped;
+}
+
+/**@brief Set the clock and radio power policy.
+ */
+uint32_t timeslot_power_policy_set(timeslot_power_policy_t policy)
+{
+    if (m_running || m_slot_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_power_policy = policy;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Get the clock and radio power policy.
+ */
+timeslot_power_policy_t timeslot_power_policy_get(void)
+{
+    return m_power_policy;
+}
+
+
+/**@brief Get and clear the power statistics since the previous call.
+ */
+void timeslot_power_stats_get(timeslot_power_stats_t * p_stats, uint32_t interval_us)
+{
+    uint32_t latency_sum_us;
+    uint32_t hfxo_ticks;
+    uint32_t now;
+    uint64_t charge;
+
+    CRITICAL_REGION_ENTER();
+    *p_stats         = m_power_stats;
+    latency_sum_us   = m_latency_sum_us;
+    memset(&m_power_stats, 0, sizeof(m_power_stats));
+    m_power_stats.latency_min_us = UINT32_MAX;
+    m_latency_sum_us = 0;
+    CRITICAL_REGION_EXIT();
+
+    if (p_stats->slots == 0)
+    {
+        p_stats->latency_min_us = 0;
+    }
+    else
+    {
+        p_stats->latency_avg_us = latency_sum_us / p_stats->slots;
+    }
+
+    /* With the per-session policy the HFXO runs for as long as it is held */
+    now                = app_timer_cnt_get();
+    hfxo_ticks         = m_hfxo_held_ticks;
+    m_hfxo_held_ticks  = 0;
+    if (m_hfxo_held)
+    {
+        hfxo_ticks       += app_timer_cnt_diff_compute(now, m_hfxo_held_since);
+        m_hfxo_held_since = now;
+    }
+    p_stats->hfxo_on_us += (uint32_t)(((uint64_t)hfxo_ticks * 1000000UL) / APP_TIMER_CLOCK_FREQ);
+
+    if (interval_us == 0)
+    {
+        p_stats->current_ua = 0;
+        return;
+    }
+
+    charge = (uint64_t)p_stats->hfxo_on_us  * POWER_HFXO_UA +
+             (uint64_t)p_stats->radio_on_us * POWER_RADIO_UA +
+             (uint64_t)p_stats->cpu_on_us   * POWER_CPU_UA;
+    p_stats->current_ua = (uint32_t)(charge / interval_us);
+}
+
 /**
  * TIMESLOT_BEGIN SWI handler.
+ *
+ * Only the exchanges run here. The histogram is queued for the main loop, which does the
+ * distance calculation and reporting outside the timeslot.
  */
 void TIMESLOT_BEGIN_IRQHandler(void)
 {
+    rtt_burst_t * p_burst;
+    uint32_t      begin_us;
+    uint32_t      ready_us;
+    uint32_t      end_us;
+    uint32_t      latency_us;
+    uint32_t      hfxo_running;
+    bool          power_down = power_per_slot(m_schedule.rate_hz);
+
     TIMESLOT_BEGIN_EGU->EVENTS_TRIGGERED[0] = 0;
     bsp_board_led_on(LED4);
-    do_rtt_measurement();
+
+    NRF_TIMER0->TASKS_CAPTURE[2] = 1;
+    begin_us = NRF_TIMER0->CC[2];
+
+    if ((sd_clock_hfclk_is_running(&hfxo_running) == NRF_SUCCESS) && !hfxo_running)
+    {
+        m_power_stats.hfxo_cold_starts++;
+    }
+
+    if (!power_down && !m_radio_powered)
+    {
+        m_radio_powered     = true;
+        m_radio_on_since_us = begin_us;
+    }
+
+    /* If the main loop has fallen behind, range anyway and drop the result */
+    p_burst = rtt_queue_write_claim(&m_burst_queue);
+    if (p_burst == NULL)
+    {
+        p_burst = &m_burst_scratch;
+    }
+
+    p_burst->single_shot = m_single_shot;
+    if (m_single_shot)
+    {
+        p_burst->peer = m_single_shot_peer;
+        ready_us = do_rtt_measurement(m_slot_length - rtt_config_get()->burst_margin_us, m_single_shot_exchanges,
+                                      RTT_CONFIG_PEER_ADDRESS(p_burst->peer), &m_single_shot_link, p_burst, power_down);
+        m_single_shot = false;
+    }
+    else
+    {
+        /* The next responder in the frame */
+        p_burst->peer = 0;
+        if (m_schedule.frame_len != 0)
+        {
+            p_burst->peer = m_schedule.frame[m_frame_index];
+            m_frame_index = (m_frame_index + 1) % m_schedule.frame_len;
+        }
+
+        if (m_schedule.rate_hz == 0)
+        {
+            ready_us = do_rtt_measurement(DO_RTT_LENGTH_US(m_slot_length), RTT_EXCHANGES_UNLIMITED,
+                                          RTT_CONFIG_PEER_ADDRESS(p_burst->peer), &m_schedule.links[p_burst->peer],
+                                          p_burst, power_down);
+        }
+        else
+        {
+            ready_us = do_rtt_measurement(m_slot_length - rtt_config_get()->burst_margin_us, m_schedule.exchanges,
+                                          RTT_CONFIG_PEER_ADDRESS(p_burst->peer), &m_schedule.links[p_burst->peer],
+                                          p_burst, power_down);
+        }
+    }
+
+    p_burst->timestamp = app_timer_cnt_get();
+    m_bursts++;
+
+    NRF_TIMER0->TASKS_CAPTURE[2] = 1;
+    end_us = NRF_TIMER0->CC[2];
+
+    /* Time from the start of the timeslot or extension until the first packet can be sent */
+    latency_us = begin_us - m_slot_start_us + ready_us;
+    m_power_stats.slots++;
+    m_latency_sum_us += latency_us;
+    if (latency_us < m_power_stats.latency_min_us)
+    {
+        m_power_stats.latency_min_us = latency_us;
+    }
+    if (latency_us > m_power_stats.latency_max_us)
+    {
+        m_power_stats.latency_max_us = latency_us;
+    }
+    m_power_stats.cpu_on_us += end_us - begin_us;
+    if (power_down)
+    {
+        m_power_stats.radio_on_us += end_us - begin_us;
+    }
+
+    if (p_burst == &m_burst_scratch)
+    {
+        m_bursts_dropped++;
+        return;
+    }
+
+    rtt_queue_write_commit(&m_burst_queue);
+
+    /* The handler drains the whole queue, so a full scheduler queue loses nothing */
+    (void)app_sched_event_put(NULL, 0, burst_queue_process);
 }
 
 /**
@@ -277,4 +1022,17 @@ void TIMESLOT_END_IRQHandler(void)
 {
     TIMESLOT_END_EGU->EVENTS_TRIGGERED[0] = 0;
     bsp_board_led_off(LED4);
-}
\ No newline at end of file
+
+    if (m_radio_powered)
+    {
+        /* Powered down at the end of the timeslot */
+        m_power_stats.radio_on_us += m_slot_end_us - m_radio_on_since_us;
+        m_radio_powered = false;
+    }
+
+    if (!m_hfxo_warm)
+    {
+        /* The SoftDevice started the HFXO for this timeslot and stops it again */
+        m_power_stats.hfxo_on_us += m_slot_end_us + POWER_HFXO_STARTUP_US;
+    }
+}
@@ -25,6 +25,8 @@
 #ifndef TIMESLOT_H__
 #define TIMESLOT_H__
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "nrf.h"
 #include "app_error.h"
 #include "nrf_gpio.h"
@@ -33,6 +35,8 @@
 #include "nrf_sdh_soc.h"
 #include "boards.h"
 #include "rtt_parameters.h"
+#include "rtt_estimator.h"
+#include "rtt_config.h"
 
 #define TIMESLOT_BEGIN_EGU         NRF_EGU3
 #define TIMESLOT_BEGIN_IRQn        SWI3_EGU3_IRQn
@@ -42,6 +46,59 @@
 #define TIMESLOT_END_IRQn          SWI4_EGU4_IRQn
 #define TIMESLOT_END_IRQHandler    SWI4_EGU4_IRQHandler
 #define TIMESLOT_END_IRQPriority   7
+#define TIMESLOT_SOC_OBSERVER_PRIO 1
+
+/**@brief Ranging schedule
+ *
+ * @details A rate of 0 selects continuous ranging, where each timeslot is extended up to
+ *          TS_TOT_EXT_LENGTH_US and a new timeslot is requested as soon as it ends.
+ *
+ *          The bursts are shared between the responders in a TDMA frame. Burst n ranges with
+ *          the responder frame[n % frame_len]. The rate counts the bursts to all responders.
+ *          Each responder is ranged with on its own radio link.
+ */
+typedef struct
+{
+    uint32_t rate_hz;                     /**< Requested number of bursts per second. */
+    uint32_t exchanges;                   /**< Number of exchanges in each burst. */
+    uint8_t  frame_len;                   /**< Number of bursts in the frame. 0 ranges with responder 0 only. */
+    uint8_t  frame[RTT_PEERS_FRAME_MAX];  /**< Responder of each burst in the frame. */
+    rtt_link_t links[RTT_PEERS_MAX];      /**< Radio link of each responder. */
+} timeslot_schedule_t;
+
+/**@brief Clock and radio power policy
+ */
+typedef enum
+{
+    TIMESLOT_POWER_POLICY_PER_SLOT,    /**< The SoftDevice starts the HFXO for every timeslot, and the radio is powered down after every burst. */
+    TIMESLOT_POWER_POLICY_PER_SESSION, /**< The HFXO runs and the radio stays powered across extensions while ranging. Both are off when ranging stops. */
+    TIMESLOT_POWER_POLICY_AUTO,        /**< Per slot at a burst rate, per session in continuous ranging. The scheduler leaves at least half of every period
+                                            to the BLE link, so at any burst rate the HFXO would be held far longer than it takes to start. */
+} timeslot_power_policy_t;
+
+/**@brief Power statistics over a report interval
+ */
+typedef struct
+{
+    uint32_t slots;            /**< Number of timeslots and extensions measured. */
+    uint32_t latency_min_us;   /**< Shortest time from timeslot start to the first radio ready. */
+    uint32_t latency_avg_us;   /**< Mean time from timeslot start to the first radio ready. */
+    uint32_t latency_max_us;   /**< Longest time from timeslot start to the first radio ready. */
+    uint32_t hfxo_cold_starts; /**< Bursts that found the HFXO not running. */
+    uint32_t hfxo_on_us;       /**< Time the HFXO was running for ranging. */
+    uint32_t radio_on_us;      /**< Time the radio was powered. */
+    uint32_t cpu_on_us;        /**< Time the CPU was running bursts. */
+    uint32_t current_ua;       /**< Estimated average current drawn by ranging. */
+} timeslot_power_stats_t;
+
+/**@brief Burst handler
+ *
+ * @details Called from the main loop through app_scheduler for each completed burst. The
+ *          TIMESLOT_BEGIN interrupt only collects the histogram and queues it.
+ *
+ * @param[in] p_burst Histogram of the burst. Only valid during the call.
+ */
+typedef void (*timeslot_burst_handler_t)(rtt_burst_t const * p_burst);
 
 /**@brief Radio event handler
 */
@@ -74,7 +131,107 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type);
 
 
 /**@brief Function for initializing the timeslot API.
+ *
+ * @param[in] burst_handler Handler for the result of each burst.
+ */
+uint32_t timeslot_sd_init(timeslot_burst_handler_t burst_handler);
+
+
+/**@brief Start ranging according to the current schedule.
+ *
+ * @retval NRF_SUCCESS             Ranging started.
+ * @retval NRF_ERROR_INVALID_STATE Ranging is already running.
+ */
+uint32_t timeslot_start(void);
+
+
+/**@brief Stop ranging. The timeslot in progress, if any, is completed.
+ */
+void timeslot_stop(void);
+
+
+/**@brief Check whether ranging is running.
+ */
+bool timeslot_is_running(void);
+
+
+/**@brief Check whether ranging is stopped and no timeslot is in progress or requested.
+ *
+ * @details After timeslot_stop() the timeslot in progress, and one already requested, still
+ *          run. The runtime configuration may only change once this returns true.
+ */
+bool timeslot_is_idle(void);
+
+
+/**@brief Run one burst as soon as possible, outside the schedule.
+ *
+ * @details The burst is requested at high priority without extensions, and is given up if the
+ *          SoftDevice has not granted it within TS_SINGLE_SHOT_TIMEOUT_US. While ranging runs it
+ *          goes ahead of the schedule and whichever responder is next in the frame: it is
+ *          requested when the timeslot in progress ends, or at once by closing and opening the
+ *          radio session again to take back the timeslot already requested. The schedule then
+ *          resumes at its own phase, skipping a burst that would have started during the
+ *          single-shot timeslot. Its result, or a burst without exchanges when it was given up,
+ *          is passed to the burst handler with single_shot set.
+ *
+ * @param[in] peer      Responder to range with.
+ * @param[in] p_link    Radio link of the responder.
+ * @param[in] exchanges Number of exchanges in the burst.
+ *
+ * @retval NRF_SUCCESS             Burst requested.
+ * @retval NRF_ERROR_INVALID_PARAM Invalid responder, link or number of exchanges.
+ * @retval NRF_ERROR_BUSY          A single-shot burst is already waiting or in progress, or
+ *                                 ranging was stopped and its last timeslot has not ended.
+ */
+uint32_t timeslot_single_shot(uint8_t peer, rtt_link_t const * p_link, uint32_t exchanges);
+
+
+/**@brief Set the ranging schedule. The schedule takes effect from the next timeslot request.
+ *
+ * @retval NRF_SUCCESS             Schedule accepted.
+ * @retval NRF_ERROR_INVALID_PARAM The bursts do not fit the requested rate, or the frame is invalid.
+ */
+uint32_t timeslot_schedule_set(timeslot_schedule_t const * p_schedule);
+
+
+/**@brief Get the most recently set ranging schedule.
+ */
+void timeslot_schedule_get(timeslot_schedule_t * p_schedule);
+
+
+/**@brief Get and clear the number of completed and blocked bursts since the previous call.
+ */
+void timeslot_rate_get(uint32_t * p_bursts, uint32_t * p_blocked);
+
+
+/**@brief Get the total number of timeslot requests and grants.
+ */
+void timeslot_grant_stats_get(uint32_t * p_requests, uint32_t * p_grants);
+
+
+/**@brief Get the total number of bursts dropped because the burst queue was full.
+ */
+uint32_t timeslot_dropped_get(void);
+
+
+/**@brief Set the clock and radio power policy.
+ *
+ * @retval NRF_SUCCESS             Policy set.
+ * @retval NRF_ERROR_INVALID_STATE Ranging is running.
+ */
+uint32_t timeslot_power_policy_set(timeslot_power_policy_t policy);
+
+
+/**@brief Get the clock and radio power policy.
+ */
+timeslot_power_policy_t timeslot_power_policy_get(void);
+
+
+/**@brief Get and clear the power statistics since the previous call.
+ *
+ * @param[out] p_stats     Power statistics.
+ * @param[in]  interval_us Time since the previous call, used for the current estimate.
  */
-uint32_t timeslot_sd_init();
+void timeslot_power_stats_get(timeslot_power_stats_t * p_stats, uint32_t interval_us);
 
 #endif
@@ -0,0 +1,461 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Analyses an archive of captures on all CPUs: the accuracy, stability and packet errors of each
+   session, and of all bursts by their true distance. The captures are memory-mapped, the
+   sessions are shared out to a pool of threads, and the distances are estimated again with the
+   firmware's own calc_dist(). */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtt_calibration_file.h"
+#include "rtt_capture.h"
+
+extern "C" {
+#include "rtt_estimator.h"
+}
+
+namespace {
+
+using namespace rtt;
+
+constexpr double RTC_FREQ_HZ = 32768.0;
+
+/**@brief Mean and variance, updated one value at a time and mergeable across threads */
+struct Moments
+{
+    uint64_t n    = 0;
+    double   mean = 0.0;
+    double   m2   = 0.0; /* Sum of squared differences from the mean */
+
+    void add(double value)
+    {
+        double delta = value - mean;
+        n++;
+        mean += delta / n;
+        m2   += delta * (value - mean);
+    }
+
+    void merge(Moments const & other)
+    {
+        if (other.n == 0)
+        {
+            return;
+        }
+
+        double total = static_cast<double>(n + other.n);
+        double delta = other.mean - mean;
+        mean += delta * other.n / total;
+        m2   += other.m2 + delta * delta * n * other.n / total;
+        n    += other.n;
+    }
+
+    double std() const { return (n > 1) ? std::sqrt(m2 / (n - 1)) : NAN; }
+};
+
+/**@brief Overlapping Allan deviation at one averaging time */
+struct Allan
+{
+    double tau_s;
+    double deviation_m;
+};
+
+/**@brief Figures of one session */
+struct Session
+{
+    std::string        name;
+    std::string        error;       /**< Why the capture could not be read, else empty. */
+    uint64_t           bursts    = 0;
+    uint64_t           exchanges = 0;
+    uint64_t           valid     = 0;
+    double             seconds   = 0.0;
+    Moments            estimate;    /**< Distance estimates. */
+    Moments            error_m;     /**< Estimate minus the true distance, where it is known. */
+    Moments            truth;       /**< True distances of those estimates. */
+    std::vector<Allan> allan;       /**< At octaves of the burst interval. */
+};
+
+/**@brief Bursts of all sessions at one true distance */
+struct DistanceBin
+{
+    uint64_t bursts    = 0;
+    uint64_t exchanges = 0;
+    uint64_t valid     = 0;
+    Moments  error_m;
+};
+
+using DistanceBins = std::map<int64_t, DistanceBin>;
+
+double per(uint64_t exchanges, uint64_t valid)
+{
+    return (exchanges != 0) ? 1.0 - static_cast<double>(valid) / exchanges : NAN;
+}
+
+/**@brief Overlapping Allan deviation of evenly spaced samples, at 1, 2, 4... samples
+ *
+ * @details Uses prefix sums, so each averaging time takes one pass over the samples.
+ */
+std::vector<Allan> allan_deviation(std::vector<double> const & samples, double interval_s)
+{
+    std::vector<Allan>  allan;
+    std::vector<double> sums(samples.size() + 1, 0.0);
+
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        sums[i + 1] = sums[i] + samples[i];
+    }
+
+    for (size_t m = 1; 2 * m < samples.size(); m *= 2)
+    {
+        double sum   = 0.0;
+        size_t count = samples.size() - 2 * m + 1;
+        for (size_t k = 0; k < count; k++)
+        {
+            double first  = sums[k + m] - sums[k];
+            double second = sums[k + 2 * m] - sums[k + m];
+            double change = (second - first) / m;
+            sum += change * change;
+        }
+        allan.push_back({m * interval_s, std::sqrt(sum / (2.0 * count))});
+    }
+    return allan;
+}
+
+/**@brief Analyse one capture, adding its bursts to the distance bins of the thread */
+void session_analyze(std::string const & path, double bin_m, rtt_calibration_t const & calibration,
+                     Session & session, DistanceBins & bins)
+{
+    Capture capture;
+
+    session.name  = std::filesystem::path(path).filename().string();
+    session.error = capture.open(path.c_str());
+    if (!session.error.empty())
+    {
+        return;
+    }
+
+    double       truth_m    = capture.metadata_number("truth_m", NAN);
+    CaptureBurst burst;
+    rtt_burst_t  estimated  = {};
+    uint64_t     first      = 0;
+    uint64_t     last       = 0;
+    std::vector<double> series; /* The error where the truth is known, so movement drops out */
+
+    estimated.bin_offset = static_cast<uint16_t>(capture.metadata_number("bin_offset", RTT_DEFAULT_BIN_OFFSET));
+    session.bursts       = capture.bursts();
+    for (size_t i = 0; i < session.bursts; i++)
+    {
+        capture.burst(i, burst);
+        first = (i == 0) ? burst.timestamp : first;
+        last  = burst.timestamp;
+
+        session.exchanges += burst.exchanges;
+        session.valid     += burst.valid;
+
+        double distance_m;
+        if (burst.flags & CAPTURE_FLAG_HISTOGRAM)
+        {
+            std::copy(burst.bins.begin(), burst.bins.end(), estimated.bins);
+            distance_m = calc_dist(&estimated, &calibration);
+        }
+        else
+        {
+            distance_m = (burst.distance_mm != CAPTURE_DISTANCE_NONE) ? burst.distance_mm / 1000.0 : NAN;
+        }
+
+        double truth = (burst.truth_mm != CAPTURE_DISTANCE_NONE) ? burst.truth_mm / 1000.0 : truth_m;
+        if (!std::isnan(truth))
+        {
+            DistanceBin & bin = bins[std::llround(truth / bin_m)];
+            bin.bursts++;
+            bin.exchanges += burst.exchanges;
+            bin.valid     += burst.valid;
+            if (!std::isnan(distance_m))
+            {
+                bin.error_m.add(distance_m - truth);
+            }
+        }
+
+        if (std::isnan(distance_m))
+        {
+            continue;
+        }
+        session.estimate.add(distance_m);
+        if (!std::isnan(truth))
+        {
+            session.error_m.add(distance_m - truth);
+            session.truth.add(truth);
+        }
+        series.push_back(std::isnan(truth) ? distance_m : distance_m - truth);
+    }
+
+    session.seconds = (last - first) / RTC_FREQ_HZ;
+    if (series.size() > 2)
+    {
+        session.allan = allan_deviation(series, session.seconds / (session.bursts - 1));
+    }
+}
+
+/**@brief Analyse the sessions on a pool of threads, each taking the next session when it is done */
+void sessions_analyze(std::vector<std::string> const & paths, uint32_t threads, double bin_m,
+                      rtt_calibration_t const & calibration, std::vector<Session> & sessions, DistanceBins & bins)
+{
+    std::atomic<size_t>       next{0};
+    std::vector<DistanceBins> thread_bins(threads);
+    std::vector<std::thread>  pool;
+
+    sessions.resize(paths.size());
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        pool.emplace_back([&, t]()
+        {
+            size_t i;
+            while ((i = next.fetch_add(1, std::memory_order_relaxed)) < paths.size())
+            {
+                session_analyze(paths[i], bin_m, calibration, sessions[i], thread_bins[t]);
+            }
+        });
+    }
+
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        pool[t].join();
+        for (auto const & [key, bin] : thread_bins[t])
+        {
+            DistanceBin & total = bins[key];
+            total.bursts    += bin.bursts;
+            total.exchanges += bin.exchanges;
+            total.valid     += bin.valid;
+            total.error_m.merge(bin.error_m);
+        }
+    }
+}
+
+/**@brief Averaging time with the lowest Allan deviation, where averaging stops paying off */
+Allan allan_floor(std::vector<Allan> const & allan)
+{
+    return *std::min_element(allan.begin(), allan.end(),
+                             [](Allan const & a, Allan const & b) { return a.deviation_m < b.deviation_m; });
+}
+
+void print(std::vector<Session> const & sessions, DistanceBins const & bins, double bin_m)
+{
+    std::printf("%-24s %8s %8s %7s %9s %9s %8s %8s %9s %16s\n", "session", "bursts", "seconds", "per",
+                "mean_m", "truth_m", "bias_m", "std_m", "adev_m", "floor_m @ tau_s");
+    for (Session const & s : sessions)
+    {
+        if (!s.error.empty())
+        {
+            continue;
+        }
+
+        double truth = (s.truth.n != 0) ? s.truth.mean : NAN;
+        double bias  = (s.error_m.n != 0) ? s.error_m.mean : NAN;
+        double std   = (s.error_m.n != 0) ? s.error_m.std() : s.estimate.std();
+        std::printf("%-24s %8llu %8.1f %7.4f %9.3f %9.3f %+8.3f %8.3f", s.name.c_str(),
+                    (unsigned long long)s.bursts, s.seconds, per(s.exchanges, s.valid),
+                    s.estimate.mean, truth, bias, std);
+        if (s.allan.empty())
+        {
+            std::printf(" %9s %16s\n", "-", "-");
+        }
+        else
+        {
+            Allan floor = allan_floor(s.allan);
+            std::printf(" %9.3f %8.3f @ %5.2f\n", s.allan.front().deviation_m, floor.deviation_m, floor.tau_s);
+        }
+    }
+
+    std::printf("\n%9s %10s %7s %9s %8s\n", "truth_m", "bursts", "per", "bias_m", "std_m");
+    for (auto const & [key, bin] : bins)
+    {
+        std::printf("%9.2f %10llu %7.4f %+9.3f %8.3f\n", key * bin_m, (unsigned long long)bin.bursts,
+                    per(bin.exchanges, bin.valid), (bin.error_m.n != 0) ? bin.error_m.mean : NAN, bin.error_m.std());
+    }
+}
+
+/**@brief Write the figures as JSON, leaving out the ones that are unknown */
+void json_write(std::FILE * p_file, std::vector<Session> const & sessions, DistanceBins const & bins, double bin_m)
+{
+    auto number = [](double value)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), std::isnan(value) ? "null" : "%.6g", value);
+        return std::string(text);
+    };
+
+    std::string json = "{\"sessions\": [\n";
+    for (Session const & s : sessions)
+    {
+        if (!s.error.empty())
+        {
+            continue;
+        }
+
+        json += (json.back() == '\n' ? "  " : ",\n  ");
+        json += "{\"name\": \"" + s.name + "\", \"bursts\": " + std::to_string(s.bursts) +
+                ", \"estimates\": " + std::to_string(s.estimate.n) +
+                ", \"seconds\": " + number(s.seconds) +
+                ", \"per\": " + number(per(s.exchanges, s.valid)) +
+                ", \"mean_m\": " + number(s.estimate.mean) +
+                ", \"truth_m\": " + number((s.truth.n != 0) ? s.truth.mean : NAN) +
+                ", \"bias_m\": " + number((s.error_m.n != 0) ? s.error_m.mean : NAN) +
+                ", \"std_m\": " + number((s.error_m.n != 0) ? s.error_m.std() : s.estimate.std()) +
+                ", \"allan\": [";
+        for (size_t i = 0; i < s.allan.size(); i++)
+        {
+            json += std::string(i ? ", " : "") + "[" + number(s.allan[i].tau_s) + ", " + number(s.allan[i].deviation_m) + "]";
+        }
+        json += "]}";
+    }
+
+    json += "\n], \"distances\": [\n";
+    for (auto const & [key, bin] : bins)
+    {
+        json += (json.back() == '\n' ? "  " : ",\n  ");
+        json += "{\"truth_m\": " + number(key * bin_m) + ", \"bursts\": " + std::to_string(bin.bursts) +
+                ", \"per\": " + number(per(bin.exchanges, bin.valid)) +
+                ", \"bias_m\": " + number((bin.error_m.n != 0) ? bin.error_m.mean : NAN) +
+                ", \"std_m\": " + number(bin.error_m.std()) + "}";
+    }
+    json += "\n]}\n";
+    std::fputs(json.c_str(), p_file);
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] capture|directory...\n"
+                 "Prints the figures of each session and of all bursts by true distance. A directory\n"
+                 "stands for the .rttcap files in it. The true distance is taken from each burst, or\n"
+                 "else from the truth_m metadata of the capture.\n"
+                 "  -j <threads>  Threads to analyse with, default the number of CPUs\n"
+                 "  -r <m>        Width of the distance bins, default 0.1\n"
+                 "  -c <file>     Calibration blob to estimate with, from rtt_calibrate\n"
+                 "  -o <file>     Also write the figures as JSON to a file\n",
+                 p_name);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    char const *             p_output      = nullptr;
+    char const *             p_calibration = nullptr;
+    uint32_t                 threads       = std::max(1U, std::thread::hardware_concurrency());
+    double                   bin_m         = 0.1;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option[0] != '-')
+        {
+            capture_paths_add(argv[i], paths);
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        char const * p_value = argv[++i];
+        if (option == "-o")      p_output      = p_value;
+        else if (option == "-c") p_calibration = p_value;
+        else if (option == "-j") threads       = static_cast<uint32_t>(std::max(1, std::atoi(p_value)));
+        else if (option == "-r") bin_m         = std::strtod(p_value, nullptr);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (paths.empty() || !(bin_m > 0.0))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    rtt_calibration_t calibration = RTT_CALIBRATION_DEFAULT;
+    if (p_calibration != nullptr)
+    {
+        std::string error = calibration_load(p_calibration, calibration);
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    std::vector<Session> sessions;
+    DistanceBins         bins;
+
+    threads = std::min(threads, static_cast<uint32_t>(paths.size()));
+
+    auto start = std::chrono::steady_clock::now();
+    sessions_analyze(paths, threads, bin_m, calibration, sessions, bins);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool     failed = false;
+    uint64_t bursts = 0;
+    for (Session const & session : sessions)
+    {
+        if (!session.error.empty())
+        {
+            std::fprintf(stderr, "%s\n", session.error.c_str());
+            failed = true;
+        }
+        bursts += session.bursts;
+    }
+
+    print(sessions, bins, bin_m);
+    if (p_output != nullptr)
+    {
+        std::FILE * p_file = std::fopen(p_output, "w");
+        if (p_file == nullptr)
+        {
+            std::perror(p_output);
+            return 2;
+        }
+        json_write(p_file, sessions, bins, bin_m);
+        std::fclose(p_file);
+    }
+
+    std::fprintf(stderr, "%zu sessions, %llu bursts in %.3f s on %u threads, %.2f M bursts/s\n",
+                 sessions.size(), (unsigned long long)bursts, elapsed, threads,
+                 (elapsed > 0.0) ? bursts / elapsed / 1e6 : 0.0);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Runs the standard ranging scenarios on the simulator and writes their figures as JSON. Given
+   the output of an earlier run as a baseline, it compares the tracked figures and fails if one
+   has got worse by more than its tolerance. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rtt_figures.h"
+#include "rtt_jobs.h"
+#include "sim_channel.h"
+#include "sim_core.h"
+#include "sim_medium.h"
+#include "sim_metrics.h"
+
+extern "C" sim_firmware_t const sim_firmware_initiator;
+extern "C" sim_firmware_t const sim_firmware_responder;
+extern "C" sim_firmware_t const sim_firmware_initiator_b;
+
+namespace {
+
+using namespace rtt;
+using namespace rtt::sim;
+
+/**@brief A standard scenario, set up on top of the default configuration */
+struct Scenario
+{
+    char const * p_name;
+    double       seconds;
+    void      (* setup)(Config & config);
+};
+
+Scenario const SCENARIOS[] =
+{
+    {"los_1m",     10.0, [](Config & config) { config.medium.distance_m = 1.0; }},
+    {"los_10m",    10.0, [](Config & config) { config.medium.distance_m = 10.0; }},
+    {"los_30m",    10.0, [](Config & config) { config.medium.distance_m = 30.0; }},
+    {"los_100m",   10.0, [](Config & config) { config.medium.distance_m = 100.0; }},
+    {"moving",     10.0, [](Config & config)
+        {
+            config.medium.distance_m    = 2.0;
+            config.medium.distance_to_m = 20.0;
+            config.medium.speed_mps     = 1.5;
+        }},
+    {"congested",  10.0, [](Config & config)
+        {
+            config.medium.distance_m        = 10.0;
+            config.softdevice.ble_interval  = from_us(30000);
+            config.softdevice.ble_event     = from_us(7500);
+            config.softdevice.grants        = "gggggggggc";
+        }},
+    {"high_per",   10.0, [](Config & config)
+        {
+            config.medium.distance_m = 10.0;
+            config.medium.loss       = 0.2;
+            config.medium.crc_error  = 0.1;
+        }},
+    {"continuous",  2.0, [](Config & config)
+        {
+            config.medium.distance_m = 10.0;
+            config.ranging.rate_hz   = 0;
+        }},
+    {"single_shot", 10.0, [](Config & config)
+        {
+            config.medium.distance_m      = 10.0;
+            config.ranging.single_shot_ms = 337;
+        }},
+    {"two_initiators", 10.0, [](Config & config)
+        {
+            config.medium.distance_m     = 10.0;
+            config.ranging.initiators    = 2;
+            config.ranging.second_link   = {0x5A3C96E1, 0};
+        }},
+};
+
+std::vector<Tracked> const TRACKED =
+{
+    {"exchanges_per_s",             HIGHER,      0.0,   0.01},
+    {"valid_ratio",                 HIGHER,      0.002, 0.0},
+    {"bias_m",                      NEARER_ZERO, 0.1,   0.0},
+    {"std_m",                       LOWER,       0.05,  0.05},
+    {"latency_us",                  LOWER,       0.0,   0.05},
+    {"single_shot_us",              LOWER,       0.0,   0.05},
+    {"estimator_cycles",            EITHER,      0.0,   0.0},  /* Host cycles vary too much between runs to gate on */
+    {"initiator_slot_utilisation",  EITHER,      0.0,   0.0},
+    {"responder_slot_utilisation",  EITHER,      0.0,   0.0},
+    {"initiator_extension_success", HIGHER,      0.01,  0.0},
+    {"responder_extension_success", HIGHER,      0.01,  0.0},
+    {"initiator_current_ua",        LOWER,       0.0,   0.02},
+    {"responder_current_ua",        LOWER,       0.0,   0.02},
+};
+
+/**@brief Run a scenario and write its figures. Runs in a child process of jobs_run(). */
+void scenario_run(Scenario const & scenario, uint64_t seed, std::FILE * p_output)
+{
+    Config config;
+    config.seed = seed;
+    scenario.setup(config);
+
+    ChannelConfig channel_config = channel_line_of_sight();
+    FieldChannel  channel(config.medium, channel_config, config.seed);
+    Medium        medium(config.medium, channel);
+    Simulator     simulator(config, medium);
+    Metrics       metrics;
+
+    simulator.observer_set(&metrics);
+    simulator.add(sim_firmware_initiator);
+    simulator.add(sim_firmware_responder);
+    if (config.ranging.initiators > 1)
+    {
+        simulator.add(sim_firmware_initiator_b);
+    }
+    simulator.run(static_cast<Time>(scenario.seconds * PS_PER_S));
+
+    results_write_json(p_output, scenario.p_name, metrics.results(simulator, scenario.seconds));
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] [scenario...]\n"
+                 "Runs the standard ranging scenarios on the simulator, all of them by default.\n"
+                 "  -o <file>   Write the figures as JSON to a file, default stdout\n"
+                 "  -b <file>   Compare with the figures of an earlier run, fail if one got worse\n"
+                 "  -j <jobs>   Scenarios to run at a time, default the number of CPUs\n"
+                 "  -s <seed>   Random seed, default 1\n"
+                 "  -l          List the scenarios\n",
+                 p_name);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    char const *                  p_output   = nullptr;
+    char const *                  p_baseline = nullptr;
+    uint64_t                      seed       = 1;
+    uint32_t                      jobs       = jobs_default();
+    std::vector<Scenario const *> scenarios;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "-l")
+        {
+            for (Scenario const & scenario : SCENARIOS)
+            {
+                std::printf("%-12s %.0f s\n", scenario.p_name, scenario.seconds);
+            }
+            return 0;
+        }
+        if (option[0] != '-')
+        {
+            auto found = std::find_if(std::begin(SCENARIOS), std::end(SCENARIOS),
+                                      [&](Scenario const & scenario) { return option == scenario.p_name; });
+            if (found == std::end(SCENARIOS))
+            {
+                std::fprintf(stderr, "%s: no such scenario\n", argv[i]);
+                return 2;
+            }
+            scenarios.push_back(&*found);
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        char const * p_value = argv[++i];
+        if (option == "-o")      p_output   = p_value;
+        else if (option == "-b") p_baseline = p_value;
+        else if (option == "-j") jobs       = std::max(1, std::atoi(p_value));
+        else if (option == "-s") seed       = std::strtoull(p_value, nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (scenarios.empty())
+    {
+        for (Scenario const & scenario : SCENARIOS)
+        {
+            scenarios.push_back(&scenario);
+        }
+    }
+
+    std::map<std::string, Figures> baseline;
+    if (p_baseline != nullptr)
+    {
+        if (!figures_load(p_baseline, baseline))
+        {
+            std::fprintf(stderr, "%s: cannot read the baseline\n", p_baseline);
+            return 2;
+        }
+    }
+
+    std::vector<std::string> outputs = jobs_run(scenarios.size(), jobs, [&](size_t index, std::FILE * p_output)
+    {
+        scenario_run(*scenarios[index], seed, p_output);
+    });
+
+    std::FILE * p_file = (p_output == nullptr) ? stdout : std::fopen(p_output, "w");
+    if (p_file == nullptr)
+    {
+        std::perror(p_output);
+        return 2;
+    }
+
+    std::string json = "{\"seed\": " + std::to_string(seed) + ", \"scenarios\": [\n";
+    bool        failed = false;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        if (outputs[i].empty())
+        {
+            std::fprintf(stderr, "%s: failed\n", scenarios[i]->p_name);
+            failed = true;
+        }
+        else
+        {
+            json += (json.back() == '\n' ? "  " : ",\n  ") + outputs[i];
+        }
+    }
+    json += "\n]}\n";
+    std::fputs(json.c_str(), p_file);
+    if (p_file != stdout)
+    {
+        std::fclose(p_file);
+    }
+
+    if (p_baseline != nullptr)
+    {
+        std::map<std::string, Figures> current;
+        std::vector<std::string>       names;
+        figures_parse(json, current);
+        for (Scenario const * p_scenario : scenarios)
+        {
+            names.push_back(p_scenario->p_name);
+        }
+        if (figures_compare(baseline, current, names, TRACKED, "scenario") > 0)
+        {
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Fits the calibration of a board pair from bursts recorded at surveyed distances, and writes it
+   as a blob the initiator loads from the last page of flash (see rtt_calibration.h).
+
+   The estimate is linear in the mean round trip, so the scale and the offset are fitted with a
+   robust straight line through every burst: Huber weights, refitted until they settle, so
+   multipath outliers pull less than in least squares. The dwell time trimmed before binning only
+   moves the histogram window: it is set so the shortest round trips land a margin above the
+   first bin, and the offset is moved to match. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rtt_calibration_file.h"
+#include "rtt_capture.h"
+
+extern "C" {
+#include "rtt_estimator.h"
+}
+
+namespace {
+
+using namespace rtt;
+
+constexpr double SCALE_NOMINAL_M = 299792458.0 / 16e6 / 2.0; /* Half a 16 MHz tick at the speed of light */
+constexpr double HUBER_K         = 1.345;                    /* 95 % efficient for normal residuals */
+constexpr double MAD_TO_SIGMA    = 1.4826;
+
+/**@brief One burst: its mean round trip in ticks before any trimming, and the truth */
+struct Point
+{
+    double   ticks;
+    double   truth_m;
+    uint32_t burst; /* Index into the bursts kept for the residuals */
+};
+
+/**@brief Straight line truth = scale * ticks + intercept */
+struct Line
+{
+    double scale;
+    double intercept;
+};
+
+double median(std::vector<double> values)
+{
+    if (values.empty())
+    {
+        return NAN;
+    }
+
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    return values[middle];
+}
+
+/**@brief Weighted least squares line, or only the intercept if the scale is fixed */
+Line line_fit(std::vector<Point> const & points, std::vector<double> const & weights, double fixed_scale)
+{
+    double sw = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        double w = weights[i];
+        sw  += w;
+        sx  += w * points[i].ticks;
+        sy  += w * points[i].truth_m;
+    }
+
+    double mx = sx / sw;
+    double my = sy / sw;
+    if (!std::isnan(fixed_scale))
+    {
+        return {fixed_scale, my - fixed_scale * mx};
+    }
+
+    /* Centred, as the ticks are in the thousands and vary by tens */
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        double dx = points[i].ticks - mx;
+        sxx += weights[i] * dx * dx;
+        sxy += weights[i] * dx * (points[i].truth_m - my);
+    }
+
+    double scale = sxy / sxx;
+    return {scale, my - scale * mx};
+}
+
+/**@brief Huber M-estimate of the line by iteratively reweighted least squares */
+Line robust_fit(std::vector<Point> const & points, double fixed_scale, size_t & downweighted)
+{
+    std::vector<double> weights(points.size(), 1.0);
+    std::vector<double> residuals(points.size());
+    Line                line = line_fit(points, weights, fixed_scale);
+
+    for (int iteration = 0; iteration < 50; iteration++)
+    {
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            residuals[i] = points[i].truth_m - (line.scale * points[i].ticks + line.intercept);
+        }
+
+        std::vector<double> absolute(residuals.size());
+        std::transform(residuals.begin(), residuals.end(), absolute.begin(), [](double r) { return std::fabs(r); });
+        double k = HUBER_K * std::max(1e-3, MAD_TO_SIGMA * median(absolute));
+
+        downweighted = 0;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            weights[i]    = (absolute[i] <= k) ? 1.0 : k / absolute[i];
+            downweighted += (absolute[i] > k) ? 1 : 0;
+        }
+
+        Line next = line_fit(points, weights, fixed_scale);
+        bool done = (std::fabs(next.scale - line.scale) < 1e-9) && (std::fabs(next.intercept - line.intercept) < 1e-6);
+        line = next;
+        if (done)
+        {
+            break;
+        }
+    }
+    return line;
+}
+
+/**@brief Round trip at a quantile of all exchanges in the histograms, in ticks before trimming */
+double ticks_quantile(std::map<int64_t, uint64_t> const & counts, uint64_t total, double quantile)
+{
+    uint64_t target = static_cast<uint64_t>(quantile * total);
+    uint64_t seen   = 0;
+
+    for (auto const & [ticks, count] : counts)
+    {
+        seen += count;
+        if (seen > target)
+        {
+            return static_cast<double>(ticks);
+        }
+    }
+    return counts.empty() ? NAN : static_cast<double>(counts.rbegin()->first);
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] capture|directory...\n"
+                 "Fits the calibration of a board pair from captures at surveyed distances, with the\n"
+                 "true distance of each burst or the truth_m metadata of its capture, and at least two\n"
+                 "distances unless the scale is fixed.\n"
+                 "  -o <file>       Write the calibration blob\n"
+                 "  --hex <file>    Write the blob as Intel HEX at the last page of flash, to program\n"
+                 "                  with: nrfjprog --program <file> --sectorerase --verify\n"
+                 "  --chip <chip>   nrf52840 or nrf52833, for the flash address, default nrf52840\n"
+                 "  --id <n>        Identifies the calibration: the low 32 bits of the responder's\n"
+                 "                  device address, for example 0x5E0A1B2C, default 0\n"
+                 "  --slot <n>      Slot in the page of the central ranging with several responders,\n"
+                 "                  0 to %u, default 0. Slot 0 is used by responders without a blob.\n"
+                 "  --scale <m>     Fix the scale, metres per tick, instead of fitting it\n"
+                 "  --margin <bins> Bins left below the shortest round trips, default 8\n"
+                 "  --bins <n>      Histogram bins in use, default %u\n",
+                 p_name, RTT_CALIBRATION_BLOBS_MAX - 1, RTT_DEFAULT_BINS);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    char const *             p_blob_path = nullptr;
+    char const *             p_hex_path  = nullptr;
+    uint32_t                 address     = 0xFF000;
+    uint32_t                 id          = 0;
+    uint32_t                 slot        = 0;
+    double                   fixed_scale = NAN;
+    double                   margin      = 8;
+    double                   bins        = RTT_DEFAULT_BINS;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option[0] != '-')
+        {
+            capture_paths_add(argv[i], paths);
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        std::string value = argv[++i];
+        if (option == "-o")            p_blob_path = argv[i];
+        else if (option == "--hex")    p_hex_path  = argv[i];
+        else if (option == "--id")     id          = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--slot")   slot        = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--scale")  fixed_scale = std::strtod(value.c_str(), nullptr);
+        else if (option == "--margin") margin      = std::strtod(value.c_str(), nullptr);
+        else if (option == "--bins")   bins        = std::strtod(value.c_str(), nullptr);
+        else if (option == "--chip" && value == "nrf52840") address = 0xFF000;
+        else if (option == "--chip" && value == "nrf52833") address = 0x7F000;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (paths.empty() || (bins < 1) || (bins > RTT_NUM_BINS) || (slot >= RTT_CALIBRATION_BLOBS_MAX))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Point>          points;
+    std::vector<rtt_burst_t>    bursts;
+    std::map<int64_t, uint64_t> tick_counts; /* Exchanges by round trip, before trimming */
+    uint64_t                    exchanges   = 0;
+    uint64_t                    outside     = 0; /* Valid exchanges that fell outside the recorded window */
+    uint64_t                    at_edge     = 0; /* Bursts with counts in the first or last bin */
+
+    for (std::string const & path : paths)
+    {
+        Capture     capture;
+        std::string error = capture.open(path.c_str());
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        double       truth_m    = capture.metadata_number("truth_m", NAN);
+        uint16_t     bin_offset = static_cast<uint16_t>(capture.metadata_number("bin_offset", RTT_DEFAULT_BIN_OFFSET));
+        CaptureBurst burst;
+
+        for (size_t i = 0; i < capture.bursts(); i++)
+        {
+            capture.burst(i, burst);
+
+            double   truth = (burst.truth_mm != CAPTURE_DISTANCE_NONE) ? burst.truth_mm / 1000.0 : truth_m;
+            uint64_t sum   = 0;
+            double   moment = 0.0;
+            size_t   last  = 0;
+            for (size_t bin = 0; bin < burst.bins.size(); bin++)
+            {
+                sum    += burst.bins[bin];
+                moment += burst.bins[bin] * (bin + 1.0);
+                last    = (burst.bins[bin] != 0) ? bin : last;
+            }
+            if (!(burst.flags & CAPTURE_FLAG_HISTOGRAM) || (sum == 0) || std::isnan(truth))
+            {
+                continue;
+            }
+
+            for (size_t bin = 0; bin < burst.bins.size(); bin++)
+            {
+                if (burst.bins[bin] != 0)
+                {
+                    tick_counts[static_cast<int64_t>(bin) + bin_offset] += burst.bins[bin];
+                }
+            }
+            exchanges += sum;
+            outside   += (burst.valid > sum) ? burst.valid - sum : 0;
+            at_edge   += ((burst.bins[0] != 0) || (last + 1 == burst.bins.size())) ? 1 : 0;
+
+            rtt_burst_t estimated = {};
+            estimated.valid      = burst.valid;
+            estimated.bin_offset = bin_offset;
+            std::copy(burst.bins.begin(), burst.bins.end(), estimated.bins);
+            bursts.push_back(estimated);
+            points.push_back({moment / sum + bin_offset, truth, static_cast<uint32_t>(bursts.size() - 1)});
+        }
+    }
+
+    std::map<int64_t, std::vector<size_t>> by_distance; /* Point indices by true distance, mm */
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        by_distance[std::llround(points[i].truth_m * 1000.0)].push_back(i);
+    }
+    if (by_distance.empty() || ((by_distance.size() < 2) && std::isnan(fixed_scale)))
+    {
+        std::fprintf(stderr, "Need bursts at two or more true distances, or --scale: found %zu\n", by_distance.size());
+        return 1;
+    }
+
+    size_t downweighted = 0;
+    Line   line         = robust_fit(points, fixed_scale, downweighted);
+    if (!(line.scale > 0.0))
+    {
+        std::fprintf(stderr, "The fitted scale %.4f m is not positive, are the true distances right?\n", line.scale);
+        return 1;
+    }
+
+    /* Place the window, then move the offset so the estimate stays on the fitted line */
+    double lowest  = ticks_quantile(tick_counts, exchanges, 0.001);
+    double highest = ticks_quantile(tick_counts, exchanges, 0.999);
+    double dwell   = std::max(0.0, std::floor(lowest - margin));
+
+    rtt_calibration_t calibration;
+    calibration.scale_m    = static_cast<float>(line.scale);
+    calibration.offset_m   = static_cast<float>(-line.intercept - line.scale * dwell);
+    calibration.bin_offset = static_cast<uint16_t>(dwell);
+    calibration.id         = id;
+
+    /* Residuals of the firmware's own estimate with the calibration as it will be stored */
+    std::printf("%10s %8s %10s %10s %10s\n", "truth_m", "bursts", "bias_m", "std_m", "rms_m");
+    double sum_squares = 0.0;
+    for (auto const & [truth_mm, indices] : by_distance)
+    {
+        double sum = 0.0, squares = 0.0;
+        for (size_t i : indices)
+        {
+            double residual = calc_dist(&bursts[points[i].burst], &calibration) - points[i].truth_m;
+            sum     += residual;
+            squares += residual * residual;
+        }
+
+        double n    = static_cast<double>(indices.size());
+        double bias = sum / n;
+        sum_squares += squares;
+        std::printf("%10.3f %8zu %+10.4f %10.4f %10.4f\n", truth_mm / 1000.0, indices.size(), bias,
+                    std::sqrt(std::max(0.0, squares / n - bias * bias)), std::sqrt(squares / n));
+    }
+    double rms_m = std::sqrt(sum_squares / points.size());
+
+    std::printf("\nscale      %.6f m/tick, %+.0f ppm from nominal%s\n", line.scale,
+                1e6 * (line.scale / SCALE_NOMINAL_M - 1.0), std::isnan(fixed_scale) ? "" : " (fixed)");
+    std::printf("offset     %.4f m\n", calibration.offset_m);
+    std::printf("bin_offset %u ticks, round trips from %.0f to %.0f ticks use bins %.0f to %.0f of %.0f\n",
+                calibration.bin_offset, lowest, highest, lowest - dwell, highest - dwell, bins);
+    std::printf("residual   %.4f m RMS over %zu bursts, %zu down-weighted as outliers\n",
+                rms_m, points.size(), downweighted);
+
+    if (highest - dwell >= bins)
+    {
+        std::printf("warning    the round trips do not fit in %.0f bins, the longest will be dropped\n", bins);
+    }
+    if ((outside != 0) || (at_edge != 0))
+    {
+        std::printf("warning    %llu exchanges fell outside the recorded window and %llu bursts reach its edge,\n"
+                    "           record again with a bin_offset that fits the round trips\n",
+                    (unsigned long long)outside, (unsigned long long)at_edge);
+    }
+
+    CalibrationBlob blob = calibration_encode(calibration, static_cast<uint32_t>(std::time(nullptr)),
+                                              static_cast<uint16_t>(std::min(65535.0, std::round(rms_m * 1000.0))));
+    if (p_blob_path != nullptr)
+    {
+        std::ofstream file(p_blob_path, std::ios::binary);
+        file.write(reinterpret_cast<char const *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+        if (!file)
+        {
+            std::fprintf(stderr, "%s: write failed\n", p_blob_path);
+            return 1;
+        }
+    }
+    if (p_hex_path != nullptr)
+    {
+        std::ofstream file(p_hex_path);
+        file << calibration_hex(blob, address + slot * RTT_CALIBRATION_BLOB_LEN);
+        if (!file)
+        {
+            std::fprintf(stderr, "%s: write failed\n", p_hex_path);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rtt_calibration_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "rtt_stream_decoder.h"
+
+namespace rtt {
+
+namespace {
+
+inline void put16(uint8_t * p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void put32(uint8_t * p, uint32_t value)
+{
+    put16(&p[0], static_cast<uint16_t>(value));
+    put16(&p[2], static_cast<uint16_t>(value >> 16));
+}
+
+inline uint16_t u16(uint8_t const * p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t u32(uint8_t const * p)
+{
+    return static_cast<uint32_t>(u16(&p[0])) | (static_cast<uint32_t>(u16(&p[2])) << 16);
+}
+
+inline uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bits_float(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* One Intel HEX record */
+std::string hex_record(uint8_t type, uint16_t address, uint8_t const * p_data, size_t len)
+{
+    char    text[16];
+    uint8_t sum = static_cast<uint8_t>(len + (address >> 8) + address + type);
+
+    std::snprintf(text, sizeof(text), ":%02X%04X%02X", static_cast<unsigned>(len), address, type);
+    std::string record = text;
+    for (size_t i = 0; i < len; i++)
+    {
+        std::snprintf(text, sizeof(text), "%02X", p_data[i]);
+        record += text;
+        sum    += p_data[i];
+    }
+    std::snprintf(text, sizeof(text), "%02X\n", static_cast<uint8_t>(-sum));
+    return record + text;
+}
+
+} // namespace
+
+
+CalibrationBlob calibration_encode(rtt_calibration_t const & calibration, uint32_t fitted, uint16_t rms_mm)
+{
+    CalibrationBlob blob{};
+
+    put32(&blob[0], RTT_CALIBRATION_MAGIC);
+    blob[4] = RTT_CALIBRATION_VERSION;
+    put16(&blob[6], calibration.bin_offset);
+    put32(&blob[8], float_bits(calibration.scale_m));
+    put32(&blob[12], float_bits(calibration.offset_m));
+    put32(&blob[16], calibration.id);
+    put32(&blob[20], fitted);
+    put16(&blob[24], rms_mm);
+    put16(&blob[RTT_CALIBRATION_CRC_OFFSET], crc16(blob.data(), RTT_CALIBRATION_CRC_OFFSET));
+    put16(&blob[30], 0xFFFF);
+    return blob;
+}
+
+std::string calibration_decode(uint8_t const * p_blob, size_t len, rtt_calibration_t & calibration)
+{
+    if (len != RTT_CALIBRATION_BLOB_LEN)
+    {
+        return "wrong length for a calibration blob";
+    }
+    if (u32(&p_blob[0]) != RTT_CALIBRATION_MAGIC)
+    {
+        return "not a calibration blob";
+    }
+    if (p_blob[4] != RTT_CALIBRATION_VERSION)
+    {
+        return "calibration version " + std::to_string(p_blob[4]) + " is not supported";
+    }
+    if (crc16(p_blob, RTT_CALIBRATION_CRC_OFFSET) != u16(&p_blob[RTT_CALIBRATION_CRC_OFFSET]))
+    {
+        return "calibration blob CRC error";
+    }
+
+    rtt_calibration_t decoded;
+    decoded.bin_offset = u16(&p_blob[6]);
+    decoded.scale_m    = bits_float(u32(&p_blob[8]));
+    decoded.offset_m   = bits_float(u32(&p_blob[12]));
+    decoded.id         = u32(&p_blob[16]);
+    if (!(decoded.scale_m > 0.0f) || !std::isfinite(decoded.offset_m))
+    {
+        return "calibration scale or offset out of range";
+    }
+
+    calibration = decoded;
+    return "";
+}
+
+std::string calibration_load(char const * p_path, rtt_calibration_t & calibration)
+{
+    std::ifstream        file(p_path, std::ios::binary);
+    std::vector<uint8_t> blob((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (!file && !file.eof())
+    {
+        return std::string(p_path) + ": cannot read";
+    }
+
+    std::string error = calibration_decode(blob.data(), blob.size(), calibration);
+    return error.empty() ? error : std::string(p_path) + ": " + error;
+}
+
+AnchorBlob anchor_encode(rtt_anchor_t const & anchor)
+{
+    AnchorBlob blob{};
+
+    put32(&blob[0], RTT_ANCHORS_MAGIC);
+    blob[4] = RTT_ANCHORS_VERSION;
+    put32(&blob[8], anchor.id);
+    put32(&blob[12], static_cast<uint32_t>(anchor.x_mm));
+    put32(&blob[16], static_cast<uint32_t>(anchor.y_mm));
+    put32(&blob[20], static_cast<uint32_t>(anchor.z_mm));
+    put16(&blob[RTT_ANCHORS_CRC_OFFSET], crc16(blob.data(), RTT_ANCHORS_CRC_OFFSET));
+    put16(&blob[30], 0xFFFF);
+    return blob;
+}
+
+std::string flash_hex(uint8_t const * p_data, size_t len, uint32_t address)
+{
+    uint8_t upper[2] = {static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16)};
+    std::string hex = hex_record(0x04, 0, upper, sizeof(upper));
+
+    for (size_t i = 0; i < len; i += 16)
+    {
+        hex += hex_record(0x00, static_cast<uint16_t>(address + i), &p_data[i], std::min<size_t>(16, len - i));
+    }
+    return hex + hex_record(0x01, 0, nullptr, 0);
+}
+
+std::string calibration_hex(CalibrationBlob const & blob, uint32_t address)
+{
+    return flash_hex(blob.data(), blob.size(), address);
+}
+
+} // namespace rtt
@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_CALIBRATION_FILE_H__
+#define RTT_CALIBRATION_FILE_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include "rtt_anchors.h"
+#include "rtt_calibration.h"
+}
+
+namespace rtt {
+
+using CalibrationBlob = std::array<uint8_t, RTT_CALIBRATION_BLOB_LEN>;
+using AnchorBlob      = std::array<uint8_t, RTT_ANCHORS_BLOB_LEN>;
+
+/**@brief Encode a calibration blob as rtt_calibration.h describes it
+ *
+ * @param[in] fitted Time of the fit, seconds since 1970.
+ * @param[in] rms_mm RMS residual of the fit.
+ */
+CalibrationBlob calibration_encode(rtt_calibration_t const & calibration, uint32_t fitted, uint16_t rms_mm);
+
+/**@brief Decode and check a calibration blob, as rtt_calibration_decode does on the device
+ *
+ * @return Empty on success, else what is wrong with it
+ */
+std::string calibration_decode(uint8_t const * p_blob, size_t len, rtt_calibration_t & calibration);
+
+/**@brief Read a calibration blob file written by rtt_calibrate
+ *
+ * @return Empty on success, else what went wrong
+ */
+std::string calibration_load(char const * p_path, rtt_calibration_t & calibration);
+
+/**@brief Encode the coordinates of an anchor as rtt_anchors.h describes them */
+AnchorBlob anchor_encode(rtt_anchor_t const & anchor);
+
+/**@brief Intel HEX file that programs bytes at an address, within one 64 KiB segment */
+std::string flash_hex(uint8_t const * p_data, size_t len, uint32_t address);
+
+/**@brief Intel HEX file that programs a blob at an address */
+std::string calibration_hex(CalibrationBlob const & blob, uint32_t address);
+
+} // namespace rtt
+
+#endif // RTT_CALIBRATION_FILE_H__
@@ -0,0 +1,333 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rtt_capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rtt {
+
+namespace {
+
+constexpr size_t MAGIC_LEN = sizeof(CAPTURE_MAGIC) - 1;
+
+inline uint16_t u16(uint8_t const * p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t u32(uint8_t const * p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t u64(uint8_t const * p)
+{
+    return static_cast<uint64_t>(u32(&p[0])) | (static_cast<uint64_t>(u32(&p[4])) << 32);
+}
+
+inline void put16(std::vector<uint8_t> & out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void put32(std::vector<uint8_t> & out, uint32_t value)
+{
+    put16(out, static_cast<uint16_t>(value));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+inline void put64(std::vector<uint8_t> & out, uint64_t value)
+{
+    put32(out, static_cast<uint32_t>(value));
+    put32(out, static_cast<uint32_t>(value >> 32));
+}
+
+constexpr uint32_t align8(uint32_t len)
+{
+    return (len + 7U) & ~7U;
+}
+
+constexpr uint32_t RECORD_LEN = align8(CAPTURE_BURST_HEADER_LEN + 2 * RTT_STREAM_HISTOGRAM_MAX_BINS);
+
+} // namespace
+
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+std::string CaptureWriter::open(char const * p_path, CaptureMetadata const & metadata)
+{
+    std::string text;
+    for (auto const & [key, value] : metadata)
+    {
+        if (key.empty() || (key.find_first_of("=\n") != std::string::npos) || (value.find('\n') != std::string::npos))
+        {
+            return "invalid metadata key or value: " + key;
+        }
+        text += key + "=" + value + "\n";
+    }
+
+    std::vector<uint8_t> header(CAPTURE_MAGIC, CAPTURE_MAGIC + MAGIC_LEN);
+    uint32_t             offset = align8(static_cast<uint32_t>(CAPTURE_HEADER_LEN + text.size()));
+
+    put16(header, CAPTURE_VERSION_MAJOR);
+    put16(header, CAPTURE_VERSION_MINOR);
+    put32(header, offset);
+    put16(header, static_cast<uint16_t>(RECORD_LEN));
+    put16(header, RTT_STREAM_HISTOGRAM_MAX_BINS);
+    put32(header, static_cast<uint32_t>(text.size()));
+    header.insert(header.end(), text.begin(), text.end());
+    header.resize(offset, 0);
+
+    close();
+    m_p_file = std::fopen(p_path, "wb");
+    if (m_p_file == nullptr)
+    {
+        return std::string(p_path) + ": " + std::strerror(errno);
+    }
+    if (std::fwrite(header.data(), 1, header.size(), m_p_file) != header.size())
+    {
+        close();
+        return std::string(p_path) + ": write failed";
+    }
+    return "";
+}
+
+bool CaptureWriter::write(CaptureBurst const & burst)
+{
+    std::vector<uint8_t> record;
+
+    record.reserve(RECORD_LEN);
+    put64(record, burst.timestamp);
+    put32(record, static_cast<uint32_t>(burst.distance_mm));
+    put32(record, static_cast<uint32_t>(burst.truth_mm));
+    put16(record, burst.exchanges);
+    put16(record, burst.valid);
+    record.push_back(burst.flags);
+    record.push_back(static_cast<uint8_t>(burst.rssi_dbm));
+    put16(record, static_cast<uint16_t>(burst.temperature));
+    for (uint16_t bin : burst.bins)
+    {
+        put16(record, bin);
+    }
+    record.resize(RECORD_LEN, 0);
+
+    return (m_p_file != nullptr) && (std::fwrite(record.data(), 1, record.size(), m_p_file) == record.size());
+}
+
+bool CaptureWriter::close()
+{
+    if (m_p_file == nullptr)
+    {
+        return true;
+    }
+
+    bool ok = (std::fclose(m_p_file) == 0);
+    m_p_file = nullptr;
+    return ok;
+}
+
+
+Capture::~Capture()
+{
+    unmap();
+}
+
+Capture::Capture(Capture && other) noexcept
+{
+    *this = std::move(other);
+}
+
+Capture & Capture::operator=(Capture && other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        m_p_data        = std::exchange(other.m_p_data, nullptr);
+        m_size          = std::exchange(other.m_size, 0);
+        m_version_minor = other.m_version_minor;
+        m_offset        = other.m_offset;
+        m_record_len    = other.m_record_len;
+        m_bins          = other.m_bins;
+        m_metadata      = std::move(other.m_metadata);
+    }
+    return *this;
+}
+
+void Capture::unmap()
+{
+    if (m_p_data != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(m_p_data), m_size);
+        m_p_data = nullptr;
+        m_size   = 0;
+    }
+}
+
+std::string Capture::open(char const * p_path)
+{
+    unmap();
+    m_metadata.clear();
+
+    int fd = ::open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+        return std::string(p_path) + ": " + std::strerror(errno);
+    }
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || (static_cast<size_t>(status.st_size) < CAPTURE_HEADER_LEN))
+    {
+        ::close(fd);
+        return std::string(p_path) + ": not a capture";
+    }
+
+    void * p_map = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p_map == MAP_FAILED)
+    {
+        return std::string(p_path) + ": " + std::strerror(errno);
+    }
+    m_p_data = static_cast<uint8_t const *>(p_map);
+    m_size   = static_cast<size_t>(status.st_size);
+
+    uint8_t const * p = m_p_data;
+    if (std::memcmp(p, CAPTURE_MAGIC, MAGIC_LEN) != 0)
+    {
+        unmap();
+        return std::string(p_path) + ": not a capture";
+    }
+    if (u16(&p[8]) != CAPTURE_VERSION_MAJOR)
+    {
+        uint16_t major = u16(&p[8]);
+        unmap();
+        return std::string(p_path) + ": capture version " + std::to_string(major) + " is not supported";
+    }
+
+    uint32_t metadata_len = u32(&p[20]);
+
+    m_version_minor = u16(&p[10]);
+    m_offset        = u32(&p[12]);
+    m_record_len    = u16(&p[16]);
+    m_bins          = u16(&p[18]);
+    if ((m_offset < CAPTURE_HEADER_LEN + static_cast<uint64_t>(metadata_len)) || (m_offset > m_size) ||
+        (m_bins > RTT_STREAM_HISTOGRAM_MAX_BINS) || (m_record_len < CAPTURE_BURST_HEADER_LEN + 2 * m_bins))
+    {
+        unmap();
+        return std::string(p_path) + ": corrupt capture header";
+    }
+
+    std::string text(reinterpret_cast<char const *>(&p[CAPTURE_HEADER_LEN]), metadata_len);
+    size_t      start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+
+        size_t equals = text.find('=', start);
+        if (equals < end)
+        {
+            m_metadata.emplace_back(text.substr(start, equals - start), text.substr(equals + 1, end - equals - 1));
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+std::string Capture::metadata_get(char const * p_key) const
+{
+    auto found = std::find_if(m_metadata.begin(), m_metadata.end(),
+                              [&](auto const & entry) { return entry.first == p_key; });
+    return (found != m_metadata.end()) ? found->second : std::string();
+}
+
+double Capture::metadata_number(char const * p_key, double fallback) const
+{
+    std::string value = metadata_get(p_key);
+    return value.empty() ? fallback : std::strtod(value.c_str(), nullptr);
+}
+
+size_t Capture::bursts() const
+{
+    return (m_p_data != nullptr) ? (m_size - m_offset) / m_record_len : 0;
+}
+
+void Capture::burst(size_t i, CaptureBurst & burst) const
+{
+    uint8_t const * p = &m_p_data[m_offset + i * m_record_len];
+
+    burst.timestamp   = u64(&p[0]);
+    burst.distance_mm = static_cast<int32_t>(u32(&p[8]));
+    burst.truth_mm    = static_cast<int32_t>(u32(&p[12]));
+    burst.exchanges   = u16(&p[16]);
+    burst.valid       = u16(&p[18]);
+    burst.flags       = p[20];
+    burst.rssi_dbm    = static_cast<int8_t>(p[21]);
+    burst.temperature = static_cast<int16_t>(u16(&p[22]));
+    burst.bins.fill(0);
+    for (uint32_t bin = 0; bin < m_bins; bin++)
+    {
+        burst.bins[bin] = u16(&p[CAPTURE_BURST_HEADER_LEN + 2 * bin]);
+    }
+}
+
+void capture_paths_add(char const * p_path, std::vector<std::string> & paths)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(p_path, error))
+    {
+        paths.push_back(p_path);
+        return;
+    }
+
+    std::vector<std::string> found;
+    for (auto const & entry : std::filesystem::directory_iterator(p_path, error))
+    {
+        if (entry.path().extension() == ".rttcap")
+        {
+            found.push_back(entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+} // namespace rtt
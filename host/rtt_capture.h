@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_CAPTURE_H__
+#define RTT_CAPTURE_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rtt_stream_format.h"
+
+namespace rtt {
+
+/**@brief Capture file format
+ *
+ * @details A capture keeps the bursts of one ranging session for replay on the host. It is a
+ *          header, session metadata and fixed-size burst records, so it can be appended to while
+ *          recording and memory-mapped and indexed when read. A record cut short at the end of
+ *          the file is ignored, and so is the part of a longer record after the fields a reader
+ *          knows. Timestamps are RTC ticks, 32768 Hz, extended past the wrap of the counter. All
+ *          fields are little endian.
+ *
+ *          Header:
+ *          | Offset | Size | Field                                                         |
+ *          |--------|------|---------------------------------------------------------------|
+ *          | 0      | 8    | Magic, "RTTCAP\r\n"                                           |
+ *          | 8      | 2    | Major version, readers reject one they do not know            |
+ *          | 10     | 2    | Minor version, counts fields added at the end of the records  |
+ *          | 12     | 4    | Offset of the first burst record, a multiple of 8             |
+ *          | 16     | 2    | Length of a burst record, a multiple of 8                     |
+ *          | 18     | 2    | Bins in a burst record, n                                     |
+ *          | 20     | 4    | Length of the metadata, m                                     |
+ *          | 24     | m    | Metadata, one "key=value" line for each entry                 |
+ *
+ *          Burst record, version 1.0:
+ *          | Offset | Size | Field                                                         |
+ *          |--------|------|---------------------------------------------------------------|
+ *          | 0      | 8    | Timestamp at the end of the burst                             |
+ *          | 8      | 4    | Distance estimated on the device, mm, signed, or none         |
+ *          | 12     | 4    | True distance, mm, signed, or none                            |
+ *          | 16     | 2    | Exchanges attempted                                           |
+ *          | 18     | 2    | Exchanges with a valid response                               |
+ *          | 20     | 1    | Flags, CAPTURE_FLAG_*                                         |
+ *          | 21     | 1    | RSSI at the responder, dBm, signed                            |
+ *          | 22     | 2    | Die temperature of the responder, 0.25 degrees C, signed      |
+ *          | 24     | 2n   | Round trip histogram                                          |
+ *
+ *          Metadata keys in use:
+ *          | Key        | Value                                                         |
+ *          |------------|---------------------------------------------------------------|
+ *          | source     | "stream" recorded from an initiator, "sim" from rtt_sim       |
+ *          | recorded   | Start of the recording, UTC, ISO 8601                         |
+ *          | peer       | Peer index of the responder recorded from the stream          |
+ *          | truth_m    | Surveyed distance, for the bursts without their own           |
+ *          | bin_offset | Round trip ticks trimmed before binning, default 4150         |
+ *          | site       | Where it was recorded                                         |
+ *          | initiator  | Board of the initiator                                        |
+ *          | responder  | Board of the responder                                        |
+ *          | note       | Anything else                                                 |
+ */
+
+#define CAPTURE_MAGIC                "RTTCAP\r\n"
+#define CAPTURE_VERSION_MAJOR        1
+#define CAPTURE_VERSION_MINOR        0
+#define CAPTURE_HEADER_LEN           24
+#define CAPTURE_BURST_HEADER_LEN     24
+#define CAPTURE_DISTANCE_NONE        INT32_MIN
+
+#define CAPTURE_FLAG_HISTOGRAM       0x01 /**< The histogram was recorded. */
+#define CAPTURE_FLAG_RSSI            0x02 /**< The RSSI is known. */
+#define CAPTURE_FLAG_TEMPERATURE     0x04 /**< The temperature is known. */
+
+/**@brief Session metadata, in the order it was written */
+using CaptureMetadata = std::vector<std::pair<std::string, std::string>>;
+
+/**@brief One burst of a capture */
+struct CaptureBurst
+{
+    uint64_t timestamp   = 0;
+    int32_t  distance_mm = CAPTURE_DISTANCE_NONE;
+    int32_t  truth_mm    = CAPTURE_DISTANCE_NONE;
+    uint16_t exchanges   = 0;
+    uint16_t valid       = 0;
+    uint8_t  flags       = 0;
+    int8_t   rssi_dbm    = 0;
+    int16_t  temperature = 0;
+    std::array<uint16_t, RTT_STREAM_HISTOGRAM_MAX_BINS> bins{};
+};
+
+/**@brief Writes a capture, one burst at a time */
+class CaptureWriter
+{
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter();
+
+    CaptureWriter(CaptureWriter const &) = delete;
+    CaptureWriter & operator=(CaptureWriter const &) = delete;
+
+    /**@brief Create the file and write the header and metadata
+     *
+     * @return Empty on success, else what went wrong
+     */
+    std::string open(char const * p_path, CaptureMetadata const & metadata);
+
+    /**@brief Append a burst. Returns false on a write error. */
+    bool write(CaptureBurst const & burst);
+
+    /**@brief Flush and close the file. Returns false on a write error. */
+    bool close();
+
+    bool is_open() const { return m_p_file != nullptr; }
+
+private:
+    std::FILE * m_p_file = nullptr;
+};
+
+/**@brief A capture file mapped into memory for reading */
+class Capture
+{
+public:
+    Capture() = default;
+    ~Capture();
+
+    Capture(Capture && other) noexcept;
+    Capture & operator=(Capture && other) noexcept;
+    Capture(Capture const &) = delete;
+    Capture & operator=(Capture const &) = delete;
+
+    /**@brief Map a capture and check its header
+     *
+     * @return Empty on success, else what went wrong
+     */
+    std::string open(char const * p_path);
+
+    CaptureMetadata const & metadata() const { return m_metadata; }
+
+    /**@brief Value of a metadata key, empty if it is not set */
+    std::string metadata_get(char const * p_key) const;
+
+    /**@brief Numeric value of a metadata key, the fallback if it is not set */
+    double metadata_number(char const * p_key, double fallback) const;
+
+    /**@brief Number of complete burst records */
+    size_t bursts() const;
+
+    /**@brief Decode a burst record, i < bursts() */
+    void burst(size_t i, CaptureBurst & burst) const;
+
+    uint16_t version_minor() const { return m_version_minor; }
+
+private:
+    void unmap();
+
+    uint8_t const * m_p_data        = nullptr;
+    size_t          m_size          = 0;
+    uint16_t        m_version_minor = 0;
+    uint32_t        m_offset        = 0; /* Offset of the first burst record */
+    uint32_t        m_record_len    = 0;
+    uint32_t        m_bins          = 0;
+    CaptureMetadata m_metadata;
+};
+
+/**@brief Add a capture path, or the .rttcap files in a directory in name order */
+void capture_paths_add(char const * p_path, std::vector<std::string> & paths);
+
+} // namespace rtt
+
+#endif // RTT_CAPTURE_H__
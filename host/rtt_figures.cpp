@@ -0,0 +1,156 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rtt_figures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace rtt {
+
+bool figures_parse(std::string const & json, std::map<std::string, Figures> & runs)
+{
+    size_t start = 0;
+
+    while ((start = json.find("{\"name\"", start)) != std::string::npos)
+    {
+        size_t end = json.find('}', start);
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+
+        std::stringstream fields(json.substr(start + 1, end - start - 1));
+        std::string       field;
+        std::string       name;
+        Figures           figures;
+        while (std::getline(fields, field, ','))
+        {
+            size_t key_start = field.find('"');
+            size_t key_end   = field.find('"', key_start + 1);
+            size_t colon     = field.find(':', key_end);
+            if ((key_start == std::string::npos) || (key_end == std::string::npos) || (colon == std::string::npos))
+            {
+                return false;
+            }
+
+            std::string key   = field.substr(key_start + 1, key_end - key_start - 1);
+            std::string value = field.substr(colon + 1);
+            if (key == "name")
+            {
+                size_t value_start = value.find('"');
+                name = value.substr(value_start + 1, value.find('"', value_start + 1) - value_start - 1);
+            }
+            else
+            {
+                figures[key] = std::strtod(value.c_str(), nullptr);
+            }
+        }
+        runs[name] = figures;
+        start = end;
+    }
+    return true;
+}
+
+bool figures_load(char const * p_path, std::map<std::string, Figures> & runs)
+{
+    std::ifstream     file(p_path);
+    std::stringstream text;
+
+    text << file.rdbuf();
+    return file && figures_parse(text.str(), runs);
+}
+
+uint32_t figures_compare(std::map<std::string, Figures> const & baseline,
+                         std::map<std::string, Figures> const & current,
+                         std::vector<std::string> const & names,
+                         std::vector<Tracked> const & tracked,
+                         char const * p_label)
+{
+    uint32_t regressions = 0;
+    int      width       = 12;
+
+    for (std::string const & name : names)
+    {
+        width = std::max(width, static_cast<int>(name.size()));
+    }
+
+    std::fprintf(stderr, "%-*s %-28s %12s %12s %10s\n", width, p_label, "figure", "baseline", "now", "change");
+    for (std::string const & name : names)
+    {
+        auto results = current.find(name);
+        auto base    = baseline.find(name);
+        if (results == current.end())
+        {
+            continue;
+        }
+        if (base == baseline.end())
+        {
+            std::fprintf(stderr, "%-*s not in the baseline\n", width, name.c_str());
+            continue;
+        }
+
+        Figures const & figures = results->second;
+
+        for (Tracked const & figure : tracked)
+        {
+            auto now  = figures.find(figure.p_key);
+            auto then = base->second.find(figure.p_key);
+            if ((now == figures.end()) || (then == base->second.end()))
+            {
+                continue;
+            }
+
+            double worse;
+            switch (figure.better)
+            {
+                case HIGHER:      worse = then->second - now->second; break;
+                case LOWER:       worse = now->second - then->second; break;
+                case NEARER_ZERO: worse = std::fabs(now->second) - std::fabs(then->second); break;
+                default:          worse = 0.0; break;
+            }
+
+            double       tolerance = std::max(figure.absolute, figure.relative * std::fabs(then->second));
+            char const * p_verdict = "";
+            if (worse > tolerance)
+            {
+                p_verdict = "worse";
+                regressions++;
+            }
+            else if (-worse > tolerance)
+            {
+                p_verdict = "better";
+            }
+            std::fprintf(stderr, "%-*s %-28s %12.4g %12.4g %+10.4g %s\n", width, name.c_str(), figure.p_key,
+                         then->second, now->second, now->second - then->second, p_verdict);
+        }
+    }
+    return regressions;
+}
+
+} // namespace rtt
@@ -0,0 +1,80 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_FIGURES_H__
+#define RTT_FIGURES_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rtt {
+
+/**@brief Figures of one run, by key */
+using Figures = std::map<std::string, double>;
+
+enum Better
+{
+    HIGHER,
+    LOWER,
+    NEARER_ZERO,
+    EITHER,     /* Only reported */
+};
+
+/**@brief A figure compared with the baseline. It has got worse if it moved the wrong way by
+ *        more than the larger of the absolute and the relative tolerance. */
+struct Tracked
+{
+    char const * p_key;
+    Better       better;
+    double       absolute;
+    double       relative;
+};
+
+/**@brief Parse a JSON file of flat objects, each with a "name" and numeric figures, by name.
+ *
+ * @details This is the output of rtt_bench and rtt_replay, not JSON in general: the objects
+ *          must not nest and the values must not contain commas or braces.
+ */
+bool figures_parse(std::string const & json, std::map<std::string, Figures> & runs);
+
+/**@brief Read and parse a file written by figures_parse's producers */
+bool figures_load(char const * p_path, std::map<std::string, Figures> & runs);
+
+/**@brief Print the tracked figures of the named runs next to the baseline
+ *
+ * @param[in] p_label Heading of the name column.
+ *
+ * @return Number of figures that got worse
+ */
+uint32_t figures_compare(std::map<std::string, Figures> const & baseline,
+                         std::map<std::string, Figures> const & current,
+                         std::vector<std::string> const & names,
+                         std::vector<Tracked> const & tracked,
+                         char const * p_label);
+
+} // namespace rtt
+
+#endif // RTT_FIGURES_H__
@@ -0,0 +1,107 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rtt_jobs.h"
+
+#include <cstdlib>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace rtt {
+
+std::vector<std::string> jobs_run(size_t count, uint32_t jobs, Job const & job)
+{
+    struct Running
+    {
+        pid_t  pid;
+        int    fd;
+        size_t index;
+    };
+
+    std::vector<std::string> outputs(count);
+    std::vector<Running>     running;
+    size_t                   next = 0;
+
+    std::fflush(nullptr);
+    while ((next < count) || !running.empty())
+    {
+        while ((next < count) && (running.size() < jobs))
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                std::perror("pipe");
+                std::exit(EXIT_FAILURE);
+            }
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                std::perror("fork");
+                std::exit(EXIT_FAILURE);
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+
+                std::FILE * p_file = fdopen(fds[1], "w");
+                job(next, p_file);
+                std::fclose(p_file);
+                std::_Exit(EXIT_SUCCESS);
+            }
+            close(fds[1]);
+            running.push_back({pid, fds[0], next++});
+        }
+
+        /* The outputs are small enough to wait for the jobs in order */
+        Running done = running.front();
+        running.erase(running.begin());
+
+        std::string output;
+        char        buffer[1024];
+        ssize_t     length;
+        while ((length = read(done.fd, buffer, sizeof(buffer))) > 0)
+        {
+            output.append(buffer, static_cast<size_t>(length));
+        }
+        close(done.fd);
+
+        int status;
+        waitpid(done.pid, &status, 0);
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS))
+        {
+            outputs[done.index] = output;
+        }
+    }
+    return outputs;
+}
+
+uint32_t jobs_default()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus > 0) ? static_cast<uint32_t>(cpus) : 1;
+}
+
+} // namespace rtt
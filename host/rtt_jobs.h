@@ -0,0 +1,54 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_JOBS_H__
+#define RTT_JOBS_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rtt {
+
+/**@brief A job, run in a child process. It writes its output to the file it is given and
+ *        returns; exiting with a failure marks the job as failed. */
+using Job = std::function<void(size_t index, std::FILE * p_output)>;
+
+/**@brief Run jobs in child processes, up to a number of them at a time
+ *
+ * @details Each job gets a process of its own, as the firmware images of the simulator keep their
+ *          state in globals and can only run once per process.
+ *
+ * @return The output of each job in order, empty for those that failed
+ */
+std::vector<std::string> jobs_run(size_t count, uint32_t jobs, Job const & job);
+
+/**@brief Number of CPUs, the default number of jobs */
+uint32_t jobs_default();
+
+} // namespace rtt
+
+#endif // RTT_JOBS_H__
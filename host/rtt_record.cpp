@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Records the initiator's binary record stream from a file, a serial port or stdin into a
+   capture file for rtt_replay: the histogram and the device's estimate of every burst to one
+   responder, its latest RSSI and temperature, and metadata about the session. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "rtt_capture.h"
+#include "rtt_stream_decoder.h"
+#include "rtt_telemetry.h"
+
+namespace {
+
+volatile std::sig_atomic_t m_stop = 0;
+
+/**@brief Pairs each distance record of the responder with the histogram that follows it */
+class Recorder : public rtt::RecordHandler
+{
+public:
+    Recorder(rtt::CaptureWriter & writer, uint8_t peer) : m_writer(writer), m_peer(peer) {}
+
+    void on_distance(rtt::DistanceRecord const & r) override
+    {
+        flush();
+        if (r.peer != m_peer)
+        {
+            return;
+        }
+        m_burst.timestamp   = r.timestamp;
+        m_burst.distance_mm = r.distance_mm;
+        m_burst.exchanges   = r.exchanges;
+        m_burst.valid       = r.valid;
+        m_burst.flags       = m_telemetry_flags;
+        m_burst.bins.fill(0);
+        m_pending = true;
+    }
+
+    void on_histogram(rtt::HistogramRecord const & r) override
+    {
+        if (r.peer != m_peer)
+        {
+            return;
+        }
+        if (!m_pending || (r.timestamp != m_burst.timestamp))
+        {
+            m_unpaired++;
+            return;
+        }
+
+        m_burst.bins   = r.bins;
+        m_burst.flags |= CAPTURE_FLAG_HISTOGRAM;
+        flush();
+    }
+
+    void on_telemetry(rtt::TelemetryRecord const & r) override
+    {
+        if (r.peer != m_peer)
+        {
+            return;
+        }
+        if (r.valid & (1U << RTT_TELEMETRY_RSSI))
+        {
+            m_burst.rssi_dbm   = static_cast<int8_t>(r.rssi_dbm);
+            m_telemetry_flags |= CAPTURE_FLAG_RSSI;
+        }
+        if (r.valid & (1U << RTT_TELEMETRY_TEMPERATURE))
+        {
+            m_burst.temperature = static_cast<int16_t>(r.temperature);
+            m_telemetry_flags  |= CAPTURE_FLAG_TEMPERATURE;
+        }
+    }
+
+    /**@brief Write the last burst, with or without its histogram */
+    void flush()
+    {
+        if (!m_pending)
+        {
+            return;
+        }
+
+        m_pending = false;
+        if (!m_writer.write(m_burst))
+        {
+            m_write_errors++;
+        }
+        m_bursts++;
+        if (!(m_burst.flags & CAPTURE_FLAG_HISTOGRAM))
+        {
+            m_without_histogram++;
+        }
+    }
+
+    uint64_t bursts() const { return m_bursts; }
+    uint64_t without_histogram() const { return m_without_histogram; }
+    uint64_t unpaired() const { return m_unpaired; }
+    uint64_t write_errors() const { return m_write_errors; }
+
+private:
+    rtt::CaptureWriter & m_writer;
+    uint8_t              m_peer;
+    rtt::CaptureBurst    m_burst;
+    bool                 m_pending           = false;
+    uint8_t              m_telemetry_flags   = 0;
+    uint64_t             m_bursts            = 0;
+    uint64_t             m_without_histogram = 0;
+    uint64_t             m_unpaired          = 0; /* Histograms without their distance record */
+    uint64_t             m_write_errors      = 0;
+};
+
+void stop(int)
+{
+    m_stop = 1;
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-p peer] [-m key=value]... capture [stream]\n"
+                 "Records the binary record stream of the initiator from stream, or from stdin, into a\n"
+                 "capture file for rtt_replay. Stops at the end of the stream or on Ctrl-C.\n"
+                 "A serial port must be set up first, for example: stty -F /dev/ttyACM0 1000000 raw\n"
+                 "  -p peer       Record the bursts to this responder, by peer index (default 0)\n"
+                 "  -m key=value  Session metadata, for example truth_m=4.20, site=lab or note=...\n"
+                 "                See rtt_capture.h for the keys in use\n",
+                 p_name);
+}
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    rtt::CaptureMetadata      metadata = {{"source", "stream"}};
+    std::vector<char const *> paths;
+    unsigned long             peer     = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-p") == 0)
+        {
+            char * p_end = nullptr;
+            peer = (i + 1 < argc) ? std::strtoul(argv[++i], &p_end, 0) : 256;
+            if ((p_end == nullptr) || (*p_end != '\0') || (peer > UINT8_MAX))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (std::strcmp(argv[i], "-m") == 0)
+        {
+            char const * p_entry  = (i + 1 < argc) ? argv[++i] : "";
+            char const * p_equals = std::strchr(p_entry, '=');
+            if (p_equals == nullptr)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            metadata.emplace_back(std::string(p_entry, p_equals), std::string(p_equals + 1));
+        }
+        else if ((argv[i][0] == '-') || (paths.size() == 2))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char        recorded[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(recorded, sizeof(recorded), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    metadata.insert(metadata.begin() + 1, {"recorded", recorded});
+    metadata.insert(metadata.begin() + 2, {"peer", std::to_string(peer)});
+
+    std::FILE * p_input = (paths.size() < 2) ? stdin : std::fopen(paths[1], "rb");
+    if (p_input == nullptr)
+    {
+        std::perror(paths[1]);
+        return 1;
+    }
+
+    rtt::CaptureWriter writer;
+    std::string        error = writer.open(paths[0], metadata);
+    if (!error.empty())
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    Recorder             recorder(writer, static_cast<uint8_t>(peer));
+    rtt::StreamDecoder   decoder(recorder);
+    std::vector<uint8_t> buffer(4096);
+    size_t               len;
+
+    /* Without SA_RESTART, so a read from a serial port returns on Ctrl-C */
+    struct sigaction action = {};
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    while (!m_stop && ((len = std::fread(buffer.data(), 1, buffer.size(), p_input)) > 0))
+    {
+        decoder.feed(buffer.data(), len);
+    }
+    recorder.flush();
+
+    if (p_input != stdin)
+    {
+        std::fclose(p_input);
+    }
+    if (!writer.close() || (recorder.write_errors() != 0))
+    {
+        std::fprintf(stderr, "%s: write failed\n", paths[0]);
+        return 1;
+    }
+
+    rtt::DecoderStats const & stats = decoder.stats();
+    std::fprintf(stderr, "%llu bursts recorded, %llu without a histogram, %llu histograms without a distance\n",
+                 (unsigned long long)recorder.bursts(), (unsigned long long)recorder.without_histogram(),
+                 (unsigned long long)recorder.unpaired());
+    std::fprintf(stderr, "%llu frames lost, %llu CRC errors, %llu framing errors\n",
+                 (unsigned long long)stats.lost, (unsigned long long)stats.crc_errors,
+                 (unsigned long long)stats.framing_errors);
+
+    return 0;
+}
@@ -0,0 +1,338 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Replays captures through the initiator's distance estimator, compiled from the firmware
+   sources, and writes the accuracy and cost of the estimates as JSON. Given the output of an
+   earlier run as a baseline, it fails if a capture got less accurate or slower to estimate. */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <x86intrin.h>
+
+#include "rtt_calibration_file.h"
+#include "rtt_capture.h"
+#include "rtt_figures.h"
+
+extern "C" {
+#include "rtt_estimator.h"
+}
+
+namespace {
+
+using namespace rtt;
+
+constexpr double RTC_FREQ_HZ = 32768.0;
+
+/**@brief Replays are deterministic but for the cycles, which are the fastest of several passes */
+std::vector<Tracked> const TRACKED =
+{
+    {"estimates",        HIGHER,      0.0,   0.0},
+    {"bias_m",           NEARER_ZERO, 0.005, 0.0},
+    {"std_m",            LOWER,       0.005, 0.0},
+    {"rms_m",            LOWER,       0.005, 0.0},
+    {"estimator_cycles", LOWER,       0.0,   0.25},
+    {"device_change_m",  EITHER,      0.0,   0.0},
+};
+
+/**@brief Figures of one replayed capture */
+struct Replay
+{
+    std::string name;
+    size_t      bursts           = 0;
+    size_t      replayed         = 0;   /**< Bursts with a histogram. */
+    size_t      estimates        = 0;   /**< Replayed bursts with an estimate. */
+    size_t      truths           = 0;   /**< Estimates with a true distance. */
+    double      truth_m          = NAN; /**< Mean true distance at the estimates. */
+    double      bias_m           = NAN;
+    double      std_m            = NAN;
+    double      rms_m            = NAN;
+    double      device_change_m  = NAN; /**< Mean absolute change from the estimates made on the device. */
+    double      estimator_cycles = 0.0; /**< Host CPU cycles for each burst, fastest pass. */
+    double      seconds          = 0.0; /**< Time span of the capture. */
+    double      speedup          = 0.0; /**< Capture time over replay time. */
+};
+
+/**@brief Replay one capture
+ *
+ * @return Empty on success, else what went wrong
+ */
+std::string replay(char const * p_path, uint32_t passes, rtt_calibration_t const & calibration, Replay & result)
+{
+    Capture     capture;
+    std::string error = capture.open(p_path);
+    if (!error.empty())
+    {
+        return error;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    double                   truth_m    = capture.metadata_number("truth_m", NAN);
+    double                   bin_offset = capture.metadata_number("bin_offset", RTT_DEFAULT_BIN_OFFSET);
+    std::vector<rtt_burst_t> bursts;
+    std::vector<double>      truths;
+    std::vector<int32_t>     device_mm;
+    CaptureBurst             burst;
+    uint64_t                 first      = 0;
+
+    result.name   = std::filesystem::path(p_path).filename().string();
+    result.bursts = capture.bursts();
+    bursts.reserve(result.bursts);
+    for (size_t i = 0; i < result.bursts; i++)
+    {
+        capture.burst(i, burst);
+        first          = (i == 0) ? burst.timestamp : first;
+        result.seconds = (burst.timestamp - first) / RTC_FREQ_HZ;
+        if (!(burst.flags & CAPTURE_FLAG_HISTOGRAM))
+        {
+            continue;
+        }
+
+        rtt_burst_t replayed = {};
+        replayed.exchanges = burst.exchanges;
+        replayed.valid     = burst.valid;
+        replayed.timestamp  = static_cast<uint32_t>(burst.timestamp);
+        replayed.bin_offset = static_cast<uint16_t>(bin_offset);
+        std::copy(burst.bins.begin(), burst.bins.end(), replayed.bins);
+
+        bursts.push_back(replayed);
+        truths.push_back((burst.truth_mm != CAPTURE_DISTANCE_NONE) ? burst.truth_mm / 1000.0 : truth_m);
+        device_mm.push_back(burst.distance_mm);
+    }
+    result.replayed = bursts.size();
+
+    std::vector<float> estimates(bursts.size());
+    uint64_t           fastest = UINT64_MAX;
+    for (uint32_t pass = 0; pass < passes; pass++)
+    {
+        uint64_t cycles = __rdtsc();
+        for (size_t i = 0; i < bursts.size(); i++)
+        {
+            estimates[i] = calc_dist(&bursts[i], &calibration);
+        }
+        fastest = std::min<uint64_t>(fastest, __rdtsc() - cycles);
+    }
+
+    double sum_truth = 0.0, sum_error = 0.0, sum_error_2 = 0.0, sum_change = 0.0;
+    size_t changes   = 0;
+    for (size_t i = 0; i < estimates.size(); i++)
+    {
+        if (std::isnan(estimates[i]))
+        {
+            continue;
+        }
+        result.estimates++;
+        if (device_mm[i] != CAPTURE_DISTANCE_NONE)
+        {
+            sum_change += std::fabs(estimates[i] - device_mm[i] / 1000.0);
+            changes++;
+        }
+        if (!std::isnan(truths[i]))
+        {
+            double error = estimates[i] - truths[i];
+            sum_truth   += truths[i];
+            sum_error   += error;
+            sum_error_2 += error * error;
+            result.truths++;
+        }
+    }
+
+    if (result.truths != 0)
+    {
+        double n = static_cast<double>(result.truths);
+        result.truth_m = sum_truth / n;
+        result.bias_m  = sum_error / n;
+        result.rms_m   = std::sqrt(sum_error_2 / n);
+        result.std_m   = std::sqrt(std::max(0.0, sum_error_2 / n - result.bias_m * result.bias_m));
+    }
+    if (changes != 0)
+    {
+        result.device_change_m = sum_change / changes;
+    }
+    if (!bursts.empty())
+    {
+        result.estimator_cycles = static_cast<double>(fastest) / bursts.size();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.speedup = (elapsed > 0.0) ? result.seconds / elapsed : 0.0;
+    return "";
+}
+
+/**@brief Write a replay as one JSON object with flat fields, leaving out the unknown figures */
+std::string replay_json(Replay const & result)
+{
+    std::string json = "{\"name\": \"" + result.name + "\"";
+    char        field[64];
+
+    auto add = [&](char const * p_key, double value, char const * p_format)
+    {
+        if (!std::isnan(value))
+        {
+            std::snprintf(field, sizeof(field), p_format, value);
+            json += std::string(", \"") + p_key + "\": " + field;
+        }
+    };
+
+    add("bursts",           static_cast<double>(result.bursts),    "%.0f");
+    add("replayed",         static_cast<double>(result.replayed),  "%.0f");
+    add("estimates",        static_cast<double>(result.estimates), "%.0f");
+    add("seconds",          result.seconds,          "%.3f");
+    add("truth_m",          result.truth_m,          "%.4f");
+    add("bias_m",           result.bias_m,           "%.4f");
+    add("std_m",            result.std_m,            "%.4f");
+    add("rms_m",            result.rms_m,            "%.4f");
+    add("device_change_m",  result.device_change_m,  "%.4f");
+    add("estimator_cycles", result.estimator_cycles, "%.1f");
+    add("speedup",          result.speedup,          "%.0f");
+    return json + "}";
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] capture|directory...\n"
+                 "Replays captures through the firmware's distance estimator. A directory stands for\n"
+                 "the .rttcap files in it. The true distance is taken from each burst, or else from\n"
+                 "the truth_m metadata of the capture.\n"
+                 "  -o <file>    Write the figures as JSON to a file, default stdout\n"
+                 "  -b <file>    Compare with the figures of an earlier run, fail if one got worse\n"
+                 "  -p <passes>  Timed passes over each capture, the fastest counts, default 5\n"
+                 "  -c <file>    Calibration blob to estimate with, from rtt_calibrate, default the\n"
+                 "               calibration the firmware is built with\n",
+                 p_name);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    char const *             p_output      = nullptr;
+    char const *             p_baseline    = nullptr;
+    char const *             p_calibration = nullptr;
+    uint32_t                 passes        = 5;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option[0] != '-')
+        {
+            capture_paths_add(argv[i], paths);
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        char const * p_value = argv[++i];
+        if (option == "-o")      p_output      = p_value;
+        else if (option == "-b") p_baseline    = p_value;
+        else if (option == "-c") p_calibration = p_value;
+        else if (option == "-p") passes        = static_cast<uint32_t>(std::max(1, std::atoi(p_value)));
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (paths.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    rtt_calibration_t calibration = RTT_CALIBRATION_DEFAULT;
+    if (p_calibration != nullptr)
+    {
+        std::string error = calibration_load(p_calibration, calibration);
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    std::map<std::string, Figures> baseline;
+    if ((p_baseline != nullptr) && !figures_load(p_baseline, baseline))
+    {
+        std::fprintf(stderr, "%s: cannot read the baseline\n", p_baseline);
+        return 2;
+    }
+
+    std::string              json   = "{\"captures\": [\n";
+    std::vector<std::string> names;
+    bool                     failed = false;
+    for (std::string const & path : paths)
+    {
+        Replay      result;
+        std::string error = replay(path.c_str(), passes, calibration, result);
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            failed = true;
+            continue;
+        }
+
+        std::fprintf(stderr, "%s: %zu bursts, %zu estimates, %.0f s replayed %.0fx faster\n",
+                     result.name.c_str(), result.bursts, result.estimates, result.seconds, result.speedup);
+        json += (json.back() == '\n' ? "  " : ",\n  ") + replay_json(result);
+        names.push_back(result.name);
+    }
+    json += "\n]}\n";
+
+    std::FILE * p_file = (p_output == nullptr) ? stdout : std::fopen(p_output, "w");
+    if (p_file == nullptr)
+    {
+        std::perror(p_output);
+        return 2;
+    }
+    std::fputs(json.c_str(), p_file);
+    if (p_file != stdout)
+    {
+        std::fclose(p_file);
+    }
+
+    if (p_baseline != nullptr)
+    {
+        std::map<std::string, Figures> current;
+        figures_parse(json, current);
+        if (figures_compare(baseline, current, names, TRACKED, "capture") > 0)
+        {
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
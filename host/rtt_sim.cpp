@@ -0,0 +1,402 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Runs the initiator and responder firmware against each other on the simulated register model
+   and reports the exchange rate and the accuracy of the distance estimate. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "rtt_capture.h"
+#include "rtt_parameters.h"
+#include "sim_channel.h"
+#include "sim_core.h"
+#include "sim_medium.h"
+#include "sim_metrics.h"
+#include "sim_softdevice.h"
+
+extern "C" {
+#include "rtt_config.h"
+}
+
+extern "C" sim_firmware_t const sim_firmware_initiator;
+extern "C" sim_firmware_t const sim_firmware_responder;
+extern "C" sim_firmware_t const sim_firmware_initiator_b;
+
+namespace {
+
+using namespace rtt::sim;
+
+class Report : public Metrics
+{
+public:
+    Report(bool verbose, rtt::CaptureWriter & capture) : m_verbose(verbose), m_capture(capture) {}
+
+    void on_burst(Node const & node, sim_burst_t const & burst) override
+    {
+        Metrics::on_burst(node, burst);
+        if (m_capture.is_open())
+        {
+            capture_write(node, burst);
+        }
+        if (m_verbose)
+        {
+            std::printf("%12.3f %s: burst %u/%u valid, %u crc errors, %u ignored, %u timeouts, %.2f m\n",
+                        to_us(node.now()) / 1000.0, node.name(), burst.valid, burst.exchanges,
+                        burst.rx_crc_error, burst.rx_ignored, burst.rx_timeouts, burst.distance_m);
+        }
+    }
+
+    void on_log(Node const & node, char const * p_line) override
+    {
+        if (m_verbose)
+        {
+            std::printf("%12.3f %s: %s\n", to_us(node.now()) / 1000.0, node.name(), p_line);
+        }
+    }
+
+    static void print(Results const & results, Simulator const & simulator)
+    {
+        std::printf("simulated      %.3f s, %u bursts\n", results.seconds, results.bursts);
+        std::printf("exchanges      %u, %.1f /s\n", results.exchanges, results.exchanges_per_s);
+        std::printf("valid          %u, %.1f %%\n", results.valid, 100.0 * results.valid_ratio);
+        std::printf("crc errors     %u\n", results.crc_errors);
+        std::printf("ignored        %u\n", results.ignored);
+        std::printf("timeouts       %u\n", results.timeouts);
+
+        if (results.estimates == 0)
+        {
+            std::printf("distance       no estimate, true %.2f m\n", simulator.medium().range(0));
+        }
+        else
+        {
+            std::printf("distance       %.2f m mean, %.2f m std, true %.2f m, error %+.2f m\n",
+                        results.mean_m, results.std_m, results.range_m, results.bias_m);
+            std::printf("latency        %.1f us mean, %.1f us max, estimator %.0f host cycles\n",
+                        results.latency_us, results.latency_max_us, results.estimator_cycles);
+        }
+
+        if (results.single_shots != 0)
+        {
+            std::printf("single shots   %u, %.1f ms mean, %.1f ms max from request to result\n",
+                        results.single_shots, results.single_shot_us / 1000.0, results.single_shot_max_us / 1000.0);
+        }
+
+        for (auto const & p_node : simulator.nodes())
+        {
+            TimeslotStats stats = p_node->softdevice().stats();
+
+            std::printf("timeslots      %s: %u requests, %u granted, %u blocked, %u canceled\n",
+                        p_node->name(), stats.requests, stats.granted, stats.blocked, stats.canceled);
+            std::printf("               %.1f %% of the time in timeslots, %.1f %% of the granted length used\n",
+                        100.0 * to_us(stats.slot_time) / (results.seconds * 1e6),
+                        (stats.granted_time != 0) ? 100.0 * stats.slot_time / stats.granted_time : 0.0);
+            std::printf("               %u extensions, %u failed\n", stats.extensions, stats.extensions_failed);
+        }
+        for (NodeResults const & node : results.nodes)
+        {
+            std::printf("power          %s: radio %.2f %% active, HFXO %.2f %% running, %.0f uA\n",
+                        node.name.c_str(), 100.0 * node.radio_duty, 100.0 * node.hfxo_duty, node.current_ua);
+        }
+    }
+
+private:
+    /**@brief Write a burst to the capture, with the true distance when it ended */
+    void capture_write(Node const & node, sim_burst_t const & burst)
+    {
+        rtt::CaptureBurst record;
+
+        record.timestamp   = static_cast<uint64_t>(node.now() * (32768.0 / PS_PER_S));
+        record.distance_mm = std::isnan(burst.distance_m) ? CAPTURE_DISTANCE_NONE
+                                                          : static_cast<int32_t>(std::lround(burst.distance_m * 1000.0));
+        record.truth_mm    = static_cast<int32_t>(std::lround(node.sim().medium().range(node.now()) * 1000.0));
+        record.exchanges   = static_cast<uint16_t>(burst.exchanges);
+        record.valid       = static_cast<uint16_t>(burst.valid);
+        record.flags       = CAPTURE_FLAG_HISTOGRAM;
+        std::copy(burst.p_bins, burst.p_bins + std::min<size_t>(burst.bins, record.bins.size()), record.bins.begin());
+        m_capture.write(record);
+    }
+
+    bool                 m_verbose;
+    rtt::CaptureWriter & m_capture;
+};
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  -t <s>             Simulated time, default 10\n"
+                 "  -d <m>             Distance between the nodes, default 1\n"
+                 "  -p <ns>            Propagation delay, instead of the distance\n"
+                 "  --to <m>           Move back and forth between -d and this distance\n"
+                 "  --speed <m/s>      Speed of the movement, default 0\n"
+                 "  -l <p>             Packet loss probability, default 0\n"
+                 "  -c <p>             CRC error probability, default 0\n"
+                 "  -r <Hz>            Bursts per second, 0 for continuous ranging, default 10\n"
+                 "  -n <exchanges>     Exchanges in each burst, default 16\n"
+                 "  --slot <us>        Timeslot length in continuous ranging, default TS_LEN_US\n"
+                 "  --margin <us>      Time a burst leaves at the end of its timeslot,\n"
+                 "                     default TS_BURST_END_MARGIN_US\n"
+                 "  --bins <n>         Histogram bins in use, default RTT_DEFAULT_BINS\n"
+                 "  --power <policy>   Power policy of the initiator: slot, session or auto\n"
+                 "  --single-shot <ms> Interval of single-shot requests during the ranging,\n"
+                 "                     default none\n"
+                 "  --link <aa,seed>   Access address and hop seed of the link of both nodes,\n"
+                 "                     default 0,0: the shared access address and channel\n"
+                 "  --responder-link <aa,seed> Link of the responder only, to check that it\n"
+                 "                     ignores an initiator on another link\n"
+                 "  --second <aa,seed> Add a second initiator on this link, which gives the\n"
+                 "                     responder another address than the first\n"
+                 "  -s <seed>          Random seed, default 1\n"
+                 "  --ramp-up <us>     Radio ramp-up time, default 140\n"
+                 "  --ramp-up-fast <us> Fast radio ramp-up time, default 40\n"
+                 "  --tx-disable <us>  Radio disable time from TX, default 6\n"
+                 "  --tx-chain <ns>    START to the first bit on the air, default 600\n"
+                 "  --rx-chain <ns>    Bit at the antenna to its event, default 7180\n"
+                 "  --grants <pattern> Outcome of each timeslot request in turn, repeated:\n"
+                 "                     g granted, b blocked, c canceled\n"
+                 "  --extensions <pattern> Outcome of each extension in turn, repeated:\n"
+                 "                     1 succeeds, 0 fails\n"
+                 "  --ble-interval <us> Interval of other BLE connection events, default none\n"
+                 "  --ble-event <us>   Length of each connection event\n"
+                 "  --channel <file>   Field channel: multipath, timing error and packet errors,\n"
+                 "                     see channel_config_load() in host/sim/sim_channel.h\n"
+                 "  --ppm <a,b>        Crystal offset of the initiator and the responder\n"
+                 "  --capture <file>   Record the bursts into a capture for rtt_replay\n"
+                 "  -j                 Print the results as JSON\n"
+                 "  -v                 Print each burst and the firmware log\n",
+                 p_name);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    Config        config;
+    ChannelConfig channel_config;
+    char const *  p_channel_path = nullptr;
+    char const *  p_capture_path = nullptr;
+    double        seconds        = 10.0;
+    bool          verbose        = false;
+    bool          json           = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "-v" || option == "-j")
+        {
+            (option == "-v" ? verbose : json) = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        char const * p_value = argv[++i];
+        if (option == "--channel" || option == "--capture")
+        {
+            (option == "--channel" ? p_channel_path : p_capture_path) = p_value;
+            continue;
+        }
+        if (option == "--ppm")
+        {
+            char * p_end;
+            config.ppm.clear();
+            do
+            {
+                config.ppm.push_back(std::strtod(p_value, &p_end));
+                p_value = p_end + 1;
+            } while (*p_end == ',');
+            if (*p_end != '\0')
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            continue;
+        }
+        if (option == "--power")
+        {
+            std::string policy = p_value;
+            if (policy != "slot" && policy != "session" && policy != "auto")
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            config.ranging.power = (policy == "slot")    ? SIM_POWER_PER_SLOT :
+                                   (policy == "session") ? SIM_POWER_PER_SESSION : SIM_POWER_AUTO;
+            continue;
+        }
+        if (option == "--link" || option == "--responder-link" || option == "--second")
+        {
+            char *        p_end;
+            unsigned long access_address = std::strtoul(p_value, &p_end, 0);
+            unsigned long hop_seed       = 0;
+            if (*p_end == ',')
+            {
+                hop_seed = std::strtoul(p_end + 1, &p_end, 0);
+            }
+            if ((*p_end != '\0') || (access_address > UINT32_MAX) || (hop_seed > UINT8_MAX) ||
+                !rtt_config_access_address_is_valid(static_cast<uint32_t>(access_address)))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            sim_link_t link = {static_cast<uint32_t>(access_address), static_cast<uint8_t>(hop_seed)};
+            if (option == "--second")
+            {
+                config.ranging.initiators  = 2;
+                config.ranging.second_link = link;
+                continue;
+            }
+            config.ranging.responder_link = link;
+            if (option == "--link")
+            {
+                config.ranging.initiator_link = link;
+            }
+            continue;
+        }
+        if (option == "--grants" || option == "--extensions")
+        {
+            std::string pattern = p_value;
+            char const * p_outcomes = (option == "--grants") ? "gbc" : "01";
+            if (pattern.find_first_not_of(p_outcomes) != std::string::npos)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            (option == "--grants" ? config.softdevice.grants : config.softdevice.extensions) = pattern;
+            continue;
+        }
+
+        char *       p_end;
+        double       value   = std::strtod(p_value, &p_end);
+        if ((*p_end != '\0') || (value < 0))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (option == "-t")                   seconds                     = value;
+        else if (option == "-d")              config.medium.distance_m    = value;
+        else if (option == "-p")              config.medium.delay_ns      = value;
+        else if (option == "--to")            config.medium.distance_to_m = value;
+        else if (option == "--speed")         config.medium.speed_mps     = value;
+        else if (option == "-l")              config.medium.loss          = value;
+        else if (option == "-c")              config.medium.crc_error     = value;
+        else if (option == "-r")              config.ranging.rate_hz      = static_cast<uint32_t>(value);
+        else if (option == "-n")              config.ranging.exchanges    = static_cast<uint32_t>(value);
+        else if (option == "--slot")          config.ranging.slot_length_us  = static_cast<uint32_t>(value);
+        else if (option == "--margin")        config.ranging.burst_margin_us = static_cast<uint32_t>(value);
+        else if (option == "--bins")          config.ranging.bins            = static_cast<uint32_t>(value);
+        else if (option == "--single-shot")   config.ranging.single_shot_ms  = static_cast<uint32_t>(value);
+        else if (option == "-s")              config.seed                 = static_cast<uint64_t>(value);
+        else if (option == "--ramp-up")       config.radio.ramp_up        = from_us(value);
+        else if (option == "--ramp-up-fast")  config.radio.ramp_up_fast   = from_us(value);
+        else if (option == "--tx-disable")    config.radio.tx_disable     = from_us(value);
+        else if (option == "--tx-chain")      config.radio.tx_chain       = from_ns(value);
+        else if (option == "--rx-chain")      config.radio.rx_chain       = from_ns(value);
+        else if (option == "--ble-interval")  config.softdevice.ble_interval = from_us(value);
+        else if (option == "--ble-event")     config.softdevice.ble_event    = from_us(value);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::unique_ptr<Channel> p_channel;
+    if (p_channel_path != nullptr)
+    {
+        std::string error = channel_config_load(p_channel_path, channel_config);
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        p_channel = std::make_unique<FieldChannel>(config.medium, channel_config, config.seed);
+    }
+    else
+    {
+        p_channel = std::make_unique<FreeSpace>(config.medium, config.seed);
+    }
+
+    rtt::CaptureWriter capture;
+    if (p_capture_path != nullptr)
+    {
+        std::string command = argv[0];
+        for (int i = 1; i < argc; i++)
+        {
+            command += std::string(" ") + argv[i];
+        }
+
+        rtt::CaptureMetadata metadata = {{"source", "sim"}, {"bin_offset", std::to_string(RTT_DEFAULT_BIN_OFFSET)},
+                                         {"note", command}};
+        std::string          error    = capture.open(p_capture_path, metadata);
+        if (!error.empty())
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    Medium    medium(config.medium, *p_channel);
+    Simulator simulator(config, medium);
+    Report    report(verbose, capture);
+
+    simulator.observer_set(&report);
+    simulator.add(sim_firmware_initiator);
+    simulator.add(sim_firmware_responder);
+    if (config.ranging.initiators > 1)
+    {
+        simulator.add(sim_firmware_initiator_b);
+    }
+    simulator.run(static_cast<Time>(seconds * PS_PER_S));
+
+    if (!capture.close())
+    {
+        std::fprintf(stderr, "%s: write failed\n", p_capture_path);
+        return 2;
+    }
+
+    Results results = report.results(simulator, seconds);
+    if (json)
+    {
+        results_write_json(stdout, "rtt_sim", results);
+        std::putchar('\n');
+    }
+    else
+    {
+        Report::print(results, simulator);
+    }
+
+    return (results.valid > 0) ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Decodes the initiator's binary record stream from a file, a serial port or stdin, and prints
+   the records as CSV on stdout and the decoder statistics on stderr. */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "rtt_stream_decoder.h"
+
+namespace {
+
+constexpr double RTC_FREQ_HZ = 32768.0;
+
+class CsvPrinter : public rtt::RecordHandler
+{
+public:
+    explicit CsvPrinter(bool enabled) : m_enabled(enabled) {}
+
+    void on_distance(rtt::DistanceRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("distance,%.6f,%d,%u,%u,%u\n", r.timestamp / RTC_FREQ_HZ, r.distance_mm, r.exchanges, r.valid,
+                        r.peer);
+        }
+
+        Throughput & peer = m_throughput[r.peer];
+        peer.bursts++;
+        peer.valid += r.valid;
+        if (m_bursts++ == 0)
+        {
+            m_first = r.timestamp;
+        }
+        m_last = r.timestamp;
+    }
+
+    void on_result(rtt::ResultRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("result,%.6f,%u,%d,%u,%u\n", r.timestamp / RTC_FREQ_HZ, r.index, r.distance_mm, r.bursts, r.peer);
+        }
+    }
+
+    void on_histogram(rtt::HistogramRecord const & r) override
+    {
+        if (!m_enabled)
+        {
+            return;
+        }
+
+        std::printf("histogram,%.6f,%u,%u,", r.timestamp / RTC_FREQ_HZ, r.exchanges, r.valid);
+        for (size_t i = 0; i < r.bins.size(); i++)
+        {
+            if (r.bins[i] != 0)
+            {
+                std::printf(" %zu:%u", i, r.bins[i]);
+            }
+        }
+        std::printf(",%u\n", r.peer);
+    }
+
+    void on_counters(rtt::CountersRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("counters,%.6f,%u,%u,%u,%u,%u,%u,%u,%u\n", r.timestamp / RTC_FREQ_HZ,
+                        r.bursts, r.blocked, r.requests, r.grants, r.bursts_dropped,
+                        r.records_sent, r.records_dropped, r.frames_dropped);
+        }
+        m_frames_dropped = r.frames_dropped;
+    }
+
+    void on_telemetry(rtt::TelemetryRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("telemetry,%.6f,0x%02x,%u,%u,%u,%d,%.2f,%u\n", r.timestamp / RTC_FREQ_HZ, r.valid,
+                        r.rx_ok, r.rx_crc_errors, r.tx, r.rssi_dbm, r.temperature / 4.0, r.peer);
+        }
+    }
+
+    void on_stats(rtt::StatsRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            for (rtt::StatsCounters const * p_counters : {&r.session, &r.lifetime})
+            {
+                std::printf("stats,%.6f,%s,%s,%u,%u,%u,%u,%u,%u,%u,%u\n", r.timestamp / RTC_FREQ_HZ,
+                            (r.role == 0) ? "initiator" : "responder",
+                            (p_counters == &r.session) ? "session" : "lifetime",
+                            p_counters->bursts, p_counters->tx, p_counters->rx_crc_ok, p_counters->rx_crc_error,
+                            p_counters->rx_ignored, p_counters->rx_timeouts, p_counters->slots_requested,
+                            p_counters->slots_granted);
+            }
+        }
+    }
+
+    void on_peer(rtt::PeerRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("peer,%.6f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", r.timestamp / RTC_FREQ_HZ, r.peer,
+                        r.weight, r.period_bursts, r.session.bursts, r.session.tx, r.session.rx_crc_ok,
+                        r.session.rx_crc_error, r.session.rx_ignored, r.session.rx_timeouts,
+                        r.session.slots_requested, r.session.slots_granted);
+        }
+    }
+
+    void on_position(rtt::PositionRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("position,%.6f,%d,%d,%d", r.timestamp / RTC_FREQ_HZ, r.x_mm, r.y_mm, r.z_mm);
+            for (int32_t covariance : r.covariance_mm2)
+            {
+                std::printf(",%d", covariance);
+            }
+            std::printf(",%u,%u,%u,%u\n", r.rms_residual_mm, r.anchors, r.iterations, r.cycles);
+        }
+    }
+
+    void on_profile(rtt::ProfileRecord const & r) override
+    {
+        if (m_enabled)
+        {
+            std::printf("profile,%.6f,%u,%u,%u,%u,%u,%u", r.timestamp / RTC_FREQ_HZ, r.phase, r.clock_mhz,
+                        r.count, r.min, r.mean, r.max);
+            for (uint16_t bucket : r.buckets)
+            {
+                std::printf(",%u", bucket);
+            }
+            std::printf("\n");
+        }
+    }
+
+    void on_trace(rtt::TraceRecord const & r) override
+    {
+        if (!m_enabled)
+        {
+            return;
+        }
+
+        if (r.lost != 0)
+        {
+            std::printf("trace,%.6f,lost,%u\n", r.timestamp / RTC_FREQ_HZ, r.lost);
+        }
+        for (rtt::TraceEvent const & event : r.events)
+        {
+            char const * p_name = rtt::trace_event_name(event.event);
+
+            if (p_name != nullptr)
+            {
+                std::printf("trace,%.6f,%s\n", event.timestamp / RTC_FREQ_HZ, p_name);
+            }
+            else
+            {
+                std::printf("trace,%.6f,%u\n", event.timestamp / RTC_FREQ_HZ, event.event);
+            }
+        }
+    }
+
+    uint32_t frames_dropped() const { return m_frames_dropped; }
+
+    /* Bursts and valid exchanges per second to each responder and to all of them, over the time
+       from the first to the last distance record */
+    void throughput_print() const
+    {
+        double   seconds = (m_last - m_first) / RTC_FREQ_HZ;
+        uint64_t valid   = 0;
+
+        if ((m_bursts < 2) || !(seconds > 0))
+        {
+            return;
+        }
+
+        for (auto const & [peer, throughput] : m_throughput)
+        {
+            std::fprintf(stderr, "Responder %u: %llu bursts, %.2f bursts/s, %.1f valid exchanges/s\n", peer,
+                         (unsigned long long)throughput.bursts, throughput.bursts / seconds,
+                         throughput.valid / seconds);
+            valid += throughput.valid;
+        }
+        std::fprintf(stderr, "All responders: %.2f bursts/s, %.1f valid exchanges/s over %.1f s\n",
+                     m_bursts / seconds, valid / seconds, seconds);
+    }
+
+private:
+    struct Throughput
+    {
+        uint64_t bursts = 0;
+        uint64_t valid  = 0;
+    };
+
+    bool                          m_enabled;
+    uint32_t                      m_frames_dropped = 0;
+    std::map<uint8_t, Throughput> m_throughput;
+    uint64_t                      m_bursts = 0;
+    uint64_t                      m_first  = 0;
+    uint64_t                      m_last   = 0;
+};
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-q] [file]\n"
+                 "Decodes the binary record stream of the initiator from file, or from stdin.\n"
+                 "A serial port must be set up first, for example: stty -F /dev/ttyACM0 1000000 raw\n"
+                 "  -q  Only print the statistics\n", p_name);
+}
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    char const * p_path = nullptr;
+    bool         quiet  = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-q") == 0)
+        {
+            quiet = true;
+        }
+        else if ((argv[i][0] == '-') || (p_path != nullptr))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            p_path = argv[i];
+        }
+    }
+
+    std::FILE * p_file = (p_path == nullptr) ? stdin : std::fopen(p_path, "rb");
+    if (p_file == nullptr)
+    {
+        std::perror(p_path);
+        return 1;
+    }
+
+    CsvPrinter           printer(!quiet);
+    rtt::StreamDecoder   decoder(printer);
+    std::vector<uint8_t> buffer(1 << 16);
+    size_t               len;
+
+    auto start = std::chrono::steady_clock::now();
+    while ((len = std::fread(buffer.data(), 1, buffer.size(), p_file)) > 0)
+    {
+        decoder.feed(buffer.data(), len);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (p_file != stdin)
+    {
+        std::fclose(p_file);
+    }
+
+    rtt::DecoderStats const & stats = decoder.stats();
+
+    std::fprintf(stderr, "%llu bytes, %llu frames: %llu distance, %llu result, %llu histogram, %llu counters, %llu telemetry, %llu stats, %llu profile, %llu trace, %llu peer, %llu position\n",
+                 (unsigned long long)stats.bytes, (unsigned long long)stats.frames,
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_DISTANCE],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_RESULT],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_HISTOGRAM],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_COUNTERS],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_TELEMETRY],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_STATS],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_PROFILE],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_TRACE],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_PEER],
+                 (unsigned long long)stats.records[RTT_STREAM_RECORD_POSITION]);
+    std::fprintf(stderr, "%llu lost (%u dropped by the initiator), %llu CRC errors, %llu framing errors, %llu unknown\n",
+                 (unsigned long long)stats.lost, printer.frames_dropped(), (unsigned long long)stats.crc_errors,
+                 (unsigned long long)stats.framing_errors, (unsigned long long)stats.unknown);
+    printer.throughput_print();
+    if (seconds > 0)
+    {
+        std::fprintf(stderr, "Decoded in %.3f s: %.2f M frames/s, %.1f MB/s\n",
+                     seconds, stats.frames / seconds / 1e6, stats.bytes / seconds / 1e6);
+    }
+
+    return 0;
+}
@@ -0,0 +1,459 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rtt_stream_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace rtt {
+
+namespace {
+
+constexpr size_t   MAX_ENCODED_LEN = RTT_STREAM_ENCODED_LEN(RTT_STREAM_MAX_FRAME_LEN) - 1; /* Without the delimiter */
+constexpr uint32_t RTC_MASK        = 0x00FFFFFFUL;
+
+constexpr std::array<uint16_t, 256> crc16_table_make()
+{
+    std::array<uint16_t, 256> table{};
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+        }
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> CRC16_TABLE = crc16_table_make();
+
+inline uint16_t u16(uint8_t const * p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t u32(uint8_t const * p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void stats_counters(uint8_t const * p, StatsCounters & counters)
+{
+    counters.bursts          = u32(&p[0]);
+    counters.tx              = u32(&p[4]);
+    counters.rx_crc_ok       = u32(&p[8]);
+    counters.rx_crc_error    = u32(&p[12]);
+    counters.rx_ignored      = u32(&p[16]);
+    counters.rx_timeouts     = u32(&p[20]);
+    counters.slots_requested = u32(&p[24]);
+    counters.slots_granted   = u32(&p[28]);
+}
+
+/* COBS decode a frame without its delimiter. Returns the decoded length, or 0 if it is malformed. */
+size_t cobs_decode(uint8_t const * p_encoded, size_t len, uint8_t * p_frame)
+{
+    size_t in  = 0;
+    size_t out = 0;
+
+    while (in < len)
+    {
+        uint8_t code = p_encoded[in++];
+
+        if ((code == 0) || ((in + code - 1) > len))
+        {
+            return 0;
+        }
+
+        std::memcpy(&p_frame[out], &p_encoded[in], code - 1);
+        in  += code - 1;
+        out += code - 1;
+
+        if ((code != 0xFF) && (in < len))
+        {
+            p_frame[out++] = 0;
+        }
+    }
+
+    return out;
+}
+
+} // namespace
+
+
+uint16_t crc16(uint8_t const * p_data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ p_data[i]) & 0xFF]);
+    }
+
+    return crc;
+}
+
+
+char const * trace_event_name(uint8_t event)
+{
+    switch (event)
+    {
+        case RTT_TRACE_SLOT_START:         return "slot_start";
+        case RTT_TRACE_SLOT_END:           return "slot_end";
+        case RTT_TRACE_EXTEND_REQUEST:     return "extend_request";
+        case RTT_TRACE_EXTEND_SUCCEEDED:   return "extend_succeeded";
+        case RTT_TRACE_EXTEND_FAILED:      return "extend_failed";
+        case RTT_TRACE_EXCHANGE_START:     return "exchange_start";
+        case RTT_TRACE_EXCHANGE_VALID:     return "exchange_valid";
+        case RTT_TRACE_EXCHANGE_CRC_ERROR: return "exchange_crc_error";
+        case RTT_TRACE_EXCHANGE_IGNORED:   return "exchange_ignored";
+        case RTT_TRACE_EXCHANGE_TIMEOUT:   return "exchange_timeout";
+        case RTT_TRACE_EXCHANGE_EXPIRED:   return "exchange_expired";
+        default:                           return nullptr;
+    }
+}
+
+
+StreamDecoder::StreamDecoder(RecordHandler & handler) :
+    m_handler(handler)
+{
+    m_pending.reserve(MAX_ENCODED_LEN);
+    m_trace.events.reserve(RTT_STREAM_TRACE_MAX_EVENTS);
+}
+
+
+void StreamDecoder::feed(uint8_t const * p_data, size_t len)
+{
+    uint8_t const * p_end = p_data + len;
+
+    m_stats.bytes += len;
+
+    while (p_data < p_end)
+    {
+        auto p_delimiter = static_cast<uint8_t const *>(std::memchr(p_data, RTT_STREAM_DELIMITER, p_end - p_data));
+
+        if (p_delimiter == nullptr)
+        {
+            /* Keep the start of the frame for the next call. A frame that grows too long is
+               counted once when its delimiter arrives. */
+            if (m_synced)
+            {
+                size_t room = (MAX_ENCODED_LEN + 1) - std::min(m_pending.size(), MAX_ENCODED_LEN + 1);
+                m_pending.insert(m_pending.end(), p_data, p_data + std::min(room, static_cast<size_t>(p_end - p_data)));
+            }
+            return;
+        }
+
+        if (!m_synced)
+        {
+            m_synced = true;
+        }
+        else if (m_pending.empty())
+        {
+            frame_process(p_data, p_delimiter - p_data);
+        }
+        else
+        {
+            size_t room = (MAX_ENCODED_LEN + 1) - std::min(m_pending.size(), MAX_ENCODED_LEN + 1);
+            m_pending.insert(m_pending.end(), p_data, p_data + std::min(room, static_cast<size_t>(p_delimiter - p_data)));
+            frame_process(m_pending.data(), m_pending.size());
+            m_pending.clear();
+        }
+
+        p_data = p_delimiter + 1;
+    }
+}
+
+
+void StreamDecoder::frame_process(uint8_t const * p_encoded, size_t len)
+{
+    uint8_t  frame[MAX_ENCODED_LEN];
+    size_t   frame_len;
+    uint16_t sequence;
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    frame_len = (len > MAX_ENCODED_LEN) ? 0 : cobs_decode(p_encoded, len, frame);
+    if (frame_len < (RTT_STREAM_HEADER_LEN + RTT_STREAM_CRC_LEN))
+    {
+        m_stats.framing_errors++;
+        return;
+    }
+
+    frame_len -= RTT_STREAM_CRC_LEN;
+    if (crc16(frame, frame_len) != u16(&frame[frame_len]))
+    {
+        m_stats.crc_errors++;
+        return;
+    }
+
+    m_stats.frames++;
+
+    sequence = u16(&frame[1]);
+    if (m_sequenced)
+    {
+        m_stats.lost += static_cast<uint16_t>(sequence - m_next_sequence);
+    }
+    m_sequenced     = true;
+    m_next_sequence = static_cast<uint16_t>(sequence + 1);
+
+    record_dispatch(frame[0], &frame[RTT_STREAM_HEADER_LEN], frame_len - RTT_STREAM_HEADER_LEN);
+}
+
+
+void StreamDecoder::record_dispatch(uint8_t type, uint8_t const * p_record, size_t len)
+{
+    switch (type)
+    {
+        case RTT_STREAM_RECORD_DISTANCE:
+            if ((len == RTT_STREAM_DISTANCE_LEN) || (len == RTT_STREAM_DISTANCE_V1_LEN))
+            {
+                DistanceRecord record;
+                record.timestamp   = timestamp_extend(u32(&p_record[0]));
+                record.distance_mm = static_cast<int32_t>(u32(&p_record[4]));
+                record.exchanges   = u16(&p_record[8]);
+                record.valid       = u16(&p_record[10]);
+                record.peer        = (len == RTT_STREAM_DISTANCE_LEN) ? p_record[12] : 0;
+                m_peer             = record.peer;
+                m_stats.records[type]++;
+                m_handler.on_distance(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_RESULT:
+            if ((len == RTT_STREAM_RESULT_LEN) || (len == RTT_STREAM_RESULT_V1_LEN))
+            {
+                ResultRecord record;
+                record.timestamp   = timestamp_extend(u32(&p_record[0]));
+                record.index       = u32(&p_record[4]);
+                record.distance_mm = static_cast<int32_t>(u32(&p_record[8]));
+                record.bursts      = u16(&p_record[12]);
+                record.peer        = (len == RTT_STREAM_RESULT_LEN) ? p_record[14] : 0;
+                m_stats.records[type]++;
+                m_handler.on_result(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_HISTOGRAM:
+            if (len >= RTT_STREAM_HISTOGRAM_HEADER_LEN)
+            {
+                size_t first = p_record[8];
+                size_t count = p_record[9];
+
+                if ((len == RTT_STREAM_HISTOGRAM_HEADER_LEN + 2 * count) &&
+                    (first + count <= RTT_STREAM_HISTOGRAM_MAX_BINS))
+                {
+                    m_histogram.timestamp = timestamp_extend(u32(&p_record[0]));
+                    m_histogram.exchanges = u16(&p_record[4]);
+                    m_histogram.valid     = u16(&p_record[6]);
+                    m_histogram.peer      = m_peer;
+                    m_histogram.bins.fill(0);
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        m_histogram.bins[first + i] = u16(&p_record[RTT_STREAM_HISTOGRAM_HEADER_LEN + 2 * i]);
+                    }
+                    m_stats.records[type]++;
+                    m_handler.on_histogram(m_histogram);
+                    return;
+                }
+            }
+            break;
+
+        case RTT_STREAM_RECORD_COUNTERS:
+            if (len == RTT_STREAM_COUNTERS_LEN)
+            {
+                CountersRecord record;
+                record.timestamp       = timestamp_extend(u32(&p_record[0]));
+                record.bursts          = u32(&p_record[4]);
+                record.blocked         = u32(&p_record[8]);
+                record.requests        = u32(&p_record[12]);
+                record.grants          = u32(&p_record[16]);
+                record.bursts_dropped  = u32(&p_record[20]);
+                record.records_sent    = u32(&p_record[24]);
+                record.records_dropped = u32(&p_record[28]);
+                record.frames_dropped  = u32(&p_record[32]);
+                m_stats.records[type]++;
+                m_handler.on_counters(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_TELEMETRY:
+            if ((len == RTT_STREAM_TELEMETRY_LEN) || (len == RTT_STREAM_TELEMETRY_V1_LEN))
+            {
+                TelemetryRecord record;
+                record.timestamp     = timestamp_extend(u32(&p_record[0]));
+                record.valid         = p_record[4];
+                record.rx_ok         = u32(&p_record[5]);
+                record.rx_crc_errors = u32(&p_record[9]);
+                record.tx            = u32(&p_record[13]);
+                record.rssi_dbm      = static_cast<int32_t>(u32(&p_record[17]));
+                record.temperature   = static_cast<int32_t>(u32(&p_record[21]));
+                record.peer          = (len == RTT_STREAM_TELEMETRY_LEN) ? p_record[25] : 0;
+                m_stats.records[type]++;
+                m_handler.on_telemetry(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_STATS:
+            if (len == RTT_STREAM_STATS_LEN)
+            {
+                StatsRecord record;
+                record.timestamp = timestamp_extend(u32(&p_record[0]));
+                record.role      = p_record[4];
+                stats_counters(&p_record[5], record.session);
+                stats_counters(&p_record[5 + 4 * RTT_STREAM_STATS_COUNTERS], record.lifetime);
+                m_stats.records[type]++;
+                m_handler.on_stats(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_PEER:
+            if (len == RTT_STREAM_PEER_LEN)
+            {
+                PeerRecord record;
+                record.timestamp     = timestamp_extend(u32(&p_record[0]));
+                record.peer          = p_record[4];
+                record.weight        = p_record[5];
+                record.period_bursts = p_record[6];
+                stats_counters(&p_record[7], record.session);
+                m_stats.records[type]++;
+                m_handler.on_peer(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_POSITION:
+            if (len == RTT_STREAM_POSITION_LEN)
+            {
+                PositionRecord record;
+                record.timestamp = timestamp_extend(u32(&p_record[0]));
+                record.x_mm      = static_cast<int32_t>(u32(&p_record[4]));
+                record.y_mm      = static_cast<int32_t>(u32(&p_record[8]));
+                record.z_mm      = static_cast<int32_t>(u32(&p_record[12]));
+                for (size_t i = 0; i < record.covariance_mm2.size(); i++)
+                {
+                    record.covariance_mm2[i] = static_cast<int32_t>(u32(&p_record[16 + 4 * i]));
+                }
+                record.rms_residual_mm = u16(&p_record[40]);
+                record.anchors         = p_record[42];
+                record.iterations      = p_record[43];
+                record.cycles          = u32(&p_record[44]);
+                m_stats.records[type]++;
+                m_handler.on_position(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_PROFILE:
+            if (len == RTT_STREAM_PROFILE_LEN)
+            {
+                ProfileRecord record;
+                record.timestamp = timestamp_extend(u32(&p_record[0]));
+                record.phase     = p_record[4];
+                record.clock_mhz = p_record[5];
+                record.count     = u32(&p_record[6]);
+                record.min       = u32(&p_record[10]);
+                record.mean      = u32(&p_record[14]);
+                record.max       = u32(&p_record[18]);
+                for (size_t i = 0; i < record.buckets.size(); i++)
+                {
+                    record.buckets[i] = u16(&p_record[22 + 2 * i]);
+                }
+                m_stats.records[type]++;
+                m_handler.on_profile(record);
+                return;
+            }
+            break;
+
+        case RTT_STREAM_RECORD_TRACE:
+            if ((len >= RTT_STREAM_TRACE_HEADER_LEN) &&
+                (len == RTT_STREAM_TRACE_HEADER_LEN + 4 * static_cast<size_t>(p_record[8])))
+            {
+                uint32_t ticks = u32(&p_record[0]) & RTC_MASK;
+
+                m_trace.timestamp = timestamp_extend(ticks);
+                m_trace.lost      = u32(&p_record[4]);
+                m_trace.events.clear();
+                for (size_t i = 0; i < p_record[8]; i++)
+                {
+                    uint32_t event = u32(&p_record[RTT_STREAM_TRACE_HEADER_LEN + 4 * i]);
+
+                    /* Events happened before the record was written */
+                    m_trace.events.push_back({m_trace.timestamp - ((ticks - event) & RTC_MASK),
+                                              static_cast<uint8_t>(event >> RTT_TRACE_EVENT_POS)});
+                }
+                m_stats.records[type]++;
+                m_handler.on_trace(m_trace);
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    m_stats.unknown++;
+}
+
+
+/* Same as clock_ms in rtt_results.c: move forward when the ticks are later than the last
+   timestamp, count back otherwise, since results are stamped after the bursts they average. */
+uint64_t StreamDecoder::timestamp_extend(uint32_t ticks)
+{
+    uint32_t diff;
+
+    ticks &= RTC_MASK;
+    if (!m_clocked)
+    {
+        m_clocked    = true;
+        m_clock      = ticks;
+        m_clock_last = ticks;
+        return m_clock;
+    }
+
+    diff = (ticks - m_clock_last) & RTC_MASK;
+    if (diff <= (RTC_MASK >> 1))
+    {
+        m_clock     += diff;
+        m_clock_last = ticks;
+        return m_clock;
+    }
+
+    return m_clock - ((m_clock_last - ticks) & RTC_MASK);
+}
+
+} // namespace rtt
@@ -0,0 +1,242 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_STREAM_DECODER_H__
+#define RTT_STREAM_DECODER_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rtt_stream_format.h"
+#include "rtt_trace.h"
+
+namespace rtt {
+
+/**@brief Distance measured by one burst. */
+struct DistanceRecord
+{
+    uint64_t timestamp;   /**< Extended RTC ticks, 32768 Hz. */
+    int32_t  distance_mm;
+    uint16_t exchanges;
+    uint16_t valid;
+    uint8_t  peer;        /**< Responder, 0 in streams from before there were several. */
+};
+
+/**@brief Averaged session result. */
+struct ResultRecord
+{
+    uint64_t timestamp;
+    uint32_t index;
+    int32_t  distance_mm;
+    uint16_t bursts;
+    uint8_t  peer;
+};
+
+/**@brief Round trip histogram of one burst, with the bins that were not written set to zero. */
+struct HistogramRecord
+{
+    uint64_t timestamp;
+    uint16_t exchanges;
+    uint16_t valid;
+    uint8_t  peer;        /**< Responder of the preceding distance record. */
+    std::array<uint16_t, RTT_STREAM_HISTOGRAM_MAX_BINS> bins;
+};
+
+/**@brief Initiator counters. */
+struct CountersRecord
+{
+    uint64_t timestamp;
+    uint32_t bursts;
+    uint32_t blocked;
+    uint32_t requests;
+    uint32_t grants;
+    uint32_t bursts_dropped;
+    uint32_t records_sent;
+    uint32_t records_dropped;
+    uint32_t frames_dropped;
+};
+
+/**@brief Latest responder telemetry. */
+struct TelemetryRecord
+{
+    uint64_t timestamp;
+    uint8_t  valid;       /**< Bit n is set if field n has been received. */
+    uint32_t rx_ok;
+    uint32_t rx_crc_errors;
+    uint32_t tx;
+    int32_t  rssi_dbm;
+    int32_t  temperature; /**< 0.25 degrees Celsius. */
+    uint8_t  peer;
+};
+
+/**@brief Ranging statistics counters, in the order of rtt_stats_t. */
+struct StatsCounters
+{
+    uint32_t bursts;
+    uint32_t tx;
+    uint32_t rx_crc_ok;
+    uint32_t rx_crc_error;
+    uint32_t rx_ignored;
+    uint32_t rx_timeouts;
+    uint32_t slots_requested;
+    uint32_t slots_granted;
+};
+
+/**@brief Ranging statistics snapshot. */
+struct StatsRecord
+{
+    uint64_t      timestamp;
+    uint8_t       role;     /**< 0 initiator, 1 responder. */
+    StatsCounters session;  /**< Since the start of the session. */
+    StatsCounters lifetime; /**< Since start-up. */
+};
+
+/**@brief Share of the bursts and session statistics of one responder. */
+struct PeerRecord
+{
+    uint64_t      timestamp;
+    uint8_t       peer;
+    uint8_t       weight;        /**< Share of the bursts asked for. */
+    uint8_t       period_bursts; /**< The responder gets every period_bursts-th burst. */
+    StatsCounters session;
+};
+
+/**@brief Position solved by the initiator from the distances to the anchors. */
+struct PositionRecord
+{
+    uint64_t               timestamp;      /**< Of the newest distance. */
+    int32_t                x_mm;
+    int32_t                y_mm;
+    int32_t                z_mm;
+    std::array<int32_t, 6> covariance_mm2; /**< xx, xy, xz, yy, yz and zz. */
+    uint16_t               rms_residual_mm;
+    uint8_t                anchors;
+    uint8_t                iterations;
+    uint32_t               cycles;         /**< 0 when not profiled. */
+};
+
+/**@brief Time spent in one phase of the exchanges, in CPU cycles. */
+struct ProfileRecord
+{
+    uint64_t timestamp;
+    uint8_t  phase;     /**< RTT_PROFILER_* in rtt_profiler.h. */
+    uint8_t  clock_mhz; /**< CPU clock. */
+    uint32_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t max;
+    std::array<uint16_t, RTT_STREAM_PROFILE_BUCKETS> buckets; /**< Bucket i counts 2^i to 2^(i+1) - 1 cycles. */
+};
+
+/**@brief One traced event. */
+struct TraceEvent
+{
+    uint64_t timestamp; /**< Extended RTC ticks, 32768 Hz. */
+    uint8_t  event;     /**< RTT_TRACE_* in rtt_trace.h. */
+};
+
+/**@brief Timeslot and exchange events traced since the previous trace record. */
+struct TraceRecord
+{
+    uint64_t                timestamp;
+    uint32_t                lost;   /**< Events lost before the first event. */
+    std::vector<TraceEvent> events; /**< Oldest first. */
+};
+
+/**@brief Receiver of decoded records. The records are only valid during the call. */
+class RecordHandler
+{
+public:
+    virtual ~RecordHandler() = default;
+
+    virtual void on_distance(DistanceRecord const &) {}
+    virtual void on_result(ResultRecord const &) {}
+    virtual void on_histogram(HistogramRecord const &) {}
+    virtual void on_counters(CountersRecord const &) {}
+    virtual void on_telemetry(TelemetryRecord const &) {}
+    virtual void on_stats(StatsRecord const &) {}
+    virtual void on_profile(ProfileRecord const &) {}
+    virtual void on_trace(TraceRecord const &) {}
+    virtual void on_peer(PeerRecord const &) {}
+    virtual void on_position(PositionRecord const &) {}
+};
+
+/**@brief Decoder statistics. */
+struct DecoderStats
+{
+    uint64_t bytes          = 0;  /**< Bytes fed to the decoder. */
+    uint64_t frames         = 0;  /**< Frames with a valid CRC. */
+    uint64_t records[11]    = {}; /**< Records decoded, by record type. */
+    uint64_t lost           = 0;  /**< Frames missing from the sequence numbers. */
+    uint64_t crc_errors     = 0;  /**< Frames with a wrong CRC. */
+    uint64_t framing_errors = 0;  /**< Frames that could not be COBS decoded, or were too long or short. */
+    uint64_t unknown        = 0;  /**< Frames with a valid CRC and an unknown record type or length. */
+};
+
+/**@brief Incremental decoder for the initiator's binary record stream.
+ *
+ * @details Bytes can be fed in pieces of any size. The bytes before the first delimiter are
+ *          discarded, since the stream may have been joined mid-frame. Lost frames are counted
+ *          from gaps in the sequence numbers, which include the frames the initiator dropped.
+ */
+class StreamDecoder
+{
+public:
+    explicit StreamDecoder(RecordHandler & handler);
+
+    /**@brief Decode bytes from the stream. */
+    void feed(uint8_t const * p_data, size_t len);
+
+    DecoderStats const & stats() const { return m_stats; }
+
+private:
+    void frame_process(uint8_t const * p_encoded, size_t len);
+    void record_dispatch(uint8_t type, uint8_t const * p_record, size_t len);
+    uint64_t timestamp_extend(uint32_t ticks);
+
+    RecordHandler &      m_handler;
+    DecoderStats         m_stats;
+    std::vector<uint8_t> m_pending;               /* Start of a frame split across calls to feed */
+    bool                 m_synced        = false; /* A delimiter has been seen */
+    bool                 m_sequenced     = false; /* A frame has been decoded */
+    uint16_t             m_next_sequence = 0;
+    bool                 m_clocked       = false; /* A timestamp has been extended */
+    uint64_t             m_clock         = 0;     /* Extended ticks at m_clock_last */
+    uint32_t             m_clock_last    = 0;
+    uint8_t              m_peer          = 0;     /* Responder of the last distance record */
+    HistogramRecord      m_histogram;
+    TraceRecord          m_trace;
+};
+
+/**@brief CRC-16/CCITT-FALSE, as computed by crc16_compute in the nRF5 SDK. */
+uint16_t crc16(uint8_t const * p_data, size_t len);
+
+/**@brief Name of a trace event, or nullptr if it is unknown. */
+char const * trace_event_name(uint8_t event);
+
+} // namespace rtt
+
+#endif // RTT_STREAM_DECODER_H__
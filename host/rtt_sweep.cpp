@@ -0,0 +1,548 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Runs the simulated initiator and responder over a grid of ranging configurations, one process
+   per configuration and as many at a time as there are CPUs. For each it reports the accuracy of
+   the averaged results, their latency, the current of both nodes and the share of the radio time
+   the ranging takes, and then the configurations no other one beats on all of the chosen
+   objectives: the Pareto front to pick deployment profiles from. */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rtt_figures.h"
+#include "rtt_jobs.h"
+#include "sim_channel.h"
+#include "sim_core.h"
+#include "sim_medium.h"
+#include "sim_metrics.h"
+
+extern "C" {
+#include "nrf_error.h"
+#include "rtt_config.h"
+}
+
+extern "C" sim_firmware_t const sim_firmware_initiator;
+extern "C" sim_firmware_t const sim_firmware_responder;
+
+namespace {
+
+using namespace rtt;
+using namespace rtt::sim;
+
+/**@brief A parameter the grid can vary, with its value when it does not */
+struct Parameter
+{
+    char const * p_key;
+    char const * p_help;
+    double       fallback;
+};
+
+enum
+{
+    RATE_HZ,
+    EXCHANGES,
+    SLOT_US,
+    MARGIN_US,
+    BINS,
+    AVERAGING,
+    POWER,
+    PARAMETERS
+};
+
+Parameter const PARAMETER[PARAMETERS] =
+{
+    {"rate_hz",   "Bursts per second, 0 for continuous ranging",          TS_DEFAULT_RATE_HZ},
+    {"exchanges", "Exchanges in each burst",                              TS_DEFAULT_EXCHANGES},
+    {"slot_us",   "Timeslot length in continuous ranging",                TS_LEN_US},
+    {"margin_us", "Time a burst leaves at the end of its timeslot",       TS_BURST_END_MARGIN_US},
+    {"bins",      "Histogram bins in use",                                RTT_DEFAULT_BINS},
+    {"averaging", "Bursts with a distance averaged into a result",        RTT_SESSION_DEFAULT_AVERAGING},
+    {"power",     "Power policy of the initiator, slot, session or auto", SIM_POWER_AUTO},
+};
+
+/**@brief Name of a power policy, as the power parameter takes it */
+char const * power_name(double power)
+{
+    return (power == SIM_POWER_PER_SLOT) ? "slot" : (power == SIM_POWER_PER_SESSION) ? "session" : "auto";
+}
+
+/**@brief Figures the front can be taken over, all better when lower */
+char const * const OBJECTIVES[] =
+{
+    "rms_m", "bias_abs_m", "std_m", "latency_ms", "update_ms", "current_ua", "initiator_current_ua",
+    "responder_current_ua", "utilisation",
+};
+
+using Point = std::array<double, PARAMETERS>;
+
+/**@brief What every point of the sweep shares */
+struct Sweep
+{
+    ChannelConfig channel;
+    double        distance_m = 10.0;
+    double        seconds    = 20.0;
+    uint64_t      seed       = 1;
+};
+
+/**@brief Averages the estimates as the session does, over every window of consecutive bursts
+ *        rather than only the ones it reports, for more samples of the same error
+ */
+class Averaging : public Metrics
+{
+public:
+    explicit Averaging(uint32_t depth) : m_depth(depth) {}
+
+    void on_burst(Node const & node, sim_burst_t const & burst) override
+    {
+        Metrics::on_burst(node, burst);
+        if (std::isnan(burst.distance_m))
+        {
+            return;
+        }
+
+        Time now = node.now();
+        m_window.push_back({burst.distance_m, to_us(now)});
+        m_sum_m  += burst.distance_m;
+        m_sum_us += to_us(now);
+        if (m_window.size() > m_depth)
+        {
+            m_sum_m  -= m_window.front().distance_m;
+            m_sum_us -= m_window.front().time_us;
+            m_window.pop_front();
+        }
+        if (m_window.size() == m_depth)
+        {
+            double error = m_sum_m / m_depth - node.sim().medium().range(now);
+
+            m_windows++;
+            m_sum_error   += error;
+            m_sum_error_2 += error * error;
+            m_sum_delay   += to_us(now) - m_sum_us / m_depth;
+        }
+    }
+
+    /**@brief Write the figures of the run as one flat JSON object */
+    void write_json(std::FILE * p_file, Point const & point, Simulator const & sim, double seconds) const
+    {
+        Results results     = Metrics::results(sim, seconds);
+        double  n           = static_cast<double>(std::max<uint64_t>(m_windows, 1));
+        double  bias        = m_sum_error / n;
+        double  current     = 0.0;
+        double  utilisation = 0.0;
+
+        std::fprintf(p_file, "{\"name\": \"%s\"", point_name(point).c_str());
+        for (size_t i = 0; i < PARAMETERS; i++)
+        {
+            std::fprintf(p_file, ", \"%s\": %g", PARAMETER[i].p_key, point[i]);
+        }
+        std::fprintf(p_file, ", \"windows\": %llu", static_cast<unsigned long long>(m_windows));
+        std::fprintf(p_file, ", \"rms_m\": %.4f", std::sqrt(m_sum_error_2 / n));
+        std::fprintf(p_file, ", \"bias_abs_m\": %.4f", std::fabs(bias));
+        std::fprintf(p_file, ", \"std_m\": %.4f", std::sqrt(std::max(0.0, m_sum_error_2 / n - bias * bias)));
+        std::fprintf(p_file, ", \"latency_ms\": %.2f", m_sum_delay / n / 1000.0 + results.latency_us / 1000.0);
+        std::fprintf(p_file, ", \"update_ms\": %.2f",
+                     (results.estimates != 0) ? 1000.0 * seconds * m_depth / results.estimates : 0.0);
+        std::fprintf(p_file, ", \"burst_std_m\": %.4f", results.std_m);
+        std::fprintf(p_file, ", \"valid_ratio\": %.4f", results.valid_ratio);
+        std::fprintf(p_file, ", \"exchanges_per_s\": %.1f", results.exchanges_per_s);
+        for (NodeResults const & node : results.nodes)
+        {
+            current    += node.current_ua;
+            utilisation = std::max(utilisation, node.slot_utilisation);
+            std::fprintf(p_file, ", \"%s_current_ua\": %.1f", node.name.c_str(), node.current_ua);
+        }
+        std::fprintf(p_file, ", \"current_ua\": %.1f, \"utilisation\": %.4f}", current, utilisation);
+    }
+
+    static std::string point_name(Point const & point)
+    {
+        std::string name;
+        char        text[64];
+
+        for (size_t i = 0; i < PARAMETERS; i++)
+        {
+            if (i == POWER)
+            {
+                std::snprintf(text, sizeof(text), "%s=%s", PARAMETER[i].p_key, power_name(point[i]));
+            }
+            else
+            {
+                std::snprintf(text, sizeof(text), "%s=%g", PARAMETER[i].p_key, point[i]);
+            }
+            name += (name.empty() ? "" : " ") + std::string(text);
+        }
+        return name;
+    }
+
+private:
+    struct Sample
+    {
+        double distance_m;
+        double time_us;
+    };
+
+    uint32_t           m_depth;
+    std::deque<Sample> m_window;
+    double             m_sum_m       = 0.0;
+    double             m_sum_us      = 0.0;
+    uint64_t           m_windows     = 0;
+    double             m_sum_error   = 0.0;
+    double             m_sum_error_2 = 0.0;
+    double             m_sum_delay   = 0.0; /* From the mean time of a window to its end, in us */
+};
+
+/**@brief The firmware configuration of a point */
+rtt_config_t point_config(Point const & point)
+{
+    rtt_config_t config = RTT_CONFIG_DEFAULT;
+
+    config.rate_hz         = static_cast<uint16_t>(point[RATE_HZ]);
+    config.exchanges       = static_cast<uint16_t>(point[EXCHANGES]);
+    config.slot_length_us  = static_cast<uint32_t>(point[SLOT_US]);
+    config.burst_margin_us = static_cast<uint16_t>(point[MARGIN_US]);
+    config.bins            = static_cast<uint8_t>(point[BINS]);
+    config.averaging       = static_cast<uint16_t>(point[AVERAGING]);
+    return config;
+}
+
+/**@brief Run a point and write its figures. Runs in a child process of jobs_run(). */
+void point_run(Sweep const & sweep, Point const & point, std::FILE * p_output)
+{
+    Config config;
+
+    config.seed              = sweep.seed;
+    config.medium.distance_m = sweep.distance_m;
+    config.ranging           =
+    {
+        static_cast<uint32_t>(point[RATE_HZ]), static_cast<uint32_t>(point[EXCHANGES]),
+        static_cast<uint32_t>(point[SLOT_US]), static_cast<uint32_t>(point[MARGIN_US]),
+        static_cast<uint32_t>(point[BINS]),    static_cast<sim_power_t>(point[POWER]),
+        0,                                     {0, 0},
+        {0, 0},                                1,
+        {0, 0},
+    };
+
+    FieldChannel channel(config.medium, sweep.channel, config.seed);
+    Medium       medium(config.medium, channel);
+    Simulator    simulator(config, medium);
+    Averaging    averaging(static_cast<uint32_t>(point[AVERAGING]));
+
+    simulator.observer_set(&averaging);
+    simulator.add(sim_firmware_initiator);
+    simulator.add(sim_firmware_responder);
+    simulator.run(static_cast<Time>(sweep.seconds * PS_PER_S));
+
+    averaging.write_json(p_output, point, simulator, sweep.seconds);
+}
+
+/**@brief Parse key=value,value,... into the values of a parameter */
+bool axis_parse(std::string const & arg, std::vector<std::vector<double>> & axes)
+{
+    size_t equals = arg.find('=');
+    auto   found  = std::find_if(std::begin(PARAMETER), std::end(PARAMETER),
+                                 [&](Parameter const & parameter) { return arg.compare(0, equals, parameter.p_key) == 0; });
+    if ((equals == std::string::npos) || (found == std::end(PARAMETER)))
+    {
+        return false;
+    }
+
+    std::vector<double> & values = axes[found - std::begin(PARAMETER)];
+    values.clear();
+    for (size_t begin = equals + 1; begin <= arg.size();)
+    {
+        size_t      end   = std::min(arg.find(',', begin), arg.size());
+        std::string value = arg.substr(begin, end - begin);
+        char *      p_end;
+
+        if (found == &PARAMETER[POWER] && (value == "slot" || value == "session" || value == "auto"))
+        {
+            values.push_back((value == "slot")    ? SIM_POWER_PER_SLOT :
+                             (value == "session") ? SIM_POWER_PER_SESSION : SIM_POWER_AUTO);
+        }
+        else
+        {
+            values.push_back(std::strtod(value.c_str(), &p_end));
+            if (value.empty() || (*p_end != '\0') || (values.back() < 0) || (found == &PARAMETER[POWER]))
+            {
+                return false;
+            }
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+/**@brief Whether a dominates b: no worse on every objective and better on one */
+bool dominates(Figures const & a, Figures const & b, std::vector<std::string> const & objectives)
+{
+    bool better = false;
+
+    for (std::string const & objective : objectives)
+    {
+        if (a.at(objective) > b.at(objective))
+        {
+            return false;
+        }
+        better = better || (a.at(objective) < b.at(objective));
+    }
+    return better;
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] [parameter=value,value,...]...\n"
+                 "Runs the simulated ranging over every combination of the values given and prints\n"
+                 "the Pareto front. The parameters not given keep their default:\n",
+                 p_name);
+    for (Parameter const & parameter : PARAMETER)
+    {
+        std::fprintf(stderr, "  %-10s %s\n", parameter.p_key, parameter.p_help);
+    }
+    std::fprintf(stderr,
+                 "Options:\n"
+                 "  -d <m>         Distance between the nodes, default 10\n"
+                 "  -t <s>         Simulated time of each point, default 20\n"
+                 "  -s <seed>      Random seed, default 1\n"
+                 "  -j <jobs>      Points to run at a time, default the number of CPUs\n"
+                 "  --channel <file> Field channel, default line of sight, see channel_config_load()\n"
+                 "  -p <list>      Objectives of the front, comma separated, default\n"
+                 "                 rms_m,latency_ms,current_ua,utilisation; any of:\n"
+                 "                ");
+    for (char const * p_objective : OBJECTIVES)
+    {
+        std::fprintf(stderr, " %s", p_objective);
+    }
+    std::fprintf(stderr,
+                 "\n"
+                 "  -a             Print all points, the front marked with *\n"
+                 "  -o <file>      Write the figures of all points as JSON\n");
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    Sweep                            sweep;
+    char const *                     p_output   = nullptr;
+    bool                             all        = false;
+    uint32_t                         jobs       = jobs_default();
+    std::vector<std::string>         objectives = {"rms_m", "latency_ms", "current_ua", "utilisation"};
+    std::vector<std::vector<double>> axes(PARAMETERS);
+
+    sweep.channel = channel_line_of_sight();
+    for (size_t i = 0; i < PARAMETERS; i++)
+    {
+        axes[i] = {PARAMETER[i].fallback};
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "-a")
+        {
+            all = true;
+            continue;
+        }
+        if (option[0] != '-')
+        {
+            if (!axis_parse(option, axes))
+            {
+                std::fprintf(stderr, "%s: not a parameter and its values\n", argv[i]);
+                return 2;
+            }
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        char const * p_value = argv[++i];
+        if (option == "-o")      p_output         = p_value;
+        else if (option == "-d") sweep.distance_m = std::strtod(p_value, nullptr);
+        else if (option == "-t") sweep.seconds    = std::strtod(p_value, nullptr);
+        else if (option == "-s") sweep.seed       = std::strtoull(p_value, nullptr, 0);
+        else if (option == "-j") jobs             = std::max(1, std::atoi(p_value));
+        else if (option == "--channel")
+        {
+            std::string error = channel_config_load(p_value, sweep.channel);
+            if (!error.empty())
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else if (option == "-p")
+        {
+            objectives.clear();
+            for (char const * p_begin = p_value; *p_begin != '\0';)
+            {
+                char const * p_end = std::strchr(p_begin, ',');
+                p_end = (p_end == nullptr) ? p_begin + std::strlen(p_begin) : p_end;
+                objectives.emplace_back(p_begin, p_end);
+                if (std::find_if(std::begin(OBJECTIVES), std::end(OBJECTIVES),
+                                 [&](char const * p_objective) { return objectives.back() == p_objective; })
+                    == std::end(OBJECTIVES))
+                {
+                    std::fprintf(stderr, "%s: not an objective\n", objectives.back().c_str());
+                    return 2;
+                }
+                p_begin = (*p_end == ',') ? p_end + 1 : p_end;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (objectives.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    /* Every combination, leaving out those the firmware would refuse */
+    std::vector<Point> points;
+    size_t             combinations = 1;
+    for (std::vector<double> const & values : axes)
+    {
+        combinations *= values.size();
+    }
+    for (size_t combination = 0; combination < combinations; combination++)
+    {
+        Point  point;
+        size_t rest = combination;
+        for (size_t i = PARAMETERS; i-- > 0;)
+        {
+            point[i] = axes[i][rest % axes[i].size()];
+            rest    /= axes[i].size();
+        }
+
+        rtt_config_t config = point_config(point);
+        if (rtt_config_validate(&config) != NRF_SUCCESS)
+        {
+            std::fprintf(stderr, "%s: refused by rtt_config_validate()\n", Averaging::point_name(point).c_str());
+            continue;
+        }
+        points.push_back(point);
+    }
+
+    std::vector<std::string> outputs = jobs_run(points.size(), jobs, [&](size_t index, std::FILE * p_output)
+    {
+        point_run(sweep, points[index], p_output);
+    });
+
+    std::vector<Figures> figures(points.size());
+    std::vector<size_t>  ran; /* Points with at least one averaged result */
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        std::map<std::string, Figures> parsed;
+        if (outputs[i].empty() || !figures_parse(outputs[i], parsed) || parsed.empty())
+        {
+            std::fprintf(stderr, "%s: failed\n", Averaging::point_name(points[i]).c_str());
+            continue;
+        }
+        figures[i] = parsed.begin()->second;
+        if (figures[i].at("windows") > 0)
+        {
+            ran.push_back(i);
+        }
+    }
+
+    std::vector<bool> front(points.size(), false);
+    for (size_t i : ran)
+    {
+        front[i] = std::none_of(ran.begin(), ran.end(), [&](size_t j)
+        {
+            return dominates(figures[j], figures[i], objectives);
+        });
+    }
+
+    std::sort(ran.begin(), ran.end(), [&](size_t a, size_t b)
+    {
+        return figures[a].at(objectives[0]) < figures[b].at(objectives[0]);
+    });
+
+    std::printf("  %-8s %9s %9s %9s %5s %9s %7s", "rate_hz", "exchanges", "slot_us", "margin_us", "bins", "averaging", "power");
+    for (std::string const & objective : objectives)
+    {
+        std::printf(" %12s", objective.c_str());
+    }
+    std::printf("\n");
+    for (size_t i : ran)
+    {
+        if (!front[i] && !all)
+        {
+            continue;
+        }
+
+        Point const & point = points[i];
+        std::printf("%c %-8g %9g %9g %9g %5g %9g %7s", front[i] ? '*' : ' ', point[RATE_HZ], point[EXCHANGES],
+                    point[SLOT_US], point[MARGIN_US], point[BINS], point[AVERAGING],
+                    power_name(point[POWER]));
+        for (std::string const & objective : objectives)
+        {
+            std::printf(" %12.4g", figures[i].at(objective));
+        }
+        std::printf("\n");
+    }
+    std::printf("%zu of %zu points on the front, %zu without a result\n",
+                static_cast<size_t>(std::count(front.begin(), front.end(), true)), points.size(),
+                points.size() - ran.size());
+
+    if (p_output != nullptr)
+    {
+        std::string json = "{\"seed\": " + std::to_string(sweep.seed) + ", \"points\": [\n";
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            if (!figures[i].empty())
+            {
+                json += (json.back() == '\n' ? "  " : ",\n  ") + outputs[i].substr(0, outputs[i].size() - 1) +
+                        ", \"pareto\": " + (front[i] ? "1}" : "0}");
+            }
+        }
+        json += "\n]}\n";
+
+        std::FILE * p_file = std::fopen(p_output, "w");
+        if ((p_file == nullptr) || (std::fputs(json.c_str(), p_file) < 0) || (std::fclose(p_file) != 0))
+        {
+            std::perror(p_output);
+            return 2;
+        }
+    }
+    return ran.empty() ? 1 : 0;
+}
@@ -0,0 +1,417 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Reconstructs the timeline of the timeslots and exchanges from the trace events in the
+   initiator's binary record stream, or in a dump of the trace ring of either side, and prints
+   timeslot, gap and exchange statistics. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "rtt_stream_decoder.h"
+
+namespace {
+
+constexpr double   RTC_FREQ_HZ = 32768.0;
+constexpr uint32_t RTC_MASK    = RTT_TRACE_TICKS_MASK;
+
+double ticks_to_us(uint64_t ticks)
+{
+    return ticks * 1e6 / RTC_FREQ_HZ;
+}
+
+/* Values summarised when the trace has been read */
+class Durations
+{
+public:
+    void add(double value) { m_values.push_back(value); }
+
+    void print(char const * p_name)
+    {
+        if (m_values.empty())
+        {
+            std::printf("%-22s %8u\n", p_name, 0U);
+            return;
+        }
+
+        std::sort(m_values.begin(), m_values.end());
+
+        double sum = 0;
+        for (double value : m_values)
+        {
+            sum += value;
+        }
+
+        std::printf("%-22s %8zu %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n", p_name, m_values.size(),
+                    m_values.front(), sum / m_values.size(), percentile(0.5), percentile(0.9),
+                    percentile(0.99), m_values.back());
+    }
+
+private:
+    double percentile(double p) const
+    {
+        return m_values[std::min(m_values.size() - 1, static_cast<size_t>(p * m_values.size()))];
+    }
+
+    std::vector<double> m_values;
+};
+
+class TraceAnalyzer : public rtt::RecordHandler
+{
+public:
+    explicit TraceAnalyzer(bool timeline) : m_timeline(timeline)
+    {
+        if (m_timeline)
+        {
+            std::printf("time_s,event,since_previous_us\n");
+        }
+    }
+
+    /* Frames lost from the stream may have carried events, so they are a gap like lost events */
+    void decoder_set(rtt::StreamDecoder const & decoder) { mp_decoder = &decoder; }
+
+    void on_trace(rtt::TraceRecord const & r) override
+    {
+        if ((mp_decoder != nullptr) && (mp_decoder->stats().lost != m_frames_lost))
+        {
+            m_frames_lost = mp_decoder->stats().lost;
+            gap();
+            if (m_timeline)
+            {
+                std::printf("%.6f,frames lost,\n", m_last / RTC_FREQ_HZ);
+            }
+        }
+        if (r.lost != 0)
+        {
+            lost_add(r.lost);
+        }
+        for (rtt::TraceEvent const & event : r.events)
+        {
+            event_add(event);
+        }
+    }
+
+    void lost_add(uint32_t lost)
+    {
+        m_lost += lost;
+        gap();
+
+        if (m_timeline)
+        {
+            std::printf("%.6f,lost %u,\n", m_last / RTC_FREQ_HZ, lost);
+        }
+    }
+
+    void event_add(rtt::TraceEvent const & event)
+    {
+        uint64_t t = event.timestamp;
+
+        if (m_timeline)
+        {
+            char const * p_name = rtt::trace_event_name(event.event);
+
+            if (p_name != nullptr)
+            {
+                std::printf("%.6f,%s,", t / RTC_FREQ_HZ, p_name);
+            }
+            else
+            {
+                std::printf("%.6f,%u,", t / RTC_FREQ_HZ, event.event);
+            }
+            if (m_events > 0)
+            {
+                std::printf("%.0f", ticks_to_us(t - m_last));
+            }
+            std::printf("\n");
+        }
+
+        m_events++;
+        m_last = t;
+        m_counts[std::min<size_t>(event.event, RTT_TRACE_EVENTS)]++;
+
+        switch (event.event)
+        {
+            case RTT_TRACE_SLOT_START:
+                if (m_have_start)
+                {
+                    m_slot_period.add(ticks_to_us(t - m_slot_start));
+                }
+                if (m_have_end)
+                {
+                    m_slot_gap.add(ticks_to_us(t - m_slot_end));
+                }
+                m_in_slot        = true;
+                m_have_start     = true;
+                m_slot_start     = t;
+                m_slot_exchanges = 0;
+                break;
+
+            case RTT_TRACE_SLOT_END:
+                if (m_in_slot)
+                {
+                    m_slot_length.add(ticks_to_us(t - m_slot_start));
+                    m_exchanges_per_slot.add(m_slot_exchanges);
+                }
+                m_in_slot    = false;
+                m_exchanging = false;
+                m_have_end   = true;
+                m_slot_end   = t;
+                break;
+
+            case RTT_TRACE_EXTEND_REQUEST:
+                m_extending      = true;
+                m_extend_request = t;
+                break;
+
+            case RTT_TRACE_EXTEND_SUCCEEDED:
+            case RTT_TRACE_EXTEND_FAILED:
+                if (m_extending)
+                {
+                    m_extend_latency.add(ticks_to_us(t - m_extend_request));
+                }
+                m_extending = false;
+                break;
+
+            case RTT_TRACE_EXCHANGE_START:
+                m_exchanging     = true;
+                m_exchange_start = t;
+                m_slot_exchanges++;
+                break;
+
+            case RTT_TRACE_EXCHANGE_VALID:
+            case RTT_TRACE_EXCHANGE_CRC_ERROR:
+            case RTT_TRACE_EXCHANGE_IGNORED:
+            case RTT_TRACE_EXCHANGE_TIMEOUT:
+            case RTT_TRACE_EXCHANGE_EXPIRED:
+                if (m_exchanging)
+                {
+                    m_exchange.add(ticks_to_us(t - m_exchange_start));
+                }
+                m_exchanging = false;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void print()
+    {
+        if (m_frames_lost != 0)
+        {
+            std::fprintf(stderr, "%llu stream frames lost, nothing is measured across them\n",
+                         (unsigned long long)m_frames_lost);
+        }
+
+        std::FILE * p_out = m_timeline ? stderr : stdout;
+
+        std::fprintf(p_out, "%llu events, %llu lost\n", (unsigned long long)m_events, (unsigned long long)m_lost);
+        for (uint8_t i = 1; i < RTT_TRACE_EVENTS; i++)
+        {
+            std::fprintf(p_out, "  %-20s %llu\n", rtt::trace_event_name(i), (unsigned long long)m_counts[i]);
+        }
+        if (m_counts[0] + m_counts[RTT_TRACE_EVENTS] > 0)
+        {
+            std::fprintf(p_out, "  %-20s %llu\n", "unknown", (unsigned long long)(m_counts[0] + m_counts[RTT_TRACE_EVENTS]));
+        }
+
+        if (m_timeline)
+        {
+            return;
+        }
+
+        std::printf("\n%-22s %8s %10s %10s %10s %10s %10s %10s\n", "", "count", "min", "mean", "p50", "p90", "p99", "max");
+        m_slot_length.print("slot length (us)");
+        m_slot_period.print("slot period (us)");
+        m_slot_gap.print("slot gap (us)");
+        m_extend_latency.print("extend latency (us)");
+        m_exchange.print("exchange (us)");
+        m_exchanges_per_slot.print("exchanges per slot");
+    }
+
+private:
+    /* Events are missing here: nothing is measured across the gap */
+    void gap()
+    {
+        m_in_slot    = false;
+        m_exchanging = false;
+        m_extending  = false;
+        m_have_start = false;
+        m_have_end   = false;
+    }
+
+    bool                       m_timeline;
+    rtt::StreamDecoder const * mp_decoder    = nullptr;
+    uint64_t                   m_frames_lost = 0;  /* Frames lost from the stream when last checked */
+    uint64_t                   m_events      = 0;
+    uint64_t                   m_lost        = 0;
+    uint64_t                   m_last        = 0;
+    uint64_t                   m_counts[RTT_TRACE_EVENTS + 1] = {}; /* By event ID, the last counts unknown IDs */
+
+    bool     m_in_slot        = false;
+    bool     m_have_start     = false; /* m_slot_start is valid */
+    bool     m_have_end       = false; /* m_slot_end is valid */
+    bool     m_extending      = false;
+    bool     m_exchanging     = false;
+    uint64_t m_slot_start     = 0;
+    uint64_t m_slot_end       = 0;
+    uint64_t m_extend_request = 0;
+    uint64_t m_exchange_start = 0;
+    uint32_t m_slot_exchanges = 0;
+
+    Durations m_slot_length;        /* Slot start to slot end, extensions included */
+    Durations m_slot_period;        /* Slot start to the next slot start */
+    Durations m_slot_gap;           /* Slot end to the next slot start */
+    Durations m_extend_latency;     /* Extension request to its outcome */
+    Durations m_exchange;           /* Exchange start to its outcome */
+    Durations m_exchanges_per_slot; /* Exchanges started in each slot */
+};
+
+/* A dump of m_trace in rtt_trace.c: the free running head followed by a power-of-two ring of
+   events. The events are extended from the first one, each within 512 s of the previous one. */
+bool ram_dump_analyze(std::vector<uint8_t> const & dump, TraceAnalyzer & analyzer)
+{
+    size_t   size = (dump.size() >= 8) ? ((dump.size() - 4) / 4) : 0;
+    uint32_t head;
+    uint32_t first;
+    uint64_t clock = 0;
+    uint32_t last  = 0;
+
+    if ((size == 0) || ((size & (size - 1)) != 0) || ((dump.size() - 4) % 4 != 0))
+    {
+        return false;
+    }
+
+    auto u32 = [&dump](size_t offset)
+    {
+        return static_cast<uint32_t>(dump[offset]) | (static_cast<uint32_t>(dump[offset + 1]) << 8) |
+               (static_cast<uint32_t>(dump[offset + 2]) << 16) | (static_cast<uint32_t>(dump[offset + 3]) << 24);
+    };
+
+    head  = u32(0);
+    first = (head > size) ? static_cast<uint32_t>(head - size) : 0;
+
+    if (first > 0)
+    {
+        analyzer.lost_add(first);
+    }
+
+    for (uint32_t i = first; i != head; i++)
+    {
+        uint32_t event = u32(4 + 4 * (i & (size - 1)));
+        uint32_t ticks = event & RTC_MASK;
+
+        clock = (i == first) ? ticks : (clock + ((ticks - last) & RTC_MASK));
+        last  = ticks;
+
+        analyzer.event_add({clock, static_cast<uint8_t>(event >> RTT_TRACE_EVENT_POS)});
+    }
+
+    return true;
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [-r] [-t] [file]\n"
+                 "Reconstructs the timeslots and exchanges from the trace events of the initiator's\n"
+                 "binary record stream in file, or stdin, and prints timeslot and gap statistics.\n"
+                 "  -r  The input is a binary dump of m_trace in rtt_trace.c, of either side, taken\n"
+                 "      with a debugger, for example with J-Link Commander: savebin trace.bin <addr> <size>\n"
+                 "  -t  Print the timeline as CSV instead, and the event counts on stderr\n", p_name);
+}
+
+} // namespace
+
+
+int main(int argc, char ** argv)
+{
+    char const * p_path   = nullptr;
+    bool         ram      = false;
+    bool         timeline = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-r") == 0)
+        {
+            ram = true;
+        }
+        else if (std::strcmp(argv[i], "-t") == 0)
+        {
+            timeline = true;
+        }
+        else if ((argv[i][0] == '-') || (p_path != nullptr))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            p_path = argv[i];
+        }
+    }
+
+    std::FILE * p_file = (p_path == nullptr) ? stdin : std::fopen(p_path, "rb");
+    if (p_file == nullptr)
+    {
+        std::perror(p_path);
+        return 1;
+    }
+
+    TraceAnalyzer        analyzer(timeline);
+    rtt::StreamDecoder   decoder(analyzer);
+    std::vector<uint8_t> buffer(1 << 16);
+    std::vector<uint8_t> dump;
+    size_t               len;
+
+    analyzer.decoder_set(decoder);
+    while ((len = std::fread(buffer.data(), 1, buffer.size(), p_file)) > 0)
+    {
+        if (ram)
+        {
+            dump.insert(dump.end(), buffer.begin(), buffer.begin() + len);
+        }
+        else
+        {
+            decoder.feed(buffer.data(), len);
+        }
+    }
+
+    if (p_file != stdin)
+    {
+        std::fclose(p_file);
+    }
+
+    if (ram && !ram_dump_analyze(dump, analyzer))
+    {
+        std::fprintf(stderr, "Not a trace dump: expected the head and a power of two events, %zu bytes\n", dump.size());
+        return 1;
+    }
+
+    analyzer.print();
+
+    return 0;
+}
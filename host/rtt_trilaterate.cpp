@@ -0,0 +1,373 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Writes the surveyed coordinates of the anchors as blobs the initiator loads from the last page
+   of flash (see rtt_anchors.h), and checks the firmware's own position solver (rtt_position.c)
+   against them: random tag positions inside the anchors, distances with the noise the solver
+   assumes, and the error, the share of errors inside the reported 2 sigma ellipse, the
+   iterations and the host time of every update. rtt_trilaterate_fixed runs the integer solver. */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtt_calibration_file.h"
+
+extern "C" {
+#include "nrf_error.h"
+#include "rtt_anchors.h"
+#include "rtt_position.h"
+}
+
+namespace {
+
+using namespace rtt;
+
+constexpr double RTC_FREQ_HZ = 32768.0;
+
+std::vector<rtt_anchor_t> g_anchors;
+
+/* Share of a normal distribution inside 2 sigma, in 2 and 3 dimensions */
+constexpr double CONTAINMENT_2D = 0.8647;
+constexpr double CONTAINMENT_3D = 0.7385;
+
+/**@brief Read the anchors, one per line: id and x, y and z in metres. # starts a comment.
+ *
+ * @return Empty on success, else what went wrong
+ */
+std::string anchors_read(char const * p_path, std::vector<rtt_anchor_t> & anchors)
+{
+    std::ifstream file(p_path);
+    std::string   line;
+    size_t        number = 0;
+
+    if (!file)
+    {
+        return std::string(p_path) + ": cannot read";
+    }
+    while (std::getline(file, line))
+    {
+        number++;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string        id;
+        double             x, y, z;
+        if (!(fields >> id >> x >> y >> z))
+        {
+            return std::string(p_path) + ":" + std::to_string(number) + ": expected id x y z";
+        }
+
+        rtt_anchor_t anchor;
+        anchor.id   = static_cast<uint32_t>(std::strtoul(id.c_str(), nullptr, 0));
+        anchor.x_mm = static_cast<int32_t>(std::lround(x * 1000.0));
+        anchor.y_mm = static_cast<int32_t>(std::lround(y * 1000.0));
+        anchor.z_mm = static_cast<int32_t>(std::lround(z * 1000.0));
+        for (rtt_anchor_t const & other : anchors)
+        {
+            if (other.id == anchor.id)
+            {
+                return std::string(p_path) + ":" + std::to_string(number) + ": anchor " + id + " is listed twice";
+            }
+        }
+        anchors.push_back(anchor);
+    }
+    if (anchors.size() > RTT_ANCHORS_MAX)
+    {
+        return std::string(p_path) + ": more than " + std::to_string(RTT_ANCHORS_MAX) + " anchors";
+    }
+    return "";
+}
+
+/**@brief Mahalanobis distance of an error from the covariance of the position, in sigmas */
+double mahalanobis(double const * p_error, rtt_position_t const & position, uint32_t dims)
+{
+    double const * e = p_error;
+    double         c[6];
+    for (size_t k = 0; k < 6; k++)
+    {
+        c[k] = position.covariance_mm2[k];
+    }
+
+    if (dims == 2)
+    {
+        double det = c[0] * c[3] - c[1] * c[1];
+        return std::sqrt((c[3] * e[0] * e[0] - 2.0 * c[1] * e[0] * e[1] + c[0] * e[1] * e[1]) / det);
+    }
+
+    double i[6] = {c[3] * c[5] - c[4] * c[4], c[2] * c[4] - c[1] * c[5], c[1] * c[4] - c[2] * c[3],
+                   c[0] * c[5] - c[2] * c[2], c[1] * c[2] - c[0] * c[4], c[0] * c[3] - c[1] * c[1]};
+    double det  = c[0] * i[0] + c[1] * i[1] + c[2] * i[2];
+    double q    = i[0] * e[0] * e[0] + i[3] * e[1] * e[1] + i[5] * e[2] * e[2] +
+                  2.0 * (i[1] * e[0] * e[1] + i[2] * e[0] * e[2] + i[4] * e[1] * e[2]);
+    return std::sqrt(q / det);
+}
+
+void usage(char const * p_name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options] anchors\n"
+                 "Reads the anchors, one per line: id x y z, with the id the low 32 bits of the\n"
+                 "responder's device address, for example 0x5E0A1B2C, and the coordinates in metres.\n"
+                 "  --hex <file>       Write the anchors as Intel HEX in the last page of flash, to\n"
+                 "                     program with: nrfjprog --program <file> --sectorerase --verify\n"
+                 "                     after the calibration, which is in the same page\n"
+                 "  --chip <chip>      nrf52840 or nrf52833, for the flash address, default nrf52840\n"
+                 "  --simulate <n>     Solve n random tag positions inside the anchors\n"
+                 "  --dimensions <n>   2 or 3, default %u\n"
+                 "  --tag-z <m>        Height of the tag, default %.2f\n"
+                 "  --sigma <m>        Standard deviation of a distance with every exchange valid, default %.2f\n"
+                 "  --quality <n>      Lowest share of valid exchanges of a burst, percent, default 30\n"
+                 "  --rounds <n>       Distances to every anchor at each position, default 3\n"
+                 "  --seed <n>         Seed of the noise, default 1\n",
+                 p_name, RTT_POSITION_DEFAULT_DIMENSIONS, RTT_POSITION_DEFAULT_TAG_Z_MM / 1000.0,
+                 RTT_POSITION_DEFAULT_SIGMA_MM / 1000.0);
+}
+
+} // namespace
+
+/* The solver looks the anchors up here instead of in flash */
+extern "C" rtt_anchor_t const * rtt_anchors_find(uint32_t id)
+{
+    for (rtt_anchor_t const & anchor : g_anchors)
+    {
+        if (anchor.id == id)
+        {
+            return &anchor;
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char ** argv)
+{
+    char const *          p_anchors_path = nullptr;
+    char const *          p_hex_path     = nullptr;
+    uint32_t              address        = 0xFF000;
+    uint32_t              positions      = 0;
+    uint32_t              quality_min    = 30;
+    uint32_t              rounds         = 3;
+    uint64_t              seed           = 1;
+    rtt_position_config_t config         = RTT_POSITION_CONFIG_DEFAULT;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option[0] != '-')
+        {
+            if (p_anchors_path != nullptr)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            p_anchors_path = argv[i];
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        std::string value = argv[++i];
+        if (option == "--hex")             p_hex_path        = argv[i];
+        else if (option == "--simulate")   positions         = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--dimensions") config.dimensions = static_cast<uint8_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--tag-z")      config.tag_z_mm   = static_cast<int32_t>(std::lround(std::strtod(value.c_str(), nullptr) * 1000.0));
+        else if (option == "--sigma")      config.sigma_mm   = static_cast<uint32_t>(std::lround(std::strtod(value.c_str(), nullptr) * 1000.0));
+        else if (option == "--quality")    quality_min       = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--rounds")     rounds            = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 0));
+        else if (option == "--seed")       seed              = std::strtoull(value.c_str(), nullptr, 0);
+        else if (option == "--chip" && value == "nrf52840") address = 0xFF000;
+        else if (option == "--chip" && value == "nrf52833") address = 0x7F000;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((p_anchors_path == nullptr) || (quality_min < 1) || (quality_min > 100) || (rounds < 1))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string error = anchors_read(p_anchors_path, g_anchors);
+    if (!error.empty())
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf("%12s %10s %10s %10s\n", "id", "x_m", "y_m", "z_m");
+    for (rtt_anchor_t const & anchor : g_anchors)
+    {
+        std::printf("  0x%08X %10.3f %10.3f %10.3f\n", anchor.id, anchor.x_mm / 1000.0, anchor.y_mm / 1000.0,
+                    anchor.z_mm / 1000.0);
+    }
+
+    if (p_hex_path != nullptr)
+    {
+        std::vector<uint8_t> blobs;
+        for (rtt_anchor_t const & anchor : g_anchors)
+        {
+            AnchorBlob blob = anchor_encode(anchor);
+            blobs.insert(blobs.end(), blob.begin(), blob.end());
+        }
+
+        std::ofstream file(p_hex_path);
+        file << flash_hex(blobs.data(), blobs.size(), address + RTT_ANCHORS_PAGE_OFFSET);
+        if (!file)
+        {
+            std::fprintf(stderr, "%s: write failed\n", p_hex_path);
+            return 1;
+        }
+    }
+
+    if (positions == 0)
+    {
+        return 0;
+    }
+    if (rtt_position_init(&config) != NRF_SUCCESS)
+    {
+        std::fprintf(stderr, "Invalid solver configuration: dimensions %u, sigma %u mm\n", config.dimensions,
+                     config.sigma_mm);
+        return 1;
+    }
+    if (g_anchors.size() < config.dimensions + 1U)
+    {
+        std::fprintf(stderr, "A %uD position needs %u anchors, found %zu\n", config.dimensions,
+                     config.dimensions + 1U, g_anchors.size());
+        return 1;
+    }
+
+    /* Tags inside the box of the anchors, in 3D below the highest */
+    double low[3]  = {INFINITY, INFINITY, INFINITY};
+    double high[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (rtt_anchor_t const & anchor : g_anchors)
+    {
+        double const p[3] = {static_cast<double>(anchor.x_mm), static_cast<double>(anchor.y_mm),
+                             static_cast<double>(anchor.z_mm)};
+        for (size_t k = 0; k < 3; k++)
+        {
+            low[k]  = std::min(low[k], p[k]);
+            high[k] = std::max(high[k], p[k]);
+        }
+    }
+    low[2] = std::min(low[2], 0.0);
+
+    std::mt19937_64                  random(seed);
+    std::uniform_real_distribution<> uniform(0.0, 1.0);
+    std::normal_distribution<>       normal(0.0, 1.0);
+    std::uniform_int_distribution<>  quality(static_cast<int>(quality_min), 100);
+
+    uint64_t updates    = 0;
+    uint64_t solved     = 0;
+    uint64_t failed     = 0;
+    uint64_t contained  = 0;
+    uint64_t iterations = 0;
+    double   squares    = 0.0;
+    double   error_max  = 0.0;
+    double   seconds    = 0.0;
+    uint32_t timestamp  = 0;
+
+    for (uint32_t position = 0; position < positions; position++)
+    {
+        double truth[3];
+        for (size_t k = 0; k < 3; k++)
+        {
+            truth[k] = low[k] + uniform(random) * (high[k] - low[k]);
+        }
+        if (config.dimensions == 2)
+        {
+            truth[2] = config.tag_z_mm;
+        }
+
+        rtt_position_reset();
+        for (uint32_t round = 0; round < rounds; round++)
+        {
+            for (rtt_anchor_t const & anchor : g_anchors)
+            {
+                double range = std::hypot(truth[0] - anchor.x_mm, truth[1] - anchor.y_mm, truth[2] - anchor.z_mm);
+                int    q     = quality(random);
+                double noisy = range + normal(random) * config.sigma_mm * std::sqrt(100.0 / q);
+
+                /* One burst to every anchor a second */
+                timestamp = (timestamp + static_cast<uint32_t>(RTC_FREQ_HZ / g_anchors.size())) & 0xFFFFFF;
+
+                rtt_position_t result;
+                auto     start    = std::chrono::steady_clock::now();
+                uint32_t err_code = rtt_position_update(anchor.id, static_cast<int32_t>(std::max(0.0, std::round(noisy))),
+                                                        static_cast<uint8_t>(q), timestamp, &result);
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                updates++;
+
+                if (err_code == NRF_ERROR_INVALID_STATE)
+                {
+                    continue;
+                }
+                if (err_code != NRF_SUCCESS)
+                {
+                    failed++;
+                    continue;
+                }
+
+                double error[3] = {result.x_mm - truth[0], result.y_mm - truth[1], result.z_mm - truth[2]};
+                double norm     = std::sqrt(error[0] * error[0] + error[1] * error[1] +
+                                            ((config.dimensions == 3) ? error[2] * error[2] : 0.0));
+                solved++;
+                squares    += norm * norm;
+                error_max   = std::max(error_max, norm);
+                iterations += result.iterations;
+                contained  += (mahalanobis(error, result, config.dimensions) <= 2.0) ? 1 : 0;
+            }
+        }
+    }
+
+    std::printf("\n%u positions, %u rounds of distances, sigma %.3f m, quality %u to 100 %%\n", positions, rounds,
+                config.sigma_mm / 1000.0, quality_min);
+    std::printf("solved      %llu of %llu updates, %llu failed\n", (unsigned long long)solved,
+                (unsigned long long)updates, (unsigned long long)failed);
+    if (solved != 0)
+    {
+        std::printf("error       %.3f m RMS, %.3f m largest\n", std::sqrt(squares / solved) / 1000.0, error_max / 1000.0);
+        std::printf("2 sigma     %.1f %% inside, %.1f %% expected\n", 100.0 * contained / solved,
+                    100.0 * ((config.dimensions == 2) ? CONTAINMENT_2D : CONTAINMENT_3D));
+        std::printf("iterations  %.2f mean\n", static_cast<double>(iterations) / solved);
+    }
+    std::printf("update      %.2f us on the host\n", 1e6 * seconds / updates);
+    return 0;
+}
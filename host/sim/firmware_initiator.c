@@ -0,0 +1,209 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Initiator node of the host simulator. Replaces main.c of the central: ranging starts at once
+   with the schedule given to the simulator, and each burst is reported to it. Single-shot
+   requests, when the simulator is given an interval for them, come from compare 0 of RTC1,
+   which app_timer does not use here.
+
+   Built a second time with SIM_INITIATOR_SECOND for a second initiator. It ranges on a link of
+   its own and numbers the responder as its peer 1, so it gives the responder another address
+   than the first, and starts half a burst period later, as two centrals would not start
+   together. */
+
+#include <math.h>
+#include <stdint.h>
+#include "nrf.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_sdh.h"
+#include "sim.h"
+#include "rtt_config.h"
+#include "rtt_estimator.h"
+#include "timeslot.h"
+
+void SD_EVT_IRQHandler(void);
+void TIMESLOT_BEGIN_IRQHandler(void);
+void TIMESLOT_END_IRQHandler(void);
+void RTC1_IRQHandler(void);
+
+#if SIM_INITIATOR_SECOND
+#define SIM_PEER     1                         /* Index the initiator gives the responder */
+#define SIM_FIRMWARE sim_firmware_initiator_b
+#define SIM_NAME     "initiator_b"
+#else
+#define SIM_PEER     0
+#define SIM_FIRMWARE sim_firmware_initiator
+#define SIM_NAME     "initiator"
+#endif
+
+/* The simulated boards have no calibration blob in flash */
+static rtt_calibration_t const m_calibration = RTT_CALIBRATION_DEFAULT;
+
+static rtt_link_t m_link;                  /* Link of the responder */
+static uint32_t   m_single_shot_ticks;     /* Interval of the single-shot requests */
+static uint32_t   m_single_shot_requested; /* app_timer ticks at the last single-shot request */
+
+
+/**@brief Report a completed burst to the simulator
+ */
+static void burst_handler(rtt_burst_t const * p_burst)
+{
+    uint64_t start      = sim_cycles();
+    float    distance_m = (p_burst->valid > 0) ? calc_dist(p_burst, &m_calibration) : NAN;
+    uint64_t cycles     = sim_cycles() - start;
+
+    sim_burst_t burst =
+    {
+        .exchanges        = p_burst->exchanges,
+        .valid            = p_burst->valid,
+        .rx_crc_error     = p_burst->rx_crc_error,
+        .rx_ignored       = p_burst->rx_ignored,
+        .rx_timeouts      = p_burst->rx_timeouts,
+        .p_bins           = p_burst->bins,
+        .bins             = rtt_config_get()->bins,
+        .distance_m       = distance_m,
+        .estimator_cycles = cycles,
+        .single_shot      = p_burst->single_shot,
+    };
+
+    if (p_burst->single_shot)
+    {
+        burst.request_us = (uint32_t)(((uint64_t)app_timer_cnt_diff_compute(app_timer_cnt_get(), m_single_shot_requested) *
+                                       1000000UL) / APP_TIMER_CLOCK_FREQ);
+    }
+
+    sim_burst_report(&burst);
+}
+
+
+/**@brief Request a single-shot burst, as the central does on a range request
+ *
+ * @details A request while the previous one is still waiting is dropped.
+ */
+void RTC1_IRQHandler(void)
+{
+    uint32_t err_code;
+
+    NRF_RTC1->EVENTS_COMPARE[0] = 0;
+    NRF_RTC1->CC[0] = (NRF_RTC1->CC[0] + m_single_shot_ticks) & RTC_COUNTER_COUNTER_Msk;
+
+    err_code = timeslot_single_shot(SIM_PEER, &m_link, rtt_config_get()->exchanges);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_single_shot_requested = app_timer_cnt_get();
+    }
+    else if (err_code != NRF_ERROR_BUSY)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+static void initiator_main(void)
+{
+    uint32_t            err_code;
+    sim_ranging_t       ranging;
+    rtt_config_t        config = *rtt_config_get();
+    timeslot_schedule_t schedule = {0};
+
+    sim_ranging_get(&ranging);
+    config.rate_hz         = ranging.rate_hz;
+    config.exchanges       = ranging.exchanges;
+    config.slot_length_us  = (ranging.slot_length_us != 0) ? ranging.slot_length_us : config.slot_length_us;
+    config.burst_margin_us = (ranging.burst_margin_us != 0) ? ranging.burst_margin_us : config.burst_margin_us;
+    config.bins            = (ranging.bins != 0) ? ranging.bins : config.bins;
+#if SIM_INITIATOR_SECOND
+    config.access_address  = ranging.second_link.access_address;
+    config.hop_seed        = ranging.second_link.hop_seed;
+#else
+    config.access_address  = ranging.initiator_link.access_address;
+    config.hop_seed        = ranging.initiator_link.hop_seed;
+#endif
+    err_code = rtt_config_stage(&config);
+    APP_ERROR_CHECK(err_code);
+    (void)rtt_config_apply();
+
+    schedule.rate_hz   = ranging.rate_hz;
+    schedule.exchanges = ranging.exchanges;
+    rtt_config_link_get(&config, &schedule.links[SIM_PEER]);
+    m_link = schedule.links[SIM_PEER];
+#if SIM_INITIATOR_SECOND
+    schedule.frame[0]  = SIM_PEER;
+    schedule.frame_len = 1;
+#endif
+    err_code = timeslot_schedule_set(&schedule);
+    APP_ERROR_CHECK(err_code);
+
+    if (ranging.power != SIM_POWER_DEFAULT)
+    {
+        err_code = timeslot_power_policy_set((ranging.power == SIM_POWER_PER_SLOT)    ? TIMESLOT_POWER_POLICY_PER_SLOT :
+                                             (ranging.power == SIM_POWER_PER_SESSION) ? TIMESLOT_POWER_POLICY_PER_SESSION
+                                                                                      : TIMESLOT_POWER_POLICY_AUTO);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = nrf_sdh_enable_request();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = timeslot_sd_init(burst_handler);
+    APP_ERROR_CHECK(err_code);
+
+#if SIM_INITIATOR_SECOND
+    sim_delay_ns((ranging.rate_hz != 0) ? 500000000ULL / ranging.rate_hz : 0);
+#endif
+
+    err_code = timeslot_start();
+    APP_ERROR_CHECK(err_code);
+
+    if (ranging.single_shot_ms != 0)
+    {
+        m_single_shot_ticks = APP_TIMER_TICKS(ranging.single_shot_ms);
+        NRF_RTC1->CC[0]     = m_single_shot_ticks;
+        NRF_RTC1->INTENSET  = RTC_INTENSET_COMPARE0_Set << RTC_INTENSET_COMPARE0_Pos;
+        NVIC_EnableIRQ(RTC1_IRQn);
+    }
+
+    for (;;)
+    {
+        app_sched_execute();
+        __WFE();
+    }
+}
+
+
+sim_firmware_t const SIM_FIRMWARE =
+{
+    .p_name  = SIM_NAME,
+    .main    = initiator_main,
+    .vectors =
+    {
+        [SD_EVT_IRQn]         = SD_EVT_IRQHandler,
+        [TIMESLOT_BEGIN_IRQn] = TIMESLOT_BEGIN_IRQHandler,
+        [TIMESLOT_END_IRQn]   = TIMESLOT_END_IRQHandler,
+        [RTC1_IRQn]           = RTC1_IRQHandler,
+    },
+};
@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Responder node of the host simulator. Replaces main.c of the peripheral: the listening
+   windows start at once with the schedule given to the simulator. The responder searches for
+   the initiator at each of its single-shot requests, as on a range request, from compare 0 of
+   RTC1 at the same interval.
+
+   Each initiator is served as one that has written its configuration: with its own link and
+   the address it gives the responder, on connections 0 and 1. */
+
+#include <stdint.h>
+#include "nrf.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_sdh.h"
+#include "sim.h"
+#include "rtt_config.h"
+#include "rtt_initiators.h"
+#include "timeslot.h"
+
+void SD_EVT_IRQHandler(void);
+void TIMESLOT_BEGIN_IRQHandler(void);
+void TIMESLOT_END_IRQHandler(void);
+void RTC1_IRQHandler(void);
+
+static uint32_t m_single_shot_ticks; /* Interval of the initiator's single-shot requests */
+
+
+/**@brief Listen for the initiator's single-shot burst, outside the windows of its schedule
+ */
+void RTC1_IRQHandler(void)
+{
+    NRF_RTC1->EVENTS_COMPARE[0] = 0;
+    NRF_RTC1->CC[0] = (NRF_RTC1->CC[0] + m_single_shot_ticks) & RTC_COUNTER_COUNTER_Msk;
+
+    timeslot_search();
+}
+
+
+static void responder_main(void)
+{
+    uint32_t            err_code;
+    sim_ranging_t       ranging;
+    rtt_config_t        config = *rtt_config_get();
+    timeslot_schedule_t schedule;
+
+    sim_ranging_get(&ranging);
+    config.rate_hz         = ranging.rate_hz;
+    config.exchanges       = ranging.exchanges;
+    config.slot_length_us  = (ranging.slot_length_us != 0) ? ranging.slot_length_us : config.slot_length_us;
+    config.burst_margin_us = (ranging.burst_margin_us != 0) ? ranging.burst_margin_us : config.burst_margin_us;
+    config.bins            = (ranging.bins != 0) ? ranging.bins : config.bins;
+    config.access_address  = ranging.responder_link.access_address;
+    config.hop_seed        = ranging.responder_link.hop_seed;
+    err_code = rtt_config_stage(&config);
+    APP_ERROR_CHECK(err_code);
+    (void)rtt_config_apply();
+
+    rtt_initiators_init();
+    config.address = RTT_CONFIG_PEER_ADDRESS(0);
+    err_code = rtt_initiators_add(0, &config);
+    APP_ERROR_CHECK(err_code);
+
+    if (ranging.initiators > 1)
+    {
+        rtt_config_t second = config;
+
+        second.address        = RTT_CONFIG_PEER_ADDRESS(1);
+        second.access_address = ranging.second_link.access_address;
+        second.hop_seed       = ranging.second_link.hop_seed;
+        err_code = rtt_initiators_add(1, &second);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    schedule.rate_hz   = ranging.rate_hz;
+    schedule.exchanges = ranging.exchanges;
+    err_code = timeslot_schedule_set(&schedule);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_sdh_enable_request();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = timeslot_sd_init();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = timeslot_start();
+    APP_ERROR_CHECK(err_code);
+
+    if (ranging.single_shot_ms != 0)
+    {
+        m_single_shot_ticks = APP_TIMER_TICKS(ranging.single_shot_ms);
+        NRF_RTC1->CC[0]     = m_single_shot_ticks;
+        NRF_RTC1->INTENSET  = RTC_INTENSET_COMPARE0_Set << RTC_INTENSET_COMPARE0_Pos;
+        NVIC_EnableIRQ(RTC1_IRQn);
+    }
+
+    for (;;)
+    {
+        app_sched_execute();
+        __WFE();
+    }
+}
+
+
+sim_firmware_t const sim_firmware_responder =
+{
+    .p_name  = "responder",
+    .main    = responder_main,
+    .vectors =
+    {
+        [SD_EVT_IRQn]         = SD_EVT_IRQHandler,
+        [TIMESLOT_BEGIN_IRQn] = TIMESLOT_BEGIN_IRQHandler,
+        [TIMESLOT_END_IRQn]   = TIMESLOT_END_IRQHandler,
+        [RTC1_IRQn]           = RTC1_IRQHandler,
+    },
+};
@@ -0,0 +1,53 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#include <stdint.h>
+#include "nrf.h"
+#include "app_util.h"
+
+/* Application interrupt priorities with a SoftDevice */
+typedef enum
+{
+    APP_IRQ_PRIORITY_HIGHEST = 2,
+    APP_IRQ_PRIORITY_HIGH    = 3,
+    APP_IRQ_PRIORITY_MID     = 5,
+    APP_IRQ_PRIORITY_LOW     = 6,
+    APP_IRQ_PRIORITY_LOWEST  = 7,
+    APP_IRQ_PRIORITY_THREAD  = 15
+} app_irq_priority_t;
+
+/* The critical region masks the application interrupts, like sd_nvic_critical_region_enter() */
+#define CRITICAL_REGION_ENTER()                         \
+    {                                                   \
+        uint8_t __CR_NESTED = 0;                        \
+        sim_critical_region_enter(&__CR_NESTED);
+
+#define CRITICAL_REGION_EXIT()                          \
+        sim_critical_region_exit(__CR_NESTED);          \
+    }
+
+#endif // APP_UTIL_PLATFORM_H__
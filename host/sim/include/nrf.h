@@ -0,0 +1,466 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NRF_H__
+#define NRF_H__
+
+/* Register model of the nRF52840 peripherals used by the ranging firmware, for the host
+   simulator. The layouts follow the nRF52840 product specification so that register addresses
+   written to PPI channels decode to the right peripheral. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sim.h"
+
+#define NRF52840_XXAA
+
+#ifndef __I
+#define __I  volatile const
+#endif
+#ifndef __O
+#define __O  volatile
+#endif
+#ifndef __IO
+#define __IO volatile
+#endif
+#define __IM  volatile const
+#define __OM  volatile
+#define __IOM volatile
+
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE static inline
+#endif
+
+/**@brief Interrupt numbers */
+typedef enum
+{
+    POWER_CLOCK_IRQn = 0,
+    RADIO_IRQn       = 1,
+    UARTE0_UART0_IRQn = 2,
+    GPIOTE_IRQn      = 6,
+    SAADC_IRQn       = 7,
+    TIMER0_IRQn      = 8,
+    TIMER1_IRQn      = 9,
+    TIMER2_IRQn      = 10,
+    RTC0_IRQn        = 11,
+    TEMP_IRQn        = 12,
+    RNG_IRQn         = 13,
+    ECB_IRQn         = 14,
+    CCM_AAR_IRQn     = 15,
+    WDT_IRQn         = 16,
+    RTC1_IRQn        = 17,
+    QDEC_IRQn        = 18,
+    COMP_LPCOMP_IRQn = 19,
+    SWI0_EGU0_IRQn   = 20,
+    SWI1_EGU1_IRQn   = 21,
+    SWI2_EGU2_IRQn   = 22,
+    SWI3_EGU3_IRQn   = 23,
+    SWI4_EGU4_IRQn   = 24,
+    SWI5_EGU5_IRQn   = 25,
+    TIMER3_IRQn      = 26,
+    TIMER4_IRQn      = 27,
+    PWM0_IRQn        = 28,
+    PDM_IRQn         = 29,
+    MWU_IRQn         = 32,
+    PWM1_IRQn        = 33,
+    PWM2_IRQn        = 34,
+    SPIM2_SPIS2_SPI2_IRQn = 35,
+    RTC2_IRQn        = 36,
+    I2S_IRQn         = 37,
+    FPU_IRQn         = 38,
+    USBD_IRQn        = 39,
+    UARTE1_IRQn      = 40,
+    QSPI_IRQn        = 41,
+    CRYPTOCELL_IRQn  = 42,
+    PWM3_IRQn        = 45,
+    SPIM3_IRQn       = 47
+} IRQn_Type;
+
+/**@brief 2.4 GHz radio */
+typedef struct
+{
+    __OM  uint32_t TASKS_TXEN;
+    __OM  uint32_t TASKS_RXEN;
+    __OM  uint32_t TASKS_START;
+    __OM  uint32_t TASKS_STOP;
+    __OM  uint32_t TASKS_DISABLE;
+    __OM  uint32_t TASKS_RSSISTART;
+    __OM  uint32_t TASKS_RSSISTOP;
+    __OM  uint32_t TASKS_BCSTART;
+    __OM  uint32_t TASKS_BCSTOP;
+    __OM  uint32_t TASKS_EDSTART;
+    __OM  uint32_t TASKS_EDSTOP;
+    __OM  uint32_t TASKS_CCASTART;
+    __OM  uint32_t TASKS_CCASTOP;
+    __IM  uint32_t RESERVED0[51];
+    __IOM uint32_t EVENTS_READY;
+    __IOM uint32_t EVENTS_ADDRESS;
+    __IOM uint32_t EVENTS_PAYLOAD;
+    __IOM uint32_t EVENTS_END;
+    __IOM uint32_t EVENTS_DISABLED;
+    __IOM uint32_t EVENTS_DEVMATCH;
+    __IOM uint32_t EVENTS_DEVMISS;
+    __IOM uint32_t EVENTS_RSSIEND;
+    __IM  uint32_t RESERVED1[2];
+    __IOM uint32_t EVENTS_BCMATCH;
+    __IM  uint32_t RESERVED2;
+    __IOM uint32_t EVENTS_CRCOK;
+    __IOM uint32_t EVENTS_CRCERROR;
+    __IOM uint32_t EVENTS_FRAMESTART;
+    __IOM uint32_t EVENTS_EDEND;
+    __IOM uint32_t EVENTS_EDSTOPPED;
+    __IOM uint32_t EVENTS_CCAIDLE;
+    __IOM uint32_t EVENTS_CCABUSY;
+    __IOM uint32_t EVENTS_CCASTOPPED;
+    __IOM uint32_t EVENTS_RATEBOOST;
+    __IOM uint32_t EVENTS_TXREADY;
+    __IOM uint32_t EVENTS_RXREADY;
+    __IOM uint32_t EVENTS_MHRMATCH;
+    __IM  uint32_t RESERVED3[3];
+    __IOM uint32_t EVENTS_PHYEND;
+    __IM  uint32_t RESERVED4[36];
+    __IOM uint32_t SHORTS;
+    __IM  uint32_t RESERVED5[64];
+    __IOM uint32_t INTENSET;
+    __IOM uint32_t INTENCLR;
+    __IM  uint32_t RESERVED6[61];
+    __IM  uint32_t CRCSTATUS;
+    __IM  uint32_t RESERVED7;
+    __IM  uint32_t RXMATCH;
+    __IM  uint32_t RXCRC;
+    __IM  uint32_t DAI;
+    __IM  uint32_t PDUSTAT;
+    __IM  uint32_t RESERVED8[59];
+    __IOM uint32_t PACKETPTR;
+    __IOM uint32_t FREQUENCY;
+    __IOM uint32_t TXPOWER;
+    __IOM uint32_t MODE;
+    __IOM uint32_t PCNF0;
+    __IOM uint32_t PCNF1;
+    __IOM uint32_t BASE0;
+    __IOM uint32_t BASE1;
+    __IOM uint32_t PREFIX0;
+    __IOM uint32_t PREFIX1;
+    __IOM uint32_t TXADDRESS;
+    __IOM uint32_t RXADDRESSES;
+    __IOM uint32_t CRCCNF;
+    __IOM uint32_t CRCPOLY;
+    __IOM uint32_t CRCINIT;
+    __IM  uint32_t RESERVED9;
+    __IOM uint32_t TIFS;
+    __IM  uint32_t RSSISAMPLE;
+    __IM  uint32_t RESERVED10;
+    __IM  uint32_t STATE;
+    __IOM uint32_t DATAWHITEIV;
+    __IM  uint32_t RESERVED11[2];
+    __IOM uint32_t BCC;
+    __IM  uint32_t RESERVED12[39];
+    __IOM uint32_t DAB[8];
+    __IOM uint32_t DAP[8];
+    __IOM uint32_t DACNF;
+    __IOM uint32_t MHRMATCHCONF;
+    __IOM uint32_t MHRMATCHMAS;
+    __IM  uint32_t RESERVED13;
+    __IOM uint32_t MODECNF0;
+    __IM  uint32_t RESERVED14[3];
+    __IOM uint32_t SFD;
+    __IOM uint32_t EDCNT;
+    __IOM uint32_t EDSAMPLE;
+    __IOM uint32_t CCACTRL;
+    __IM  uint32_t RESERVED15[611];
+    __IOM uint32_t POWER;
+} NRF_RADIO_Type;
+
+/**@brief Timer/counter */
+typedef struct
+{
+    __OM  uint32_t TASKS_START;
+    __OM  uint32_t TASKS_STOP;
+    __OM  uint32_t TASKS_COUNT;
+    __OM  uint32_t TASKS_CLEAR;
+    __OM  uint32_t TASKS_SHUTDOWN;
+    __IM  uint32_t RESERVED0[11];
+    __OM  uint32_t TASKS_CAPTURE[6];
+    __IM  uint32_t RESERVED1[58];
+    __IOM uint32_t EVENTS_COMPARE[6];
+    __IM  uint32_t RESERVED2[42];
+    __IOM uint32_t SHORTS;
+    __IM  uint32_t RESERVED3[64];
+    __IOM uint32_t INTENSET;
+    __IOM uint32_t INTENCLR;
+    __IM  uint32_t RESERVED4[126];
+    __IOM uint32_t MODE;
+    __IOM uint32_t BITMODE;
+    __IM  uint32_t RESERVED5;
+    __IOM uint32_t PRESCALER;
+    __IM  uint32_t RESERVED6[11];
+    __IOM uint32_t CC[6];
+} NRF_TIMER_Type;
+
+/**@brief Real time counter */
+typedef struct
+{
+    __OM  uint32_t TASKS_START;
+    __OM  uint32_t TASKS_STOP;
+    __OM  uint32_t TASKS_CLEAR;
+    __OM  uint32_t TASKS_TRIGOVRFLW;
+    __IM  uint32_t RESERVED0[60];
+    __IOM uint32_t EVENTS_TICK;
+    __IOM uint32_t EVENTS_OVRFLW;
+    __IM  uint32_t RESERVED1[14];
+    __IOM uint32_t EVENTS_COMPARE[4];
+    __IM  uint32_t RESERVED2[109];
+    __IOM uint32_t INTENSET;
+    __IOM uint32_t INTENCLR;
+    __IM  uint32_t RESERVED3[13];
+    __IOM uint32_t EVTEN;
+    __IOM uint32_t EVTENSET;
+    __IOM uint32_t EVTENCLR;
+    __IM  uint32_t RESERVED4[110];
+    __IM  uint32_t COUNTER;
+    __IOM uint32_t PRESCALER;
+    __IM  uint32_t RESERVED5[13];
+    __IOM uint32_t CC[4];
+} NRF_RTC_Type;
+
+/**@brief Event generator unit */
+typedef struct
+{
+    __OM  uint32_t TASKS_TRIGGER[16];
+    __IM  uint32_t RESERVED0[48];
+    __IOM uint32_t EVENTS_TRIGGERED[16];
+    __IM  uint32_t RESERVED1[112];
+    __IOM uint32_t INTEN;
+    __IOM uint32_t INTENSET;
+    __IOM uint32_t INTENCLR;
+} NRF_EGU_Type;
+
+typedef struct
+{
+    __OM  uint32_t EN;
+    __OM  uint32_t DIS;
+} PPI_TASKS_CHG_Type;
+
+typedef struct
+{
+    __IOM uint32_t EEP;
+    __IOM uint32_t TEP;
+} PPI_CH_Type;
+
+typedef struct
+{
+    __IOM uint32_t TEP;
+} PPI_FORK_Type;
+
+/**@brief Programmable peripheral interconnect */
+typedef struct
+{
+    PPI_TASKS_CHG_Type TASKS_CHG[6];
+    __IM  uint32_t     RESERVED0[308];
+    __IOM uint32_t     CHEN;
+    __IOM uint32_t     CHENSET;
+    __IOM uint32_t     CHENCLR;
+    __IM  uint32_t     RESERVED1;
+    PPI_CH_Type        CH[20];
+    __IM  uint32_t     RESERVED2[148];
+    __IOM uint32_t     CHG[6];
+    __IM  uint32_t     RESERVED3[62];
+    PPI_FORK_Type      FORK[32];
+} NRF_PPI_Type;
+
+#define NRF_RADIO  ((NRF_RADIO_Type *) sim_periph(SIM_PERIPH_RADIO))
+#define NRF_TIMER0 ((NRF_TIMER_Type *) sim_periph(SIM_PERIPH_TIMER0))
+#define NRF_TIMER1 ((NRF_TIMER_Type *) sim_periph(SIM_PERIPH_TIMER1))
+#define NRF_TIMER2 ((NRF_TIMER_Type *) sim_periph(SIM_PERIPH_TIMER2))
+#define NRF_TIMER3 ((NRF_TIMER_Type *) sim_periph(SIM_PERIPH_TIMER3))
+#define NRF_TIMER4 ((NRF_TIMER_Type *) sim_periph(SIM_PERIPH_TIMER4))
+#define NRF_RTC0   ((NRF_RTC_Type *)   sim_periph(SIM_PERIPH_RTC0))
+#define NRF_RTC1   ((NRF_RTC_Type *)   sim_periph(SIM_PERIPH_RTC1))
+#define NRF_EGU0   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU0))
+#define NRF_EGU1   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU1))
+#define NRF_EGU2   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU2))
+#define NRF_EGU3   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU3))
+#define NRF_EGU4   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU4))
+#define NRF_EGU5   ((NRF_EGU_Type *)   sim_periph(SIM_PERIPH_EGU5))
+#define NRF_PPI    ((NRF_PPI_Type *)   sim_periph(SIM_PERIPH_PPI))
+
+/* RADIO bit fields */
+#define RADIO_SHORTS_READY_START_Pos        (0UL)
+#define RADIO_SHORTS_READY_START_Enabled    (1UL)
+#define RADIO_SHORTS_END_DISABLE_Pos        (1UL)
+#define RADIO_SHORTS_END_DISABLE_Enabled    (1UL)
+#define RADIO_SHORTS_DISABLED_TXEN_Pos      (2UL)
+#define RADIO_SHORTS_DISABLED_TXEN_Enabled  (1UL)
+#define RADIO_SHORTS_DISABLED_RXEN_Pos      (3UL)
+#define RADIO_SHORTS_DISABLED_RXEN_Enabled  (1UL)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Pos  (4UL)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Enabled (1UL)
+#define RADIO_SHORTS_END_START_Pos          (5UL)
+#define RADIO_SHORTS_END_START_Enabled      (1UL)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Pos  (8UL)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Enabled (1UL)
+
+#define RADIO_INTENSET_READY_Pos            (0UL)
+#define RADIO_INTENSET_ADDRESS_Pos          (1UL)
+#define RADIO_INTENSET_PAYLOAD_Pos          (2UL)
+#define RADIO_INTENSET_END_Pos              (3UL)
+#define RADIO_INTENSET_DISABLED_Pos         (4UL)
+#define RADIO_INTENSET_RSSIEND_Pos          (7UL)
+#define RADIO_INTENSET_CRCOK_Pos            (12UL)
+#define RADIO_INTENSET_CRCERROR_Pos         (13UL)
+#define RADIO_INTENSET_TXREADY_Pos          (21UL)
+#define RADIO_INTENSET_RXREADY_Pos          (22UL)
+#define RADIO_INTENSET_PHYEND_Pos           (27UL)
+
+#define RADIO_CRCSTATUS_CRCSTATUS_Pos       (0UL)
+#define RADIO_CRCSTATUS_CRCSTATUS_CRCError  (0UL)
+#define RADIO_CRCSTATUS_CRCSTATUS_CRCOk     (1UL)
+
+#define RADIO_FREQUENCY_FREQUENCY_Pos       (0UL)
+#define RADIO_FREQUENCY_FREQUENCY_Msk       (0x7FUL << RADIO_FREQUENCY_FREQUENCY_Pos)
+#define RADIO_FREQUENCY_MAP_Pos             (8UL)
+#define RADIO_FREQUENCY_MAP_Default         (0UL)
+#define RADIO_FREQUENCY_MAP_Low             (1UL)
+
+#define RADIO_TXPOWER_TXPOWER_Pos           (0UL)
+#define RADIO_TXPOWER_TXPOWER_Msk           (0xFFUL << RADIO_TXPOWER_TXPOWER_Pos)
+
+#define RADIO_MODE_MODE_Pos                 (0UL)
+#define RADIO_MODE_MODE_Msk                 (0xFUL << RADIO_MODE_MODE_Pos)
+#define RADIO_MODE_MODE_Nrf_1Mbit           (0UL)
+#define RADIO_MODE_MODE_Nrf_2Mbit           (1UL)
+#define RADIO_MODE_MODE_Ble_1Mbit           (3UL)
+#define RADIO_MODE_MODE_Ble_2Mbit           (4UL)
+#define RADIO_MODE_MODE_Ble_LR125Kbit       (5UL)
+#define RADIO_MODE_MODE_Ble_LR500Kbit       (6UL)
+#define RADIO_MODE_MODE_Ieee802154_250Kbit  (15UL)
+
+#define RADIO_PCNF0_LFLEN_Pos               (0UL)
+#define RADIO_PCNF0_LFLEN_Msk               (0xFUL << RADIO_PCNF0_LFLEN_Pos)
+#define RADIO_PCNF0_S0LEN_Pos               (8UL)
+#define RADIO_PCNF0_S0LEN_Msk               (0x1UL << RADIO_PCNF0_S0LEN_Pos)
+#define RADIO_PCNF0_S1LEN_Pos               (16UL)
+#define RADIO_PCNF0_S1LEN_Msk               (0xFUL << RADIO_PCNF0_S1LEN_Pos)
+#define RADIO_PCNF0_S1INCL_Pos              (20UL)
+#define RADIO_PCNF0_S1INCL_Msk              (0x1UL << RADIO_PCNF0_S1INCL_Pos)
+#define RADIO_PCNF0_PLEN_Pos                (24UL)
+#define RADIO_PCNF0_PLEN_Msk                (0x3UL << RADIO_PCNF0_PLEN_Pos)
+#define RADIO_PCNF0_PLEN_8bit               (0UL)
+#define RADIO_PCNF0_PLEN_16bit              (1UL)
+
+#define RADIO_PCNF1_MAXLEN_Pos              (0UL)
+#define RADIO_PCNF1_MAXLEN_Msk              (0xFFUL << RADIO_PCNF1_MAXLEN_Pos)
+#define RADIO_PCNF1_STATLEN_Pos             (8UL)
+#define RADIO_PCNF1_STATLEN_Msk             (0xFFUL << RADIO_PCNF1_STATLEN_Pos)
+#define RADIO_PCNF1_BALEN_Pos               (16UL)
+#define RADIO_PCNF1_BALEN_Msk               (0x7UL << RADIO_PCNF1_BALEN_Pos)
+#define RADIO_PCNF1_WHITEEN_Pos             (25UL)
+#define RADIO_PCNF1_WHITEEN_Msk             (0x1UL << RADIO_PCNF1_WHITEEN_Pos)
+
+#define RADIO_CRCCNF_LEN_Pos                (0UL)
+#define RADIO_CRCCNF_LEN_Msk                (0x3UL << RADIO_CRCCNF_LEN_Pos)
+
+#define RADIO_STATE_STATE_Disabled          (0UL)
+#define RADIO_STATE_STATE_RxRu              (1UL)
+#define RADIO_STATE_STATE_RxIdle            (2UL)
+#define RADIO_STATE_STATE_Rx                (3UL)
+#define RADIO_STATE_STATE_RxDisable         (4UL)
+#define RADIO_STATE_STATE_TxRu              (9UL)
+#define RADIO_STATE_STATE_TxIdle            (10UL)
+#define RADIO_STATE_STATE_Tx                (11UL)
+#define RADIO_STATE_STATE_TxDisable         (12UL)
+
+#define RADIO_MODECNF0_RU_Pos               (0UL)
+#define RADIO_MODECNF0_RU_Msk               (0x1UL << RADIO_MODECNF0_RU_Pos)
+#define RADIO_MODECNF0_RU_Default           (0UL)
+#define RADIO_MODECNF0_RU_Fast              (1UL)
+
+#define RADIO_POWER_POWER_Pos               (0UL)
+#define RADIO_POWER_POWER_Disabled          (0UL)
+#define RADIO_POWER_POWER_Enabled           (1UL)
+
+/* TIMER bit fields */
+#define TIMER_SHORTS_COMPARE0_CLEAR_Pos     (0UL)
+#define TIMER_SHORTS_COMPARE0_STOP_Pos      (8UL)
+
+#define TIMER_INTENSET_COMPARE0_Pos         (16UL)
+#define TIMER_INTENSET_COMPARE0_Enabled     (1UL)
+#define TIMER_INTENSET_COMPARE0_Set         (1UL)
+#define TIMER_INTENSET_COMPARE1_Pos         (17UL)
+#define TIMER_INTENSET_COMPARE1_Enabled     (1UL)
+#define TIMER_INTENSET_COMPARE1_Set         (1UL)
+#define TIMER_INTENSET_COMPARE2_Pos         (18UL)
+#define TIMER_INTENSET_COMPARE2_Set         (1UL)
+#define TIMER_INTENSET_COMPARE3_Pos         (19UL)
+#define TIMER_INTENSET_COMPARE3_Set         (1UL)
+#define TIMER_INTENCLR_COMPARE0_Pos         (16UL)
+#define TIMER_INTENCLR_COMPARE0_Clear       (1UL)
+#define TIMER_INTENCLR_COMPARE1_Pos         (17UL)
+#define TIMER_INTENCLR_COMPARE1_Clear       (1UL)
+#define TIMER_INTENCLR_COMPARE2_Pos         (18UL)
+#define TIMER_INTENCLR_COMPARE2_Clear       (1UL)
+#define TIMER_INTENCLR_COMPARE3_Pos         (19UL)
+#define TIMER_INTENCLR_COMPARE3_Clear       (1UL)
+
+#define TIMER_MODE_MODE_Pos                 (0UL)
+#define TIMER_MODE_MODE_Msk                 (0x3UL << TIMER_MODE_MODE_Pos)
+#define TIMER_MODE_MODE_Timer               (0UL)
+#define TIMER_MODE_MODE_Counter             (1UL)
+#define TIMER_MODE_MODE_LowPowerCounter     (2UL)
+
+#define TIMER_BITMODE_BITMODE_Pos           (0UL)
+#define TIMER_BITMODE_BITMODE_Msk           (0x3UL << TIMER_BITMODE_BITMODE_Pos)
+#define TIMER_BITMODE_BITMODE_16Bit         (0UL)
+#define TIMER_BITMODE_BITMODE_08Bit         (1UL)
+#define TIMER_BITMODE_BITMODE_24Bit         (2UL)
+#define TIMER_BITMODE_BITMODE_32Bit         (3UL)
+
+#define TIMER_PRESCALER_PRESCALER_Pos       (0UL)
+#define TIMER_PRESCALER_PRESCALER_Msk       (0xFUL << TIMER_PRESCALER_PRESCALER_Pos)
+
+/* RTC bit fields */
+#define RTC_COUNTER_COUNTER_Msk             (0xFFFFFFUL)
+
+#define RTC_INTENSET_COMPARE0_Pos           (16UL)
+#define RTC_INTENSET_COMPARE0_Set           (1UL)
+
+/**@brief Core functions, backed by the simulated interrupt controller */
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type irq)       { sim_nvic_enable(irq); }
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type irq)      { sim_nvic_disable(irq); }
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type irq)   { sim_nvic_set_pending(irq); }
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type irq) { sim_nvic_clear_pending(irq); }
+__STATIC_INLINE void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) { sim_nvic_set_priority(irq, priority); }
+__STATIC_INLINE uint32_t NVIC_GetPriority(IRQn_Type irq) { return sim_nvic_get_priority(irq); }
+
+#define __DMB()                 __asm__ volatile ("" ::: "memory")
+#define __DSB()                 __asm__ volatile ("" ::: "memory")
+#define __ISB()                 __asm__ volatile ("" ::: "memory")
+#define __NOP()                 __asm__ volatile ("")
+#define __SEV()                 __asm__ volatile ("")
+#define __WFE()                 sim_wait_for_event()
+#define __WFI()                 sim_wait_for_event()
+#define __LDREXW(p_addr)        sim_ldrex(p_addr)
+#define __STREXW(value, p_addr) sim_strex((value), (p_addr))
+
+#endif // NRF_H__
@@ -0,0 +1,53 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NRF_ERROR_H__
+#define NRF_ERROR_H__
+
+/* SoftDevice error codes, as in the nRF5 SDK */
+
+#define NRF_ERROR_BASE_NUM              (0x0)
+
+#define NRF_SUCCESS                     (NRF_ERROR_BASE_NUM + 0)
+#define NRF_ERROR_SVC_HANDLER_MISSING   (NRF_ERROR_BASE_NUM + 1)
+#define NRF_ERROR_SOFTDEVICE_NOT_ENABLED (NRF_ERROR_BASE_NUM + 2)
+#define NRF_ERROR_INTERNAL              (NRF_ERROR_BASE_NUM + 3)
+#define NRF_ERROR_NO_MEM                (NRF_ERROR_BASE_NUM + 4)
+#define NRF_ERROR_NOT_FOUND             (NRF_ERROR_BASE_NUM + 5)
+#define NRF_ERROR_NOT_SUPPORTED         (NRF_ERROR_BASE_NUM + 6)
+#define NRF_ERROR_INVALID_PARAM         (NRF_ERROR_BASE_NUM + 7)
+#define NRF_ERROR_INVALID_STATE         (NRF_ERROR_BASE_NUM + 8)
+#define NRF_ERROR_INVALID_LENGTH        (NRF_ERROR_BASE_NUM + 9)
+#define NRF_ERROR_INVALID_FLAGS         (NRF_ERROR_BASE_NUM + 10)
+#define NRF_ERROR_INVALID_DATA          (NRF_ERROR_BASE_NUM + 11)
+#define NRF_ERROR_DATA_SIZE             (NRF_ERROR_BASE_NUM + 12)
+#define NRF_ERROR_TIMEOUT               (NRF_ERROR_BASE_NUM + 13)
+#define NRF_ERROR_NULL                  (NRF_ERROR_BASE_NUM + 14)
+#define NRF_ERROR_FORBIDDEN             (NRF_ERROR_BASE_NUM + 15)
+#define NRF_ERROR_INVALID_ADDR          (NRF_ERROR_BASE_NUM + 16)
+#define NRF_ERROR_BUSY                  (NRF_ERROR_BASE_NUM + 17)
+#define NRF_ERROR_CONN_COUNT            (NRF_ERROR_BASE_NUM + 18)
+#define NRF_ERROR_RESOURCES             (NRF_ERROR_BASE_NUM + 19)
+
+#endif // NRF_ERROR_H__
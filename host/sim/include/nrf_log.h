@@ -0,0 +1,43 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NRF_LOG_H__
+#define NRF_LOG_H__
+
+#include "nrf.h"
+
+/* Log lines of the simulated nodes go to the simulator, which prints them when verbose */
+
+#define NRF_LOG_ERROR(...)   sim_log(__VA_ARGS__)
+#define NRF_LOG_WARNING(...) sim_log(__VA_ARGS__)
+#define NRF_LOG_INFO(...)    sim_log(__VA_ARGS__)
+#define NRF_LOG_DEBUG(...)   sim_log(__VA_ARGS__)
+#define NRF_LOG_RAW_INFO(...) sim_log(__VA_ARGS__)
+#define NRF_LOG_FLUSH()      do { } while (0)
+
+#define NRF_LOG_FLOAT_MARKER "%s%d.%02d"
+#define NRF_LOG_FLOAT(val)   (((val) < 0 && (val) > -1.0) ? "-" : ""), (int)(val), \
+                             (int)((((val) > 0) ? (val) - (int)(val) : (int)(val) - (val)) * 100)
+
+#endif // NRF_LOG_H__
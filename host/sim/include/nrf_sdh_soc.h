@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NRF_SDH_SOC_H__
+#define NRF_SDH_SOC_H__
+
+#include <stdint.h>
+#include "nrf_sdh.h"
+
+typedef void (*nrf_sdh_soc_evt_handler_t)(uint32_t evt_id, void * p_context);
+
+typedef struct
+{
+    nrf_sdh_soc_evt_handler_t handler;
+    void                    * p_context;
+} nrf_sdh_soc_evt_observer_t;
+
+/**@brief Add an observer of the SoC events. Used by NRF_SDH_SOC_OBSERVER. */
+void nrf_sdh_soc_observer_register(nrf_sdh_soc_evt_observer_t const * p_observer, uint8_t prio);
+
+/* The SDK places observers in a linker section. The firmware of each simulated node is linked
+   into one object, so the observers register themselves with that node's dispatcher instead. */
+#define NRF_SDH_SOC_OBSERVER(_name, _prio, _handler, _context)                      \
+    static nrf_sdh_soc_evt_observer_t const _name =                                 \
+    {                                                                               \
+        .handler   = _handler,                                                      \
+        .p_context = _context                                                       \
+    };                                                                              \
+    static void __attribute__((constructor)) _name##_register(void)                 \
+    {                                                                               \
+        nrf_sdh_soc_observer_register(&_name, _prio);                               \
+    }
+
+#endif // NRF_SDH_SOC_H__
@@ -0,0 +1,168 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+
+/* SoC library and radio timeslot API of the SoftDevice, as in S140 v7. Implemented by the
+   SoftDevice stand-in of the host simulator. */
+
+#include <stdint.h>
+#include "nrf.h"
+#include "nrf_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NRF_RADIO_NOTIFICATION_INACTIVE_GUARANTEED_TIME_US (62)
+#define NRF_RADIO_MINIMUM_TIMESLOT_LENGTH_EXTENSION_TIME_US (200)
+#define NRF_RADIO_MAX_EXTENSION_PROCESSING_TIME_US         (20)
+#define NRF_RADIO_MIN_EXTENSION_MARGIN_US                  (82)
+
+#define NRF_RADIO_LENGTH_MIN_US           (100)
+#define NRF_RADIO_LENGTH_MAX_US           (100000)
+#define NRF_RADIO_DISTANCE_MAX_US         (128000000UL - 1UL)
+#define NRF_RADIO_EARLIEST_TIMEOUT_MAX_US (128000000UL - 1UL)
+#define NRF_RADIO_START_JITTER_US         (2)
+
+#define SD_EVT_IRQn       (SWI2_EGU2_IRQn)
+#define SD_EVT_IRQHandler (SWI2_EGU2_IRQHandler)
+
+/**@brief SoC events */
+enum NRF_SOC_EVTS
+{
+    NRF_EVT_HFCLKSTARTED,
+    NRF_EVT_POWER_FAILURE_WARNING,
+    NRF_EVT_FLASH_OPERATION_SUCCESS,
+    NRF_EVT_FLASH_OPERATION_ERROR,
+    NRF_EVT_RADIO_BLOCKED,
+    NRF_EVT_RADIO_CANCELED,
+    NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN,
+    NRF_EVT_RADIO_SESSION_IDLE,
+    NRF_EVT_RADIO_SESSION_CLOSED,
+    NRF_EVT_POWER_USB_POWER_READY,
+    NRF_EVT_POWER_USB_DETECTED,
+    NRF_EVT_POWER_USB_REMOVED,
+    NRF_EVT_NUMBER_OF_EVTS
+};
+
+/**@brief Timeslot signals */
+enum NRF_RADIO_CALLBACK_SIGNAL_TYPE
+{
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_START,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_FAILED,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_SUCCEEDED
+};
+
+/**@brief Actions requested by the signal callback */
+enum NRF_RADIO_SIGNAL_CALLBACK_ACTION
+{
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_END,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END
+};
+
+enum NRF_RADIO_HFCLK_CFG
+{
+    NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED,
+    NRF_RADIO_HFCLK_CFG_NO_GUARANTEE
+};
+
+enum NRF_RADIO_PRIORITY
+{
+    NRF_RADIO_PRIORITY_HIGH,
+    NRF_RADIO_PRIORITY_NORMAL,
+};
+
+enum NRF_RADIO_REQUEST_TYPE
+{
+    NRF_RADIO_REQ_TYPE_EARLIEST,
+    NRF_RADIO_REQ_TYPE_NORMAL
+};
+
+typedef struct
+{
+    uint8_t  hfclk;
+    uint8_t  priority;
+    uint32_t length_us;
+    uint32_t timeout_us;
+} nrf_radio_request_earliest_t;
+
+typedef struct
+{
+    uint8_t  hfclk;
+    uint8_t  priority;
+    uint32_t distance_us;
+    uint32_t length_us;
+} nrf_radio_request_normal_t;
+
+typedef struct
+{
+    uint8_t request_type;
+    union
+    {
+        nrf_radio_request_earliest_t earliest;
+        nrf_radio_request_normal_t   normal;
+    } params;
+} nrf_radio_request_t;
+
+typedef struct
+{
+    uint8_t callback_action;
+    union
+    {
+        struct
+        {
+            nrf_radio_request_t * p_next;
+        } request;
+        struct
+        {
+            uint32_t length_us;
+        } extend;
+    } params;
+} nrf_radio_signal_callback_return_param_t;
+
+typedef nrf_radio_signal_callback_return_param_t * (*nrf_radio_signal_callback_t)(uint8_t signal_type);
+
+uint32_t sd_radio_session_open(nrf_radio_signal_callback_t p_radio_signal_callback);
+uint32_t sd_radio_session_close(void);
+uint32_t sd_radio_request(nrf_radio_request_t const * p_request);
+
+uint32_t sd_evt_get(uint32_t * p_evt_id);
+
+uint32_t sd_clock_hfclk_request(void);
+uint32_t sd_clock_hfclk_release(void);
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running);
+
+uint32_t sd_temp_get(int32_t * p_temp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_SOC_H__
@@ -0,0 +1,174 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_H__
+#define SIM_H__
+
+/* Interface between the firmware of a simulated node and the host simulator in host/sim.
+   The firmware is compiled unmodified against the headers in this directory. Every access to
+   a peripheral goes through sim_periph(), which lets the simulator apply the side effects of
+   the previous access, advance the node's clock and run the interrupts that have become due. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Simulated peripherals, with their offset from the peripheral base 0x40000000 */
+typedef enum
+{
+    SIM_PERIPH_RADIO,
+    SIM_PERIPH_TIMER0,
+    SIM_PERIPH_TIMER1,
+    SIM_PERIPH_TIMER2,
+    SIM_PERIPH_RTC0,
+    SIM_PERIPH_RTC1,
+    SIM_PERIPH_EGU0,
+    SIM_PERIPH_EGU1,
+    SIM_PERIPH_EGU2,
+    SIM_PERIPH_EGU3,
+    SIM_PERIPH_EGU4,
+    SIM_PERIPH_EGU5,
+    SIM_PERIPH_TIMER3,
+    SIM_PERIPH_TIMER4,
+    SIM_PERIPH_PPI,
+    SIM_PERIPHS
+} sim_periph_t;
+
+#define SIM_PERIPH_OFFSETS                                                  \
+{                                                                           \
+    0x01000, 0x08000, 0x09000, 0x0A000, 0x0B000, 0x11000, 0x14000, 0x15000, \
+    0x16000, 0x17000, 0x18000, 0x19000, 0x1A000, 0x1B000, 0x1F000           \
+}
+
+#define SIM_PERIPH_SPACE 0x20000 /**< Size of the peripheral space of one node. */
+#define SIM_IRQS         48      /**< Number of interrupt lines of the nRF52840. */
+
+/**@brief Get the registers of a peripheral of the running node */
+void * sim_periph(sim_periph_t periph);
+
+/**@brief Keep the CPU busy */
+void sim_delay_ns(uint64_t ns);
+
+/**@brief Sleep until an interrupt has run */
+void sim_wait_for_event(void);
+
+/**@brief Interrupt controller */
+void     sim_nvic_enable(int32_t irq);
+void     sim_nvic_disable(int32_t irq);
+void     sim_nvic_set_pending(int32_t irq);
+void     sim_nvic_clear_pending(int32_t irq);
+void     sim_nvic_set_priority(int32_t irq, uint32_t priority);
+uint32_t sim_nvic_get_priority(int32_t irq);
+
+/**@brief Mask the application interrupts, as sd_nvic_critical_region_enter does */
+void sim_critical_region_enter(uint8_t * p_nested);
+void sim_critical_region_exit(uint8_t nested);
+
+/**@brief Exclusive access. An interrupt between the two clears the reservation. */
+uint32_t sim_ldrex(volatile uint32_t * p_addr);
+uint32_t sim_strex(uint32_t value, volatile uint32_t * p_addr);
+
+/**@brief Stop the simulation on a firmware error */
+void sim_error(uint32_t err_code, char const * p_file, uint32_t line) __attribute__((noreturn));
+
+/**@brief Write a log line of the running node */
+void sim_log(char const * p_format, ...) __attribute__((format(printf, 1, 2)));
+
+/**@brief Result of one burst, reported by the initiator */
+typedef struct
+{
+    uint32_t         exchanges;         /**< Exchanges attempted. */
+    uint32_t         valid;             /**< Responses with the expected sequence number. */
+    uint32_t         rx_crc_error;      /**< Responses with a CRC error. */
+    uint32_t         rx_ignored;        /**< Responses with an unexpected sequence number. */
+    uint32_t         rx_timeouts;       /**< Exchanges without a response. */
+    uint16_t const * p_bins;            /**< Round trip histogram. */
+    uint32_t         bins;              /**< Number of bins in the histogram. */
+    float            distance_m;        /**< Estimated distance, NAN without a valid exchange. */
+    uint64_t         estimator_cycles;  /**< Host CPU cycles calc_dist() took. */
+    bool             single_shot;       /**< Run for a single-shot request. */
+    uint32_t         request_us;        /**< Time from the single-shot request to the result. */
+} sim_burst_t;
+
+/**@brief Report the result of a burst */
+void sim_burst_report(sim_burst_t const * p_burst);
+
+/**@brief Host CPU cycle counter, for code that takes no simulated time */
+uint64_t sim_cycles(void);
+
+/**@brief Power policy of the initiator, see timeslot_power_policy_t */
+typedef enum
+{
+    SIM_POWER_DEFAULT,     /**< The firmware default. */
+    SIM_POWER_PER_SLOT,
+    SIM_POWER_PER_SESSION,
+    SIM_POWER_AUTO,
+} sim_power_t;
+
+/**@brief Radio link of a node, see rtt_link_t */
+typedef struct
+{
+    uint32_t access_address; /**< 0 for the shared access address. */
+    uint8_t  hop_seed;       /**< 0 stays on the configured channel. */
+} sim_link_t;
+
+/**@brief Ranging schedule and configuration the nodes start with */
+typedef struct
+{
+    uint32_t    rate_hz;         /**< Bursts per second, 0 for continuous ranging. */
+    uint32_t    exchanges;       /**< Exchanges in each burst. */
+    uint32_t    slot_length_us;  /**< Timeslot length in continuous ranging, 0 for the default. */
+    uint32_t    burst_margin_us; /**< Time a burst leaves at the end of its timeslot, 0 for the default. */
+    uint32_t    bins;            /**< Histogram bins in use, 0 for the default. */
+    sim_power_t power;
+    uint32_t    single_shot_ms;  /**< Interval of the single-shot requests, 0 for none. */
+    sim_link_t  initiator_link;  /**< Link the initiator ranges on. */
+    sim_link_t  responder_link;  /**< Link the responder listens on. */
+    uint32_t    initiators;      /**< Initiators ranging with the responder, 1 or 2. */
+    sim_link_t  second_link;     /**< Link of the second initiator, which needs one of its own. */
+} sim_ranging_t;
+
+/**@brief Get the ranging schedule given to the simulator */
+void sim_ranging_get(sim_ranging_t * p_ranging);
+
+/**@brief Firmware of a simulated node
+ *
+ * @details Each firmware image is linked into one relocatable object, in which only its
+ *          descriptor is left global, so several nodes can run the same sources.
+ */
+typedef struct
+{
+    char const * p_name;
+    void      (* main)(void);                 /**< Thread mode. The node sleeps if it returns. */
+    void      (* vectors[SIM_IRQS])(void);    /**< Interrupt handlers, NULL if not used. */
+} sim_firmware_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_H__
@@ -0,0 +1,101 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Event scheduler of a simulated node, a copy of the SDK's queue semantics without the
+   configurable sizes. */
+
+#include <stdint.h>
+#include <string.h>
+#include "nrf.h"
+#include "app_util_platform.h"
+#include "app_scheduler.h"
+
+#define SCHED_QUEUE_SIZE      32  /* Events, must be a power of two */
+#define SCHED_MAX_EVENT_SIZE  64
+
+typedef struct
+{
+    app_sched_event_handler_t handler;
+    uint16_t                  event_size;
+    uint8_t                   data[SCHED_MAX_EVENT_SIZE];
+} event_t;
+
+static event_t           m_queue[SCHED_QUEUE_SIZE];
+static volatile uint32_t m_head = 0; /* Next event to execute */
+static volatile uint32_t m_tail = 0; /* Next free entry */
+
+
+uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size)
+{
+    if ((max_event_size > SCHED_MAX_EVENT_SIZE) || (queue_size > SCHED_QUEUE_SIZE))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_sched_event_put(void const * p_event_data, uint16_t event_size, app_sched_event_handler_t handler)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    if (event_size > SCHED_MAX_EVENT_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if ((m_tail - m_head) == SCHED_QUEUE_SIZE)
+    {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    else
+    {
+        event_t * p_event = &m_queue[m_tail % SCHED_QUEUE_SIZE];
+
+        p_event->handler    = handler;
+        p_event->event_size = event_size;
+        if ((p_event_data != NULL) && (event_size > 0))
+        {
+            memcpy(p_event->data, p_event_data, event_size);
+        }
+        m_tail++;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+void app_sched_execute(void)
+{
+    while (m_head != m_tail)
+    {
+        event_t * p_event = &m_queue[m_head % SCHED_QUEUE_SIZE];
+
+        p_event->handler((p_event->event_size > 0) ? p_event->data : NULL, p_event->event_size);
+        m_head++;
+    }
+}
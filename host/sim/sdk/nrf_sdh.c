@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* SoftDevice handler of a simulated node. Compiled into each node, so every node has its own
+   observers. SoC events are pulled from the SoftDevice stand-in in SD_EVT_IRQHandler, as the
+   SDK does with the interrupt dispatch model. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf.h"
+#include "app_error.h"
+#include "app_util_platform.h"
+#include "nrf_sdh.h"
+#include "nrf_sdh_soc.h"
+
+#define SOC_OBSERVERS_MAX 8
+#define SOC_OBSERVER_PRIO_LEVELS 4
+
+static struct
+{
+    nrf_sdh_soc_evt_observer_t const * p_observer;
+    uint8_t                            prio;
+} m_soc_observers[SOC_OBSERVERS_MAX];
+
+static uint32_t m_soc_observer_count = 0;
+static bool     m_enabled            = false;
+
+
+void nrf_sdh_soc_observer_register(nrf_sdh_soc_evt_observer_t const * p_observer, uint8_t prio)
+{
+    if ((m_soc_observer_count == SOC_OBSERVERS_MAX) || (prio >= SOC_OBSERVER_PRIO_LEVELS))
+    {
+        APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
+    }
+
+    m_soc_observers[m_soc_observer_count].p_observer = p_observer;
+    m_soc_observers[m_soc_observer_count].prio       = prio;
+    m_soc_observer_count++;
+}
+
+
+uint32_t nrf_sdh_enable_request(void)
+{
+    if (m_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_enabled = true;
+
+    NVIC_SetPriority(SD_EVT_IRQn, APP_IRQ_PRIORITY_LOWEST);
+    NVIC_EnableIRQ(SD_EVT_IRQn);
+
+    return NRF_SUCCESS;
+}
+
+
+bool nrf_sdh_is_enabled(void)
+{
+    return m_enabled;
+}
+
+
+/**@brief Pass the SoC events to the observers, in order of observer priority
+ */
+void SD_EVT_IRQHandler(void)
+{
+    uint32_t evt_id;
+
+    while (sd_evt_get(&evt_id) == NRF_SUCCESS)
+    {
+        for (uint8_t prio = 0; prio < SOC_OBSERVER_PRIO_LEVELS; prio++)
+        {
+            for (uint32_t i = 0; i < m_soc_observer_count; i++)
+            {
+                if (m_soc_observers[i].prio == prio)
+                {
+                    m_soc_observers[i].p_observer->handler(evt_id, m_soc_observers[i].p_observer->p_context);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,227 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_channel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <sstream>
+
+#include "sim_radio.h"
+
+namespace rtt::sim {
+
+namespace {
+
+constexpr double PATH_LOSS_1M_DB = 40.2; /* Free space at 2.44 GHz */
+constexpr double MIN_DISTANCE_M  = 0.1;
+constexpr double JITTER_LIMIT    = 4.0;  /* Normal timing errors are cut at this many sigma */
+
+} // namespace
+
+FreeSpace::FreeSpace(MediumConfig const & config, uint64_t seed) :
+    m_config(config),
+    m_random(seed)
+{
+}
+
+double FreeSpace::path_loss(double distance_m, double exponent) const
+{
+    return PATH_LOSS_1M_DB + 10.0 * exponent * std::log10(std::max(distance_m, MIN_DISTANCE_M));
+}
+
+Path FreeSpace::propagate(Transmission const & transmission, double distance_m)
+{
+    Path path;
+
+    path.lost     = uniform() < m_config.loss;
+    path.corrupt  = uniform() < m_config.crc_error;
+    path.rssi_dbm = transmission.power_dbm - path_loss(distance_m, 2.0);
+    return path;
+}
+
+FieldChannel::FieldChannel(MediumConfig const & config, ChannelConfig const & channel, uint64_t seed) :
+    FreeSpace(config, seed),
+    m_channel(channel)
+{
+    for (JitterHistogram const & histogram : m_channel.histograms)
+    {
+        m_bins.emplace_back(histogram.counts.begin(), histogram.counts.end());
+    }
+}
+
+double FieldChannel::offset_ns(double rssi_dbm)
+{
+    if (!m_channel.histograms.empty())
+    {
+        size_t nearest = 0;
+        for (size_t i = 1; i < m_channel.histograms.size(); i++)
+        {
+            if (std::fabs(m_channel.histograms[i].rssi_dbm - rssi_dbm) <
+                std::fabs(m_channel.histograms[nearest].rssi_dbm - rssi_dbm))
+            {
+                nearest = i;
+            }
+        }
+
+        size_t bin = m_bins[nearest](m_random);
+        return m_channel.histograms[nearest].offsets_ns[bin] + (uniform() - 0.5) * m_channel.histogram_bin_ns;
+    }
+    if (m_channel.jitter_ns > 0.0)
+    {
+        double sigma = m_channel.jitter_ns * std::pow(10.0, (m_channel.jitter_rssi_dbm - rssi_dbm) / 20.0);
+        return sigma * std::clamp(m_normal(m_random), -JITTER_LIMIT, JITTER_LIMIT);
+    }
+    return 0.0;
+}
+
+Path FieldChannel::propagate(Transmission const & transmission, double distance_m)
+{
+    Path path;
+
+    /* The taps add to the line of sight with random phases; the receiver locks on to the
+       centre of the power that falls into its correlator. */
+    std::complex<double> amplitude(1.0, 0.0);
+    double tap_power = 0.0;
+    double tap_delay = 0.0;
+    for (Tap const & tap : m_channel.taps)
+    {
+        double sigma = std::sqrt(std::pow(10.0, tap.power_db / 10.0) / 2.0);
+        std::complex<double> tap_amplitude(sigma * m_normal(m_random), sigma * m_normal(m_random));
+
+        amplitude += tap_amplitude;
+        tap_power += std::norm(tap_amplitude);
+        tap_delay += std::norm(tap_amplitude) * tap.delay_ns;
+    }
+
+    path.rssi_dbm = transmission.power_dbm - path_loss(distance_m, m_channel.exponent) +
+                    10.0 * std::log10(std::max(std::norm(amplitude), 1e-6));
+    path.offset   = std::llround((tap_delay / (1.0 + tap_power) + offset_ns(path.rssi_dbm)) * PS_PER_NS);
+
+    double miss = 1.0 / (1.0 + std::exp((path.rssi_dbm - m_channel.sensitivity_dbm) / m_channel.sensitivity_slope_db));
+    auto   per  = m_channel.channel_per.find(transmission.frequency);
+
+    path.lost    = (uniform() < m_config.loss) || (uniform() < miss);
+    path.corrupt = (uniform() < m_config.crc_error) ||
+                   ((per != m_channel.channel_per.end()) && (uniform() < per->second));
+    return path;
+}
+
+std::string channel_config_load(char const * p_path, ChannelConfig & config)
+{
+    std::ifstream file(p_path);
+    if (!file)
+    {
+        return std::string(p_path) + ": cannot be opened";
+    }
+
+    std::string line;
+    for (uint32_t number = 1; std::getline(file, line); number++)
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string        key;
+        if (!(fields >> key))
+        {
+            continue;
+        }
+
+        bool ok;
+        if (key == "exponent")
+        {
+            ok = static_cast<bool>(fields >> config.exponent);
+        }
+        else if (key == "tap")
+        {
+            Tap tap;
+            ok = static_cast<bool>(fields >> tap.delay_ns >> tap.power_db) && (tap.delay_ns >= 0.0);
+            config.taps.push_back(tap);
+        }
+        else if (key == "jitter")
+        {
+            ok = static_cast<bool>(fields >> config.jitter_ns >> config.jitter_rssi_dbm) && (config.jitter_ns >= 0.0);
+        }
+        else if (key == "histogram")
+        {
+            JitterHistogram histogram;
+            double offset;
+            double count;
+            double total = 0.0;
+
+            ok = static_cast<bool>(fields >> histogram.rssi_dbm);
+            while (ok && (fields >> offset))
+            {
+                ok = static_cast<bool>(fields >> count) && (count >= 0.0);
+                histogram.offsets_ns.push_back(offset);
+                histogram.counts.push_back(count);
+                total += count;
+            }
+            ok = ok && fields.eof() && (total > 0.0);
+            config.histograms.push_back(histogram);
+        }
+        else if (key == "histogram_bin")
+        {
+            ok = static_cast<bool>(fields >> config.histogram_bin_ns) && (config.histogram_bin_ns >= 0.0);
+        }
+        else if (key == "sensitivity")
+        {
+            ok = static_cast<bool>(fields >> config.sensitivity_dbm >> config.sensitivity_slope_db) &&
+                 (config.sensitivity_slope_db > 0.0);
+        }
+        else if (key == "per")
+        {
+            uint32_t frequency;
+            double   per;
+            ok = static_cast<bool>(fields >> frequency >> per) && (per >= 0.0) && (per <= 1.0);
+            config.channel_per[frequency] = per;
+        }
+        else
+        {
+            ok = false;
+        }
+
+        std::string rest;
+        if (!ok || (fields >> rest))
+        {
+            return std::string(p_path) + ":" + std::to_string(number) + ": cannot read '" + line + "'";
+        }
+    }
+    return std::string();
+}
+
+ChannelConfig channel_line_of_sight()
+{
+    ChannelConfig channel;
+
+    channel.jitter_ns            = 8.0;
+    channel.jitter_rssi_dbm      = -60.0;
+    channel.sensitivity_dbm      = -94.0;
+    channel.sensitivity_slope_db = 1.5;
+    return channel;
+}
+
+} // namespace rtt::sim
@@ -0,0 +1,121 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_CHANNEL_H__
+#define SIM_CHANNEL_H__
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sim_config.h"
+
+namespace rtt::sim {
+
+struct Transmission;
+
+/**@brief How one packet reaches one receiver */
+struct Path
+{
+    int64_t offset   = 0;     /**< Timing error of the receiver's events, in ps. */
+    double  rssi_dbm = 0.0;
+    bool    lost     = false; /**< Not detected. */
+    bool    corrupt  = false; /**< Detected, with a CRC error. */
+};
+
+/**@brief Channel model of the medium
+ *
+ * @details Decides what happens to a packet on its way to a receiver, apart from the line of
+ *          sight delay that the medium adds. Draws come from the channel's own generator, so a
+ *          run can be reproduced from its seed.
+ */
+class Channel
+{
+public:
+    virtual ~Channel() = default;
+
+    /**@brief A packet travels a distance to a receiver */
+    virtual Path propagate(Transmission const & transmission, double distance_m) = 0;
+};
+
+/**@brief Free space with a fixed loss and CRC error probability and no timing error */
+class FreeSpace : public Channel
+{
+public:
+    FreeSpace(MediumConfig const & config, uint64_t seed);
+
+    Path propagate(Transmission const & transmission, double distance_m) override;
+
+protected:
+    double uniform() { return m_uniform(m_random); }
+    double path_loss(double distance_m, double exponent) const;
+
+    MediumConfig const &                   m_config;
+    std::mt19937_64                        m_random;
+    std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+};
+
+/**@brief Channel from field measurements: multipath, timing error, sensitivity and channel PER */
+class FieldChannel : public FreeSpace
+{
+public:
+    FieldChannel(MediumConfig const & config, ChannelConfig const & channel, uint64_t seed);
+
+    Path propagate(Transmission const & transmission, double distance_m) override;
+
+private:
+    double offset_ns(double rssi_dbm);
+
+    ChannelConfig const &                       m_channel;
+    std::vector<std::discrete_distribution<size_t>> m_bins; /* One for each histogram */
+    std::normal_distribution<double>            m_normal{0.0, 1.0};
+};
+
+/**@brief Read a channel description
+ *
+ * @details One parameter per line, '#' starts a comment:
+ *
+ *          | Line                                  | Sets                                  |
+ *          |---------------------------------------|---------------------------------------|
+ *          | exponent <n>                          | exponent                              |
+ *          | tap <delay ns> <power dB>             | adds to taps                          |
+ *          | jitter <sigma ns> <at RSSI dBm>       | jitter_ns, jitter_rssi_dbm            |
+ *          | histogram <RSSI dBm> <ns> <count> ... | adds to histograms, in bin pairs      |
+ *          | histogram_bin <ns>                    | histogram_bin_ns                      |
+ *          | sensitivity <dBm> <slope dB>          | sensitivity_dbm, sensitivity_slope_db |
+ *          | per <frequency MHz> <probability>     | adds to channel_per                   |
+ *
+ * @return Empty on success, otherwise what is wrong and where
+ */
+std::string channel_config_load(char const * p_path, ChannelConfig & config);
+
+/**@brief Line of sight channel of the benchmark and the sweeps: timing error from the RSSI
+ *        and packets lost around the sensitivity, no multipath
+ */
+ChannelConfig channel_line_of_sight();
+
+} // namespace rtt::sim
+
+#endif // SIM_CHANNEL_H__
@@ -0,0 +1,152 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_CONFIG_H__
+#define SIM_CONFIG_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+namespace rtt::sim {
+
+/**@brief Simulated time in picoseconds */
+using Time = uint64_t;
+
+constexpr Time NEVER     = UINT64_MAX;
+constexpr Time PS_PER_NS = 1000;
+constexpr Time PS_PER_US = 1000000;
+constexpr Time PS_PER_MS = 1000000000;
+constexpr Time PS_PER_S  = 1000000000000;
+
+constexpr Time from_us(double us) { return static_cast<Time>(us * PS_PER_US + 0.5); }
+constexpr Time from_ns(double ns) { return static_cast<Time>(ns * PS_PER_NS + 0.5); }
+constexpr double to_us(Time time) { return static_cast<double>(time) / PS_PER_US; }
+
+/**@brief CPU timing */
+struct CpuConfig
+{
+    Time access    = from_ns(47);  /**< Time between peripheral accesses, 3 cycles at 64 MHz. */
+    Time irq_entry = from_ns(188); /**< Interrupt entry, 12 cycles at 64 MHz. */
+};
+
+/**@brief Radio timing
+ *
+ * @details The ramp-up and disable times are the nRF52840 figures. The chain delays are not
+ *          specified closely enough, so their sum is set to give the round trip the firmware
+ *          is calibrated for: 4156.5 ticks of 16 MHz at 0 m with RTT_DEFAULT_BIN_OFFSET and
+ *          the offset in rtt_estimator.c.
+ */
+struct RadioConfig
+{
+    Time ramp_up      = from_us(140); /**< TXEN or RXEN to READY. */
+    Time ramp_up_fast = from_us(40);  /**< TXEN or RXEN to READY with MODECNF0.RU set. */
+    Time tx_disable   = from_us(6);   /**< DISABLE to DISABLED from TX. */
+    Time rx_disable   = 0;            /**< DISABLE to DISABLED from RX. */
+    Time tx_chain     = from_ns(600); /**< START to the first bit on the air. */
+    Time rx_chain     = from_ns(7180); /**< Bit at the antenna to the event it completes. */
+    Time rssi         = from_ns(250); /**< RSSISTART to RSSIEND. */
+};
+
+/**@brief Virtual air medium between the nodes */
+struct MediumConfig
+{
+    double distance_m    = 1.0;  /**< Distance between the nodes. */
+    double distance_to_m = -1.0; /**< Other end of a moving node's path, none if negative. */
+    double speed_mps     = 0.0;  /**< Speed back and forth along that path. */
+    double delay_ns      = -1.0; /**< Propagation delay, from the distance if negative. */
+    double loss          = 0.0;  /**< Probability that a packet is not detected at all. */
+    double crc_error     = 0.0;  /**< Probability that a detected packet fails its CRC. */
+};
+
+/**@brief Multipath component, relative to the line of sight */
+struct Tap
+{
+    double delay_ns; /**< Excess delay over the line of sight. */
+    double power_db; /**< Mean power, faded per packet. */
+};
+
+/**@brief Measured timing errors of the receiver at one RSSI */
+struct JitterHistogram
+{
+    double              rssi_dbm;
+    std::vector<double> offsets_ns; /**< Bin centres. */
+    std::vector<double> counts;
+};
+
+/**@brief Field channel between the nodes, on top of MediumConfig
+ *
+ * @details The timing error moves every event a receiver generates for a packet, as its bit
+ *          clock recovery would; the line of sight still decides when the packet arrives. Each
+ *          tap adds a Rayleigh faded copy of the packet that pulls the timing later by its share
+ *          of the power. A packet is not detected with a probability that rises around the
+ *          sensitivity, and fails its CRC with the error rate of its frequency.
+ */
+struct ChannelConfig
+{
+    double                       exponent        = 2.0;    /**< Path loss exponent beyond 1 m. */
+    std::vector<Tap>             taps;
+    double                       jitter_ns       = 0.0;    /**< Timing error sigma at jitter_rssi_dbm. */
+    double                       jitter_rssi_dbm = -60.0;  /**< The sigma grows 20 dB per decade below. */
+    std::vector<JitterHistogram> histograms;               /**< Used instead of jitter_ns, the nearest RSSI. */
+    double                       histogram_bin_ns = 0.0;   /**< Width of the histogram bins. */
+    double                       sensitivity_dbm = -200.0; /**< Half of the packets are not detected. */
+    double                       sensitivity_slope_db = 1.0;
+    std::map<uint32_t, double>   channel_per;              /**< CRC error probability by frequency in MHz. */
+};
+
+/**@brief SoftDevice timeslot timing and contention
+ *
+ * @details The patterns are replayed in turn and repeat, one character for each request or
+ *          extension. A request is blocked or canceled when its pattern says so or when its
+ *          timeslot would overlap a connection event; an extension fails in the same way.
+ */
+struct SoftDeviceConfig
+{
+    Time        earliest_latency = from_us(100); /**< From an earliest request to its timeslot. */
+    Time        hfxo_startup     = from_us(360); /**< Crystal start-up before a timeslot that needs it. */
+    std::string grants;                          /**< 'g' granted, 'b' blocked, 'c' canceled at its start. */
+    std::string extensions;                      /**< '1' succeeds, '0' fails. */
+    Time        ble_interval     = 0;            /**< Connection interval of other BLE activity, 0 for none. */
+    Time        ble_event        = 0;            /**< Length of each connection event. */
+};
+
+/**@brief Simulator configuration */
+struct Config
+{
+    CpuConfig           cpu;
+    RadioConfig         radio;
+    MediumConfig        medium;
+    SoftDeviceConfig    softdevice;
+    sim_ranging_t       ranging = {10, 16, 0, 0, 0, SIM_POWER_DEFAULT, 0, {0, 0}, {0, 0}, 1, {0, 0}};
+    std::vector<double> ppm;     /**< Crystal offset of each node, in the order they are added. */
+    uint64_t            seed    = 1;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_CONFIG_H__
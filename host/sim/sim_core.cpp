@@ -0,0 +1,799 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <x86intrin.h>
+
+#include "nrf.h"
+#include "sim_medium.h"
+#include "sim_peripherals.h"
+#include "sim_radio.h"
+#include "sim_softdevice.h"
+
+namespace rtt::sim {
+
+namespace {
+
+constexpr uint32_t MAX_NODES          = 8;
+constexpr size_t   STACK_SIZE         = 256 * 1024;
+constexpr Time     CLOCK_PERIOD       = 62500;
+constexpr uint64_t CLOCK_PERIOD_FS    = 62500000;
+constexpr uint32_t CRITICAL_PRIORITY  = 2;    /* Lowest priority the critical region masks */
+constexpr uint32_t EVENTS_OFFSET      = 0x100;
+constexpr uint32_t INTEN_OFFSET       = 0x300;
+constexpr uint32_t INTENSET_OFFSET    = 0x304;
+constexpr uint32_t INTENCLR_OFFSET    = 0x308;
+
+/**@brief Memory below 4 GiB, so the firmware can keep its addresses in 32-bit registers */
+void * map_low(size_t size)
+{
+    void * p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        fatal("cannot map %zu bytes below 4 GiB", size);
+    }
+    return p;
+}
+
+} // namespace
+
+void fatal(char const * p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    std::fputs("rtt_sim: ", stderr);
+    std::vfprintf(stderr, p_format, args);
+    std::fputc('\n', stderr);
+    va_end(args);
+    std::exit(EXIT_FAILURE);
+}
+
+Peripheral::Peripheral(Node & node, sim_periph_t id, int32_t irq) :
+    m_node(node),
+    m_id(id),
+    m_irq(irq),
+    m_p_base(node.periph_base(id))
+{
+}
+
+void Peripheral::event(uint32_t offset)
+{
+    reg(offset) = 1;
+    m_node.ppi_event(Node::bus_address(m_p_base + offset));
+
+    if ((m_irq >= 0) && (m_inten & (1u << ((offset - EVENTS_OFFSET) / 4))))
+    {
+        m_node.irq_pend(m_irq, true);
+    }
+}
+
+bool Peripheral::sync_tasks(uint32_t first, uint32_t last)
+{
+    bool triggered = false;
+
+    for (uint32_t offset = first; offset <= last; offset += 4)
+    {
+        if (reg(offset) != 0)
+        {
+            reg(offset) = 0;
+            task(offset);
+            triggered = true;
+        }
+    }
+    return triggered;
+}
+
+void Peripheral::sync_inten(bool has_inten)
+{
+    uint32_t inten = m_inten;
+
+    if (has_inten && (reg(INTEN_OFFSET) != m_inten))
+    {
+        inten = reg(INTEN_OFFSET);
+    }
+    if (reg(INTENSET_OFFSET) != m_inten)
+    {
+        inten |= reg(INTENSET_OFFSET);
+    }
+    inten &= ~reg(INTENCLR_OFFSET);
+
+    /* An event that is already set interrupts when it is enabled */
+    uint32_t enabled = inten & ~m_inten;
+    for (uint32_t i = 0; enabled != 0; i++, enabled >>= 1)
+    {
+        if ((enabled & 1) && (reg(EVENTS_OFFSET + 4 * i) != 0) && (m_irq >= 0))
+        {
+            m_node.irq_pend(m_irq, true);
+        }
+    }
+
+    m_inten = inten;
+    if (has_inten)
+    {
+        reg(INTEN_OFFSET) = m_inten;
+    }
+    reg(INTENSET_OFFSET) = m_inten;
+    reg(INTENCLR_OFFSET) = 0;
+}
+
+void Peripheral::reschedule()
+{
+    m_node.reschedule(*this);
+}
+
+Node::Node(Simulator & sim, sim_firmware_t const & firmware, uint32_t index, uint8_t * p_space) :
+    m_sim(sim),
+    m_firmware(firmware),
+    m_index(index),
+    m_p_space(p_space),
+    m_clock_phase(sim.random() % CLOCK_PERIOD)
+{
+    Config const & config = sim.config();
+    double         ppm    = (index < config.ppm.size()) ? config.ppm[index] : 0.0;
+
+    m_clock_fs = static_cast<uint64_t>(std::llround(CLOCK_PERIOD_FS / (1.0 + ppm * 1e-6)));
+    m_priority_stack.push_back(THREAD_PRIORITY);
+
+    auto p_radio = std::make_unique<Radio>(*this, config.radio, sim.medium());
+    m_p_radio = p_radio.get();
+    m_periphs[SIM_PERIPH_RADIO]  = std::move(p_radio);
+    m_periphs[SIM_PERIPH_TIMER0] = std::make_unique<Timer>(*this, SIM_PERIPH_TIMER0, TIMER0_IRQn, 4);
+    m_periphs[SIM_PERIPH_TIMER1] = std::make_unique<Timer>(*this, SIM_PERIPH_TIMER1, TIMER1_IRQn, 4);
+    m_periphs[SIM_PERIPH_TIMER2] = std::make_unique<Timer>(*this, SIM_PERIPH_TIMER2, TIMER2_IRQn, 4);
+    m_periphs[SIM_PERIPH_TIMER3] = std::make_unique<Timer>(*this, SIM_PERIPH_TIMER3, TIMER3_IRQn, 6);
+    m_periphs[SIM_PERIPH_TIMER4] = std::make_unique<Timer>(*this, SIM_PERIPH_TIMER4, TIMER4_IRQn, 6);
+    m_periphs[SIM_PERIPH_RTC0]   = std::make_unique<Rtc>(*this, SIM_PERIPH_RTC0, RTC0_IRQn, false);
+    m_periphs[SIM_PERIPH_RTC1]   = std::make_unique<Rtc>(*this, SIM_PERIPH_RTC1, RTC1_IRQn, true);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        sim_periph_t id = static_cast<sim_periph_t>(SIM_PERIPH_EGU0 + i);
+        m_periphs[id] = std::make_unique<Egu>(*this, id, SWI0_EGU0_IRQn + static_cast<int32_t>(i));
+    }
+    m_periphs[SIM_PERIPH_PPI] = std::make_unique<Ppi>(*this);
+    m_p_softdevice = std::make_unique<SoftDevice>(*this, config.softdevice, sim.random());
+
+    for (auto & p_periph : m_periphs)
+    {
+        m_components.push_back(p_periph.get());
+    }
+    m_components.push_back(m_p_softdevice.get());
+    for (size_t i = 0; i < m_components.size(); i++)
+    {
+        m_components[i]->m_index = i;
+        m_next.push_back(m_components[i]->next());
+    }
+    m_next_min = *std::min_element(m_next.begin(), m_next.end());
+}
+
+Node::~Node()
+{
+    if (m_p_stack != nullptr)
+    {
+        munmap(m_p_stack, STACK_SIZE);
+    }
+}
+
+Time Node::clock_edge(uint64_t n) const
+{
+    unsigned __int128 fs = static_cast<unsigned __int128>(n) * m_clock_fs;
+    return m_clock_phase + static_cast<Time>((fs + 999) / 1000);
+}
+
+uint64_t Node::clock_edges(Time time) const
+{
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(time - m_clock_phase) * 1000 / m_clock_fs);
+}
+
+Time Node::local(Time duration) const
+{
+    return static_cast<Time>((static_cast<unsigned __int128>(duration) * m_clock_fs + CLOCK_PERIOD_FS / 2) / CLOCK_PERIOD_FS);
+}
+
+Timer & Node::timer(sim_periph_t id) const
+{
+    return static_cast<Timer &>(*m_periphs[id]);
+}
+
+uint32_t Node::bus_address(void const volatile * p_reg)
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(p_reg);
+    if (address > UINT32_MAX)
+    {
+        fatal("address %p is not on the 32-bit bus", const_cast<void const *>(p_reg));
+    }
+    return static_cast<uint32_t>(address);
+}
+
+void Node::ppi_event(uint32_t address)
+{
+    static_cast<Ppi &>(*m_periphs[SIM_PERIPH_PPI]).route(address);
+}
+
+void Node::task(uint32_t address)
+{
+    uint32_t offset = address - bus_address(m_p_space);
+
+    for (uint32_t i = 0; i < SIM_PERIPHS; i++)
+    {
+        if ((offset >= PERIPH_OFFSETS[i]) && (offset < PERIPH_OFFSETS[i] + 0x1000))
+        {
+            m_periphs[i]->task(offset - PERIPH_OFFSETS[i]);
+            return;
+        }
+    }
+    fatal("%s: PPI task 0x%08x is not simulated", name(), address);
+}
+
+void Node::reschedule(Component const & component)
+{
+    Time previous = m_next[component.m_index];
+    Time next     = component.next();
+
+    m_next[component.m_index] = next;
+    if (next < m_next_min)
+    {
+        m_next_min = next;
+    }
+    else if ((previous == m_next_min) && (next != previous))
+    {
+        m_next_min = *std::min_element(m_next.begin(), m_next.end());
+    }
+}
+
+Time Node::next_activity() const
+{
+    return m_next_min;
+}
+
+void Node::run_due()
+{
+    while (m_next_min <= m_now)
+    {
+        size_t index = static_cast<size_t>(std::find(m_next.begin(), m_next.end(), m_next_min) - m_next.begin());
+
+        m_components[index]->run();
+        m_next[index] = m_components[index]->next();
+        m_next_min    = *std::min_element(m_next.begin(), m_next.end());
+    }
+}
+
+bool Node::dispatch()
+{
+    bool ran = false;
+
+    for (;;)
+    {
+        uint64_t ready    = m_pending & m_enabled;
+        uint32_t priority = m_priority_stack.back();
+        int32_t  irq      = -1;
+
+        for (int32_t i = 0; ready != 0; i++, ready >>= 1)
+        {
+            if (!(ready & 1) || (m_priority[i] >= priority))
+            {
+                continue;
+            }
+            if ((m_critical != 0) && (m_priority[i] >= CRITICAL_PRIORITY))
+            {
+                continue;
+            }
+            irq      = i;
+            priority = m_priority[i];
+        }
+        if (irq < 0)
+        {
+            return ran;
+        }
+        call(irq);
+        ran = true;
+    }
+}
+
+void Node::call(int32_t irq)
+{
+    sync_last();
+    m_pending &= ~(1ull << irq);
+    m_priority_stack.push_back(m_priority[irq]);
+    m_exclusive = false;
+    m_sleeping  = false;
+    m_woken     = true;
+
+    advance(m_now + m_sim.config().cpu.irq_entry);
+
+    if (SoftDevice::owns(irq))
+    {
+        m_p_softdevice->interrupt(irq);
+    }
+    else if (m_firmware.vectors[irq] != nullptr)
+    {
+        m_firmware.vectors[irq]();
+    }
+    else
+    {
+        fatal("%s: interrupt %d has no handler", name(), irq);
+    }
+
+    sync_last();
+    m_priority_stack.pop_back();
+}
+
+void Node::advance(Time to)
+{
+    for (;;)
+    {
+        run_due();
+        dispatch();
+        if (m_now >= to)
+        {
+            return;
+        }
+
+        Time limit = std::min(to, m_sim.horizon(*this));
+        if (limit <= m_now)
+        {
+            yield();
+            continue;
+        }
+
+        Time next = next_activity();
+        m_now = std::min(next, limit);
+        if ((m_now == to) && (next > to) && ((m_pending & m_enabled) == 0))
+        {
+            return;
+        }
+    }
+}
+
+void Node::sync_last()
+{
+    if (m_last != SIM_PERIPHS)
+    {
+        Peripheral & periph = *m_periphs[m_last];
+
+        m_last = SIM_PERIPHS;
+        if (periph.sync())
+        {
+            reschedule(periph);
+        }
+    }
+}
+
+void Node::preempt()
+{
+    sync_last();
+    advance(m_now);
+}
+
+void * Node::access(sim_periph_t id)
+{
+    if (id >= SIM_PERIPHS)
+    {
+        fatal("%s: peripheral %d is not simulated", name(), id);
+    }
+
+    sync_last();
+    advance(m_now + m_sim.config().cpu.access);
+    m_periphs[id]->refresh();
+    m_last = id;
+    return periph_base(id);
+}
+
+void Node::delay(Time duration)
+{
+    sync_last();
+    advance(m_now + duration);
+}
+
+void Node::wait_for_event()
+{
+    sync_last();
+    m_woken    = false;
+    m_sleeping = true;
+
+    while (!m_woken)
+    {
+        run_due();
+        if (dispatch())
+        {
+            break;
+        }
+
+        Time limit = std::min(next_activity(), m_sim.horizon(*this));
+        if (limit <= m_now)
+        {
+            yield();
+            continue;
+        }
+        m_now = limit;
+    }
+    m_sleeping = false;
+}
+
+void Node::irq_enable(int32_t irq, bool enable)
+{
+    if (enable)
+    {
+        m_enabled |= 1ull << irq;
+    }
+    else
+    {
+        m_enabled &= ~(1ull << irq);
+    }
+}
+
+void Node::irq_pend(int32_t irq, bool pend)
+{
+    if (pend)
+    {
+        m_pending |= 1ull << irq;
+    }
+    else
+    {
+        m_pending &= ~(1ull << irq);
+    }
+}
+
+void Node::irq_priority_set(int32_t irq, uint32_t priority)
+{
+    m_priority[irq] = priority;
+}
+
+uint32_t Node::irq_priority_get(int32_t irq) const
+{
+    return m_priority[irq];
+}
+
+void Node::critical_enter(uint8_t * p_nested)
+{
+    *p_nested  = (m_critical != 0);
+    m_critical = 1;
+}
+
+void Node::critical_exit(uint8_t nested)
+{
+    if (!nested)
+    {
+        m_critical = 0;
+    }
+}
+
+uint32_t Node::load_exclusive(uint32_t volatile * p_addr)
+{
+    uint32_t value = *p_addr;
+
+    sync_last();
+    m_exclusive = true;
+    advance(m_now + m_sim.config().cpu.access);
+    return value;
+}
+
+uint32_t Node::store_exclusive(uint32_t value, uint32_t volatile * p_addr)
+{
+    advance(m_now + m_sim.config().cpu.access);
+    if (!m_exclusive)
+    {
+        return 1;
+    }
+    *p_addr     = value;
+    m_exclusive = false;
+    return 0;
+}
+
+Time Node::emission_bound() const
+{
+    Time start = m_p_radio->earliest_start();
+
+    /* A sleeping node with a disabled radio acts no earlier than its next activity */
+    if (m_sleeping && m_p_radio->disabled())
+    {
+        Time next = next_activity();
+        if (next == NEVER)
+        {
+            return NEVER;
+        }
+        RadioConfig const & radio = m_p_radio->config();
+        start = std::max(start, next + std::min(radio.ramp_up, radio.ramp_up_fast));
+    }
+
+    Time bound = start + m_p_radio->config().tx_chain + m_sim.medium().min_delay();
+    return std::max(bound, m_now + PS_PER_NS);
+}
+
+void Node::yield()
+{
+    m_safe_until = emission_bound();
+    m_sim.yield(*this);
+}
+
+void Node::entry(uint32_t node_low, uint32_t node_high)
+{
+    Node * p_node = reinterpret_cast<Node *>((static_cast<uintptr_t>(node_high) << 32) | node_low);
+    p_node->start();
+}
+
+void Node::start()
+{
+    m_firmware.main();
+    for (;;)
+    {
+        wait_for_event();
+    }
+}
+
+Simulator * Simulator::s_p_instance = nullptr;
+
+Simulator::Simulator(Config const & config, Medium & medium) :
+    m_config(config),
+    m_medium(medium),
+    m_random(config.seed)
+{
+    if (s_p_instance != nullptr)
+    {
+        fatal("only one simulator can run at a time");
+    }
+    s_p_instance = this;
+    m_p_space    = static_cast<uint8_t *>(map_low(MAX_NODES * SIM_PERIPH_SPACE));
+}
+
+Simulator::~Simulator()
+{
+    m_nodes.clear();
+    munmap(m_p_space, MAX_NODES * SIM_PERIPH_SPACE);
+    s_p_instance = nullptr;
+}
+
+Simulator & Simulator::instance()
+{
+    if (s_p_instance == nullptr)
+    {
+        fatal("no simulator");
+    }
+    return *s_p_instance;
+}
+
+uint64_t Simulator::random()
+{
+    /* splitmix64 */
+    uint64_t z = (m_random += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+Node & Simulator::add(sim_firmware_t const & firmware)
+{
+    uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    if (index == MAX_NODES)
+    {
+        fatal("at most %u nodes can be simulated", MAX_NODES);
+    }
+
+    auto p_node = std::make_unique<Node>(*this, firmware, index, m_p_space + index * SIM_PERIPH_SPACE);
+    Node & node = *p_node;
+
+    node.m_p_stack = map_low(STACK_SIZE);
+    getcontext(&node.m_context);
+    node.m_context.uc_stack.ss_sp   = node.m_p_stack;
+    node.m_context.uc_stack.ss_size = STACK_SIZE;
+    node.m_context.uc_link          = nullptr;
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(&node);
+    makecontext(&node.m_context, reinterpret_cast<void (*)()>(&Node::entry), 2,
+                static_cast<uint32_t>(address), static_cast<uint32_t>(address >> 32));
+
+    m_nodes.push_back(std::move(p_node));
+    for (auto const & p : m_nodes)
+    {
+        p->m_safe_until = p->emission_bound();
+    }
+    return node;
+}
+
+Node & Simulator::current() const
+{
+    if (m_p_current == nullptr)
+    {
+        fatal("no node is running");
+    }
+    return *m_p_current;
+}
+
+Time Simulator::horizon(Node const & node) const
+{
+    Time horizon = m_until;
+
+    for (auto const & p_other : m_nodes)
+    {
+        if (p_other.get() != &node)
+        {
+            horizon = std::min(horizon, p_other->m_safe_until);
+        }
+    }
+    return horizon;
+}
+
+void Simulator::yield(Node & node)
+{
+    swapcontext(&node.m_context, &m_context);
+}
+
+void Simulator::run(Time until)
+{
+    m_until = until;
+
+    for (;;)
+    {
+        auto next = std::min_element(m_nodes.begin(), m_nodes.end(),
+                                     [](auto const & a, auto const & b) { return a->m_now < b->m_now; });
+        if ((next == m_nodes.end()) || ((*next)->m_now >= until))
+        {
+            break;
+        }
+
+        m_p_current = next->get();
+        swapcontext(&m_context, &m_p_current->m_context);
+        m_p_current = nullptr;
+    }
+}
+
+} // namespace rtt::sim
+
+using rtt::sim::Node;
+using rtt::sim::Simulator;
+
+namespace {
+
+Node & node()
+{
+    return Simulator::instance().current();
+}
+
+} // namespace
+
+extern "C" {
+
+void * sim_periph(sim_periph_t periph)
+{
+    return node().access(periph);
+}
+
+void sim_delay_ns(uint64_t ns)
+{
+    node().delay(ns * rtt::sim::PS_PER_NS);
+}
+
+void sim_wait_for_event(void)
+{
+    node().wait_for_event();
+}
+
+void sim_nvic_enable(int32_t irq)
+{
+    node().sync_last();
+    node().irq_enable(irq, true);
+    node().preempt();
+}
+
+void sim_nvic_disable(int32_t irq)
+{
+    node().sync_last();
+    node().irq_enable(irq, false);
+}
+
+void sim_nvic_set_pending(int32_t irq)
+{
+    node().sync_last();
+    node().irq_pend(irq, true);
+    node().preempt();
+}
+
+void sim_nvic_clear_pending(int32_t irq)
+{
+    node().sync_last();
+    node().irq_pend(irq, false);
+}
+
+void sim_nvic_set_priority(int32_t irq, uint32_t priority)
+{
+    node().sync_last();
+    node().irq_priority_set(irq, priority);
+    node().preempt();
+}
+
+uint32_t sim_nvic_get_priority(int32_t irq)
+{
+    return node().irq_priority_get(irq);
+}
+
+void sim_critical_region_enter(uint8_t * p_nested)
+{
+    node().sync_last();
+    node().critical_enter(p_nested);
+}
+
+void sim_critical_region_exit(uint8_t nested)
+{
+    node().sync_last();
+    node().critical_exit(nested);
+    node().preempt();
+}
+
+uint32_t sim_ldrex(volatile uint32_t * p_addr)
+{
+    return node().load_exclusive(p_addr);
+}
+
+uint32_t sim_strex(uint32_t value, volatile uint32_t * p_addr)
+{
+    return node().store_exclusive(value, p_addr);
+}
+
+void sim_error(uint32_t err_code, char const * p_file, uint32_t line)
+{
+    rtt::sim::fatal("%s: error 0x%x at %s:%u, %.3f us", node().name(), err_code, p_file, line,
+                    rtt::sim::to_us(node().now()));
+}
+
+void sim_log(char const * p_format, ...)
+{
+    char    line[256];
+    va_list args;
+
+    va_start(args, p_format);
+    std::vsnprintf(line, sizeof(line), p_format, args);
+    va_end(args);
+
+    if (Simulator::instance().observer() != nullptr)
+    {
+        Simulator::instance().observer()->on_log(node(), line);
+    }
+}
+
+void sim_burst_report(sim_burst_t const * p_burst)
+{
+    if (Simulator::instance().observer() != nullptr)
+    {
+        Simulator::instance().observer()->on_burst(node(), *p_burst);
+    }
+}
+
+uint64_t sim_cycles(void)
+{
+    return __rdtsc();
+}
+
+void sim_ranging_get(sim_ranging_t * p_ranging)
+{
+    *p_ranging = Simulator::instance().config().ranging;
+}
+
+} // extern "C"
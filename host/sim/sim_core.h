@@ -0,0 +1,320 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_CORE_H__
+#define SIM_CORE_H__
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <ucontext.h>
+
+#include "sim.h"
+#include "sim_config.h"
+
+namespace rtt::sim {
+
+/**@brief Stop the simulation with an error */
+[[noreturn]] void fatal(char const * p_format, ...) __attribute__((format(printf, 1, 2)));
+
+class Node;
+class Simulator;
+class Radio;
+class Timer;
+class SoftDevice;
+class Medium;
+
+/**@brief Part of a node that acts on its own at scheduled times */
+class Component
+{
+public:
+    virtual ~Component() = default;
+
+    /**@brief Time of the next activity, NEVER if none is scheduled */
+    virtual Time next() const = 0;
+
+    /**@brief Run the activity due at the node's current time */
+    virtual void run() = 0;
+
+private:
+    size_t m_index = 0; /* Position in the node's schedule */
+
+    friend class Node;
+};
+
+/**@brief Register model of one peripheral
+ *
+ * @details The registers are plain memory that the firmware reads and writes directly. Writes
+ *          to tasks and to the set and clear registers take effect when the next access to any
+ *          peripheral goes through sim_periph(), at the time of the write.
+ */
+class Peripheral : public Component
+{
+public:
+    Peripheral(Node & node, sim_periph_t id, int32_t irq);
+
+    /**@brief Apply the register writes of the last access
+     *
+     * @return True if the writes may have moved the next activity.
+     */
+    virtual bool sync() = 0;
+
+    /**@brief Update the registers the firmware is about to read */
+    virtual void refresh() {}
+
+    /**@brief Trigger the task at a register offset, from PPI */
+    virtual void task(uint32_t offset) = 0;
+
+    Time next() const override { return NEVER; }
+    void run() override {}
+
+    sim_periph_t id() const { return m_id; }
+
+protected:
+    /**@brief Generate the event at a register offset, with its PPI channels and interrupt */
+    void event(uint32_t offset);
+
+    /**@brief Trigger the tasks written in a range of task registers
+     *
+     * @return True if a task was triggered.
+     */
+    bool sync_tasks(uint32_t first, uint32_t last);
+
+    /**@brief Apply writes to INTENSET and INTENCLR, and to INTEN if the peripheral has one */
+    void sync_inten(bool has_inten);
+
+    /**@brief Register at an offset */
+    uint32_t volatile & reg(uint32_t offset) const { return *reinterpret_cast<uint32_t volatile *>(m_p_base + offset); }
+
+    template <typename T> T volatile * regs() const { return reinterpret_cast<T volatile *>(m_p_base); }
+
+    /**@brief Schedule changed, recompute the node's next activity */
+    void reschedule();
+
+    Node &         m_node;
+    sim_periph_t   m_id;
+    int32_t        m_irq;
+    uint8_t *      m_p_base;
+    uint32_t       m_inten = 0;
+};
+
+/**@brief Exchange statistics reported by the initiator's firmware */
+class Observer
+{
+public:
+    virtual ~Observer() = default;
+
+    virtual void on_burst(Node const &, sim_burst_t const &) {}
+    virtual void on_log(Node const &, char const *) {}
+};
+
+/**@brief Interrupt priority of thread mode */
+constexpr uint32_t THREAD_PRIORITY = 256;
+
+/**@brief Interrupt line of the SoftDevice's own processing, above the ones of the device */
+constexpr int32_t SOFTDEVICE_IRQ = SIM_IRQS;
+
+/**@brief One simulated nRF52840 running a firmware image */
+class Node
+{
+public:
+    Node(Simulator & sim, sim_firmware_t const & firmware, uint32_t index, uint8_t * p_space);
+    ~Node();
+
+    Node(Node const &) = delete;
+    Node & operator=(Node const &) = delete;
+
+    char const * name() const { return m_firmware.p_name; }
+    uint32_t index() const { return m_index; }
+    Time now() const { return m_now; }
+    Simulator & sim() const { return m_sim; }
+
+    Radio &      radio() const { return *m_p_radio; }
+    Timer &      timer(sim_periph_t id) const;
+    SoftDevice & softdevice() const { return *m_p_softdevice; }
+
+    /* Firmware side, called through the C interface */
+    void * access(sim_periph_t id);
+    void delay(Time duration);
+    void wait_for_event();
+
+    /**@brief Apply the side effects of the last register access */
+    void sync_last();
+
+    /**@brief Let pending interrupts preempt the running code, after an NVIC or critical region change */
+    void preempt();
+
+    /* Interrupt controller. Hardware pends interrupts, the firmware calls preempt() after a change. */
+    void irq_enable(int32_t irq, bool enable);
+    void irq_pend(int32_t irq, bool pend);
+    void irq_priority_set(int32_t irq, uint32_t priority);
+    uint32_t irq_priority_get(int32_t irq) const;
+    void critical_enter(uint8_t * p_nested);
+    void critical_exit(uint8_t nested);
+    uint32_t priority() const { return m_priority_stack.back(); }
+
+    /* Exclusive monitor */
+    uint32_t load_exclusive(uint32_t volatile * p_addr);
+    uint32_t store_exclusive(uint32_t value, uint32_t volatile * p_addr);
+
+    /* Hardware side */
+    uint8_t * periph_base(sim_periph_t id) const { return m_p_space + PERIPH_OFFSETS[id]; }
+    Peripheral & periph(sim_periph_t id) const { return *m_periphs[id]; }
+
+    /**@brief 32-bit bus address of a register, as the firmware writes it to PPI */
+    static uint32_t bus_address(void const volatile * p_reg);
+
+    /**@brief An event register was set: trigger the tasks of the PPI channels connected to it */
+    void ppi_event(uint32_t address);
+
+    /**@brief Trigger the task at a bus address */
+    void task(uint32_t address);
+
+    /**@brief The next activity of a component may have changed */
+    void reschedule(Component const & component);
+
+    /**@brief Earliest time the node's transmissions can reach other nodes, see Simulator */
+    Time safe_until() const { return m_safe_until; }
+
+    /**@brief Phase of the 16 MHz clock the peripherals count */
+    Time clock_phase() const { return m_clock_phase; }
+
+    /**@brief Time of edge n of the 16 MHz clock, edge 0 at clock_phase() */
+    Time clock_edge(uint64_t n) const;
+
+    /**@brief Last edge of the 16 MHz clock at or before a time no earlier than clock_phase() */
+    uint64_t clock_edges(Time time) const;
+
+    /**@brief Time the node's crystal takes for a duration it counts as nominal */
+    Time local(Time duration) const;
+
+    /**@brief Start the firmware. Runs in the node's own context. */
+    void start();
+
+private:
+    static constexpr uint32_t PERIPH_OFFSETS[SIM_PERIPHS] = SIM_PERIPH_OFFSETS;
+
+    static void entry(uint32_t node_low, uint32_t node_high);
+
+    void advance(Time to);
+    void run_due();
+    bool dispatch();
+    Time next_activity() const;
+    void yield();
+    void call(int32_t irq);
+    Time emission_bound() const;
+
+    Simulator &                  m_sim;
+    sim_firmware_t const &       m_firmware;
+    uint32_t                     m_index;
+    uint8_t *                    m_p_space;
+    Time                         m_now          = 0;
+    Time                         m_clock_phase  = 0;
+    uint64_t                     m_clock_fs     = 0;   /* Period of the 16 MHz clock in fs */
+    Time                         m_safe_until   = 0;
+    bool                         m_sleeping     = false;
+    bool                         m_woken        = false;
+    bool                         m_exclusive    = false;
+    sim_periph_t                 m_last         = SIM_PERIPHS; /* Peripheral accessed last, not synced */
+
+    std::array<std::unique_ptr<Peripheral>, SIM_PERIPHS> m_periphs;
+    Radio *                      m_p_radio;
+    std::unique_ptr<SoftDevice>  m_p_softdevice;
+    std::vector<Component *>     m_components;
+    std::vector<Time>            m_next;        /* Next activity of each component */
+    Time                         m_next_min     = NEVER;
+
+    /* Interrupt controller */
+    uint64_t                     m_enabled      = 0;
+    uint64_t                     m_pending      = 0;
+    std::array<uint32_t, SIM_IRQS + 1> m_priority = {};
+    std::vector<uint32_t>        m_priority_stack;
+    uint32_t                     m_critical     = 0;
+
+    ucontext_t                   m_context;
+    void *                       m_p_stack      = nullptr;
+
+    friend class Simulator;
+};
+
+/**@brief Runs the nodes in lockstep
+ *
+ * @details Each node runs in its own context until its clock would pass the horizon: the
+ *          earliest time at which another node could still put a packet on the air that
+ *          reaches it. A node is always resumed with the lowest clock, so a packet is never
+ *          delivered to a node whose clock has already passed its arrival. The horizon follows
+ *          from the radio state: a disabled radio takes at least its ramp-up time to transmit.
+ */
+class Simulator
+{
+public:
+    Simulator(Config const & config, Medium & medium);
+    ~Simulator();
+
+    /**@brief Add a node. The node runs its firmware from the first call to run(). */
+    Node & add(sim_firmware_t const & firmware);
+
+    /**@brief Run all nodes until the given time */
+    void run(Time until);
+
+    void observer_set(Observer * p_observer) { m_p_observer = p_observer; }
+    Observer * observer() const { return m_p_observer; }
+
+    Config const & config() const { return m_config; }
+    Medium & medium() const { return m_medium; }
+    std::vector<std::unique_ptr<Node>> const & nodes() const { return m_nodes; }
+
+    /**@brief Node running now */
+    Node & current() const;
+
+    /**@brief Time up to which a node may run */
+    Time horizon(Node const & node) const;
+
+    /**@brief Give control back to the scheduler */
+    void yield(Node & node);
+
+    /**@brief Simulator of the running process */
+    static Simulator & instance();
+
+    /**@brief Random numbers for the node setup, reproducible from the seed */
+    uint64_t random();
+
+private:
+    Config                             m_config;
+    Medium &                           m_medium;
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    Node *                             m_p_current  = nullptr;
+    Observer *                         m_p_observer = nullptr;
+    Time                               m_until      = 0;
+    ucontext_t                         m_context;
+    uint8_t *                          m_p_space    = nullptr;
+    uint64_t                           m_random;
+
+    static Simulator *                 s_p_instance;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_CORE_H__
@@ -0,0 +1,115 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_medium.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "sim_radio.h"
+
+namespace rtt::sim {
+
+namespace {
+
+constexpr double SPEED_OF_LIGHT   = 299792458.0;
+
+} // namespace
+
+Medium::Medium(MediumConfig const & config, Channel & channel) :
+    m_config(config),
+    m_channel(channel)
+{
+}
+
+double Medium::distance(Time time) const
+{
+    double span = std::fabs(m_config.distance_to_m - m_config.distance_m);
+
+    if ((m_config.distance_to_m < 0.0) || (m_config.speed_mps <= 0.0) || (span == 0.0))
+    {
+        return m_config.distance_m;
+    }
+
+    /* Back and forth between the two distances */
+    double travelled = std::fmod(m_config.speed_mps * static_cast<double>(time) / PS_PER_S, 2.0 * span);
+    double offset    = (travelled <= span) ? travelled : 2.0 * span - travelled;
+    return m_config.distance_m + std::copysign(offset, m_config.distance_to_m - m_config.distance_m);
+}
+
+double Medium::range(Time time) const
+{
+    if (m_config.delay_ns >= 0.0)
+    {
+        return m_config.delay_ns * 1e-9 * SPEED_OF_LIGHT;
+    }
+    return distance(time);
+}
+
+Time Medium::delay(double distance_m) const
+{
+    if (m_config.delay_ns >= 0.0)
+    {
+        return from_ns(m_config.delay_ns);
+    }
+    return static_cast<Time>(distance_m / SPEED_OF_LIGHT * PS_PER_S + 0.5);
+}
+
+Time Medium::min_delay() const
+{
+    double distance_m = m_config.distance_m;
+
+    if ((m_config.distance_to_m >= 0.0) && (m_config.speed_mps > 0.0))
+    {
+        distance_m = std::min(distance_m, m_config.distance_to_m);
+    }
+    return (m_radios.size() < 2) ? 0 : delay(distance_m);
+}
+
+void Medium::transmit(std::shared_ptr<Transmission const> const & p_transmission)
+{
+    Radio const & source = *p_transmission->p_source;
+
+    for (Radio * p_radio : m_radios)
+    {
+        if (p_radio == &source)
+        {
+            continue;
+        }
+
+        double    distance = this->distance(p_transmission->start);
+        Path      path     = m_channel.propagate(*p_transmission, distance);
+        Reception reception;
+
+        reception.p_transmission = p_transmission;
+        reception.arrival        = p_transmission->start + delay(distance);
+        reception.offset         = path.offset;
+        reception.lost           = path.lost;
+        reception.corrupt        = path.corrupt;
+        reception.rssi_dbm       = static_cast<int32_t>(std::lround(path.rssi_dbm));
+        p_radio->receive(reception);
+    }
+}
+
+} // namespace rtt::sim
@@ -0,0 +1,77 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_MEDIUM_H__
+#define SIM_MEDIUM_H__
+
+#include <memory>
+#include <vector>
+
+#include "sim_channel.h"
+#include "sim_config.h"
+
+namespace rtt::sim {
+
+class Radio;
+struct Transmission;
+
+/**@brief Virtual air between the radios of all nodes
+ *
+ * @details Delivers each packet to every other radio after the line of sight propagation
+ *          delay. What else happens to it on the way to each receiver is up to the channel,
+ *          and is drawn when the packet is sent.
+ */
+class Medium
+{
+public:
+    Medium(MediumConfig const & config, Channel & channel);
+
+    void attach(Radio & radio) { m_radios.push_back(&radio); }
+
+    /**@brief Put a packet on the air */
+    void transmit(std::shared_ptr<Transmission const> const & p_transmission);
+
+    /**@brief Line of sight propagation delay over a distance */
+    Time delay(double distance_m) const;
+
+    /**@brief Shortest propagation delay between any two radios at any time */
+    Time min_delay() const;
+
+    /**@brief Distance between the nodes at a time */
+    double distance(Time time) const;
+
+    /**@brief Distance the propagation delay at a time stands for, what ranging should measure */
+    double range(Time time) const;
+
+    MediumConfig const & config() const { return m_config; }
+
+private:
+    MediumConfig                    m_config;
+    Channel &                       m_channel;
+    std::vector<Radio *>            m_radios;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_MEDIUM_H__
@@ -0,0 +1,144 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rtt_parameters.h"
+#include "sim_medium.h"
+#include "sim_radio.h"
+#include "sim_softdevice.h"
+
+namespace rtt::sim {
+
+void Metrics::on_burst(Node const & node, sim_burst_t const & burst)
+{
+    m_sums.bursts++;
+    m_sums.exchanges  += burst.exchanges;
+    m_sums.valid      += burst.valid;
+    m_sums.crc_errors += burst.rx_crc_error;
+    m_sums.ignored    += burst.rx_ignored;
+    m_sums.timeouts   += burst.rx_timeouts;
+
+    if (burst.single_shot)
+    {
+        m_sums.single_shots++;
+        m_sum_request += burst.request_us;
+        m_sums.single_shot_max_us = std::max(m_sums.single_shot_max_us, static_cast<double>(burst.request_us));
+    }
+
+    if (std::isnan(burst.distance_m))
+    {
+        return;
+    }
+
+    Time   now     = node.now();
+    double range   = node.sim().medium().range(now);
+    double error   = burst.distance_m - range;
+    double latency = to_us(now - std::min(now, node.radio().rx_end()));
+
+    m_sums.estimates++;
+    m_sum_range   += range;
+    m_sum_error   += error;
+    m_sum_error_2 += error * error;
+    m_sum_latency += latency;
+    m_sums.latency_max_us = std::max(m_sums.latency_max_us, latency);
+    m_cycles = std::min(m_cycles, burst.estimator_cycles);
+}
+
+Results Metrics::results(Simulator const & sim, double seconds) const
+{
+    Results results = m_sums;
+
+    results.seconds         = seconds;
+    results.exchanges_per_s = (seconds > 0.0) ? results.exchanges / seconds : 0.0;
+    results.valid_ratio     = (results.exchanges != 0) ? static_cast<double>(results.valid) / results.exchanges : 0.0;
+    results.single_shot_us  = (results.single_shots != 0) ? m_sum_request / results.single_shots : 0.0;
+
+    if (results.estimates != 0)
+    {
+        double n = results.estimates;
+
+        results.range_m    = m_sum_range / n;
+        results.bias_m     = m_sum_error / n;
+        results.mean_m     = results.range_m + results.bias_m;
+        results.std_m      = std::sqrt(std::max(0.0, m_sum_error_2 / n - results.bias_m * results.bias_m));
+        results.latency_us = m_sum_latency / n;
+        results.estimator_cycles = static_cast<double>(m_cycles);
+    }
+
+    for (auto const & p_node : sim.nodes())
+    {
+        TimeslotStats stats = p_node->softdevice().stats();
+        NodeResults   node;
+
+        node.name              = p_node->name();
+        node.slot_utilisation  = (seconds > 0.0) ? to_us(stats.slot_time) / (seconds * 1e6) : 0.0;
+        node.extension_success = (stats.extensions != 0) ?
+                                 1.0 - static_cast<double>(stats.extensions_failed) / stats.extensions : 1.0;
+        node.blocked           = stats.blocked + stats.canceled;
+        node.radio_duty        = (seconds > 0.0) ? to_us(p_node->radio().active_time()) / (seconds * 1e6) : 0.0;
+        node.hfxo_duty         = (seconds > 0.0) ? to_us(stats.hfxo_time) / (seconds * 1e6) : 0.0;
+        node.current_ua        = node.slot_utilisation * POWER_CPU_UA + node.hfxo_duty * POWER_HFXO_UA +
+                                 node.radio_duty * POWER_RADIO_UA;
+        results.nodes.push_back(node);
+    }
+    return results;
+}
+
+void results_write_json(FILE * p_file, char const * p_name, Results const & results)
+{
+    std::fprintf(p_file, "{\"name\": \"%s\"", p_name);
+    std::fprintf(p_file, ", \"simulated_s\": %.3f", results.seconds);
+    std::fprintf(p_file, ", \"bursts\": %u", results.bursts);
+    std::fprintf(p_file, ", \"exchanges\": %u", results.exchanges);
+    std::fprintf(p_file, ", \"exchanges_per_s\": %.2f", results.exchanges_per_s);
+    std::fprintf(p_file, ", \"valid_ratio\": %.4f", results.valid_ratio);
+    std::fprintf(p_file, ", \"crc_errors\": %u", results.crc_errors);
+    std::fprintf(p_file, ", \"timeouts\": %u", results.timeouts);
+    std::fprintf(p_file, ", \"estimates\": %u", results.estimates);
+    std::fprintf(p_file, ", \"range_m\": %.3f", results.range_m);
+    std::fprintf(p_file, ", \"bias_m\": %.3f", results.bias_m);
+    std::fprintf(p_file, ", \"std_m\": %.3f", results.std_m);
+    std::fprintf(p_file, ", \"latency_us\": %.1f", results.latency_us);
+    std::fprintf(p_file, ", \"latency_max_us\": %.1f", results.latency_max_us);
+    std::fprintf(p_file, ", \"estimator_cycles\": %.0f", results.estimator_cycles);
+    std::fprintf(p_file, ", \"single_shots\": %u", results.single_shots);
+    std::fprintf(p_file, ", \"single_shot_us\": %.1f", results.single_shot_us);
+    std::fprintf(p_file, ", \"single_shot_max_us\": %.1f", results.single_shot_max_us);
+    for (NodeResults const & node : results.nodes)
+    {
+        std::fprintf(p_file, ", \"%s_slot_utilisation\": %.4f", node.name.c_str(), node.slot_utilisation);
+        std::fprintf(p_file, ", \"%s_extension_success\": %.4f", node.name.c_str(), node.extension_success);
+        std::fprintf(p_file, ", \"%s_blocked\": %u", node.name.c_str(), node.blocked);
+        std::fprintf(p_file, ", \"%s_radio_duty\": %.4f", node.name.c_str(), node.radio_duty);
+        std::fprintf(p_file, ", \"%s_hfxo_duty\": %.4f", node.name.c_str(), node.hfxo_duty);
+        std::fprintf(p_file, ", \"%s_current_ua\": %.1f", node.name.c_str(), node.current_ua);
+    }
+    std::fputc('}', p_file);
+}
+
+} // namespace rtt::sim
@@ -0,0 +1,108 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_METRICS_H__
+#define SIM_METRICS_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sim_core.h"
+
+namespace rtt::sim {
+
+/**@brief Timeslot use and power of one node over a run
+ *
+ * @details The current is estimated as the firmware does, from the POWER_* figures in
+ *          rtt_parameters.h: the CPU busy in the timeslots, the HFXO while it runs and the
+ *          radio while it is out of DISABLED. The sleep current is left out.
+ */
+struct NodeResults
+{
+    std::string name;
+    double      slot_utilisation;  /**< Share of the time in timeslots. */
+    double      extension_success; /**< Share of the extensions granted, 1 without extensions. */
+    uint32_t    blocked;           /**< Requests blocked or canceled. */
+    double      radio_duty;        /**< Share of the time the radio was active. */
+    double      hfxo_duty;         /**< Share of the time the HFXO ran. */
+    double      current_ua;        /**< Mean current of the ranging. */
+};
+
+/**@brief Figures of one run, as the benchmark tracks them */
+struct Results
+{
+    double   seconds           = 0.0;
+    uint32_t bursts            = 0;
+    uint32_t exchanges         = 0;
+    uint32_t valid             = 0;
+    uint32_t crc_errors        = 0;
+    uint32_t ignored           = 0;
+    uint32_t timeouts          = 0;
+    uint32_t estimates         = 0; /**< Bursts with a distance estimate. */
+    double   exchanges_per_s   = 0.0;
+    double   valid_ratio       = 0.0;
+    double   range_m           = 0.0; /**< Mean true distance at the estimates. */
+    double   mean_m            = 0.0; /**< Mean estimate. */
+    double   bias_m            = 0.0; /**< Mean error of the estimates. */
+    double   std_m             = 0.0; /**< Standard deviation of the error. */
+    double   latency_us        = 0.0; /**< Mean time from the last response of a burst to its estimate. */
+    double   latency_max_us    = 0.0;
+    double   estimator_cycles  = 0.0; /**< Fewest host CPU cycles calc_dist() took, the least noisy. */
+    uint32_t single_shots      = 0;   /**< Bursts run for a single-shot request. */
+    double   single_shot_us    = 0.0; /**< Mean time from a single-shot request to its result, as the initiator measured it. */
+    double   single_shot_max_us = 0.0;
+    std::vector<NodeResults> nodes;
+};
+
+/**@brief Collects the bursts of a run and sums them up
+ *
+ * @details The error of each estimate is taken against the range of the medium when the
+ *          estimate is reported, so a moving node is measured against where it is.
+ */
+class Metrics : public Observer
+{
+public:
+    void on_burst(Node const & node, sim_burst_t const & burst) override;
+
+    /**@brief Sum up the run so far */
+    Results results(Simulator const & sim, double seconds) const;
+
+private:
+    Results               m_sums;
+    double                m_sum_range   = 0.0;
+    double                m_sum_error   = 0.0;
+    double                m_sum_error_2 = 0.0;
+    double                m_sum_latency = 0.0;
+    double                m_sum_request = 0.0;
+    uint64_t              m_cycles      = UINT64_MAX;
+};
+
+/**@brief Write the results of a run as one JSON object with flat fields */
+void results_write_json(FILE * p_file, char const * p_name, Results const & results);
+
+} // namespace rtt::sim
+
+#endif // SIM_METRICS_H__
@@ -0,0 +1,509 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_peripherals.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "nrf.h"
+
+namespace rtt::sim {
+
+namespace {
+
+constexpr Time LFCLK_RATE   = 32768;
+
+constexpr uint32_t TIMER_START    = 0x000;
+constexpr uint32_t TIMER_STOP     = 0x004;
+constexpr uint32_t TIMER_COUNT    = 0x008;
+constexpr uint32_t TIMER_CLEAR    = 0x00C;
+constexpr uint32_t TIMER_SHUTDOWN = 0x010;
+constexpr uint32_t TIMER_CAPTURE  = 0x040;
+constexpr uint32_t TIMER_COMPARE  = 0x140;
+
+constexpr uint32_t RTC_START      = 0x000;
+constexpr uint32_t RTC_STOP       = 0x004;
+constexpr uint32_t RTC_CLEAR      = 0x008;
+constexpr uint32_t RTC_COMPARE    = 0x140;
+constexpr uint32_t RTC_COMPARES   = 4;
+
+constexpr uint32_t PPI_CHEN       = 0x500;
+constexpr uint32_t PPI_CHENSET    = 0x504;
+constexpr uint32_t PPI_CHENCLR    = 0x508;
+constexpr uint32_t PPI_CHANNELS   = 20;
+constexpr uint32_t PPI_GROUPS     = 6;
+
+} // namespace
+
+Timer::Timer(Node & node, sim_periph_t id, int32_t irq, uint32_t compares) :
+    Peripheral(node, id, irq),
+    m_compares(compares)
+{
+}
+
+bool Timer::sync()
+{
+    NRF_TIMER_Type volatile * p_regs = regs<NRF_TIMER_Type>();
+    bool changed = sync_tasks(TIMER_START, TIMER_SHUTDOWN);
+
+    changed |= sync_tasks(TIMER_CAPTURE, TIMER_CAPTURE + 4 * (m_compares - 1));
+    sync_inten(false);
+
+    /* The compare registers and the mode move the next compare event */
+    for (uint32_t i = 0; i < m_compares; i++)
+    {
+        if (p_regs->CC[i] != m_cc[i])
+        {
+            m_cc[i] = p_regs->CC[i];
+            changed = true;
+        }
+    }
+    if (p_regs->MODE != m_mode)
+    {
+        m_mode  = p_regs->MODE;
+        changed = true;
+    }
+    return changed;
+}
+
+void Timer::task(uint32_t offset)
+{
+    NRF_TIMER_Type volatile * p_regs = regs<NRF_TIMER_Type>();
+
+    switch (offset)
+    {
+        case TIMER_START:
+            start();
+            break;
+
+        case TIMER_STOP:
+            stop();
+            break;
+
+        case TIMER_SHUTDOWN:
+            stop();
+            m_base = 0;
+            break;
+
+        case TIMER_CLEAR:
+            m_checked = increments(m_node.now());
+            m_base    = -static_cast<uint32_t>(m_checked);
+            break;
+
+        case TIMER_COUNT:
+            if (m_running && p_regs->MODE != TIMER_MODE_MODE_Timer)
+            {
+                m_base++;
+                for (uint32_t i = 0; i < m_compares; i++)
+                {
+                    if (value() == (p_regs->CC[i] & m_mask))
+                    {
+                        compare(i);
+                    }
+                }
+            }
+            break;
+
+        default:
+            if (offset >= TIMER_CAPTURE && offset < TIMER_CAPTURE + 4 * m_compares)
+            {
+                p_regs->CC[(offset - TIMER_CAPTURE) / 4] = value();
+            }
+            break;
+    }
+    reschedule();
+}
+
+uint64_t Timer::increments(Time time) const
+{
+    if (!m_running || regs<NRF_TIMER_Type>()->MODE != TIMER_MODE_MODE_Timer || time < m_first)
+    {
+        return m_checked;
+    }
+    return (m_node.clock_edges(time) - m_edge) / m_divider + 1;
+}
+
+Time Timer::increment_time(uint64_t n) const
+{
+    return m_node.clock_edge(m_edge + (n - 1) * m_divider);
+}
+
+uint32_t Timer::value() const
+{
+    return (m_base + static_cast<uint32_t>(increments(m_node.now()))) & m_mask;
+}
+
+uint64_t Timer::compare_index(uint32_t cc) const
+{
+    uint32_t next = m_base + static_cast<uint32_t>(m_checked) + 1;
+    return m_checked + 1 + ((regs<NRF_TIMER_Type>()->CC[cc] - next) & m_mask);
+}
+
+Time Timer::next() const
+{
+    if (!m_running || regs<NRF_TIMER_Type>()->MODE != TIMER_MODE_MODE_Timer)
+    {
+        return NEVER;
+    }
+
+    Time next = NEVER;
+    for (uint32_t i = 0; i < m_compares; i++)
+    {
+        next = std::min(next, increment_time(compare_index(i)));
+    }
+    return next;
+}
+
+void Timer::run()
+{
+    if (!m_running || regs<NRF_TIMER_Type>()->MODE != TIMER_MODE_MODE_Timer)
+    {
+        return;
+    }
+
+    uint64_t reached = increments(m_node.now());
+    while (m_running && m_checked < reached)
+    {
+        uint64_t first = UINT64_MAX;
+        for (uint32_t i = 0; i < m_compares; i++)
+        {
+            first = std::min(first, compare_index(i));
+        }
+        if (first > reached)
+        {
+            break;
+        }
+
+        uint64_t matched = 0;
+        for (uint32_t i = 0; i < m_compares; i++)
+        {
+            if (compare_index(i) == first)
+            {
+                matched |= 1u << i;
+            }
+        }
+        m_checked = first;
+        for (uint32_t i = 0; i < m_compares; i++)
+        {
+            if (matched & (1u << i))
+            {
+                compare(i);
+            }
+        }
+    }
+    if (m_running)
+    {
+        m_checked = reached;
+    }
+}
+
+void Timer::compare(uint32_t cc)
+{
+    event(TIMER_COMPARE + 4 * cc);
+
+    uint32_t shorts = regs<NRF_TIMER_Type>()->SHORTS;
+    if (shorts & (1u << (TIMER_SHORTS_COMPARE0_CLEAR_Pos + cc)))
+    {
+        m_base = -static_cast<uint32_t>(m_checked);
+    }
+    if (shorts & (1u << (TIMER_SHORTS_COMPARE0_STOP_Pos + cc)))
+    {
+        stop();
+    }
+}
+
+void Timer::start()
+{
+    if (m_running)
+    {
+        return;
+    }
+
+    NRF_TIMER_Type volatile * p_regs = regs<NRF_TIMER_Type>();
+    static constexpr uint32_t masks[] = {0xFFFF, 0xFF, 0xFFFFFF, 0xFFFFFFFF};
+
+    m_mask    = masks[p_regs->BITMODE & TIMER_BITMODE_BITMODE_Msk];
+    m_divider = uint64_t(1) << std::min<uint32_t>(p_regs->PRESCALER & TIMER_PRESCALER_PRESCALER_Msk, 9);
+    m_running = true;
+    m_checked = 0;
+
+    /* The first increment is on the clock edge a full period after the first edge. */
+    Time     now  = m_node.now();
+    uint64_t edge = (now < m_node.clock_phase()) ? 0 : m_node.clock_edges(now) + 1;
+    m_edge        = edge + m_divider - 1;
+    m_first       = m_node.clock_edge(m_edge);
+}
+
+void Timer::stop()
+{
+    if (m_running)
+    {
+        m_base    = value();
+        m_checked = 0;
+        m_running = false;
+    }
+}
+
+void Timer::reset()
+{
+    stop();
+    m_base = 0;
+
+    NRF_TIMER_Type volatile * p_regs = regs<NRF_TIMER_Type>();
+    for (uint32_t i = 0; i < m_compares; i++)
+    {
+        p_regs->EVENTS_COMPARE[i] = 0;
+        p_regs->CC[i]             = 0;
+        m_cc[i]                   = 0;
+    }
+    m_mode            = TIMER_MODE_MODE_Timer;
+    p_regs->SHORTS    = 0;
+    p_regs->MODE      = TIMER_MODE_MODE_Timer;
+    p_regs->BITMODE   = TIMER_BITMODE_BITMODE_16Bit;
+    p_regs->PRESCALER = 4;
+    m_inten           = 0;
+    p_regs->INTENSET  = 0;
+    p_regs->INTENCLR  = 0;
+    reschedule();
+}
+
+void Timer::start_1mhz()
+{
+    NRF_TIMER_Type volatile * p_regs = regs<NRF_TIMER_Type>();
+
+    p_regs->BITMODE   = TIMER_BITMODE_BITMODE_32Bit;
+    p_regs->PRESCALER = 4;
+    start();
+    reschedule();
+}
+
+Rtc::Rtc(Node & node, sim_periph_t id, int32_t irq, bool running) :
+    Peripheral(node, id, irq),
+    m_running(running),
+    m_offset(node.sim().random() % (PS_PER_S / LFCLK_RATE))
+{
+}
+
+uint64_t Rtc::ticks() const
+{
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(m_node.now() + m_offset) * LFCLK_RATE) / PS_PER_S);
+}
+
+uint64_t Rtc::increments() const
+{
+    if (!m_running)
+    {
+        return m_checked;
+    }
+    return (ticks() - m_started) / ((regs<NRF_RTC_Type>()->PRESCALER & 0xFFF) + 1);
+}
+
+Time Rtc::increment_time(uint64_t n) const
+{
+    uint64_t tick = m_started + n * ((regs<NRF_RTC_Type>()->PRESCALER & 0xFFF) + 1);
+    return static_cast<Time>((static_cast<unsigned __int128>(tick) * PS_PER_S + LFCLK_RATE - 1) / LFCLK_RATE) - m_offset;
+}
+
+uint64_t Rtc::compare_index(uint32_t cc) const
+{
+    uint32_t next = m_base + static_cast<uint32_t>(m_checked) + 1;
+    return m_checked + 1 + ((regs<NRF_RTC_Type>()->CC[cc] - next) & RTC_COUNTER_COUNTER_Msk);
+}
+
+bool Rtc::sync()
+{
+    NRF_RTC_Type volatile * p_regs = regs<NRF_RTC_Type>();
+    uint32_t inten   = m_inten;
+    bool     changed;
+
+    /* The compares due have run, a compare set now matches from the next increment */
+    m_checked = increments();
+    sync_inten(false);
+    changed = sync_tasks(RTC_START, RTC_CLEAR) || (m_inten != inten);
+
+    /* The compare registers move the next compare event */
+    for (uint32_t i = 0; i < RTC_COMPARES; i++)
+    {
+        if (p_regs->CC[i] != m_cc[i])
+        {
+            m_cc[i] = p_regs->CC[i];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+Time Rtc::next() const
+{
+    Time next = NEVER;
+
+    for (uint32_t i = 0; m_running && (i < RTC_COMPARES); i++)
+    {
+        if (m_inten & (1u << (RTC_INTENSET_COMPARE0_Pos + i)))
+        {
+            next = std::min(next, increment_time(compare_index(i)));
+        }
+    }
+    return next;
+}
+
+void Rtc::run()
+{
+    uint64_t reached = increments();
+
+    for (uint32_t i = 0; m_running && (i < RTC_COMPARES); i++)
+    {
+        if ((m_inten & (1u << (RTC_INTENSET_COMPARE0_Pos + i))) && (compare_index(i) <= reached))
+        {
+            event(RTC_COMPARE + 4 * i);
+        }
+    }
+    m_checked = reached;
+}
+
+void Rtc::refresh()
+{
+    NRF_RTC_Type volatile * p_regs = regs<NRF_RTC_Type>();
+    uint32_t counter = m_base;
+
+    if (m_running)
+    {
+        counter += static_cast<uint32_t>((ticks() - m_started) / ((p_regs->PRESCALER & 0xFFF) + 1));
+    }
+    reg(offsetof(NRF_RTC_Type, COUNTER)) = counter & RTC_COUNTER_COUNTER_Msk;
+}
+
+void Rtc::task(uint32_t offset)
+{
+    switch (offset)
+    {
+        case RTC_START:
+            if (!m_running)
+            {
+                m_running = true;
+                m_started = ticks();
+                m_checked = 0;
+            }
+            break;
+
+        case RTC_STOP:
+            refresh();
+            m_base    = reg(offsetof(NRF_RTC_Type, COUNTER));
+            m_running = false;
+            m_checked = 0;
+            break;
+
+        case RTC_CLEAR:
+            m_base    = 0;
+            m_started = ticks();
+            m_checked = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+Egu::Egu(Node & node, sim_periph_t id, int32_t irq) :
+    Peripheral(node, id, irq)
+{
+}
+
+bool Egu::sync()
+{
+    sync_inten(true);
+    return sync_tasks(0x000, 0x03C);
+}
+
+void Egu::task(uint32_t offset)
+{
+    event(0x100 + offset);
+}
+
+Ppi::Ppi(Node & node) :
+    Peripheral(node, SIM_PERIPH_PPI, -1)
+{
+}
+
+bool Ppi::sync()
+{
+    sync_tasks(0x000, 8 * PPI_GROUPS - 4);
+
+    if (reg(PPI_CHEN) != m_chen)
+    {
+        m_chen = reg(PPI_CHEN);
+    }
+    if (reg(PPI_CHENSET) != m_chen)
+    {
+        m_chen |= reg(PPI_CHENSET);
+    }
+    m_chen &= ~reg(PPI_CHENCLR);
+    shadow();
+    return false;
+}
+
+void Ppi::shadow()
+{
+    reg(PPI_CHEN)    = m_chen;
+    reg(PPI_CHENSET) = m_chen;
+    reg(PPI_CHENCLR) = 0;
+}
+
+void Ppi::task(uint32_t offset)
+{
+    uint32_t group = regs<NRF_PPI_Type>()->CHG[offset / 8];
+
+    if (offset % 8 == 0)
+    {
+        m_chen |= group;
+    }
+    else
+    {
+        m_chen &= ~group;
+    }
+    shadow();
+}
+
+void Ppi::route(uint32_t event_address)
+{
+    NRF_PPI_Type volatile * p_regs = regs<NRF_PPI_Type>();
+
+    for (uint32_t i = 0; i < PPI_CHANNELS; i++)
+    {
+        if ((m_chen & (1u << i)) && p_regs->CH[i].EEP == event_address)
+        {
+            if (p_regs->CH[i].TEP != 0)
+            {
+                m_node.task(p_regs->CH[i].TEP);
+            }
+            if (p_regs->FORK[i].TEP != 0)
+            {
+                m_node.task(p_regs->FORK[i].TEP);
+            }
+        }
+    }
+}
+
+} // namespace rtt::sim
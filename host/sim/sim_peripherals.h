@@ -0,0 +1,136 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_PERIPHERALS_H__
+#define SIM_PERIPHERALS_H__
+
+#include <cstdint>
+
+#include "sim_core.h"
+
+namespace rtt::sim {
+
+/**@brief TIMER, in timer and counter mode
+ *
+ * @details The counter is not stored: its value follows from the time of START, counting the
+ *          edges of the node's 16 MHz clock divided by the prescaler. PRESCALER and BITMODE are
+ *          sampled at START.
+ */
+class Timer : public Peripheral
+{
+public:
+    Timer(Node & node, sim_periph_t id, int32_t irq, uint32_t compares);
+
+    bool sync() override;
+    void task(uint32_t offset) override;
+    Time next() const override;
+    void run() override;
+
+    /**@brief Stop and reset the registers, as the SoftDevice does before a timeslot */
+    void reset();
+
+    /**@brief Start at 1 MHz in 32 bit mode */
+    void start_1mhz();
+
+private:
+    uint64_t increments(Time time) const;
+    Time increment_time(uint64_t n) const;
+    uint32_t value() const;
+    uint64_t compare_index(uint32_t cc) const;
+    void compare(uint32_t cc);
+    void start();
+    void stop();
+
+    uint32_t m_compares;
+    uint32_t m_cc[6]   = {};
+    uint32_t m_mode    = 0;
+    bool     m_running = false;
+    uint32_t m_mask    = 0xFFFF;
+    uint64_t m_divider = 1;  /* Clock edges between increments */
+    uint64_t m_edge    = 0;  /* Clock edge of the first increment after START */
+    Time     m_first   = 0;  /* Time of that edge */
+    uint32_t m_base    = 0;  /* Counter value at START, less the increments skipped by CLEAR */
+    uint64_t m_checked = 0;  /* Increments compared */
+};
+
+/**@brief RTC, counting the node's 32.768 kHz clock
+ *
+ * @details Only the compare events with their interrupt enabled are generated.
+ */
+class Rtc : public Peripheral
+{
+public:
+    Rtc(Node & node, sim_periph_t id, int32_t irq, bool running);
+
+    bool sync() override;
+    void refresh() override;
+    void task(uint32_t offset) override;
+    Time next() const override;
+    void run() override;
+
+private:
+    uint64_t ticks() const;
+    uint64_t increments() const;
+    Time increment_time(uint64_t n) const;
+    uint64_t compare_index(uint32_t cc) const;
+
+    bool     m_running;
+    uint64_t m_started = 0;  /* Clock ticks at START */
+    uint32_t m_base    = 0;  /* Counter value at START */
+    Time     m_offset;       /* Phase of the clock */
+    uint32_t m_cc[4]   = {};
+    uint64_t m_checked = 0;  /* Increments compared */
+};
+
+/**@brief Event generator unit */
+class Egu : public Peripheral
+{
+public:
+    Egu(Node & node, sim_periph_t id, int32_t irq);
+
+    bool sync() override;
+    void task(uint32_t offset) override;
+};
+
+/**@brief Programmable peripheral interconnect */
+class Ppi : public Peripheral
+{
+public:
+    explicit Ppi(Node & node);
+
+    bool sync() override;
+    void task(uint32_t offset) override;
+
+    /**@brief Trigger the tasks of the enabled channels connected to an event */
+    void route(uint32_t event_address);
+
+private:
+    void shadow();
+
+    uint32_t m_chen = 0;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_PERIPHERALS_H__
@@ -0,0 +1,627 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_radio.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "nrf.h"
+#include "sim_medium.h"
+
+namespace rtt::sim {
+
+namespace {
+
+#define RADIO_REG(name) static_cast<uint32_t>(offsetof(NRF_RADIO_Type, name))
+
+constexpr uint32_t TASK_TXEN       = RADIO_REG(TASKS_TXEN);
+constexpr uint32_t TASK_RXEN       = RADIO_REG(TASKS_RXEN);
+constexpr uint32_t TASK_START      = RADIO_REG(TASKS_START);
+constexpr uint32_t TASK_STOP       = RADIO_REG(TASKS_STOP);
+constexpr uint32_t TASK_DISABLE    = RADIO_REG(TASKS_DISABLE);
+constexpr uint32_t TASK_RSSISTART  = RADIO_REG(TASKS_RSSISTART);
+constexpr uint32_t TASK_LAST       = RADIO_REG(TASKS_CCASTOP);
+
+constexpr uint32_t EVENT_READY     = RADIO_REG(EVENTS_READY);
+constexpr uint32_t EVENT_ADDRESS   = RADIO_REG(EVENTS_ADDRESS);
+constexpr uint32_t EVENT_PAYLOAD   = RADIO_REG(EVENTS_PAYLOAD);
+constexpr uint32_t EVENT_END       = RADIO_REG(EVENTS_END);
+constexpr uint32_t EVENT_DISABLED  = RADIO_REG(EVENTS_DISABLED);
+constexpr uint32_t EVENT_RSSIEND   = RADIO_REG(EVENTS_RSSIEND);
+constexpr uint32_t EVENT_CRCOK     = RADIO_REG(EVENTS_CRCOK);
+constexpr uint32_t EVENT_CRCERROR  = RADIO_REG(EVENTS_CRCERROR);
+constexpr uint32_t EVENT_TXREADY   = RADIO_REG(EVENTS_TXREADY);
+constexpr uint32_t EVENT_RXREADY   = RADIO_REG(EVENTS_RXREADY);
+constexpr uint32_t EVENT_PHYEND    = RADIO_REG(EVENTS_PHYEND);
+
+#undef RADIO_REG
+
+constexpr uint32_t SHORT_READY_START       = 1u << RADIO_SHORTS_READY_START_Pos;
+constexpr uint32_t SHORT_END_DISABLE       = 1u << RADIO_SHORTS_END_DISABLE_Pos;
+constexpr uint32_t SHORT_DISABLED_TXEN     = 1u << RADIO_SHORTS_DISABLED_TXEN_Pos;
+constexpr uint32_t SHORT_DISABLED_RXEN     = 1u << RADIO_SHORTS_DISABLED_RXEN_Pos;
+constexpr uint32_t SHORT_ADDRESS_RSSISTART = 1u << RADIO_SHORTS_ADDRESS_RSSISTART_Pos;
+constexpr uint32_t SHORT_END_START         = 1u << RADIO_SHORTS_END_START_Pos;
+
+constexpr int32_t NOISE_FLOOR_DBM = -100;
+
+} // namespace
+
+Radio::Radio(Node & node, RadioConfig const & config, Medium & medium) :
+    Peripheral(node, SIM_PERIPH_RADIO, RADIO_IRQn),
+    m_config(config),
+    m_medium(medium)
+{
+    reset_registers();
+    regs<NRF_RADIO_Type>()->POWER = RADIO_POWER_POWER_Enabled;
+    m_medium.attach(*this);
+}
+
+void Radio::reset_registers()
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+
+    std::memset(m_p_base, 0, sizeof(NRF_RADIO_Type));
+    p_regs->FREQUENCY   = 2;
+    p_regs->DATAWHITEIV = 0x40;
+    p_regs->MODECNF0    = 0x200;
+    p_regs->SFD         = 0xA7;
+    m_inten             = 0;
+}
+
+bool Radio::sync()
+{
+    bool on      = (regs<NRF_RADIO_Type>()->POWER & 1) != 0;
+    bool changed = false;
+
+    if (on != m_powered)
+    {
+        power(on);
+        changed = true;
+    }
+    if (m_powered)
+    {
+        sync_inten(false);
+        changed |= sync_tasks(TASK_TXEN, TASK_LAST);
+    }
+    return changed;
+}
+
+void Radio::refresh()
+{
+    reg(offsetof(NRF_RADIO_Type, STATE)) = m_state;
+}
+
+void Radio::power(bool on)
+{
+    if (!on)
+    {
+        if (m_p_transmission)
+        {
+            m_p_transmission->aborted = true;
+            m_p_transmission.reset();
+        }
+        m_p_reception.reset();
+        state_set(RADIO_DISABLED);
+        m_pending.clear();
+        m_latched = 0;
+        m_tifs    = false;
+        reset_registers();
+    }
+    m_powered = on;
+    reschedule();
+}
+
+void Radio::task(uint32_t offset)
+{
+    if (!m_powered)
+    {
+        return;
+    }
+
+    switch (offset)
+    {
+        case TASK_TXEN:
+            enable(true);
+            break;
+
+        case TASK_RXEN:
+            enable(false);
+            break;
+
+        case TASK_START:
+            start();
+            break;
+
+        case TASK_STOP:
+            stop();
+            break;
+
+        case TASK_DISABLE:
+            disable();
+            break;
+
+        case TASK_RSSISTART:
+            m_rssi = m_p_reception ? m_p_reception->rssi_dbm : NOISE_FLOOR_DBM;
+            schedule(m_node.now() + m_config.rssi, ACTION_RSSIEND);
+            break;
+
+        default:
+            break;
+    }
+    reschedule();
+}
+
+void Radio::state_set(State state)
+{
+    if (m_state != RADIO_DISABLED)
+    {
+        m_active += m_node.now() - m_active_at;
+    }
+    m_active_at    = m_node.now();
+    m_state        = state;
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [](Pending const & pending) { return pending.action != ACTION_RSSIEND; }),
+                    m_pending.end());
+}
+
+Time Radio::active_time() const
+{
+    return m_active + ((m_state != RADIO_DISABLED) ? m_node.now() - m_active_at : 0);
+}
+
+void Radio::schedule(Time time, Action action)
+{
+    m_pending.push_back({time, action});
+}
+
+void Radio::enable(bool tx)
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+
+    switch (m_state)
+    {
+        case RADIO_DISABLED:
+        {
+            bool fast  = (p_regs->MODECNF0 & RADIO_MODECNF0_RU_Msk) != 0;
+            Time ready = m_node.now() + (fast ? m_config.ramp_up_fast : m_config.ramp_up);
+
+            /* With the END_DISABLE and DISABLED_TXEN shorts the radio starts sending TIFS after
+               the end of the received packet on the air. */
+            if (tx && m_tifs)
+            {
+                Time tifs = m_rx_end + m_node.local(from_us(p_regs->TIFS & 0x3FF));
+                if (tifs > m_config.rx_chain + m_config.tx_chain)
+                {
+                    ready = std::max(ready, tifs - m_config.rx_chain - m_config.tx_chain);
+                }
+            }
+            state_set(tx ? RADIO_TXRU : RADIO_RXRU);
+            m_ready = ready;
+            schedule(ready, ACTION_READY);
+            break;
+        }
+
+        case RADIO_TXDISABLE:
+        case RADIO_RXDISABLE:
+            m_latched = tx ? 2 : 1;
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint32_t Radio::header_bytes() const
+{
+    uint32_t pcnf0 = regs<NRF_RADIO_Type>()->PCNF0;
+    uint32_t lflen = (pcnf0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos;
+    uint32_t s0len = (pcnf0 & RADIO_PCNF0_S0LEN_Msk) >> RADIO_PCNF0_S0LEN_Pos;
+    uint32_t s1len = (pcnf0 & RADIO_PCNF0_S1LEN_Msk) >> RADIO_PCNF0_S1LEN_Pos;
+
+    return s0len + (lflen + 7) / 8 + (s1len + 7) / 8;
+}
+
+uint32_t Radio::frequency() const
+{
+    uint32_t freq = regs<NRF_RADIO_Type>()->FREQUENCY;
+    uint32_t base = ((freq >> RADIO_FREQUENCY_MAP_Pos) & 1) ? 2360 : 2400;
+
+    return base + (freq & RADIO_FREQUENCY_FREQUENCY_Msk);
+}
+
+std::vector<uint8_t> Radio::address_bytes(uint32_t logical) const
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+    uint32_t balen  = (p_regs->PCNF1 & RADIO_PCNF1_BALEN_Msk) >> RADIO_PCNF1_BALEN_Pos;
+    uint32_t base   = (logical == 0) ? p_regs->BASE0 : p_regs->BASE1;
+    uint32_t prefix = (logical < 4) ? p_regs->PREFIX0 >> (8 * logical) : p_regs->PREFIX1 >> (8 * (logical - 4));
+
+    std::vector<uint8_t> bytes{static_cast<uint8_t>(prefix)};
+    for (uint32_t i = 0; i < balen && i < 4; i++)
+    {
+        bytes.push_back(static_cast<uint8_t>(base >> (24 - 8 * i)));
+    }
+    return bytes;
+}
+
+Time Radio::airtime(std::vector<uint8_t> const & data, Time & address, Time & payload) const
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+    uint32_t pcnf0 = p_regs->PCNF0;
+    uint32_t mbps;
+
+    switch (p_regs->MODE & RADIO_MODE_MODE_Msk)
+    {
+        case RADIO_MODE_MODE_Nrf_1Mbit:
+        case RADIO_MODE_MODE_Ble_1Mbit:
+            mbps = 1;
+            break;
+
+        case RADIO_MODE_MODE_Nrf_2Mbit:
+        case RADIO_MODE_MODE_Ble_2Mbit:
+            mbps = 2;
+            break;
+
+        default:
+            fatal("%s: radio mode %u is not simulated", m_node.name(), p_regs->MODE);
+    }
+
+    static constexpr uint32_t preambles[] = {8, 16, 32};
+    uint32_t plen = (pcnf0 & RADIO_PCNF0_PLEN_Msk) >> RADIO_PCNF0_PLEN_Pos;
+    if (plen >= 3)
+    {
+        fatal("%s: long range preamble is not simulated", m_node.name());
+    }
+
+    uint32_t balen        = (p_regs->PCNF1 & RADIO_PCNF1_BALEN_Msk) >> RADIO_PCNF1_BALEN_Pos;
+    uint32_t lflen        = (pcnf0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos;
+    uint32_t s0len        = (pcnf0 & RADIO_PCNF0_S0LEN_Msk) >> RADIO_PCNF0_S0LEN_Pos;
+    uint32_t s1len        = (pcnf0 & RADIO_PCNF0_S1LEN_Msk) >> RADIO_PCNF0_S1LEN_Pos;
+    uint32_t payload_bits = 8 * (static_cast<uint32_t>(data.size()) - header_bytes());
+    uint32_t crc_bits     = 8 * (p_regs->CRCCNF & RADIO_CRCCNF_LEN_Msk);
+    Time     bit          = PS_PER_US / mbps;
+
+    uint32_t address_bits = preambles[plen] + 8 * (balen + 1);
+    uint32_t header_bits  = 8 * s0len + lflen + s1len;
+
+    address = m_node.local(address_bits * bit);
+    payload = m_node.local((address_bits + header_bits + payload_bits) * bit);
+    return m_node.local((address_bits + header_bits + payload_bits + crc_bits) * bit);
+}
+
+void Radio::start()
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+    Time now = m_node.now();
+
+    m_packetptr = p_regs->PACKETPTR;
+
+    if (m_state == RADIO_RXIDLE)
+    {
+        state_set(RADIO_RX);
+        m_p_reception.reset();
+        return;
+    }
+    if (m_state != RADIO_TXIDLE)
+    {
+        return;
+    }
+
+    /* The packet is read from RAM as it is sent */
+    uint8_t const * p_packet = reinterpret_cast<uint8_t const *>(static_cast<uintptr_t>(m_packetptr));
+    uint32_t pcnf0   = p_regs->PCNF0;
+    uint32_t pcnf1   = p_regs->PCNF1;
+    uint32_t lflen   = (pcnf0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos;
+    uint32_t s0len   = (pcnf0 & RADIO_PCNF0_S0LEN_Msk) >> RADIO_PCNF0_S0LEN_Pos;
+    uint32_t maxlen  = (pcnf1 & RADIO_PCNF1_MAXLEN_Msk) >> RADIO_PCNF1_MAXLEN_Pos;
+    uint32_t statlen = (pcnf1 & RADIO_PCNF1_STATLEN_Msk) >> RADIO_PCNF1_STATLEN_Pos;
+    uint32_t length  = (lflen > 0) ? (p_packet[s0len] & ((1u << std::min<uint32_t>(lflen, 8)) - 1)) : 0;
+    uint32_t size    = header_bytes() + std::min(length + statlen, maxlen);
+
+    auto p_transmission = std::make_shared<Transmission>();
+    p_transmission->p_source      = this;
+    p_transmission->start         = now + m_config.tx_chain;
+    p_transmission->frequency     = frequency();
+    p_transmission->mode          = p_regs->MODE & RADIO_MODE_MODE_Msk;
+    p_transmission->address_bytes = address_bytes(p_regs->TXADDRESS & 7);
+    p_transmission->data.assign(p_packet, p_packet + size);
+    p_transmission->power_dbm     = static_cast<int8_t>(p_regs->TXPOWER & RADIO_TXPOWER_TXPOWER_Msk);
+    p_transmission->duration      = airtime(p_transmission->data, p_transmission->address, p_transmission->payload);
+
+    state_set(RADIO_TX);
+    schedule(now + p_transmission->address, ACTION_ADDRESS);
+    schedule(now + p_transmission->payload, ACTION_PAYLOAD);
+    schedule(now + p_transmission->duration, ACTION_END);
+    m_p_transmission = p_transmission;
+    m_medium.transmit(p_transmission);
+}
+
+void Radio::stop()
+{
+    if (m_state == RADIO_TX)
+    {
+        m_p_transmission->aborted = true;
+        m_p_transmission.reset();
+        state_set(RADIO_TXIDLE);
+    }
+    else if (m_state == RADIO_RX)
+    {
+        m_p_reception.reset();
+        state_set(RADIO_RXIDLE);
+    }
+}
+
+void Radio::disable()
+{
+    Time now = m_node.now();
+
+    switch (m_state)
+    {
+        case RADIO_DISABLED:
+            /* DISABLED is generated again, the firmware relies on it to restart the radio */
+            schedule(now, ACTION_DISABLED);
+            break;
+
+        case RADIO_TX:
+            m_p_transmission->aborted = true;
+            m_p_transmission.reset();
+            /* Fall through */
+        case RADIO_TXRU:
+        case RADIO_TXIDLE:
+            state_set(RADIO_TXDISABLE);
+            schedule(now + m_config.tx_disable, ACTION_DISABLED);
+            break;
+
+        case RADIO_RXRU:
+        case RADIO_RXIDLE:
+        case RADIO_RX:
+            m_p_reception.reset();
+            state_set(RADIO_RXDISABLE);
+            schedule(now + m_config.rx_disable, ACTION_DISABLED);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Radio::receive(Reception const & reception)
+{
+    m_arrivals.push_back(reception);
+    reschedule();
+}
+
+void Radio::arrive(Reception const & reception)
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+    Transmission const & transmission = *reception.p_transmission;
+
+    if (m_p_reception)
+    {
+        Transmission const & current = *m_p_reception->p_transmission;
+        if (reception.arrival < m_p_reception->arrival + current.duration && !reception.lost)
+        {
+            m_p_reception->corrupt = true;
+        }
+        return;
+    }
+    if (m_state != RADIO_RX || reception.lost || !m_powered ||
+        transmission.frequency != frequency() || transmission.mode != (p_regs->MODE & RADIO_MODE_MODE_Msk))
+    {
+        return;
+    }
+
+    uint32_t rxaddresses = p_regs->RXADDRESSES;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        if ((rxaddresses & (1u << i)) && address_bytes(i) == transmission.address_bytes)
+        {
+            m_match       = i;
+            /* A timing error cannot move an event before the packet arrives */
+            int64_t rx_chain = static_cast<int64_t>(m_config.rx_chain);
+            Time    events   = reception.arrival + static_cast<Time>(std::max(rx_chain + reception.offset, INT64_C(0)));
+
+            m_p_reception = std::make_unique<Reception>(reception);
+            schedule(events + transmission.address, ACTION_ADDRESS);
+            schedule(events + transmission.payload, ACTION_PAYLOAD);
+            schedule(events + transmission.duration, ACTION_END);
+            return;
+        }
+    }
+}
+
+void Radio::end()
+{
+    NRF_RADIO_Type volatile * p_regs = regs<NRF_RADIO_Type>();
+    uint32_t shorts = p_regs->SHORTS;
+
+    if (m_state == RADIO_TX)
+    {
+        m_p_transmission.reset();
+        state_set(RADIO_TXIDLE);
+        event(EVENT_END);
+        event(EVENT_PHYEND);
+    }
+    else
+    {
+        Transmission const & transmission = *m_p_reception->p_transmission;
+        uint32_t maxlen = (p_regs->PCNF1 & RADIO_PCNF1_MAXLEN_Msk) >> RADIO_PCNF1_MAXLEN_Pos;
+        uint32_t limit  = header_bytes() + maxlen;
+        uint32_t size   = std::min<uint32_t>(static_cast<uint32_t>(transmission.data.size()), limit);
+        bool     ok     = !m_p_reception->corrupt && !transmission.aborted && transmission.data.size() <= limit;
+
+        std::memcpy(reinterpret_cast<void *>(static_cast<uintptr_t>(m_packetptr)), transmission.data.data(), size);
+        reg(offsetof(NRF_RADIO_Type, CRCSTATUS)) = ok ? RADIO_CRCSTATUS_CRCSTATUS_CRCOk : RADIO_CRCSTATUS_CRCSTATUS_CRCError;
+        reg(offsetof(NRF_RADIO_Type, RXMATCH))   = m_match;
+
+        m_p_reception.reset();
+        m_rx_end = m_node.now();
+        state_set(RADIO_RXIDLE);
+        event(ok ? EVENT_CRCOK : EVENT_CRCERROR);
+        event(EVENT_END);
+        event(EVENT_PHYEND);
+        m_tifs = (shorts & SHORT_END_DISABLE) != 0;
+    }
+
+    if (shorts & SHORT_END_DISABLE)
+    {
+        disable();
+    }
+    else if (shorts & SHORT_END_START)
+    {
+        start();
+    }
+}
+
+void Radio::act(Action action)
+{
+    uint32_t shorts = regs<NRF_RADIO_Type>()->SHORTS;
+
+    switch (action)
+    {
+        case ACTION_READY:
+            state_set((m_state == RADIO_TXRU) ? RADIO_TXIDLE : RADIO_RXIDLE);
+            event(EVENT_READY);
+            event((m_state == RADIO_TXIDLE) ? EVENT_TXREADY : EVENT_RXREADY);
+            if (shorts & SHORT_READY_START)
+            {
+                start();
+            }
+            break;
+
+        case ACTION_DISABLED:
+            state_set(RADIO_DISABLED);
+            event(EVENT_DISABLED);
+            if (shorts & SHORT_DISABLED_TXEN)
+            {
+                enable(true);
+            }
+            else if (shorts & SHORT_DISABLED_RXEN)
+            {
+                enable(false);
+            }
+            m_tifs = false;
+            if (m_latched != 0 && m_state == RADIO_DISABLED)
+            {
+                enable(m_latched == 2);
+            }
+            m_latched = 0;
+            break;
+
+        case ACTION_ADDRESS:
+            if (m_state == RADIO_RX)
+            {
+                reg(offsetof(NRF_RADIO_Type, RXMATCH)) = m_match;
+            }
+            event(EVENT_ADDRESS);
+            if (m_state == RADIO_RX && (shorts & SHORT_ADDRESS_RSSISTART))
+            {
+                m_rssi = m_p_reception->rssi_dbm;
+                schedule(m_node.now() + m_config.rssi, ACTION_RSSIEND);
+            }
+            break;
+
+        case ACTION_PAYLOAD:
+            event(EVENT_PAYLOAD);
+            break;
+
+        case ACTION_END:
+            end();
+            break;
+
+        case ACTION_RSSIEND:
+            reg(offsetof(NRF_RADIO_Type, RSSISAMPLE)) = static_cast<uint32_t>(std::clamp(-m_rssi, 0, 127));
+            event(EVENT_RSSIEND);
+            break;
+    }
+}
+
+Time Radio::next() const
+{
+    Time next = NEVER;
+    for (Pending const & pending : m_pending)
+    {
+        next = std::min(next, pending.time);
+    }
+    for (Reception const & reception : m_arrivals)
+    {
+        next = std::min(next, reception.arrival);
+    }
+    return next;
+}
+
+void Radio::run()
+{
+    Time now = m_node.now();
+
+    for (;;)
+    {
+        auto pending = std::min_element(m_pending.begin(), m_pending.end(),
+                                        [](Pending const & a, Pending const & b) { return a.time < b.time; });
+        auto arrival = std::min_element(m_arrivals.begin(), m_arrivals.end(),
+                                        [](Reception const & a, Reception const & b) { return a.arrival < b.arrival; });
+        bool pending_due = (pending != m_pending.end()) && pending->time <= now;
+        bool arrival_due = (arrival != m_arrivals.end()) && arrival->arrival <= now;
+
+        if (arrival_due && (!pending_due || arrival->arrival < pending->time))
+        {
+            Reception reception = *arrival;
+            m_arrivals.erase(arrival);
+            arrive(reception);
+        }
+        else if (pending_due)
+        {
+            Action action = pending->action;
+            m_pending.erase(pending);
+            act(action);
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+Time Radio::earliest_start() const
+{
+    Time now = m_node.now();
+
+    switch (m_state)
+    {
+        case RADIO_TXIDLE:
+        case RADIO_TX:
+            return now;
+
+        case RADIO_TXRU:
+            return m_ready;
+
+        default:
+            return now + std::min(m_config.ramp_up, m_config.ramp_up_fast);
+    }
+}
+
+} // namespace rtt::sim
@@ -0,0 +1,167 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_RADIO_H__
+#define SIM_RADIO_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sim_core.h"
+
+namespace rtt::sim {
+
+/**@brief A packet on the air */
+struct Transmission
+{
+    Radio const *        p_source;
+    Time                 start;        /**< First bit on the air. */
+    Time                 address;      /**< Duration up to the end of the address. */
+    Time                 payload;      /**< Duration up to the end of the payload. */
+    Time                 duration;     /**< Duration up to the end of the CRC. */
+    uint32_t             frequency;    /**< MHz. */
+    uint32_t             mode;
+    std::vector<uint8_t> address_bytes; /**< Prefix first. */
+    std::vector<uint8_t> data;         /**< S0, length, S1 and payload, as in RAM. */
+    int32_t              power_dbm;
+    bool                 aborted = false; /**< Cut short by DISABLE or STOP. */
+};
+
+/**@brief A packet as it reaches a receiver */
+struct Reception
+{
+    std::shared_ptr<Transmission const> p_transmission;
+    Time                                arrival;    /**< First bit at the antenna. */
+    int64_t                             offset;     /**< Timing error of the events, in ps. */
+    bool                                lost;       /**< Not detected. */
+    bool                                corrupt;    /**< Detected, with a CRC error. */
+    int32_t                             rssi_dbm;
+};
+
+/**@brief RADIO in the proprietary and BLE modes
+ *
+ * @details Models the state machine with its shorts, ramp-up and disable times, TIFS, address
+ *          matching and the packet buffer in RAM. TX events are generated at their digital
+ *          time after START; a receiver sees each event rx_chain after the bit that completes
+ *          it reaches its antenna, moved by the timing error of the reception. Bit times and
+ *          TIFS follow the node's crystal. Reception starts only if the radio is in RX when the first
+ *          bit arrives, and a second packet during a reception corrupts it.
+ */
+class Radio : public Peripheral
+{
+public:
+    Radio(Node & node, RadioConfig const & config, Medium & medium);
+
+    bool sync() override;
+    void refresh() override;
+    void task(uint32_t offset) override;
+    Time next() const override;
+    void run() override;
+
+    /**@brief A packet is on its way from another radio */
+    void receive(Reception const & reception);
+
+    /**@brief Earliest time a START could put a packet on the air, from the current state */
+    Time earliest_start() const;
+
+    bool disabled() const { return m_state == RADIO_DISABLED; }
+
+    /**@brief Time of the last END event in RX */
+    Time rx_end() const { return m_rx_end; }
+
+    /**@brief Time the radio has spent out of DISABLED, ramp-ups included */
+    Time active_time() const;
+
+    RadioConfig const & config() const { return m_config; }
+
+private:
+    enum State : uint32_t
+    {
+        RADIO_DISABLED  = 0,
+        RADIO_RXRU      = 1,
+        RADIO_RXIDLE    = 2,
+        RADIO_RX        = 3,
+        RADIO_RXDISABLE = 4,
+        RADIO_TXRU      = 9,
+        RADIO_TXIDLE    = 10,
+        RADIO_TX        = 11,
+        RADIO_TXDISABLE = 12,
+    };
+
+    enum Action
+    {
+        ACTION_READY,
+        ACTION_DISABLED,
+        ACTION_ADDRESS,
+        ACTION_PAYLOAD,
+        ACTION_END,
+        ACTION_RSSIEND,
+    };
+
+    struct Pending
+    {
+        Time   time;
+        Action action;
+    };
+
+    void enable(bool tx);
+    void start();
+    void stop();
+    void disable();
+    void power(bool on);
+    void state_set(State state);
+    void schedule(Time time, Action action);
+    void act(Action action);
+    void arrive(Reception const & reception);
+    void end();
+    void reset_registers();
+
+    Time airtime(std::vector<uint8_t> const & data, Time & address, Time & payload) const;
+    std::vector<uint8_t> address_bytes(uint32_t logical) const;
+    uint32_t frequency() const;
+    uint32_t header_bytes() const;
+
+    RadioConfig const &    m_config;
+    Medium &               m_medium;
+    State                  m_state      = RADIO_DISABLED;
+    bool                   m_powered    = true;
+    std::vector<Pending>   m_pending;    /* State changes cancel all but RSSIEND */
+    std::vector<Reception> m_arrivals;
+    uint32_t               m_latched    = 0;   /* TXEN or RXEN during a disable, +1 */
+    bool                   m_tifs       = false; /* Last END from RX disabled by the short */
+    Time                   m_rx_end     = 0;   /* Time of the last END event in RX */
+    Time                   m_ready      = 0;   /* Time of READY during a ramp-up */
+    Time                   m_active     = 0;   /* Time out of DISABLED before m_active_at */
+    Time                   m_active_at  = 0;   /* Last change of state */
+    uint32_t               m_packetptr  = 0;   /* PACKETPTR sampled at START */
+    std::shared_ptr<Transmission> m_p_transmission; /* Packet being sent */
+    std::unique_ptr<Reception>    m_p_reception;    /* Packet being received */
+    uint32_t               m_match      = 0;
+    int32_t                m_rssi       = -127;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_RADIO_H__
@@ -0,0 +1,545 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_softdevice.h"
+
+#include <algorithm>
+
+#include "sim_peripherals.h"
+
+namespace rtt::sim {
+
+SoftDevice::SoftDevice(Node & node, SoftDeviceConfig const & config, uint64_t random) :
+    m_node(node),
+    m_config(config)
+{
+    if (m_config.ble_interval != 0)
+    {
+        m_ble_phase = random % m_config.ble_interval;
+    }
+    m_node.irq_priority_set(SOFTDEVICE_IRQ, 0);
+    m_node.irq_priority_set(RADIO_IRQn, 0);
+    m_node.irq_priority_set(TIMER0_IRQn, 0);
+    m_node.irq_enable(SOFTDEVICE_IRQ, true);
+}
+
+Time SoftDevice::next() const
+{
+    return std::min(m_start_at, m_end_at);
+}
+
+void SoftDevice::run()
+{
+    Time now = m_node.now();
+
+    if (m_active && now >= m_end_at)
+    {
+        fatal("%s: timeslot overran its end by %.3f us", m_node.name(), to_us(now - m_end_at));
+    }
+    if (now >= m_start_at)
+    {
+        m_start_at = NEVER;
+        if (m_refusal != 0)
+        {
+            m_requested = false;
+            m_node.reschedule(*this);
+            soc_event(m_refusal);
+            m_refusal = 0;
+        }
+        else
+        {
+            work_add(WORK_START);
+        }
+    }
+}
+
+void SoftDevice::work_add(uint32_t work)
+{
+    m_work |= work;
+    m_node.irq_pend(SOFTDEVICE_IRQ, true);
+}
+
+void SoftDevice::interrupt(int32_t irq)
+{
+    switch (irq)
+    {
+        case SOFTDEVICE_IRQ:
+            if (m_work & WORK_START)
+            {
+                m_work &= ~WORK_START;
+                slot_start();
+                signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_START);
+            }
+            if (m_active && (m_work & WORK_EXTENDED))
+            {
+                m_work &= ~WORK_EXTENDED;
+                signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_SUCCEEDED);
+            }
+            if (m_active && (m_work & WORK_EXTEND_FAILED))
+            {
+                m_work &= ~WORK_EXTEND_FAILED;
+                signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_FAILED);
+            }
+            break;
+
+        case RADIO_IRQn:
+            if (m_active)
+            {
+                signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO);
+            }
+            break;
+
+        case TIMER0_IRQn:
+            if (m_active)
+            {
+                signal(NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void SoftDevice::signal(uint8_t type)
+{
+    nrf_radio_signal_callback_return_param_t * p_return = m_callback(type);
+
+    m_node.sync_last();
+
+    if (p_return == nullptr)
+    {
+        soc_event(NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN);
+        return;
+    }
+
+    switch (p_return->callback_action)
+    {
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE:
+            break;
+
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND:
+            if (type == NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_SUCCEEDED ||
+                type == NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_FAILED)
+            {
+                soc_event(NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN);
+                break;
+            }
+            work_add(extend(p_return->params.extend.length_us) ? WORK_EXTENDED : WORK_EXTEND_FAILED);
+            break;
+
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_END:
+            slot_end();
+            break;
+
+        case NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END:
+            slot_end();
+            if ((p_return->params.request.p_next == nullptr) ||
+                (schedule(*p_return->params.request.p_next) != NRF_SUCCESS))
+            {
+                soc_event(NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN);
+            }
+            break;
+
+        default:
+            soc_event(NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN);
+            break;
+    }
+
+    if (!m_active && !m_requested && (p_return->callback_action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_END ||
+                                      p_return->callback_action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END))
+    {
+        soc_event(NRF_EVT_RADIO_SESSION_IDLE);
+    }
+}
+
+void SoftDevice::slot_start()
+{
+    Timer & timer0 = m_node.timer(SIM_PERIPH_TIMER0);
+
+    /* A crystal started for the timeslot ran up before it */
+    hfxo_account();
+    if ((m_hfclk_cfg == NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED) && !m_hfclk)
+    {
+        m_stats.hfxo_time += m_config.hfxo_startup;
+    }
+
+    m_requested  = false;
+    m_active     = true;
+    m_last_start = m_node.now();
+    m_end_at     = m_last_start + m_length;
+
+    m_stats.granted++;
+    m_stats.granted_time += m_length;
+
+    /* TIMER0 runs at 1 MHz from the start of the timeslot */
+    timer0.reset();
+    timer0.start_1mhz();
+    m_node.irq_pend(RADIO_IRQn, false);
+    m_node.irq_pend(TIMER0_IRQn, false);
+    m_node.irq_enable(RADIO_IRQn, true);
+    m_node.reschedule(*this);
+}
+
+void SoftDevice::slot_end()
+{
+    m_stats.slot_time += m_node.now() - m_last_start;
+
+    hfxo_account();
+    m_active = false;
+    m_end_at = NEVER;
+    m_work  &= ~(WORK_EXTENDED | WORK_EXTEND_FAILED);
+
+    m_node.timer(SIM_PERIPH_TIMER0).reset();
+    m_node.irq_enable(RADIO_IRQn, false);
+    m_node.irq_enable(TIMER0_IRQn, false);
+    m_node.irq_pend(RADIO_IRQn, false);
+    m_node.irq_pend(TIMER0_IRQn, false);
+    m_node.reschedule(*this);
+}
+
+void SoftDevice::soc_event(uint32_t evt_id)
+{
+    m_events.push_back(evt_id);
+    m_node.irq_pend(SD_EVT_IRQn, true);
+}
+
+bool SoftDevice::extend(uint32_t length_us)
+{
+    Time length = from_us(length_us);
+
+    m_stats.extensions++;
+    if ((pattern_next(m_config.extensions, m_extend_index) == '0') ||
+        ble_overlaps(m_end_at, m_end_at + length))
+    {
+        m_stats.extensions_failed++;
+        return false;
+    }
+    m_end_at             += length;
+    m_stats.granted_time += length;
+    m_node.reschedule(*this);
+    return true;
+}
+
+void SoftDevice::refuse(uint32_t evt_id, Time at)
+{
+    if (evt_id == NRF_EVT_RADIO_BLOCKED)
+    {
+        m_stats.blocked++;
+    }
+    else
+    {
+        m_stats.canceled++;
+    }
+    m_requested = true;
+    m_refusal   = evt_id;
+    m_start_at  = at;
+    m_node.reschedule(*this);
+}
+
+char SoftDevice::pattern_next(std::string const & pattern, size_t & index) const
+{
+    if (pattern.empty())
+    {
+        return '\0';
+    }
+    char outcome = pattern[index];
+    index = (index + 1) % pattern.size();
+    return outcome;
+}
+
+Time SoftDevice::ble_event_after(Time time) const
+{
+    if (time < m_ble_phase)
+    {
+        return m_ble_phase;
+    }
+
+    Time start = time - (time - m_ble_phase) % m_config.ble_interval;
+    if (start + m_config.ble_event <= time)
+    {
+        start += m_config.ble_interval;
+    }
+    return start;
+}
+
+bool SoftDevice::ble_overlaps(Time start, Time end) const
+{
+    return (m_config.ble_interval != 0) && (ble_event_after(start) < end);
+}
+
+uint32_t SoftDevice::schedule(nrf_radio_request_t const & request)
+{
+    Time now = m_node.now();
+    Time start;
+    Time timeout;
+    uint32_t length_us;
+
+    /* The clock configuration of the next timeslot may change that of the current one */
+    hfxo_account();
+
+    if (request.request_type == NRF_RADIO_REQ_TYPE_EARLIEST)
+    {
+        nrf_radio_request_earliest_t const & earliest = request.params.earliest;
+
+        if (earliest.timeout_us > NRF_RADIO_EARLIEST_TIMEOUT_MAX_US)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        length_us   = earliest.length_us;
+        m_hfclk_cfg = earliest.hfclk;
+        timeout     = now + from_us(earliest.timeout_us);
+        start       = now + m_config.earliest_latency;
+        if ((earliest.hfclk == NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED) && !m_hfclk)
+        {
+            start += m_config.hfxo_startup;
+        }
+        start = (start + PS_PER_US - 1) / PS_PER_US * PS_PER_US;
+    }
+    else if (request.request_type == NRF_RADIO_REQ_TYPE_NORMAL)
+    {
+        nrf_radio_request_normal_t const & normal = request.params.normal;
+
+        if ((m_last_start == NEVER) || (normal.distance_us > NRF_RADIO_DISTANCE_MAX_US))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        length_us   = normal.length_us;
+        m_hfclk_cfg = normal.hfclk;
+        start       = m_last_start + from_us(normal.distance_us);
+        timeout     = start;
+    }
+    else
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if ((length_us < NRF_RADIO_LENGTH_MIN_US) || (length_us > NRF_RADIO_LENGTH_MAX_US))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    Time length = from_us(length_us);
+
+    m_stats.requests++;
+    char outcome = pattern_next(m_config.grants, m_grant_index);
+
+    if (start < now)
+    {
+        refuse(NRF_EVT_RADIO_BLOCKED, now);
+        return NRF_SUCCESS;
+    }
+
+    /* An earliest timeslot goes after the connection events in its way */
+    if (m_config.ble_interval != 0)
+    {
+        if (length + m_config.ble_event > m_config.ble_interval)
+        {
+            start = NEVER;
+        }
+        while ((start <= timeout) && ble_overlaps(start, start + length))
+        {
+            start = ble_event_after(start) + m_config.ble_event;
+        }
+    }
+
+    /* A blocked request is reported once the SoftDevice has tried to fit it in, a canceled
+       one when its timeslot would have started */
+    if ((start > timeout) || (outcome == 'b'))
+    {
+        refuse(NRF_EVT_RADIO_BLOCKED, std::min(timeout, now + m_config.earliest_latency));
+    }
+    else if (outcome == 'c')
+    {
+        refuse(NRF_EVT_RADIO_CANCELED, start);
+    }
+    else
+    {
+        m_requested = true;
+        m_start_at  = start;
+        m_length    = length;
+        m_node.reschedule(*this);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::session_open(nrf_radio_signal_callback_t callback)
+{
+    if (callback == nullptr)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_callback != nullptr)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    m_callback = callback;
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::session_close()
+{
+    if (m_callback == nullptr)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+    if (m_active)
+    {
+        slot_end();
+    }
+    m_requested = false;
+    m_refusal   = 0;
+    m_start_at  = NEVER;
+    m_callback  = nullptr;
+    m_node.reschedule(*this);
+    soc_event(NRF_EVT_RADIO_SESSION_CLOSED);
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::request(nrf_radio_request_t const * p_request)
+{
+    if (p_request == nullptr)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_callback == nullptr)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+    if (m_requested || m_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return schedule(*p_request);
+}
+
+uint32_t SoftDevice::evt_get(uint32_t * p_evt_id)
+{
+    if (m_events.empty())
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_evt_id = m_events.front();
+    m_events.pop_front();
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::hfclk_request()
+{
+    hfxo_account();
+    m_hfclk = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::hfclk_release()
+{
+    hfxo_account();
+    m_hfclk = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t SoftDevice::hfclk_is_running(uint32_t * p_is_running) const
+{
+    *p_is_running = hfxo_running();
+    return NRF_SUCCESS;
+}
+
+bool SoftDevice::hfxo_running() const
+{
+    return m_hfclk || (m_active && (m_hfclk_cfg == NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED));
+}
+
+/* Call before anything hfxo_running() depends on changes */
+void SoftDevice::hfxo_account()
+{
+    if (hfxo_running())
+    {
+        m_stats.hfxo_time += m_node.now() - m_hfxo_since;
+    }
+    m_hfxo_since = m_node.now();
+}
+
+TimeslotStats SoftDevice::stats() const
+{
+    TimeslotStats stats = m_stats;
+
+    if (m_active)
+    {
+        stats.slot_time += m_node.now() - m_last_start;
+    }
+    if (hfxo_running())
+    {
+        stats.hfxo_time += m_node.now() - m_hfxo_since;
+    }
+    return stats;
+}
+
+} // namespace rtt::sim
+
+extern "C" {
+
+using rtt::sim::Simulator;
+
+uint32_t sd_radio_session_open(nrf_radio_signal_callback_t p_radio_signal_callback)
+{
+    return Simulator::instance().current().softdevice().session_open(p_radio_signal_callback);
+}
+
+uint32_t sd_radio_session_close(void)
+{
+    return Simulator::instance().current().softdevice().session_close();
+}
+
+uint32_t sd_radio_request(nrf_radio_request_t const * p_request)
+{
+    return Simulator::instance().current().softdevice().request(p_request);
+}
+
+uint32_t sd_evt_get(uint32_t * p_evt_id)
+{
+    return Simulator::instance().current().softdevice().evt_get(p_evt_id);
+}
+
+uint32_t sd_clock_hfclk_request(void)
+{
+    return Simulator::instance().current().softdevice().hfclk_request();
+}
+
+uint32_t sd_clock_hfclk_release(void)
+{
+    return Simulator::instance().current().softdevice().hfclk_release();
+}
+
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running)
+{
+    return Simulator::instance().current().softdevice().hfclk_is_running(p_is_running);
+}
+
+uint32_t sd_temp_get(int32_t * p_temp)
+{
+    *p_temp = 25 * 4;
+    return NRF_SUCCESS;
+}
+
+} // extern "C"
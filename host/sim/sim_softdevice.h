@@ -0,0 +1,131 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_SOFTDEVICE_H__
+#define SIM_SOFTDEVICE_H__
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "nrf_soc.h"
+#include "sim_core.h"
+
+namespace rtt::sim {
+
+/**@brief Use of the timeslot API by one node */
+struct TimeslotStats
+{
+    uint32_t requests          = 0; /**< Accepted by sd_radio_request or a REQUEST_AND_END. */
+    uint32_t granted           = 0; /**< Timeslots started. */
+    uint32_t blocked           = 0;
+    uint32_t canceled          = 0;
+    uint32_t extensions        = 0; /**< Extensions requested. */
+    uint32_t extensions_failed = 0;
+    Time     slot_time         = 0; /**< Time spent in timeslots. */
+    Time     granted_time      = 0; /**< Length of the timeslots started, with their extensions. */
+    Time     hfxo_time         = 0; /**< Time the HFXO ran, start-ups included. */
+};
+
+/**@brief SoftDevice stand-in: the radio timeslot API and the SoC events
+ *
+ * @details An earliest request starts after a fixed latency, a normal request at its distance
+ *          from the start of the previous timeslot. Timeslots start on whole microseconds, as
+ *          TIMER0 counts them. Requests and extensions are refused as the grant and extension
+ *          patterns and the connection events of SoftDeviceConfig say. The SoftDevice runs at
+ *          priority 0 through its own interrupt line, and during a timeslot it passes the RADIO
+ *          and TIMER0 interrupts to the signal callback.
+ */
+class SoftDevice : public Component
+{
+public:
+    SoftDevice(Node & node, SoftDeviceConfig const & config, uint64_t random);
+
+    Time next() const override;
+    void run() override;
+
+    /**@brief Handle an interrupt the SoftDevice owns */
+    void interrupt(int32_t irq);
+
+    /**@brief Whether the SoftDevice handles an interrupt line */
+    static bool owns(int32_t irq) { return irq == SOFTDEVICE_IRQ || irq == RADIO_IRQn || irq == TIMER0_IRQn; }
+
+    /* SoftDevice calls */
+    uint32_t session_open(nrf_radio_signal_callback_t callback);
+    uint32_t session_close();
+    uint32_t request(nrf_radio_request_t const * p_request);
+    uint32_t evt_get(uint32_t * p_evt_id);
+    uint32_t hfclk_request();
+    uint32_t hfclk_release();
+    uint32_t hfclk_is_running(uint32_t * p_is_running) const;
+
+    /**@brief Timeslot statistics up to now, counting the current timeslot so far */
+    TimeslotStats stats() const;
+
+private:
+    enum Work : uint32_t
+    {
+        WORK_START         = 1 << 0,
+        WORK_EXTENDED      = 1 << 1,
+        WORK_EXTEND_FAILED = 1 << 2,
+    };
+
+    uint32_t schedule(nrf_radio_request_t const & request);
+    void refuse(uint32_t evt_id, Time at);
+    bool extend(uint32_t length_us);
+    char pattern_next(std::string const & pattern, size_t & index) const;
+    Time ble_event_after(Time time) const;
+    bool ble_overlaps(Time start, Time end) const;
+    void signal(uint8_t type);
+    void slot_start();
+    void slot_end();
+    bool hfxo_running() const;
+    void hfxo_account();
+    void soc_event(uint32_t evt_id);
+    void work_add(uint32_t work);
+
+    Node &                      m_node;
+    SoftDeviceConfig const &    m_config;
+    nrf_radio_signal_callback_t m_callback     = nullptr;
+    bool                        m_requested    = false; /* A timeslot is scheduled */
+    bool                        m_active       = false; /* In a timeslot */
+    Time                        m_start_at     = NEVER; /* Start of the scheduled timeslot */
+    Time                        m_end_at       = NEVER; /* End of the current timeslot */
+    Time                        m_length       = 0;     /* Length of the scheduled timeslot */
+    Time                        m_last_start   = NEVER; /* Start of the previous timeslot */
+    uint32_t                    m_refusal      = 0;     /* BLOCKED or CANCELED, sent instead of starting */
+    Time                        m_ble_phase    = 0;     /* Start of the first connection event */
+    size_t                      m_grant_index  = 0;
+    size_t                      m_extend_index = 0;
+    TimeslotStats               m_stats;
+    uint8_t                     m_hfclk_cfg    = NRF_RADIO_HFCLK_CFG_NO_GUARANTEE;
+    bool                        m_hfclk        = false; /* Requested by the application */
+    Time                        m_hfxo_since   = 0;     /* Last change of hfxo_running() */
+    uint32_t                    m_work         = 0;
+    std::deque<uint32_t>        m_events;
+};
+
+} // namespace rtt::sim
+
+#endif // SIM_SOFTDEVICE_H__
@@ -23,8 +23,13 @@
  */
 
 #include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
 #include "ble_rtt.h"
 #include "ble_srv_common.h"
+#include "rtt_initiators.h"
+
+APP_TIMER_DEF(m_range_timer_id);  /**< Gives up a single-shot request the initiator does not answer. */
 
 
 /**@brief Function for handling the Write event.
@@ -95,4 +100,799 @@ uint32_t ble_lbs_init(ble_lbs_t * p_lbs, const ble_lbs_init_t * p_lbs_init)
     add_char_params.write_access = SEC_OPEN;
 
     return characteristic_add(p_lbs->service_handle, &add_char_params, &p_lbs->led_char_handles);
-}
\ No newline at end of file
+}
+
+/**@brief Function for notifying the waiting result batches to the gateway.
+ *
+ * @details Stops when the SoftDevice notification queue is full. The remaining batches are
+ *          sent when a notification has completed.
+ *
+ * @param[in] p_rtt  Ranging Service structure.
+ */
+static void batches_send(ble_rtt_t * p_rtt)
+{
+    uint32_t               err_code;
+    uint16_t               len;
+    ble_gatts_hvx_params_t hvx_params;
+
+    while ((p_rtt->batch_count > 0) && (p_rtt->gateway_conn_handle != BLE_CONN_HANDLE_INVALID))
+    {
+        len = p_rtt->batch_len[p_rtt->batch_head];
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = p_rtt->result_char_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_rtt->batches[p_rtt->batch_head];
+
+        err_code = sd_ble_gatts_hvx(p_rtt->gateway_conn_handle, &hvx_params);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Retry on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+            return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+            // The gateway can not receive the batch, for example because the MTU is too small.
+            p_rtt->batches_dropped++;
+        }
+
+        p_rtt->batch_head = (p_rtt->batch_head + 1) % BLE_RTT_FORWARD_QUEUE_LEN;
+        p_rtt->batch_count--;
+    }
+}
+
+
+/**@brief Function for notifying the result of a single-shot request to the gateway that made it.
+ *
+ * @param[in] p_rtt     Ranging Service structure.
+ * @param[in] p_result  Result from the initiator. The latency is filled in here.
+ */
+static void range_result_report(ble_rtt_t * p_rtt, ble_rtt_range_result_t * p_result)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    ble_rtt_evt_t          evt;
+    uint8_t                report[BLE_RTT_RANGE_REPORT_LEN];
+    uint16_t               len = 0;
+    uint32_t               ticks;
+
+    ticks                = app_timer_cnt_diff_compute(app_timer_cnt_get(), p_rtt->range_requested_at);
+    p_result->latency_us = (uint32_t)(((uint64_t)ticks * 1000000UL) / APP_TIMER_CLOCK_FREQ);
+
+    report[len++] = p_result->request_id;
+    len          += uint16_encode((uint16_t)p_result->distance_cm, &report[len]);
+    report[len++] = p_result->quality;
+    len          += uint32_encode(p_result->initiator_us, &report[len]);
+    len          += uint32_encode(p_result->latency_us, &report[len]);
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_rtt->range_now_char_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = report;
+
+    // The gateway may have disabled notification again, the request is done either way.
+    (void)sd_ble_gatts_hvx(p_rtt->range_conn_handle, &hvx_params);
+
+    evt.evt_type    = BLE_RTT_EVT_RANGE_RESULT;
+    evt.conn_handle = p_rtt->range_conn_handle;
+    evt.range       = *p_result;
+
+    p_rtt->range_conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    if (p_rtt->evt_handler != NULL)
+    {
+        p_rtt->evt_handler(p_rtt, &evt);
+    }
+}
+
+
+/**@brief Function for giving up the single-shot request being served.
+ *
+ * @param[in] p_rtt  Ranging Service structure.
+ */
+static void range_request_fail(ble_rtt_t * p_rtt)
+{
+    ble_rtt_range_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    result.request_id  = p_rtt->range_request_id;
+    result.distance_cm = BLE_RTT_DISTANCE_INVALID;
+
+    range_result_report(p_rtt, &result);
+}
+
+
+/**@brief Function for notifying a statistics snapshot to the link that has enabled notification.
+ *
+ * @details Snapshots are sent at the rate report interval, so one that does not fit in the
+ *          notification queue is dropped rather than queued.
+ *
+ * @param[in] p_rtt   Ranging Service structure.
+ * @param[in] p_data  Snapshot encoded by rtt_stats_encode.
+ * @param[in] len     Length of the snapshot.
+ */
+static void stats_send(ble_rtt_t * p_rtt, uint8_t const * p_data, uint16_t len)
+{
+    ble_gatts_hvx_params_t hvx_params;
+
+    if (p_rtt->stats_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_rtt->stats_char_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = p_data;
+
+    (void)sd_ble_gatts_hvx(p_rtt->stats_conn_handle, &hvx_params);
+}
+
+
+/**@brief Function for handling the single-shot timeout. Runs at the same priority as the BLE events.
+ *
+ * @param[in] p_context  Ranging Service structure.
+ */
+static void range_timeout_handler(void * p_context)
+{
+    ble_rtt_t * p_rtt = (ble_rtt_t *)p_context;
+
+    if (p_rtt->range_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        range_request_fail(p_rtt);
+    }
+}
+
+
+/**@brief Function for handling a single-shot result written by the initiator.
+ *
+ * @param[in] p_rtt   Ranging Service structure.
+ * @param[in] p_data  Result, BLE_RTT_RANGE_RESULT_LEN bytes.
+ */
+static void on_range_result(ble_rtt_t * p_rtt, uint8_t const * p_data)
+{
+    ble_rtt_range_result_t result;
+
+    // A result that arrives after the timeout is dropped.
+    if (   (p_rtt->range_conn_handle == BLE_CONN_HANDLE_INVALID)
+        || (p_data[0] != p_rtt->range_request_id))
+    {
+        return;
+    }
+
+    (void)app_timer_stop(m_range_timer_id);
+
+    result.request_id   = p_data[0];
+    result.distance_cm  = (int16_t)uint16_decode(&p_data[1]);
+    result.quality      = p_data[3];
+    result.initiator_us = uint32_decode(&p_data[4]);
+
+    range_result_report(p_rtt, &result);
+}
+
+
+/**@brief Function for checking whether a link has enabled notification of the Config characteristic.
+ */
+static bool is_initiator(ble_rtt_t * p_rtt, uint16_t conn_handle)
+{
+    uint8_t           cccd[BLE_CCCD_VALUE_LEN];
+    ble_gatts_value_t value;
+
+    memset(&value, 0, sizeof(value));
+    value.len     = sizeof(cccd);
+    value.p_value = cccd;
+
+    if (sd_ble_gatts_value_get(conn_handle, p_rtt->config_char_handles.cccd_handle, &value) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    return ble_srv_is_notification_enabled(cccd);
+}
+
+
+/**@brief Function for handing single-shot requests over to another initiator when one leaves.
+ */
+static void initiator_leave(ble_rtt_t * p_rtt, uint16_t conn_handle)
+{
+    if (p_rtt->initiator_conn_handle != conn_handle)
+    {
+        return;
+    }
+
+    p_rtt->initiator_conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    for (uint8_t logical = 0; logical < RTT_INITIATORS_MAX; logical++)
+    {
+        uint16_t other = rtt_initiators_conn_handle_get(logical);
+
+        if ((other != BLE_CONN_HANDLE_INVALID) && (other != conn_handle))
+        {
+            p_rtt->initiator_conn_handle = other;
+            break;
+        }
+    }
+}
+
+
+/**@brief Function for handling a command written to the Control characteristic.
+ *
+ * @param[in] p_rtt        Ranging Service structure.
+ * @param[in] conn_handle  Connection of the initiator that wrote the command.
+ * @param[in] command      BLE_RTT_CONTROL_START or BLE_RTT_CONTROL_STOP.
+ */
+static void on_control(ble_rtt_t * p_rtt, uint16_t conn_handle, uint8_t command)
+{
+    ble_rtt_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.conn_handle = conn_handle;
+
+    switch (command)
+    {
+        case BLE_RTT_CONTROL_START:
+            evt.evt_type = BLE_RTT_EVT_RANGING_START;
+            break;
+
+        case BLE_RTT_CONTROL_STOP:
+            evt.evt_type = BLE_RTT_EVT_RANGING_STOP;
+            break;
+
+        default:
+            return;
+    }
+
+    if (p_rtt->evt_handler != NULL)
+    {
+        p_rtt->evt_handler(p_rtt, &evt);
+    }
+}
+
+
+/**@brief Function for handling the Write event on the Ranging Service.
+ *
+ * @param[in] p_rtt      Ranging Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_rtt_write(ble_rtt_t * p_rtt, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    uint16_t                      conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+    uint8_t                       tail;
+
+    if (   (p_evt_write->handle == p_rtt->config_char_handles.cccd_handle)
+        && (p_evt_write->len == 2))
+    {
+        if (ble_srv_is_notification_enabled(p_evt_write->data))
+        {
+            p_rtt->initiator_conn_handle = conn_handle;
+        }
+        else
+        {
+            rtt_initiators_remove(conn_handle);
+            initiator_leave(p_rtt, conn_handle);
+        }
+    }
+    else if (   (p_evt_write->handle == p_rtt->result_char_handles.cccd_handle)
+             && (p_evt_write->len == 2))
+    {
+        if (ble_srv_is_notification_enabled(p_evt_write->data))
+        {
+            p_rtt->gateway_conn_handle = conn_handle;
+            batches_send(p_rtt);
+        }
+        else if (p_rtt->gateway_conn_handle == conn_handle)
+        {
+            p_rtt->gateway_conn_handle = BLE_CONN_HANDLE_INVALID;
+        }
+    }
+    else if (   (p_evt_write->handle == p_rtt->stats_char_handles.cccd_handle)
+             && (p_evt_write->len == 2))
+    {
+        if (ble_srv_is_notification_enabled(p_evt_write->data))
+        {
+            p_rtt->stats_conn_handle = conn_handle;
+        }
+        else if (p_rtt->stats_conn_handle == conn_handle)
+        {
+            p_rtt->stats_conn_handle = BLE_CONN_HANDLE_INVALID;
+        }
+    }
+    else if (   (p_evt_write->handle == p_rtt->stats_char_handles.value_handle)
+             && (p_evt_write->len == BLE_RTT_STATS_LEN)
+             && (p_evt_write->data[0] == RTT_STATS_ROLE_INITIATOR)
+             && (conn_handle == p_rtt->initiator_conn_handle))
+    {
+        // Reads are authorized, so the snapshot of the initiator is only forwarded.
+        stats_send(p_rtt, p_evt_write->data, p_evt_write->len);
+    }
+    else if (   (p_evt_write->handle == p_rtt->range_now_char_handles.value_handle)
+             && (p_evt_write->op == BLE_GATTS_OP_WRITE_CMD)
+             && (p_evt_write->len == BLE_RTT_RANGE_RESULT_LEN)
+             && (conn_handle == p_rtt->initiator_conn_handle))
+    {
+        on_range_result(p_rtt, p_evt_write->data);
+    }
+    else if (   (p_evt_write->handle == p_rtt->control_char_handles.value_handle)
+             && (p_evt_write->len == BLE_RTT_CONTROL_LEN)
+             && is_initiator(p_rtt, conn_handle))
+    {
+        on_control(p_rtt, conn_handle, p_evt_write->data[0]);
+    }
+    else if (   (p_evt_write->handle == p_rtt->result_char_handles.value_handle)
+             && (p_evt_write->len > BLE_RTT_BATCH_HEADER_LEN)
+             && (p_evt_write->len <= BLE_RTT_BATCH_MAX_LEN))
+    {
+        // Batches are only kept while there is a gateway to notify.
+        if (p_rtt->gateway_conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            return;
+        }
+
+        if (p_rtt->batch_count == BLE_RTT_FORWARD_QUEUE_LEN)
+        {
+            p_rtt->batches_dropped++;
+            return;
+        }
+
+        tail = (p_rtt->batch_head + p_rtt->batch_count) % BLE_RTT_FORWARD_QUEUE_LEN;
+        memcpy(p_rtt->batches[tail], p_evt_write->data, p_evt_write->len);
+        p_rtt->batch_len[tail] = p_evt_write->len;
+        p_rtt->batch_count++;
+
+        batches_send(p_rtt);
+    }
+}
+
+
+/**@brief Function for handling a single-shot request written to the Range Now characteristic.
+ *
+ * @details The request is forwarded to the initiator before the write is answered, so the
+ *          gateway learns at once whether it will get a result.
+ *
+ * @param[in] p_rtt      Ranging Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_range_now_authorize_request(ble_rtt_t * p_rtt, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t const * p_auth      = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    uint16_t                                     conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+    ble_gatts_rw_authorize_reply_params_t        reply;
+    ble_gatts_hvx_params_t                       hvx_params;
+    ble_rtt_evt_t                                evt;
+    uint16_t                                     len;
+    uint32_t                                     err_code;
+
+    if (   (p_auth->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+        || (p_auth->request.write.handle != p_rtt->range_now_char_handles.value_handle))
+    {
+        return;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.type                = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.offset = 0;
+    reply.params.write.len    = p_auth->request.write.len;
+    reply.params.write.p_data = p_auth->request.write.data;
+
+    if (p_auth->request.write.op != BLE_GATTS_OP_WRITE_REQ)
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED;
+    }
+    else if (p_auth->request.write.len != BLE_RTT_RANGE_REQUEST_LEN)
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+    else if (p_rtt->range_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        reply.params.write.gatt_status = BLE_RTT_STATUS_RANGE_BUSY;
+    }
+    else if (p_rtt->initiator_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        reply.params.write.gatt_status = BLE_RTT_STATUS_RANGE_NO_PEER;
+    }
+    else
+    {
+        p_rtt->range_requested_at = app_timer_cnt_get();
+
+        len = BLE_RTT_RANGE_REQUEST_LEN;
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = p_rtt->range_now_char_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_auth->request.write.data;
+
+        err_code = sd_ble_gatts_hvx(p_rtt->initiator_conn_handle, &hvx_params);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INSUF_RESOURCES;
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            // The initiator has not enabled notification of single-shot requests.
+            reply.params.write.gatt_status = BLE_RTT_STATUS_RANGE_NO_PEER;
+        }
+        else
+        {
+            reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+            p_rtt->range_conn_handle       = conn_handle;
+            p_rtt->range_request_id        = p_auth->request.write.data[0];
+
+            err_code = app_timer_start(m_range_timer_id, APP_TIMER_TICKS(BLE_RTT_RANGE_TIMEOUT_MS), p_rtt);
+            APP_ERROR_CHECK(err_code);
+
+            evt.evt_type         = BLE_RTT_EVT_RANGE_REQUEST;
+            evt.conn_handle      = conn_handle;
+            memset(&evt.range, 0, sizeof(evt.range));
+            evt.range.request_id = p_rtt->range_request_id;
+
+            if (p_rtt->evt_handler != NULL)
+            {
+                p_rtt->evt_handler(p_rtt, &evt);
+            }
+        }
+    }
+
+    err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+    if (err_code != NRF_SUCCESS && err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for handling a read of the Statistics characteristic.
+ *
+ * @details A read from the start takes a fresh snapshot of this responder. The rest of a long
+ *          read is served from the same snapshot.
+ *
+ * @param[in] p_rtt      Ranging Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_stats_authorize_request(ble_rtt_t * p_rtt, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t const * p_auth = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_rw_authorize_reply_params_t        reply;
+    rtt_stats_t                                  session;
+    rtt_stats_t                                  lifetime;
+    uint16_t                                     offset;
+    uint32_t                                     err_code;
+
+    if (   (p_auth->type != BLE_GATTS_AUTHORIZE_TYPE_READ)
+        || (p_auth->request.read.handle != p_rtt->stats_char_handles.value_handle))
+    {
+        return;
+    }
+
+    offset = p_auth->request.read.offset;
+    if (offset == 0)
+    {
+        rtt_stats_get(&session, &lifetime);
+        (void)rtt_stats_encode(RTT_STATS_ROLE_RESPONDER, &session, &lifetime, p_rtt->stats);
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+
+    if (offset > BLE_RTT_STATS_LEN)
+    {
+        reply.params.read.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_OFFSET;
+    }
+    else
+    {
+        reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+        reply.params.read.update      = 1;
+        reply.params.read.offset      = offset;
+        reply.params.read.len         = BLE_RTT_STATS_LEN - offset;
+        reply.params.read.p_data      = &p_rtt->stats[offset];
+    }
+
+    err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &reply);
+    if (err_code != NRF_SUCCESS && err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for handling a write to the Config characteristic.
+ *
+ * @details The configuration is checked before the write is answered, so the writer learns
+ *          whether it was accepted.
+ *
+ * @param[in] p_rtt      Ranging Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_rtt_rw_authorize_request(ble_rtt_t * p_rtt, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t const * p_auth      = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    uint16_t                                     conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+    ble_gatts_rw_authorize_reply_params_t        reply;
+    ble_gatts_hvx_params_t                       hvx_params;
+    rtt_config_t                                 config;
+    uint16_t                                     len;
+    uint32_t                                     err_code;
+
+    if (   (p_auth->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+        || (p_auth->request.write.handle != p_rtt->config_char_handles.value_handle))
+    {
+        return;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.type                = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.offset = 0;
+    reply.params.write.len    = p_auth->request.write.len;
+    reply.params.write.p_data = p_auth->request.write.data;
+
+    if (p_auth->request.write.op != BLE_GATTS_OP_WRITE_REQ)
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED;
+    }
+    else
+    {
+        err_code = rtt_config_decode(p_auth->request.write.data, p_auth->request.write.len, &config);
+        switch (err_code)
+        {
+            case NRF_SUCCESS:
+                reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+                break;
+
+            case NRF_ERROR_INVALID_LENGTH:
+                reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+                break;
+
+            case NRF_ERROR_NOT_SUPPORTED:
+                reply.params.write.gatt_status = BLE_RTT_STATUS_CONFIG_VERSION;
+                break;
+
+            default:
+                reply.params.write.gatt_status = BLE_RTT_STATUS_CONFIG_INVALID;
+                break;
+        }
+    }
+
+    if (reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        if (is_initiator(p_rtt, conn_handle))
+        {
+            // Serve the initiator on its link and address, next to the others. Its configuration
+            // is only taken into use while it is the only initiator.
+            if (rtt_initiators_add(conn_handle, &config) == NRF_SUCCESS)
+            {
+                reply.params.write.update = 1;
+            }
+            else
+            {
+                reply.params.write.gatt_status = BLE_RTT_STATUS_CONFIG_LINK;
+            }
+        }
+        else if (p_rtt->initiator_conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            // Let the initiator take it into use at its next session.
+            len = p_auth->request.write.len;
+
+            memset(&hvx_params, 0, sizeof(hvx_params));
+            hvx_params.handle = p_rtt->config_char_handles.value_handle;
+            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+            hvx_params.p_len  = &len;
+            hvx_params.p_data = p_auth->request.write.data;
+
+            err_code = sd_ble_gatts_hvx(p_rtt->initiator_conn_handle, &hvx_params);
+            if (err_code != NRF_SUCCESS)
+            {
+                reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INSUF_RESOURCES;
+            }
+        }
+        else
+        {
+            // The value is updated when the configuration is staged here.
+            (void)rtt_config_stage(&config);
+            reply.params.write.update = 1;
+        }
+    }
+
+    err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+    if (err_code != NRF_SUCCESS && err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+void ble_rtt_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_rtt_t * p_rtt = (ble_rtt_t *)p_context;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTS_EVT_WRITE:
+            on_rtt_write(p_rtt, p_ble_evt);
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rtt_rw_authorize_request(p_rtt, p_ble_evt);
+            on_range_now_authorize_request(p_rtt, p_ble_evt);
+            on_stats_authorize_request(p_rtt, p_ble_evt);
+            break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            if (p_ble_evt->evt.gatts_evt.conn_handle == p_rtt->gateway_conn_handle)
+            {
+                batches_send(p_rtt);
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_rtt->gateway_conn_handle)
+            {
+                p_rtt->gateway_conn_handle = BLE_CONN_HANDLE_INVALID;
+                p_rtt->batch_count         = 0;
+            }
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_rtt->initiator_conn_handle)
+            {
+                initiator_leave(p_rtt, p_ble_evt->evt.gap_evt.conn_handle);
+
+                // The single-shot request being served will not be answered.
+                if (p_rtt->range_conn_handle != BLE_CONN_HANDLE_INVALID)
+                {
+                    (void)app_timer_stop(m_range_timer_id);
+                    range_request_fail(p_rtt);
+                }
+            }
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_rtt->stats_conn_handle)
+            {
+                p_rtt->stats_conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_rtt->range_conn_handle)
+            {
+                (void)app_timer_stop(m_range_timer_id);
+                p_rtt->range_conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+uint32_t ble_rtt_init(ble_rtt_t * p_rtt, ble_rtt_init_t const * p_rtt_init)
+{
+    uint32_t              err_code;
+    ble_uuid_t            ble_uuid;
+    ble_add_char_params_t add_char_params;
+
+    // Initialize service structure.
+    p_rtt->evt_handler           = p_rtt_init->evt_handler;
+    p_rtt->gateway_conn_handle   = BLE_CONN_HANDLE_INVALID;
+    p_rtt->initiator_conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_rtt->range_conn_handle     = BLE_CONN_HANDLE_INVALID;
+    p_rtt->stats_conn_handle     = BLE_CONN_HANDLE_INVALID;
+    p_rtt->batch_head          = 0;
+    p_rtt->batch_count         = 0;
+    p_rtt->batches_dropped     = 0;
+
+    err_code = app_timer_create(&m_range_timer_id, APP_TIMER_MODE_SINGLE_SHOT, range_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    // Add service.
+    ble_uuid128_t base_uuid = {LBS_UUID_BASE};
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_rtt->uuid_type);
+    VERIFY_SUCCESS(err_code);
+
+    ble_uuid.type = p_rtt->uuid_type;
+    ble_uuid.uuid = RTT_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_rtt->service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    // Add Result characteristic.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid                     = RTT_UUID_RESULT_CHAR;
+    add_char_params.uuid_type                = p_rtt->uuid_type;
+    add_char_params.init_len                 = 0;
+    add_char_params.max_len                  = BLE_RTT_BATCH_MAX_LEN;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.char_props.notify        = 1;
+
+    add_char_params.read_access       = SEC_OPEN;
+    add_char_params.write_access      = SEC_OPEN;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_rtt->service_handle, &add_char_params, &p_rtt->result_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add Config characteristic, holding the configuration in use.
+    uint8_t config[RTT_CONFIG_ENCODED_LEN];
+
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid              = RTT_UUID_CONFIG_CHAR;
+    add_char_params.uuid_type         = p_rtt->uuid_type;
+    add_char_params.init_len          = rtt_config_encode(rtt_config_get(), config);
+    add_char_params.max_len           = RTT_CONFIG_ENCODED_LEN;
+    add_char_params.p_init_value      = config;
+    add_char_params.is_var_len        = true;
+    add_char_params.char_props.read   = 1;
+    add_char_params.char_props.write  = 1;
+    add_char_params.char_props.notify = 1;
+    add_char_params.is_defered_write  = true;
+
+    add_char_params.read_access       = SEC_OPEN;
+    add_char_params.write_access      = SEC_OPEN;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_rtt->service_handle, &add_char_params, &p_rtt->config_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add Range Now characteristic. Requests are written with response, results without.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid                     = RTT_UUID_RANGE_NOW_CHAR;
+    add_char_params.uuid_type                = p_rtt->uuid_type;
+    add_char_params.init_len                 = 0;
+    add_char_params.max_len                  = BLE_RTT_RANGE_REPORT_LEN;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.write         = 1;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.char_props.notify        = 1;
+    add_char_params.is_defered_write         = true;
+
+    add_char_params.read_access       = SEC_OPEN;
+    add_char_params.write_access      = SEC_OPEN;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_rtt->service_handle, &add_char_params, &p_rtt->range_now_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add Statistics characteristic. Reads take a fresh snapshot, the initiator writes its own.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid                     = RTT_UUID_STATS_CHAR;
+    add_char_params.uuid_type                = p_rtt->uuid_type;
+    add_char_params.init_len                 = 0;
+    add_char_params.max_len                  = BLE_RTT_STATS_LEN;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.read          = 1;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.char_props.notify        = 1;
+    add_char_params.is_defered_read          = true;
+
+    add_char_params.read_access       = SEC_OPEN;
+    add_char_params.write_access      = SEC_OPEN;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_rtt->service_handle, &add_char_params, &p_rtt->stats_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add Control characteristic, written by the initiators when they start and stop ranging.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid                     = RTT_UUID_CONTROL_CHAR;
+    add_char_params.uuid_type                = p_rtt->uuid_type;
+    add_char_params.init_len                 = 0;
+    add_char_params.max_len                  = BLE_RTT_CONTROL_LEN;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.write_wo_resp = 1;
+
+    add_char_params.read_access       = SEC_OPEN;
+    add_char_params.write_access      = SEC_OPEN;
+
+    return characteristic_add(p_rtt->service_handle, &add_char_params, &p_rtt->control_char_handles);
+}
+
+
+void ble_rtt_stats_send(ble_rtt_t * p_rtt)
+{
+    rtt_stats_t session;
+    rtt_stats_t lifetime;
+    uint8_t     stats[BLE_RTT_STATS_LEN];
+    uint16_t    len;
+
+    rtt_stats_get(&session, &lifetime);
+    len = rtt_stats_encode(RTT_STATS_ROLE_RESPONDER, &session, &lifetime, stats);
+
+    stats_send(p_rtt, stats, len);
+}
@@ -58,6 +58,8 @@
 #include "ble.h"
 #include "ble_srv_common.h"
 #include "nrf_sdh_ble.h"
+#include "rtt_config.h"
+#include "rtt_stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,11 +76,115 @@ NRF_SDH_BLE_OBSERVER(_name ## _obs,
                      BLE_LBS_BLE_OBSERVER_PRIO,                                                     \
                      ble_lbs_on_ble_evt, &_name)
 
+/**@brief   Macro for defining a ble_rtt instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_RTT_DEF(_name)                                                                          \
+static ble_rtt_t _name;                                                                             \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_RTT_BLE_OBSERVER_PRIO,                                                     \
+                     ble_rtt_on_ble_evt, &_name)
+
 #define LBS_UUID_BASE        {0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15, \
                               0xDE, 0xEF, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00}
 #define LBS_UUID_SERVICE     0x1523
 #define LBS_UUID_LED_CHAR    0x1525
 
+#define RTT_UUID_SERVICE     0x1530
+#define RTT_UUID_RESULT_CHAR 0x1531
+#define RTT_UUID_CONFIG_CHAR 0x1532
+#define RTT_UUID_RANGE_NOW_CHAR 0x1533
+#define RTT_UUID_STATS_CHAR  0x1534
+#define RTT_UUID_CONTROL_CHAR 0x1535
+
+#ifndef BLE_RTT_BLE_OBSERVER_PRIO
+#define BLE_RTT_BLE_OBSERVER_PRIO 2
+#endif
+
+/**@brief Ranging result batches
+ *
+ * @details The initiator writes batches of result records to the Result characteristic, and
+ *          the batches are notified unchanged to the gateways that have enabled notification.
+ *          A batch is a one byte sequence number followed by up to BLE_RTT_BATCH_RECORDS_MAX
+ *          records of BLE_RTT_RECORD_LEN bytes, little endian:
+ *
+ *          | Offset | Size | Field                                                      |
+ *          |--------|------|------------------------------------------------------------|
+ *          | 0      | 4    | Timestamp, milliseconds since the initiator started         |
+ *          | 4      | 2    | Distance in centimeters, signed. BLE_RTT_DISTANCE_INVALID if none |
+ *          | 6      | 1    | Quality, percentage of exchanges that got a valid response |
+ *          | 7      | 1    | Peer, index of the responder                               |
+ */
+#define BLE_RTT_BATCH_HEADER_LEN  1
+#define BLE_RTT_RECORD_LEN        8
+#define BLE_RTT_BATCH_MAX_LEN     (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< ATT payload: MTU less opcode and handle. */
+#define BLE_RTT_BATCH_RECORDS_MAX ((BLE_RTT_BATCH_MAX_LEN - BLE_RTT_BATCH_HEADER_LEN) / BLE_RTT_RECORD_LEN)
+#define BLE_RTT_DISTANCE_INVALID  INT16_MIN
+#define BLE_RTT_FORWARD_QUEUE_LEN 4  /**< Number of batches waiting to be notified. */
+
+/**@brief Ranging configuration
+ *
+ * @details The Config characteristic holds a configuration encoded as described in rtt_config.h.
+ *          An initiator, a link that has enabled notification of the Config characteristic, is
+ *          served on the link and address of the configuration it writes, see rtt_initiators.h.
+ *          Its configuration is staged and taken into use at the next timeslot request while it
+ *          is the only initiator, and left out of the one in use otherwise. Initiators
+ *          only write between sessions. A configuration written by any other link is notified
+ *          to the initiator that enabled notification last, which writes it back at the start
+ *          of its next session. Without an initiator it is staged directly. Writes are answered
+ *          with these application error codes when the configuration is not accepted.
+ */
+#define BLE_RTT_STATUS_CONFIG_VERSION  (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0) /**< Unknown format version. */
+#define BLE_RTT_STATUS_CONFIG_INVALID  (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 1) /**< A field is out of range. */
+#define BLE_RTT_STATUS_CONFIG_LINK     (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 4) /**< The link cannot be served with those of the other initiators. */
+
+/**@brief Single-shot ranging
+ *
+ * @details A gateway that has enabled notification of the Range Now characteristic writes a one
+ *          byte request id to it, with response. The request id is notified to the initiator,
+ *          which runs one burst and writes back BLE_RTT_RANGE_RESULT_LEN bytes. The result is
+ *          notified to the gateway with the time from the request to the result appended,
+ *          BLE_RTT_RANGE_REPORT_LEN bytes, little endian:
+ *
+ *          | Offset | Size | Field                                                      |
+ *          |--------|------|------------------------------------------------------------|
+ *          | 0      | 1    | Request id                                                 |
+ *          | 1      | 2    | Distance in centimeters, signed. BLE_RTT_DISTANCE_INVALID if none |
+ *          | 3      | 1    | Quality, percentage of exchanges that got a valid response |
+ *          | 4      | 4    | Initiator time in microseconds, from the request to the result |
+ *          | 8      | 4    | Latency in microseconds, from the request write to the result here |
+ *
+ *          One request is served at a time. A request the initiator has not answered within
+ *          BLE_RTT_RANGE_TIMEOUT_MS is reported without a distance.
+ */
+#define BLE_RTT_RANGE_REQUEST_LEN 1
+#define BLE_RTT_RANGE_RESULT_LEN  8
+#define BLE_RTT_RANGE_REPORT_LEN  12
+#define BLE_RTT_RANGE_TIMEOUT_MS  250
+#define BLE_RTT_STATUS_RANGE_BUSY      (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2) /**< Another request is being served. */
+#define BLE_RTT_STATUS_RANGE_NO_PEER   (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 3) /**< No initiator takes single-shot requests. */
+
+/**@brief Ranging statistics
+ *
+ * @details Reading the Statistics characteristic takes a snapshot of the statistics of this
+ *          responder, encoded as described in rtt_stats.h. The initiator writes its own snapshot
+ *          without response at every rate report. The snapshots of both are notified to the link
+ *          that has enabled notification, and are told apart by the role in their first byte.
+ */
+#define BLE_RTT_STATS_LEN RTT_STATS_ENCODED_LEN
+
+/**@brief Ranging control
+ *
+ * @details An initiator writes one of these commands without response to the Control
+ *          characteristic when its ranging session starts and when it stops. The responder
+ *          listens for as long as one of the initiators it is connected to ranges.
+ */
+#define BLE_RTT_CONTROL_LEN   1
+#define BLE_RTT_CONTROL_STOP  0x00 /**< The initiator has stopped ranging. */
+#define BLE_RTT_CONTROL_START 0x01 /**< The initiator has started ranging. */
+
 
 // Forward declaration of the ble_lbs_t type.
 typedef struct ble_lbs_s ble_lbs_t;
@@ -103,6 +209,70 @@ struct ble_lbs_s
 };
 
 
+/**@brief Ranging Service event type. */
+typedef enum
+{
+    BLE_RTT_EVT_RANGE_REQUEST, /**< A single-shot request has been forwarded to the initiator. */
+    BLE_RTT_EVT_RANGE_RESULT,  /**< A single-shot result has been notified to the gateway. */
+    BLE_RTT_EVT_RANGING_START, /**< An initiator has started ranging. */
+    BLE_RTT_EVT_RANGING_STOP   /**< An initiator has stopped ranging. */
+} ble_rtt_evt_type_t;
+
+/**@brief Result of a single-shot ranging request. */
+typedef struct
+{
+    uint8_t  request_id;   /**< Request id written by the gateway. */
+    int16_t  distance_cm;  /**< Distance in centimeters, BLE_RTT_DISTANCE_INVALID if none. */
+    uint8_t  quality;      /**< Percentage of exchanges that got a valid response. */
+    uint32_t initiator_us; /**< Time the initiator took, from the request notification to the result write. */
+    uint32_t latency_us;   /**< Time from the request write to the result, measured here. */
+} ble_rtt_range_result_t;
+
+/**@brief Ranging Service event. */
+typedef struct
+{
+    ble_rtt_evt_type_t     evt_type;    /**< Type of the event. */
+    uint16_t               conn_handle; /**< Connection of the gateway that made the request, or of the initiator that wrote the Control characteristic. */
+    ble_rtt_range_result_t range;       /**< Request id, and the result for @ref BLE_RTT_EVT_RANGE_RESULT. */
+} ble_rtt_evt_t;
+
+// Forward declaration of the ble_rtt_t type.
+typedef struct ble_rtt_s ble_rtt_t;
+
+/**@brief Ranging Service event handler type. */
+typedef void (*ble_rtt_evt_handler_t) (ble_rtt_t * p_rtt, ble_rtt_evt_t const * p_evt);
+
+/**@brief Ranging Service init structure. */
+typedef struct
+{
+    ble_rtt_evt_handler_t evt_handler; /**< Event handler to be called for single-shot requests and control commands. May be NULL. */
+} ble_rtt_init_t;
+
+/**@brief Ranging Service structure. This structure contains various status information for the service. */
+struct ble_rtt_s
+{
+    uint16_t                 service_handle;      /**< Handle of Ranging Service (as provided by the BLE stack). */
+    ble_gatts_char_handles_t result_char_handles; /**< Handles related to the Result Characteristic. */
+    ble_gatts_char_handles_t config_char_handles; /**< Handles related to the Config Characteristic. */
+    ble_gatts_char_handles_t range_now_char_handles; /**< Handles related to the Range Now Characteristic. */
+    ble_gatts_char_handles_t stats_char_handles;  /**< Handles related to the Statistics Characteristic. */
+    ble_gatts_char_handles_t control_char_handles; /**< Handles related to the Control Characteristic. */
+    ble_rtt_evt_handler_t    evt_handler;         /**< Event handler to be called for single-shot requests and control commands. */
+    uint8_t                  uuid_type;           /**< UUID type for the Ranging Service. */
+    uint16_t                 gateway_conn_handle; /**< Connection with notification of the Result Characteristic enabled. */
+    uint16_t                 initiator_conn_handle; /**< Connection that enabled notification of the Config Characteristic last, taking single-shot requests. */
+    uint16_t                 stats_conn_handle;   /**< Connection with notification of the Statistics Characteristic enabled. */
+    uint8_t                  batches[BLE_RTT_FORWARD_QUEUE_LEN][BLE_RTT_BATCH_MAX_LEN]; /**< Batches waiting to be notified. */
+    uint16_t                 batch_len[BLE_RTT_FORWARD_QUEUE_LEN];                      /**< Length of each waiting batch. */
+    uint8_t                  batch_head;          /**< Index of the next batch to notify. */
+    uint8_t                  batch_count;         /**< Number of batches waiting. */
+    uint32_t                 batches_dropped;     /**< Number of batches dropped because the queue was full. */
+    uint16_t                 range_conn_handle;   /**< Connection of the gateway waiting for a single-shot result. */
+    uint8_t                  stats[BLE_RTT_STATS_LEN]; /**< Statistics snapshot being read. */
+    uint8_t                  range_request_id;    /**< Id of the single-shot request being served. */
+    uint32_t                 range_requested_at;  /**< RTC counter when the single-shot request was written. */
+};
+
 /**@brief Function for initializing the LED Button Service.
  *
  * @param[out] p_lbs      LED Button Service structure. This structure must be supplied by
@@ -124,6 +294,38 @@ uint32_t ble_lbs_init(ble_lbs_t * p_lbs, const ble_lbs_init_t * p_lbs_init);
  */
 void ble_lbs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
 
+
+/**@brief Function for initializing the Ranging Service.
+ *
+ * @param[out] p_rtt      Ranging Service structure. This structure must be supplied by
+ *                        the application. It is initialized by this function and will later
+ *                        be used to identify this particular service instance.
+ * @param[in] p_rtt_init  Information needed to initialize the service.
+ *
+ * @retval NRF_SUCCESS If the service was initialized successfully. Otherwise, an error code is returned.
+ */
+uint32_t ble_rtt_init(ble_rtt_t * p_rtt, ble_rtt_init_t const * p_rtt_init);
+
+
+/**@brief Function for handling the application's BLE stack events.
+ *
+ * @details This function handles all events from the BLE stack that are of interest to the Ranging Service.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ * @param[in] p_context  Ranging Service structure.
+ */
+void ble_rtt_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Function for notifying a statistics snapshot of this responder.
+ *
+ * @details Does nothing if no link has enabled notification of the Statistics characteristic.
+ *          A snapshot that does not fit in the notification queue is dropped.
+ *
+ * @param[in] p_rtt  Ranging Service structure.
+ */
+void ble_rtt_stats_send(ble_rtt_t * p_rtt);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,8 +33,10 @@
 #include "ble_srv_common.h"
 #include "ble_advdata.h"
 #include "ble_conn_params.h"
+#include "ble_conn_state.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
+#include "nrf_soc.h"
 #include "boards.h"
 #include "app_timer.h"
 #include "ble_rtt.h"
@@ -46,7 +48,10 @@
 #include "nrf_log_default_backends.h"
 #include "radio_002.h"
 #include "timeslot.h"
+#include "rtt_stats.h"
 #include "rtt_parameters.h"
+#include "rtt_config.h"
+#include "rtt_initiators.h"
 
 #define ADVERTISING_LED                 BSP_BOARD_LED_0                         /**< Is on when device is advertising. */
 #define CONNECTED_LED                   BSP_BOARD_LED_1                         /**< Is on when device has connected. */
@@ -59,11 +64,15 @@
 
 #define DEAD_BEEF                       0xDEADBEEF                              /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
+#define RATE_REPORT_INTERVAL            APP_TIMER_TICKS(RATE_REPORT_INTERVAL_MS)  /**< Interval between reports of the achieved ranging rate (in number of timer ticks). */
+
 BLE_LBS_DEF(m_lbs);                                                             /**< LED Button Service instance. */
+BLE_RTT_DEF(m_rtt);                                                             /**< Ranging Service instance. */
 NRF_BLE_GATT_DEF(m_gatt);                                                       /**< GATT module instance. */
-NRF_BLE_QWR_DEF(m_qwr);                                                         /**< Context for the Queued Write module.*/
+NRF_BLE_QWRS_DEF(m_qwr, NRF_SDH_BLE_TOTAL_LINK_COUNT);                          /**< Contexts for the Queued Write module, one for each link. */
+APP_TIMER_DEF(m_rate_timer_id);                                                 /**< Ranging rate report timer. */
 
-static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID;                        /**< Handle of the current connection. */
+static uint32_t m_ranging_links = 0;                                            /**< Links whose initiator ranges, one bit per connection index. */
 
 static uint8_t m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET;                   /**< Advertising handle used to identify an advertising set. */
 static uint8_t m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];                    /**< Buffer for storing an encoded advertising set. */
@@ -111,16 +120,60 @@ static void leds_init(void)
     bsp_board_init(BSP_INIT_LEDS);
 }
 
-/**@brief Function for the pins initialization.
+/**@brief Function for handling the ranging rate report timer.
+ *
+ * @details Logs the rate of bursts served against the rate requested from the scheduler and
+ *          the counters of every initiator served, notifies the statistics, and updates the
+ *          temperature sent to the initiator in the ranging responses.
+ *
+ * @param[in] p_context  Unused.
  */
-static void pins_init(void)
+static void rate_timer_handler(void * p_context)
 {
-    nrf_gpio_cfg_output(DATAPIN_1);
-    nrf_gpio_cfg_output(DATAPIN_2);
-    nrf_gpio_cfg_output(DATAPIN_3);
-    nrf_gpio_cfg_output(DATAPIN_4);
+    timeslot_schedule_t schedule;
+    uint32_t            bursts;
+    uint32_t            blocked;
+    uint32_t            achieved_mhz;
+    int32_t             temperature;
+
+    // The TEMP peripheral belongs to the SoftDevice, and cannot be read from the timeslot.
+    if (sd_temp_get(&temperature) == NRF_SUCCESS)
+    {
+        radio_temperature_set(temperature);
+    }
+
+    ble_rtt_stats_send(&m_rtt);
+
+    timeslot_rate_get(&bursts, &blocked);
+    if (!timeslot_is_running())
+    {
+        return;
+    }
+
+    timeslot_schedule_get(&schedule);
+    achieved_mhz = (uint32_t)(((uint64_t)bursts * 1000000UL) / RATE_REPORT_INTERVAL_MS);
+
+    NRF_LOG_INFO("Ranging rate: requested %u Hz, achieved %u.%03u Hz, %u blocked, %s.",
+                 schedule.rate_hz, achieved_mhz / 1000, achieved_mhz % 1000, blocked,
+                 timeslot_is_synced() ? "synced" : "searching");
+
+    for (uint8_t logical = 0; logical < RTT_INITIATORS_MAX; logical++)
+    {
+        rtt_stats_t stats;
+        uint16_t    conn_handle = rtt_initiators_conn_handle_get(logical);
+
+        if (conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        rtt_initiators_stats_get(logical, &stats);
+        NRF_LOG_INFO("Initiator %u on address %u: %u windows, %u missed, %u received, %u responses.",
+                     conn_handle, logical, stats.bursts, stats.rx_timeouts, stats.rx_crc_ok, stats.tx);
+    }
 }
 
+
 /**@brief Function for the Timer initialization.
  *
  * @details Initializes the timer module.
@@ -130,6 +183,9 @@ static void timers_init(void)
     // Initialize timer module, making it use the scheduler
     ret_code_t err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_rate_timer_id, APP_TIMER_MODE_REPEATED, rate_timer_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -233,6 +289,68 @@ static void nrf_qwr_error_handler(uint32_t nrf_error)
 }
 
 
+/**@brief Function for starting to serve the initiator, if not already serving it.
+ *
+ * @details Starts a new statistics session when the timeslots start.
+ */
+static void ranging_start(void)
+{
+    if (timeslot_start() == NRF_SUCCESS)
+    {
+        rtt_stats_session_start();
+    }
+}
+
+
+/**@brief Function for stopping to serve the initiators, if serving them.
+ *
+ * @details The timeslot in progress is completed, and no other is requested.
+ */
+static void ranging_stop(void)
+{
+    if (timeslot_is_running())
+    {
+        timeslot_stop();
+        NRF_LOG_INFO("Ranging stopped.");
+    }
+}
+
+
+/**@brief Function for recording whether the initiator on a link ranges.
+ *
+ * @details The initiators are served for as long as one of them ranges, so the responder does
+ *          not listen for initiators that have stopped or gone.
+ *
+ * @param[in] conn_handle  Connection of the initiator.
+ * @param[in] ranging      Whether the initiator ranges.
+ */
+static void ranging_link_set(uint16_t conn_handle, bool ranging)
+{
+    uint16_t conn_idx = ble_conn_state_conn_idx(conn_handle);
+    uint32_t link;
+
+    if (conn_idx >= BLE_CONN_STATE_MAX_CONNECTIONS)
+    {
+        return;
+    }
+
+    link = (1UL << conn_idx);
+    if (ranging)
+    {
+        m_ranging_links |= link;
+        ranging_start();
+    }
+    else if (m_ranging_links & link)
+    {
+        m_ranging_links &= ~link;
+        if (m_ranging_links == 0)
+        {
+            ranging_stop();
+        }
+    }
+}
+
+
 /**@brief Function for handling write events to the LED characteristic.
  *
  * @param[in] p_lbs     Instance of LED Button Service to which the write applies.
@@ -250,7 +368,47 @@ static void led_write_handler(uint16_t conn_handle, ble_lbs_t * p_lbs, uint8_t l
         bsp_board_led_off(LEDBUTTON_LED);
         NRF_LOG_INFO("Received LED OFF!");
     }
-    request_next_event_earliest();
+}
+
+
+/**@brief Function for handling single-shot ranging and control events from the Ranging Service.
+ *
+ * @param[in] p_rtt  Ranging Service instance.
+ * @param[in] p_evt  Event.
+ */
+static void rtt_evt_handler(ble_rtt_t * p_rtt, ble_rtt_evt_t const * p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case BLE_RTT_EVT_RANGE_REQUEST:
+            // The initiator ranges at once, outside the windows that follow its schedule.
+            timeslot_search();
+            ranging_start();
+            break;
+
+        case BLE_RTT_EVT_RANGE_RESULT:
+            NRF_LOG_INFO("Single-shot %u: %d cm, quality %u %%, latency %u us (initiator %u us).",
+                         p_evt->range.request_id, p_evt->range.distance_cm, p_evt->range.quality,
+                         p_evt->range.latency_us, p_evt->range.initiator_us);
+            // A request served while no initiator ranges does not keep the responder listening.
+            if (m_ranging_links == 0)
+            {
+                ranging_stop();
+            }
+            break;
+
+        case BLE_RTT_EVT_RANGING_START:
+            ranging_link_set(p_evt->conn_handle, true);
+            break;
+
+        case BLE_RTT_EVT_RANGING_STOP:
+            ranging_link_set(p_evt->conn_handle, false);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
 }
 
 
@@ -260,19 +418,29 @@ static void services_init(void)
 {
     ret_code_t         err_code;
     ble_lbs_init_t     init     = {0};
+    ble_rtt_init_t     rtt_init = {0};
     nrf_ble_qwr_init_t qwr_init = {0};
 
     // Initialize Queued Write Module.
     qwr_init.error_handler = nrf_qwr_error_handler;
 
-    err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
-    APP_ERROR_CHECK(err_code);
+    for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+    {
+        err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+        APP_ERROR_CHECK(err_code);
+    }
 
     // Initialize LBS.
     init.led_write_handler = led_write_handler;
 
     err_code = ble_lbs_init(&m_lbs, &init);
     APP_ERROR_CHECK(err_code);
+
+    // Initialize the Ranging Service.
+    rtt_init.evt_handler = rtt_evt_handler;
+
+    err_code = ble_rtt_init(&m_rtt, &rtt_init);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -293,7 +461,7 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 
     if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
     {
-        err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        err_code = sd_ble_gap_disconnect(p_evt->conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
     }
 }
@@ -333,18 +501,51 @@ static void conn_params_init(void)
 
 
 /**@brief Function for starting advertising.
+ *
+ * @details Advertising continues after the first connection, so that a gateway can connect
+ *          alongside the initiator, until all peripheral links are in use.
  */
 static void advertising_start(void)
 {
     ret_code_t           err_code;
 
+    if (ble_conn_state_peripheral_conn_count() >= NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+    {
+        bsp_board_led_off(ADVERTISING_LED);
+        return;
+    }
+
     err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
-    APP_ERROR_CHECK(err_code);
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        // NRF_ERROR_INVALID_STATE: already advertising.
+        APP_ERROR_CHECK(err_code);
+    }
 
     bsp_board_led_on(ADVERTISING_LED);
 }
 
 
+/**@brief Go back to the shared radio link once no initiator is connected.
+ *
+ * @details The link of an initiator is private to its connection. The next initiator writes
+ *          its own before it ranges, or finds the responder on the shared link.
+ */
+static void shared_link_restore(void)
+{
+    rtt_config_t config = *rtt_config_get();
+
+    if ((config.access_address == RTT_CONFIG_ACCESS_ADDRESS_DEFAULT) && (config.hop_seed == 0))
+    {
+        return;
+    }
+
+    config.access_address = RTT_CONFIG_ACCESS_ADDRESS_DEFAULT;
+    config.hop_seed       = 0;
+    (void)rtt_config_stage(&config);
+}
+
+
 /**@brief Function for handling BLE events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -352,6 +553,7 @@ static void advertising_start(void)
 static void ble_evt_handler(ble_evt_t const * p_ble_evt)
 {
     ret_code_t err_code;
+    uint16_t   conn_idx;
 
     switch (p_ble_evt->header.evt_id)
     {
@@ -359,21 +561,28 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
             NRF_LOG_INFO("Connected");
             bsp_board_led_on(CONNECTED_LED);
             bsp_board_led_off(ADVERTISING_LED);
-            m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
+            conn_idx = ble_conn_state_conn_idx(p_ble_evt->evt.gap_evt.conn_handle);
+            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[conn_idx], p_ble_evt->evt.gap_evt.conn_handle);
             APP_ERROR_CHECK(err_code);
+            advertising_start();
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected");
-            bsp_board_led_off(CONNECTED_LED);
-            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            rtt_initiators_remove(p_ble_evt->evt.gap_evt.conn_handle);
+            ranging_link_set(p_ble_evt->evt.gap_evt.conn_handle, false);
+            if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                bsp_board_led_off(CONNECTED_LED);
+                shared_link_restore();
+                ranging_stop();
+            }
             advertising_start();
             break;
 
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
             // Pairing not supported
-            err_code = sd_ble_gap_sec_params_reply(m_conn_handle,
+            err_code = sd_ble_gap_sec_params_reply(p_ble_evt->evt.gap_evt.conn_handle,
                                                    BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP,
                                                    NULL,
                                                    NULL);
@@ -394,7 +603,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
 
         case BLE_GATTS_EVT_SYS_ATTR_MISSING:
             // No system attributes have been stored.
-            err_code = sd_ble_gatts_sys_attr_set(m_conn_handle, NULL, 0, 0);
+            err_code = sd_ble_gatts_sys_attr_set(p_ble_evt->evt.gatts_evt.conn_handle, NULL, 0, 0);
             APP_ERROR_CHECK(err_code);
             break;
 
@@ -433,7 +642,6 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt)
 static void ble_evt_dispatch(ble_evt_t const * p_ble_evt, void * p_context)
 {
     ble_evt_handler(p_ble_evt);
-    nrf_evt_signal_handler((uint32_t) p_ble_evt->header.evt_id);
 }
 
 /**@brief Function for initializing the BLE stack.
@@ -501,9 +709,9 @@ int main(void)
     // Initialize.
     log_init();
     leds_init();
-    pins_init();
     timers_init();
     power_management_init();
+    rtt_initiators_init();
     ble_stack_init();
     gap_params_init();
     gatt_init();
@@ -511,7 +719,11 @@ int main(void)
     advertising_init();
     conn_params_init();
 
-    timeslot_sd_init();
+    ret_code_t err_code = timeslot_sd_init();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_rate_timer_id, RATE_REPORT_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
 
     // Start execution.
     NRF_LOG_INFO("Blinky example started.");
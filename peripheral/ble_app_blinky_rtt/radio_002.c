@@ -36,26 +36,110 @@
 #include "nrf_log_default_backends.h"
 #include <stdlib.h>
 #include "rtt_parameters.h"
+#include "rtt_config.h"
+#include "rtt_telemetry.h"
+#include "rtt_stats.h"
+#include "rtt_trace.h"
+#include "rtt_initiators.h"
 
 #define NRF_GPIO NRF_P0
 
-static uint32_t radio_freq = 78;
-static uint32_t attempts = 0;
 static uint8_t test_frame[256];
-static uint32_t rx_pkt_counter = 0;
-static uint32_t rx_pkt_counter_crcok = 0;
-static uint32_t dbgcnt1=0;
-static uint32_t tx_pkt_counter = 0;
+
+/* Responder statistics since start-up, only written by do_rtt_measurement */
+static rtt_stats_t m_stats;
 
 static uint8_t response_test_frame[255] = 
     {0x00, 0x04, 0xFF, 0xC1, 0xFB, 0xE8};
 
+/* Telemetry carried in the last two bytes of the response, see rtt_telemetry.h. Every initiator
+ * gets its own fields, indexed by logical address. */
+static uint8_t          m_telemetry_field[RTT_INITIATORS_MAX];
+static uint8_t          m_telemetry_byte[RTT_INITIATORS_MAX];
+static uint32_t         m_telemetry_value[RTT_INITIATORS_MAX];
+static int32_t          m_rssi_dbm[RTT_INITIATORS_MAX];
+static volatile int32_t m_temperature     = 0;
+
+/**
+ * @brief Sets the die temperature sent as telemetry
+ *
+ * @param[in] temperature Temperature in 0.25 degrees Celsius, from sd_temp_get
+ */
+void radio_temperature_set(int32_t temperature)
+{
+    m_temperature = temperature;
+}
+
+/**
+ * @brief Writes the current telemetry byte into the response packet
+ *
+ * The field value is taken when its first byte is written, so the initiator gets all four
+ * bytes of the same value. The counters are those of the initiator on the logical address.
+ *
+ * @param[in] logical Logical address the request was received on
+ */
+static void telemetry_write(uint8_t logical)
+{
+    rtt_stats_t const * p_stats = rtt_initiators_stats(logical);
+
+    if (m_telemetry_byte[logical] == 0)
+    {
+        switch (m_telemetry_field[logical])
+        {
+            case RTT_TELEMETRY_RX_OK:
+                m_telemetry_value[logical] = p_stats->rx_crc_ok;
+                break;
+
+            case RTT_TELEMETRY_RX_CRC_ERROR:
+                m_telemetry_value[logical] = p_stats->rx_crc_error;
+                break;
+
+            case RTT_TELEMETRY_TX:
+                m_telemetry_value[logical] = p_stats->tx;
+                break;
+
+            case RTT_TELEMETRY_RSSI:
+                m_telemetry_value[logical] = (uint32_t)m_rssi_dbm[logical];
+                break;
+
+            default:
+                m_telemetry_value[logical] = (uint32_t)m_temperature;
+                break;
+        }
+    }
+
+    response_test_frame[4] = RTT_TELEMETRY_TAG(m_telemetry_field[logical], m_telemetry_byte[logical]);
+    response_test_frame[5] = (uint8_t)(m_telemetry_value[logical] >> (8 * m_telemetry_byte[logical]));
+}
+
+/**
+ * @brief Moves on to the next telemetry byte of an initiator after a response has been sent
+ */
+static void telemetry_next(uint8_t logical)
+{
+    if (++m_telemetry_byte[logical] == RTT_TELEMETRY_FIELD_LEN)
+    {
+        m_telemetry_byte[logical] = 0;
+        if (++m_telemetry_field[logical] == RTT_TELEMETRY_FIELDS)
+        {
+            m_telemetry_field[logical] = 0;
+        }
+    }
+}
+
 /**
  * @brief Initializing the radio
+ *
+ * Every initiator served is heard on a logical address of its own, see rtt_initiators.h.
+ * Without one, the access address and channel are taken from the runtime configuration. The
+ * output power always is.
  */
 void nrf_radio_init(void)
 {
-    uint32_t aa_address = 0x71764129;
+    rtt_initiators_radio_t radio;
+    rtt_config_t const * p_config = rtt_config_get();
+
+    rtt_initiators_radio_get(&radio);
     NRF_RADIO->POWER                = (RADIO_POWER_POWER_Enabled << RADIO_POWER_POWER_Pos);
 
     NRF_RADIO->MODE = 4 << RADIO_MODE_MODE_Pos; /* Radio in BLe 1M */
@@ -68,27 +152,31 @@ void nrf_radio_init(void)
     NRF_RADIO->CRCINIT = 0x555555;
     NRF_RADIO->CRCCNF = 0x103;
     NRF_RADIO->FREQUENCY = (RADIO_FREQUENCY_MAP_Default << RADIO_FREQUENCY_MAP_Pos)  +
-                            ((radio_freq << RADIO_FREQUENCY_FREQUENCY_Pos) & RADIO_FREQUENCY_FREQUENCY_Msk);
+                            ((radio.channel << RADIO_FREQUENCY_FREQUENCY_Pos) & RADIO_FREQUENCY_FREQUENCY_Msk);
     NRF_RADIO->PACKETPTR = (uint32_t)test_frame;
-    NRF_RADIO->BASE0 = aa_address << 8;
-    NRF_RADIO->PREFIX0 = (0xffffff00 | aa_address >> 24);
+    NRF_RADIO->BASE0 = radio.base0;
+    NRF_RADIO->BASE1 = radio.base1;
+    NRF_RADIO->PREFIX0 = radio.prefix0;
+    NRF_RADIO->PREFIX1 = radio.prefix1;
     NRF_RADIO->TXADDRESS = 0;
-    NRF_RADIO->RXADDRESSES = 1;
+    NRF_RADIO->RXADDRESSES = radio.rxaddresses;
     NRF_RADIO->MODECNF0= NRF_RADIO->MODECNF0 | 0x1F1F0000;
     NRF_RADIO->TIFS = 0x000000C0;
-    NRF_RADIO->TXPOWER=RADIO_TXPOWER_TXPOWER_Pos8dBm;
+    NRF_RADIO->TXPOWER = ((uint8_t)p_config->tx_power_dbm << RADIO_TXPOWER_TXPOWER_Pos) & RADIO_TXPOWER_TXPOWER_Msk;
 }
 
 /**
  * @brief Initializing TIMER4 to keep track of when the timeslot is about to end.
+ *
+ * @param[in] Measurement length in microseconds
  */
-void timer4_compare_init()
+void timer4_compare_init(uint32_t length_us)
 {
     NRF_TIMER4->TASKS_STOP          = 1;
     NRF_TIMER4->TASKS_CLEAR         = 1;
     NRF_TIMER4->MODE                = (TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos);
     NRF_TIMER4->EVENTS_COMPARE[0]   = 0;
-    NRF_TIMER4->CC[0]               = (DO_RTT_LENGTH_US);
+    NRF_TIMER4->CC[0]               = length_us;
     NRF_TIMER4->BITMODE             = (TIMER_BITMODE_BITMODE_24Bit << TIMER_BITMODE_BITMODE_Pos);
     NRF_TIMER4->PRESCALER           = 4;
     NRF_TIMER4->TASKS_START         = 1;
@@ -104,6 +192,8 @@ void end_rtt()
     NRF_RADIO->INTENCLR = 0xFFFFFFFF;
     NRF_RADIO->EVENTS_DISABLED = 0;
     while ((NRF_RADIO->EVENTS_DISABLED == 0) && !(NRF_TIMER4->EVENTS_COMPARE[0]))
+    {
+    }
     NRF_RADIO->POWER = (RADIO_POWER_POWER_Disabled << RADIO_POWER_POWER_Pos);
 
     NRF_TIMER4->TASKS_STOP  = 1;
@@ -112,24 +202,35 @@ void end_rtt()
 
 /**
  * @brief Do RTT measurements
+ *
+ * @param[in] length_us Time available for the measurements
+ *
+ * Requests carrying the address of another responder are not answered. Every request is
+ * answered on the logical address it was received on, so each initiator served only hears the
+ * responses to its own requests, and is checked against the address that initiator gives this
+ * responder.
+ *
+ * @return Time in microseconds from the start of the measurements until the first
+ *         packet with a valid CRC was received, or RTT_NO_RX.
  */
-void do_rtt_measurement(void)
+uint32_t do_rtt_measurement(uint32_t length_us)
 {
     volatile  uint32_t i;
-
-    attempts = 0;
+    uint32_t first_rx_us = RTT_NO_RX;
+    uint8_t  address;
+    uint8_t  logical;
+    uint8_t  heard       = 0;
+    rtt_stats_t * p_initiator;
 
     /* Initializinf the radio for RTT */
     nrf_radio_init();
 
     /* Configure the timer */
-    timer4_compare_init();
+    timer4_compare_init(length_us);
 
     while (!(NRF_TIMER4->EVENTS_COMPARE[0]))
     {
-        attempts++;
-
-        nrf_gpio_pin_set(DATAPIN_4);
+        RTT_TRACE(RTT_TRACE_EXCHANGE_START);
 
         NRF_RADIO->PACKETPTR = (uint32_t)test_frame; /* Switch to rx buffer */
 
@@ -145,7 +246,8 @@ void do_rtt_measurement(void)
 
         NRF_RADIO->SHORTS = (RADIO_SHORTS_READY_START_Enabled << RADIO_SHORTS_READY_START_Pos) |
                 (RADIO_SHORTS_END_DISABLE_Enabled << RADIO_SHORTS_END_DISABLE_Pos) |
-                (RADIO_SHORTS_DISABLED_TXEN_Enabled << RADIO_SHORTS_DISABLED_TXEN_Pos);
+                (RADIO_SHORTS_DISABLED_TXEN_Enabled << RADIO_SHORTS_DISABLED_TXEN_Pos) |
+                (RADIO_SHORTS_ADDRESS_RSSISTART_Enabled << RADIO_SHORTS_ADDRESS_RSSISTART_Pos);
 
         NRF_RADIO->EVENTS_END = 0U;
 
@@ -155,13 +257,55 @@ void do_rtt_measurement(void)
         {
         }
 
-        /* Packet received, check CRC */
-        rx_pkt_counter++;
+        if (NRF_RADIO->EVENTS_END == 0)
+        {
+            /* The window ended without a packet */
+            RTT_TRACE(RTT_TRACE_EXCHANGE_TIMEOUT);
+            break;
+        }
+
+        /* The response goes out on the address the request came in on */
+        logical = (uint8_t)NRF_RADIO->RXMATCH;
+        if (logical >= RTT_INITIATORS_MAX)
+        {
+            logical = 0;
+        }
+        NRF_RADIO->TXADDRESS = logical;
+        p_initiator = rtt_initiators_stats(logical);
+        address     = rtt_initiators_address_get(logical);
 
+        /* Packet received, check CRC */
         if(NRF_RADIO->CRCSTATUS>0)
         {
             /* CRC ok */
-            rx_pkt_counter_crcok++;
+            m_stats.rx_crc_ok++;
+            p_initiator->rx_crc_ok++;
+            heard |= (uint8_t)(1U << logical);
+            RTT_TRACE(RTT_TRACE_EXCHANGE_VALID);
+            m_rssi_dbm[logical] = -(int32_t)NRF_RADIO->RSSISAMPLE;
+
+            if ((address != RTT_CONFIG_ADDRESS_ANY) && (test_frame[4] != address))
+            {
+                /* A request to another responder. The shorts have already started the ramp-up
+                 * for a response, which is aborted so the addressed responder is heard. The
+                 * request does not mark the phase either, it belongs to another responder's burst. */
+                m_stats.rx_ignored++;
+                p_initiator->rx_ignored++;
+                NRF_RADIO->SHORTS = (RADIO_SHORTS_READY_START_Enabled << RADIO_SHORTS_READY_START_Pos) |
+                                    (RADIO_SHORTS_END_DISABLE_Enabled << RADIO_SHORTS_END_DISABLE_Pos);
+                NRF_RADIO->EVENTS_DISABLED = 0U;
+                NRF_RADIO->TASKS_DISABLE   = 1U;
+                while ((NRF_RADIO->EVENTS_DISABLED == 0) && !(NRF_TIMER4->EVENTS_COMPARE[0]))
+                {
+                }
+                continue;
+            }
+
+            if (first_rx_us == RTT_NO_RX)
+            {
+                NRF_TIMER4->TASKS_CAPTURE[1] = 1;
+                first_rx_us = NRF_TIMER4->CC[1];
+            }
             
             for(i=2;i<4;i++)
                 response_test_frame[i]=test_frame[i];
@@ -169,13 +313,17 @@ void do_rtt_measurement(void)
         else
         {
             /* CRC error */
-            dbgcnt1++;
+            m_stats.rx_crc_error++;
+            p_initiator->rx_crc_error++;
+            RTT_TRACE(RTT_TRACE_EXCHANGE_CRC_ERROR);
 
             /* Insert zeros as sequence number into the response packet indicating crc error to initiator */
             for(i=2;i<4;i++)
                 response_test_frame[i]=0;
         }
 
+        telemetry_write(logical);
+
         /* Switch to Tx asap and send response packet back to initiator */
         NRF_RADIO->PACKETPTR = (uint32_t)response_test_frame; /* Switch to tx buffer */
         NRF_RADIO->TASKS_RXEN = 0x0;
@@ -199,10 +347,35 @@ void do_rtt_measurement(void)
         {
         }
 
-        tx_pkt_counter++;
+        if (NRF_RADIO->EVENTS_END)
+        {
+            m_stats.tx++;
+            p_initiator->tx++;
+        }
 
-        nrf_gpio_pin_clear(DATAPIN_4);
+        /* The next response to this initiator carries its next telemetry byte */
+        telemetry_next(logical);
     }
 
     end_rtt();
+
+    m_stats.bursts++;
+    if (first_rx_us == RTT_NO_RX)
+    {
+        m_stats.rx_timeouts++;
+    }
+    rtt_initiators_window_end(heard);
+
+    return first_rx_us;
+}
+
+/**
+ * @brief Gets the responder statistics since start-up
+ *
+ * The counters are updated in the timeslot, which cannot be masked, and are copied one at a
+ * time. A copy taken during a window can be off by about one exchange between counters.
+ */
+void radio_stats_get(rtt_stats_t * p_stats)
+{
+    *p_stats = m_stats;
 }
\ No newline at end of file
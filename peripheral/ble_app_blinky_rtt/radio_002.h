@@ -25,6 +25,15 @@
 #ifndef RADIO_002_H
 #define RADIO_002_H
 
-void do_rtt_measurement(void);
+#include <stdint.h>
+#include "rtt_stats.h"
+
+#define RTT_NO_RX UINT32_MAX /* No packet was received during the measurement */
+
+uint32_t do_rtt_measurement(uint32_t length_us);
+
+void radio_temperature_set(int32_t temperature);
+
+void radio_stats_get(rtt_stats_t * p_stats);
 
 #endif // RADIO_002_H
\ No newline at end of file
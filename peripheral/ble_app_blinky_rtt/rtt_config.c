@@ -0,0 +1,268 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+#include "rtt_config.h"
+
+#define SLOT_LENGTH_MIN_US  (DO_RTT_END_MARGIN_US + 1000UL) /* Leaves at least 1 ms of exchanges in each timeslot */
+#define SLOT_LENGTH_MAX_US  (NRF_RADIO_LENGTH_MAX_US)
+
+#define ADVERTISING_ACCESS_ADDRESS  0x8E89BED6UL  /* Access address of the BLE advertising channels */
+#define DATA_CHANNELS               37            /* BLE data channels a hop seed picks from */
+
+static rtt_config_t          m_config         = RTT_CONFIG_DEFAULT;
+static rtt_config_t          m_config_pending;
+static volatile bool         m_pending_valid  = false;
+
+/* Output power levels of the radio, also the TXPOWER register values */
+static int8_t const m_tx_power_levels[] = {8, 7, 6, 5, 4, 3, 2, 0, -4, -8, -12, -16, -20, -40};
+
+
+static bool tx_power_is_valid(int8_t tx_power_dbm)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_tx_power_levels); i++)
+    {
+        if (m_tx_power_levels[i] == tx_power_dbm)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool rtt_config_access_address_is_valid(uint32_t access_address)
+{
+    uint32_t transitions = 0;
+    uint32_t run         = 1;
+    uint32_t difference  = access_address ^ ADVERTISING_ACCESS_ADDRESS;
+
+    if (access_address == RTT_CONFIG_ACCESS_ADDRESS_DEFAULT)
+    {
+        return true;
+    }
+
+    /* The advertising access address, or one bit away from it */
+    if (((difference & (difference - 1UL)) == 0) ||
+        (access_address == (access_address & 0xFFUL) * 0x01010101UL))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 1; i < 32; i++)
+    {
+        if (((access_address >> i) & 1UL) == ((access_address >> (i - 1)) & 1UL))
+        {
+            if (++run > 6)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            run = 1;
+            transitions++;
+        }
+    }
+    if (transitions > 24)
+    {
+        return false;
+    }
+
+    /* Bits 26 to 31 */
+    transitions = 0;
+    for (uint32_t i = 27; i < 32; i++)
+    {
+        if (((access_address >> i) & 1UL) != ((access_address >> (i - 1)) & 1UL))
+        {
+            transitions++;
+        }
+    }
+
+    return (transitions >= 2);
+}
+
+
+void rtt_config_link_get(rtt_config_t const * p_config, rtt_link_t * p_link)
+{
+    p_link->access_address = p_config->access_address;
+    p_link->hop_seed       = p_config->hop_seed;
+}
+
+
+void rtt_config_link_resolve(rtt_link_t const * p_link, uint32_t * p_access_address, uint8_t * p_channel)
+{
+    *p_access_address = (p_link->access_address == RTT_CONFIG_ACCESS_ADDRESS_DEFAULT) ?
+                        RADIO_DEFAULT_ACCESS_ADDRESS : p_link->access_address;
+
+    if (p_link->hop_seed == 0)
+    {
+        *p_channel = m_config.channel;
+    }
+    else
+    {
+        /* BLE data channel n is 2404 + 2n MHz, skipping advertising channel 38 at 2426 MHz */
+        uint8_t index = p_link->hop_seed % DATA_CHANNELS;
+        *p_channel    = (uint8_t)(4 + 2 * index + ((index >= 11) ? 2 : 0));
+    }
+}
+
+
+uint32_t rtt_config_validate(rtt_config_t const * p_config)
+{
+    if ((p_config->channel > RTT_CONFIG_CHANNEL_MAX) ||
+        !tx_power_is_valid(p_config->tx_power_dbm) ||
+        (p_config->bins == 0) ||
+        (p_config->bins > RTT_CONFIG_BINS_MAX) ||
+        (p_config->rate_hz > TS_MAX_RATE_HZ) ||
+        (p_config->exchanges == 0) ||
+        (p_config->exchanges > TS_MAX_EXCHANGES) ||
+        (p_config->slot_length_us < SLOT_LENGTH_MIN_US) ||
+        (p_config->slot_length_us > SLOT_LENGTH_MAX_US) ||
+        (p_config->averaging == 0) ||
+        (p_config->period_bursts == 0) ||
+        (p_config->period_bursts > RTT_CONFIG_PERIOD_MAX) ||
+        (p_config->weight == 0) ||
+        (p_config->weight > RTT_CONFIG_WEIGHT_MAX) ||
+        !rtt_config_access_address_is_valid(p_config->access_address))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* Leave at least half of each period to the BLE link */
+    if ((p_config->rate_hz != 0) &&
+        (2 * TS_BURST_LENGTH_US(p_config->exchanges, p_config->burst_margin_us) > (1000000UL / p_config->rate_hz)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint16_t rtt_config_encode(rtt_config_t const * p_config, uint8_t * p_buf)
+{
+    uint16_t len = 0;
+
+    p_buf[len++] = RTT_CONFIG_VERSION;
+    len += uint16_encode(p_config->id, &p_buf[len]);
+    p_buf[len++] = p_config->channel;
+    p_buf[len++] = (uint8_t)p_config->tx_power_dbm;
+    p_buf[len++] = p_config->bins;
+    len += uint16_encode(p_config->rate_hz, &p_buf[len]);
+    len += uint16_encode(p_config->exchanges, &p_buf[len]);
+    len += uint32_encode(p_config->slot_length_us, &p_buf[len]);
+    len += uint16_encode(p_config->burst_margin_us, &p_buf[len]);
+    len += uint16_encode(p_config->averaging, &p_buf[len]);
+    len += uint16_encode(p_config->bin_offset, &p_buf[len]);
+    p_buf[len++] = p_config->address;
+    p_buf[len++] = p_config->period_bursts;
+    p_buf[len++] = p_config->weight;
+    len += uint32_encode(p_config->access_address, &p_buf[len]);
+    p_buf[len++] = p_config->hop_seed;
+
+    return len;
+}
+
+
+uint32_t rtt_config_decode(uint8_t const * p_buf, uint16_t len, rtt_config_t * p_config)
+{
+    if ((len < 1) || (p_buf[0] != RTT_CONFIG_VERSION))
+    {
+        return (len < 1) ? NRF_ERROR_INVALID_LENGTH : NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (len != RTT_CONFIG_ENCODED_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    p_config->id              = uint16_decode(&p_buf[1]);
+    p_config->channel         = p_buf[3];
+    p_config->tx_power_dbm    = (int8_t)p_buf[4];
+    p_config->bins            = p_buf[5];
+    p_config->rate_hz         = uint16_decode(&p_buf[6]);
+    p_config->exchanges       = uint16_decode(&p_buf[8]);
+    p_config->slot_length_us  = uint32_decode(&p_buf[10]);
+    p_config->burst_margin_us = uint16_decode(&p_buf[14]);
+    p_config->averaging       = uint16_decode(&p_buf[16]);
+    p_config->bin_offset      = uint16_decode(&p_buf[18]);
+    p_config->address         = p_buf[20];
+    p_config->period_bursts   = p_buf[21];
+    p_config->weight          = p_buf[22];
+    p_config->access_address  = uint32_decode(&p_buf[23]);
+    p_config->hop_seed        = p_buf[27];
+
+    return rtt_config_validate(p_config);
+}
+
+
+uint32_t rtt_config_stage(rtt_config_t const * p_config)
+{
+    uint32_t err_code = rtt_config_validate(p_config);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    /* rtt_config_apply only reads the pending configuration while the valid flag is set */
+    m_pending_valid  = false;
+    __DMB();
+    m_config_pending = *p_config;
+    __DMB();
+    m_pending_valid  = true;
+
+    return NRF_SUCCESS;
+}
+
+
+bool rtt_config_apply(void)
+{
+    if (!m_pending_valid)
+    {
+        return false;
+    }
+
+    m_config        = m_config_pending;
+    m_pending_valid = false;
+
+    return true;
+}
+
+
+bool rtt_config_is_staged(void)
+{
+    return m_pending_valid;
+}
+
+
+rtt_config_t const * rtt_config_get(void)
+{
+    return &m_config;
+}
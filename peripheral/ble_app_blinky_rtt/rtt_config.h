@@ -0,0 +1,213 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_CONFIG_H__
+#define RTT_CONFIG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+
+/**@brief Runtime ranging configuration
+ *
+ * @details The configuration both peers range with. It is exchanged over the Config
+ *          characteristic of the Ranging Service, encoded as RTT_CONFIG_ENCODED_LEN bytes,
+ *          little endian:
+ *
+ *          | Offset | Size | Field            |
+ *          |--------|------|------------------|
+ *          | 0      | 1    | Format version, RTT_CONFIG_VERSION |
+ *          | 1      | 2    | id               |
+ *          | 3      | 1    | channel          |
+ *          | 4      | 1    | tx_power_dbm     |
+ *          | 5      | 1    | bins             |
+ *          | 6      | 2    | rate_hz          |
+ *          | 8      | 2    | exchanges        |
+ *          | 10     | 4    | slot_length_us   |
+ *          | 14     | 2    | burst_margin_us  |
+ *          | 16     | 2    | averaging        |
+ *          | 18     | 2    | bin_offset       |
+ *          | 20     | 1    | address          |
+ *          | 21     | 1    | period_bursts    |
+ *          | 22     | 1    | weight           |
+ *          | 23     | 4    | access_address   |
+ *          | 27     | 1    | hop_seed         |
+ *
+ *          A new configuration is staged, and only taken into use by rtt_config_apply() at the
+ *          next session boundary, so a burst never runs with half of an old configuration.
+ *
+ *          An initiator ranging with several responders writes each of them the same
+ *          configuration, except for the address of that responder and the period of its
+ *          bursts in the initiator's TDMA frame. The weight is the share of the bursts a
+ *          responder asks for. It is written by gateways and only read by the initiator.
+ *
+ *          The access address and the hop seed make the radio link of a pair. An initiator
+ *          gives every connection its own, so pairs ranging side by side neither hear nor
+ *          answer each other. The link is fixed for the session: the responder finds the
+ *          initiator again at every burst by listening on one channel, so the seed picks the
+ *          channel of the link instead of hopping from burst to burst.
+ */
+typedef struct
+{
+    uint16_t id;              /**< Chosen by the writer, so gateways can tell which configuration is in use. */
+    uint8_t  channel;         /**< Radio channel, frequency 2400 + channel MHz. */
+    int8_t   tx_power_dbm;    /**< Radio output power. One of the levels supported by the radio. */
+    uint8_t  bins;            /**< Number of histogram bins in use by the initiator. */
+    uint16_t rate_hz;         /**< Bursts per second. 0 selects continuous ranging. */
+    uint16_t exchanges;       /**< Exchanges in each burst. */
+    uint32_t slot_length_us;  /**< Timeslot and extension length in continuous ranging. */
+    uint16_t burst_margin_us; /**< A scheduled burst finishes its exchanges this long before the timeslot ends. */
+    uint16_t averaging;       /**< Bursts with a valid distance averaged into each result. */
+    uint16_t bin_offset;      /**< Round trip ticks trimmed away before binning, the responder dwell time. */
+    uint8_t  address;         /**< Address the responder answers to, carried in every request. RTT_CONFIG_ADDRESS_ANY answers all. */
+    uint8_t  period_bursts;   /**< The responder is ranged with every period_bursts-th burst of the initiator. */
+    uint8_t  weight;          /**< Share of the initiator's bursts asked for by the responder. */
+    uint32_t access_address;  /**< Access address of the radio link. RTT_CONFIG_ACCESS_ADDRESS_DEFAULT for RADIO_DEFAULT_ACCESS_ADDRESS. */
+    uint8_t  hop_seed;        /**< Picks the BLE data channel of the link. 0 stays on channel. */
+} rtt_config_t;
+
+/**@brief Radio link of an initiator and its responder, the link fields of rtt_config_t
+ */
+typedef struct
+{
+    uint32_t access_address;  /**< RTT_CONFIG_ACCESS_ADDRESS_DEFAULT for RADIO_DEFAULT_ACCESS_ADDRESS. */
+    uint8_t  hop_seed;        /**< 0 stays on the channel of the configuration in use. */
+} rtt_link_t;
+
+#define RTT_CONFIG_VERSION      3  /**< Version of the encoded format. */
+#define RTT_CONFIG_ENCODED_LEN  28 /**< Length of the encoded configuration. */
+#define RTT_CONFIG_BINS_MAX     128
+#define RTT_CONFIG_CHANNEL_MAX  80
+#define RTT_CONFIG_PERIOD_MAX   16 /**< Longest period of a responder's bursts, in bursts of the initiator. */
+#define RTT_CONFIG_WEIGHT_MAX   4
+
+#define RTT_CONFIG_ADDRESS_ANY          0                           /**< Address of a responder that answers every request. */
+#define RTT_CONFIG_PEER_ADDRESS(peer)   ((uint8_t)((peer) + 1))     /**< Address the initiator gives its responder number peer. */
+#define RTT_CONFIG_ACCESS_ADDRESS_DEFAULT 0                         /**< Access address field selecting RADIO_DEFAULT_ACCESS_ADDRESS. */
+
+/**@brief Configuration built from the defaults in rtt_parameters.h
+ */
+#define RTT_CONFIG_DEFAULT                                  \
+{                                                           \
+    .id              = 0,                                   \
+    .channel         = RADIO_DEFAULT_CHANNEL,               \
+    .tx_power_dbm    = RADIO_DEFAULT_TX_POWER_DBM,          \
+    .bins            = RTT_DEFAULT_BINS,                    \
+    .rate_hz         = TS_DEFAULT_RATE_HZ,                  \
+    .exchanges       = TS_DEFAULT_EXCHANGES,                \
+    .slot_length_us  = TS_LEN_US,                           \
+    .burst_margin_us = TS_BURST_END_MARGIN_US,              \
+    .averaging       = RTT_SESSION_DEFAULT_AVERAGING,       \
+    .bin_offset      = RTT_DEFAULT_BIN_OFFSET,              \
+    .address         = RTT_CONFIG_ADDRESS_ANY,              \
+    .period_bursts   = 1,                                   \
+    .weight          = 1,                                   \
+    .access_address  = RTT_CONFIG_ACCESS_ADDRESS_DEFAULT,   \
+    .hop_seed        = 0                                    \
+}
+
+
+/**@brief Check a configuration.
+ *
+ * @retval NRF_SUCCESS             The configuration can be used.
+ * @retval NRF_ERROR_INVALID_PARAM A field is out of range, or the bursts do not fit the rate.
+ */
+uint32_t rtt_config_validate(rtt_config_t const * p_config);
+
+
+/**@brief Check an access address.
+ *
+ * @details Follows the rules of the Bluetooth Core Specification for the access address of a
+ *          link: no more than six equal bits in a row, no more than 24 bit transitions, at least
+ *          two transitions in the six most significant bits, not the advertising access address
+ *          or one bit away from it, and not four equal octets. RTT_CONFIG_ACCESS_ADDRESS_DEFAULT
+ *          is also accepted.
+ */
+bool rtt_config_access_address_is_valid(uint32_t access_address);
+
+
+/**@brief Get the radio link of a configuration.
+ */
+void rtt_config_link_get(rtt_config_t const * p_config, rtt_link_t * p_link);
+
+
+/**@brief Get the access address and the radio channel a link ranges on.
+ *
+ * @param[in]  p_link           Link.
+ * @param[out] p_access_address Access address, RADIO_DEFAULT_ACCESS_ADDRESS unless the link has its own.
+ * @param[out] p_channel        Channel picked by the hop seed, or that of the configuration in use.
+ */
+void rtt_config_link_resolve(rtt_link_t const * p_link, uint32_t * p_access_address, uint8_t * p_channel);
+
+
+/**@brief Encode a configuration.
+ *
+ * @param[in]  p_config Configuration.
+ * @param[out] p_buf    Buffer of at least RTT_CONFIG_ENCODED_LEN bytes.
+ *
+ * @return Number of bytes written.
+ */
+uint16_t rtt_config_encode(rtt_config_t const * p_config, uint8_t * p_buf);
+
+
+/**@brief Decode and check a configuration.
+ *
+ * @retval NRF_SUCCESS              Decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH The length does not match the format.
+ * @retval NRF_ERROR_NOT_SUPPORTED  Unknown format version.
+ * @retval NRF_ERROR_INVALID_PARAM  A field is out of range.
+ */
+uint32_t rtt_config_decode(uint8_t const * p_buf, uint16_t len, rtt_config_t * p_config);
+
+
+/**@brief Stage a configuration. It is taken into use by the next rtt_config_apply().
+ *
+ * @retval NRF_SUCCESS             Staged. Replaces any configuration staged before.
+ * @retval NRF_ERROR_INVALID_PARAM See rtt_config_validate().
+ */
+uint32_t rtt_config_stage(rtt_config_t const * p_config);
+
+
+/**@brief Take the staged configuration into use. Only call at a session boundary.
+ *
+ * @details The timeslot handlers read the configuration in use without locking, so this must
+ *          only be called while no timeslot is in progress, or from the timeslot signal
+ *          handler while it builds the next request. It must not be preempted by
+ *          rtt_config_stage().
+ *
+ * @return True if a staged configuration was taken into use.
+ */
+bool rtt_config_apply(void);
+
+
+/**@brief Check whether a configuration is staged.
+ */
+bool rtt_config_is_staged(void);
+
+
+/**@brief Get the configuration in use.
+ */
+rtt_config_t const * rtt_config_get(void);
+
+#endif // RTT_CONFIG_H__
@@ -0,0 +1,412 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include "rtt_initiators.h"
+#include "nrf.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "ble.h"
+
+STATIC_ASSERT(RTT_INITIATORS_MAX >= 1 && RTT_INITIATORS_MAX <= 8);
+
+#define BASE_MASK   0x00FFFFFFUL /* BALEN 3, the prefix is the top octet */
+
+/**@brief An initiator on a logical address */
+typedef struct
+{
+    uint16_t conn_handle;    /**< Connection of the initiator, BLE_CONN_HANDLE_INVALID if the address is free. */
+    uint32_t access_address; /**< Access address of its link. */
+    uint8_t  channel;        /**< Channel of its link. */
+    uint8_t  address;        /**< Address it gives this responder. */
+} initiator_t;
+
+typedef struct
+{
+    initiator_t slot[RTT_INITIATORS_MAX]; /**< Indexed by logical address. */
+} initiators_t;
+
+/* Set by the BLE handlers */
+static initiators_t          m_initiators;
+static initiators_t          m_pending;
+static volatile bool         m_pending_valid = false;
+static rtt_config_t          m_configs[RTT_INITIATORS_MAX]; /* Written by each initiator, by logical address */
+
+/* In use by the radio, only accessed from the timeslot */
+static initiators_t          m_in_use;
+static rtt_stats_t           m_stats[RTT_INITIATORS_MAX];
+
+
+static void table_clear(initiators_t * p_table)
+{
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        p_table->slot[i].conn_handle    = BLE_CONN_HANDLE_INVALID;
+        p_table->slot[i].access_address = 0;
+        p_table->slot[i].channel        = 0;
+        p_table->slot[i].address        = RTT_CONFIG_ADDRESS_ANY;
+    }
+}
+
+
+void rtt_initiators_init(void)
+{
+    table_clear(&m_initiators);
+    table_clear(&m_in_use);
+    m_pending_valid = false;
+}
+
+
+/**@brief Hand the table over to the timeslot, see rtt_config_stage. */
+static void stage(void)
+{
+    m_pending_valid = false;
+    __DMB();
+    m_pending = m_initiators;
+    __DMB();
+    m_pending_valid = true;
+}
+
+
+static uint32_t table_count(initiators_t const * p_table)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (p_table->slot[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+/**@brief Take the configuration of the only initiator served into use, so the listening
+ *        windows follow its bursts. With several, each is answered on its own link and address
+ *        instead, and one must not replace the configuration of the others.
+ */
+static void config_stage(void)
+{
+    if (table_count(&m_initiators) != 1)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (m_initiators.slot[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            (void)rtt_config_stage(&m_configs[i]);
+        }
+    }
+}
+
+
+static void table_remove(initiators_t * p_table, uint16_t conn_handle)
+{
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (p_table->slot[i].conn_handle == conn_handle)
+        {
+            p_table->slot[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+        }
+    }
+}
+
+
+uint32_t rtt_initiators_add(uint16_t conn_handle, rtt_config_t const * p_config)
+{
+    initiators_t table;
+    rtt_link_t   link;
+    uint32_t     access_address;
+    uint8_t      channel;
+    bool         base1_used = false;
+    uint32_t     base1      = 0;
+    uint32_t     found      = RTT_INITIATORS_MAX;
+
+    if ((p_config == NULL) || (conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* The link of the configuration written, not that of the configuration in use */
+    rtt_config_link_get(p_config, &link);
+    access_address = (link.access_address == RTT_CONFIG_ACCESS_ADDRESS_DEFAULT) ? RADIO_DEFAULT_ACCESS_ADDRESS
+                                                                                : link.access_address;
+    channel        = p_config->channel;
+    if (link.hop_seed != 0)
+    {
+        rtt_config_link_resolve(&link, &access_address, &channel);
+    }
+
+    /* An initiator writing again gives up its own address first */
+    table = m_initiators;
+    table_remove(&table, conn_handle);
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        initiator_t const * p_slot = &table.slot[i];
+
+        if (p_slot->conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        if ((p_slot->access_address == access_address) || (p_slot->channel != channel))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        if (i > 0)
+        {
+            base1_used = true;
+            base1      = p_slot->access_address & BASE_MASK;
+        }
+    }
+
+    /* Logical addresses 1 and up share BASE1. Logical address 0 is kept for an initiator with
+     * another base as long as possible. */
+    if (!base1_used || ((access_address & BASE_MASK) == base1))
+    {
+        for (uint32_t i = 1; i < RTT_INITIATORS_MAX; i++)
+        {
+            if (table.slot[i].conn_handle == BLE_CONN_HANDLE_INVALID)
+            {
+                found = i;
+                break;
+            }
+        }
+    }
+
+    if ((found == RTT_INITIATORS_MAX) && (table.slot[0].conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        found = 0;
+    }
+
+    if (found == RTT_INITIATORS_MAX)
+    {
+        return (base1_used && ((access_address & BASE_MASK) != base1)) ? NRF_ERROR_INVALID_PARAM
+                                                                      : NRF_ERROR_NO_MEM;
+    }
+
+    table.slot[found].conn_handle    = conn_handle;
+    table.slot[found].access_address = access_address;
+    table.slot[found].channel        = channel;
+    table.slot[found].address        = p_config->address;
+    m_configs[found]                 = *p_config;
+
+    m_initiators = table;
+    stage();
+    config_stage();
+
+    return NRF_SUCCESS;
+}
+
+
+void rtt_initiators_remove(uint16_t conn_handle)
+{
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (m_initiators.slot[i].conn_handle == conn_handle)
+        {
+            table_remove(&m_initiators, conn_handle);
+            stage();
+            config_stage();
+            return;
+        }
+    }
+}
+
+
+uint32_t rtt_initiators_count(void)
+{
+    return table_count(&m_initiators);
+}
+
+
+uint16_t rtt_initiators_conn_handle_get(uint8_t logical)
+{
+    if (logical >= RTT_INITIATORS_MAX)
+    {
+        return BLE_CONN_HANDLE_INVALID;
+    }
+
+    return m_initiators.slot[logical].conn_handle;
+}
+
+
+bool rtt_initiators_apply(void)
+{
+    if (!m_pending_valid)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        uint16_t conn_handle = m_pending.slot[i].conn_handle;
+
+        if ((conn_handle != BLE_CONN_HANDLE_INVALID) && (conn_handle != m_in_use.slot[i].conn_handle))
+        {
+            memset(&m_stats[i], 0, sizeof(m_stats[i]));
+        }
+    }
+
+    m_in_use        = m_pending;
+    m_pending_valid = false;
+
+    return true;
+}
+
+
+uint32_t rtt_initiators_in_use(void)
+{
+    return table_count(&m_in_use);
+}
+
+
+void rtt_initiators_radio_get(rtt_initiators_radio_t * p_radio)
+{
+    p_radio->base0       = 0;
+    p_radio->base1       = 0;
+    p_radio->prefix0     = 0;
+    p_radio->prefix1     = 0;
+    p_radio->rxaddresses = 0;
+
+    if (table_count(&m_in_use) == 0)
+    {
+        /* No initiator has written a configuration, listen on the link of the one in use */
+        rtt_config_t const * p_config = rtt_config_get();
+        rtt_link_t           link;
+        uint32_t             access_address;
+
+        rtt_config_link_get(p_config, &link);
+        rtt_config_link_resolve(&link, &access_address, &p_radio->channel);
+
+        p_radio->base0       = access_address << 8;
+        p_radio->prefix0     = access_address >> 24;
+        p_radio->rxaddresses = 1;
+        return;
+    }
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        initiator_t const * p_slot = &m_in_use.slot[i];
+        uint32_t            prefix = p_slot->access_address >> 24;
+
+        if (p_slot->conn_handle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        if (i == 0)
+        {
+            p_radio->base0 = p_slot->access_address << 8;
+        }
+        else
+        {
+            p_radio->base1 = p_slot->access_address << 8;
+        }
+
+        if (i < 4)
+        {
+            p_radio->prefix0 |= prefix << (8 * i);
+        }
+        else
+        {
+            p_radio->prefix1 |= prefix << (8 * (i - 4));
+        }
+
+        p_radio->rxaddresses |= (uint8_t)(1U << i);
+        p_radio->channel      = p_slot->channel;
+    }
+}
+
+
+void rtt_initiators_window_end(uint8_t heard)
+{
+    uint8_t served = (table_count(&m_in_use) == 0) ? 1 : 0;
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (m_in_use.slot[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            served |= (uint8_t)(1U << i);
+        }
+    }
+
+    for (uint32_t i = 0; i < RTT_INITIATORS_MAX; i++)
+    {
+        if (served & (1U << i))
+        {
+            m_stats[i].bursts++;
+            if (!(heard & (1U << i)))
+            {
+                m_stats[i].rx_timeouts++;
+            }
+        }
+    }
+}
+
+
+uint8_t rtt_initiators_address_get(uint8_t logical)
+{
+    if ((logical >= RTT_INITIATORS_MAX) || (m_in_use.slot[logical].conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return rtt_config_get()->address;
+    }
+
+    return m_in_use.slot[logical].address;
+}
+
+
+rtt_stats_t * rtt_initiators_stats(uint8_t logical)
+{
+    if (logical >= RTT_INITIATORS_MAX)
+    {
+        logical = 0;
+    }
+
+    return &m_stats[logical];
+}
+
+
+void rtt_initiators_stats_get(uint8_t logical, rtt_stats_t * p_stats)
+{
+    if (logical >= RTT_INITIATORS_MAX)
+    {
+        memset(p_stats, 0, sizeof(*p_stats));
+        return;
+    }
+
+    *p_stats = m_stats[logical];
+}
@@ -0,0 +1,164 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_INITIATORS_H__
+#define RTT_INITIATORS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtt_parameters.h"
+#include "rtt_config.h"
+#include "rtt_stats.h"
+
+/**@brief Initiators served by the responder
+ *
+ * @details The responder answers up to RTT_INITIATORS_MAX initiators in the same listening
+ *          window, each on a logical address of the radio set to the access address of its
+ *          link, and answers every request on the logical address it arrived on. Logical
+ *          address 0 has a base of its own, BASE0, and takes any access address. Logical
+ *          addresses 1 and up share BASE1, so their access addresses must only differ in the
+ *          top octet, the prefix. Initiators give every responder links with the same base and
+ *          channel, see rtt_peers.h on the initiator, so they all fit. All initiators must range
+ *          on the same channel.
+ *
+ *          Each initiator numbers its responders on its own, so every one is answered on the
+ *          address it gives this responder in its configuration. While only one initiator is
+ *          served, its configuration is also the one in use, and the listening windows follow
+ *          its bursts. The configurations written by the others are left out of it.
+ *
+ *          The table is changed by the BLE handlers when an initiator writes its configuration
+ *          or disconnects, and handed over to the radio at the next timeslot request, like the
+ *          configuration. Without an initiator, the responder listens on the link of the
+ *          configuration in use, and answers its address.
+ *
+ *          While it serves more than one initiator, the responder listens continuously instead
+ *          of following the bursts of one of them.
+ */
+
+/**@brief Radio addresses and channel the responder listens on
+ */
+typedef struct
+{
+    uint32_t base0;       /**< BASE0 register. */
+    uint32_t base1;       /**< BASE1 register. */
+    uint32_t prefix0;     /**< PREFIX0 register, prefixes of logical addresses 0 to 3. */
+    uint32_t prefix1;     /**< PREFIX1 register, prefixes of logical addresses 4 to 7. */
+    uint8_t  rxaddresses; /**< RXADDRESSES register, bit n enables logical address n. */
+    uint8_t  channel;     /**< Radio channel, frequency 2400 + channel MHz. */
+} rtt_initiators_radio_t;
+
+
+/**@brief Function for initializing the table, without any initiator. Call before the timeslot
+ *        API is initialized.
+ */
+void rtt_initiators_init(void);
+
+
+/**@brief Serve an initiator on the link and address of the configuration it wrote.
+ *
+ * @details An initiator writing again is moved to its new link. The configuration is staged
+ *          with rtt_config_stage() if the initiator is the only one served.
+ *
+ * @param[in] conn_handle Connection of the initiator.
+ * @param[in] p_config    Configuration written by it.
+ *
+ * @retval NRF_SUCCESS             The initiator is served from the next timeslot request.
+ * @retval NRF_ERROR_INVALID_PARAM The link is that of another initiator, or does not fit the
+ *                                 channel or the shared base of the others.
+ * @retval NRF_ERROR_NO_MEM        RTT_INITIATORS_MAX initiators are already served.
+ */
+uint32_t rtt_initiators_add(uint16_t conn_handle, rtt_config_t const * p_config);
+
+
+/**@brief Stop serving the initiator of a connection, if any.
+ *
+ * @details If one initiator is left, the configuration it wrote is staged.
+ */
+void rtt_initiators_remove(uint16_t conn_handle);
+
+
+/**@brief Get the number of initiators served, as the BLE handlers last set it.
+ */
+uint32_t rtt_initiators_count(void);
+
+
+/**@brief Get the connection of the initiator on a logical address, as the BLE handlers last set it.
+ *
+ * @return The connection handle, or BLE_CONN_HANDLE_INVALID if the address is free.
+ */
+uint16_t rtt_initiators_conn_handle_get(uint8_t logical);
+
+
+/**@brief Take the table the BLE handlers last set into use. Only call from the timeslot,
+ *        while no window is in progress.
+ *
+ * @details The counters of an initiator that has taken a logical address since the last call
+ *          start again from 0.
+ *
+ * @return True if the table changed since the last call.
+ */
+bool rtt_initiators_apply(void);
+
+
+/**@brief Get the number of initiators in use by the radio.
+ */
+uint32_t rtt_initiators_in_use(void);
+
+
+/**@brief Get the radio addresses and the channel to listen on. Only call from the timeslot.
+ */
+void rtt_initiators_radio_get(rtt_initiators_radio_t * p_radio);
+
+
+/**@brief Get the address the initiator on a logical address gives this responder. Only call
+ *        from the timeslot.
+ *
+ * @details Without an initiator, the address of the configuration in use.
+ */
+uint8_t rtt_initiators_address_get(uint8_t logical);
+
+
+/**@brief Get the counters of the initiator on a logical address, for the radio to update.
+ *        Only call from the timeslot.
+ *
+ * @details A request on a logical address without an initiator, the link of the configuration
+ *          when no initiator is served, is counted on logical address 0.
+ */
+rtt_stats_t * rtt_initiators_stats(uint8_t logical);
+
+
+/**@brief Count a listening window in the counters of every initiator served. Only call from
+ *        the timeslot, at the end of the window.
+ *
+ * @param[in] heard Bit n is set if a valid packet was received on logical address n.
+ */
+void rtt_initiators_window_end(uint8_t heard);
+
+
+/**@brief Get a copy of the counters of the initiator on a logical address. Can be called from
+ *        any context. The copy can be off by about one exchange between counters.
+ */
+void rtt_initiators_stats_get(uint8_t logical, rtt_stats_t * p_stats);
+
+#endif // RTT_INITIATORS_H__
@@ -22,16 +22,11 @@
  * SOFTWARE.
  */
 
-#define DATAPIN_1 NRF_GPIO_PIN_MAP(1, 1)  /* Debug pin 1 */
-#define DATAPIN_2 NRF_GPIO_PIN_MAP(1, 3)  /* Debug pin 2 */
-#define DATAPIN_3 NRF_GPIO_PIN_MAP(1, 10) /* Debug pin 3 */
-#define DATAPIN_4 NRF_GPIO_PIN_MAP(1, 12) /* Debug pin 4 */
-
 /* BLE defines */
 #define APP_ADV_INTERVAL                64                                      /**< The advertising interval (in units of 0.625 ms; this value corresponds to 40 ms). */
 #define APP_ADV_DURATION                BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED   /**< The advertising time-out (in units of seconds). When set to 0, we will never time out. */
 
-#define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.5 seconds). */
+#define MIN_CONN_INTERVAL               MSEC_TO_UNITS(15, UNIT_1_25_MS)         /**< Minimum acceptable connection interval. The initiator keeps 15 ms between sessions to answer single-shot requests quickly. */
 #define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)        /**< Maximum acceptable connection interval (1 second). */
 #define SLAVE_LATENCY                   0                                       /**< Slave latency. */
 #define CONN_SUP_TIMEOUT                MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Connection supervisory time-out (4 seconds). */
@@ -42,11 +37,50 @@
 
 /* Timeslot API defines */
 #define TS_TOT_EXT_LENGTH_US    (1000000UL) /* Desired total timeslot length */
-#define TS_LEN_US               (10000UL)   /* Initial timeslot length */
-#define TS_LEN_EXTENSION_US     TS_LEN_US   /* Extension timeslot length */
+#define TS_LEN_US               (10000UL)   /* Default initial and extension timeslot length in continuous ranging */
 #define TS_SAFETY_MARGIN_US     (250UL)     /* The timeslot activity should be finished with this much to spare. */
 #define TS_EXTEND_MARGIN_US     (500UL)     /* The timeslot activity should request an extension this long before end of timeslot. */
 
+/* Ranging schedule defines, must match the initiator */
+#define TS_DEFAULT_RATE_HZ      (10UL)      /* Default burst rate. A rate of 0 selects continuous extension bursts. */
+#define TS_DEFAULT_EXCHANGES    (16UL)      /* Default number of exchanges in each burst */
+#define TS_MAX_RATE_HZ          (50UL)      /* Highest burst rate accepted by the scheduler */
+#define TS_MAX_EXCHANGES        (128UL)     /* Highest number of exchanges per burst accepted by the scheduler */
+#define TS_BURST_END_MARGIN_US  (500UL)     /* Default time a scheduled burst should finish its exchanges before the timeslot ends. */
+#define RTT_EXCHANGE_US         (600UL)     /* Approximate duration of one exchange: Tx ramp-up and packet, Rx ramp-up and response */
+#define RATE_REPORT_INTERVAL_MS (5000UL)    /* Interval between reports of achieved ranging rate */
+
+/* Responder synchronisation defines */
+#define TS_SYNC_GUARD_US        (1000UL)    /* The responder listens this long before and after the expected burst. */
+#define TS_SYNC_LOST_BURSTS     (5UL)       /* Number of empty listening windows before the responder searches again */
+#define TS_SEARCH_TIMEOUT_US    (10000000UL) /* Listening time without hearing an initiator before the responder stops ranging */
+
+/* Trace defines */
+#define RTT_TRACE_ENABLED       1           /* Write timeslot and exchange events to a ring in RAM, see rtt_trace.h */
+#define RTT_TRACE_SIZE          (512UL)     /* Events in the ring. Must be a power of two. */
+
+/* Radio defines. Defaults of the runtime configuration in rtt_config.h, which the initiator overrides. */
+#define RADIO_DEFAULT_CHANNEL       (78U)   /* Radio channel, 2478 MHz */
+#define RADIO_DEFAULT_TX_POWER_DBM  (8)     /* Radio output power */
+#define RADIO_DEFAULT_ACCESS_ADDRESS (0x71764129UL) /* Access address of links without their own */
+
+/* Initiator defines */
+#define RTT_INITIATORS_MAX      (3U)        /* Initiators answered in the same listening window, one logical address each. At most 8. */
+
+/* Initiator defaults, only carried in the runtime configuration on this side */
+#define RTT_SESSION_DEFAULT_AVERAGING (100UL) /* Number of bursts with a valid distance averaged into each result */
+#define RTT_DEFAULT_BINS        (128U)      /* Number of histogram bins in use */
+#define RTT_DEFAULT_BIN_OFFSET  (4150U)     /* Round trip ticks trimmed away before binning */
+
 /* RTT defines */
-#define DO_RTT_END_MARGIN_US    1000UL + TS_EXTEND_MARGIN_US /* The RTT measurements should stop this long before the timeslot extend margin */
-#define DO_RTT_LENGTH_US        TS_LEN_US - DO_RTT_END_MARGIN_US /* The duration of the RTT measurements */
\ No newline at end of file
+#define DO_RTT_END_MARGIN_US    (1000UL + TS_EXTEND_MARGIN_US) /* The RTT measurements should stop this long before the timeslot extend margin */
+#define CATCH_UP_DELAY_US       100         /* The initiator waits this long before its first exchange */
+
+/* The duration of the RTT measurements in a continuous ranging timeslot of the given length */
+#define DO_RTT_LENGTH_US(slot_us)           ((slot_us) - DO_RTT_END_MARGIN_US)
+
+/* Length of a scheduled timeslot carrying n exchanges */
+#define TS_BURST_LENGTH_US(n, margin_us)    (CATCH_UP_DELAY_US + (n) * RTT_EXCHANGE_US + (margin_us))
+
+/* Length of the responder's listening window around a burst of n exchanges */
+#define TS_WINDOW_LENGTH_US(n, margin_us)   (TS_BURST_LENGTH_US(n, margin_us) + 2 * TS_SYNC_GUARD_US)
@@ -0,0 +1,91 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "rtt_stats.h"
+#include "radio_002.h"
+#include "timeslot.h"
+
+STATIC_ASSERT(RTT_STATS_ENCODED_LEN == 1 + 2 * RTT_STATS_COUNTERS * sizeof(uint32_t));
+
+static rtt_stats_t m_session_start; /* Counters since start-up when the session started */
+
+
+/**@brief Get the counters since start-up.
+ */
+static void lifetime_get(rtt_stats_t * p_lifetime)
+{
+    radio_stats_get(p_lifetime);
+    timeslot_grant_stats_get(&p_lifetime->slots_requested, &p_lifetime->slots_granted);
+}
+
+
+void rtt_stats_session_start(void)
+{
+    rtt_stats_t lifetime;
+
+    lifetime_get(&lifetime);
+
+    CRITICAL_REGION_ENTER();
+    m_session_start = lifetime;
+    CRITICAL_REGION_EXIT();
+}
+
+
+void rtt_stats_get(rtt_stats_t * p_session, rtt_stats_t * p_lifetime)
+{
+    uint32_t const * p_start = (uint32_t const *)&m_session_start;
+    uint32_t       * p_now   = (uint32_t *)p_lifetime;
+    uint32_t       * p_diff  = (uint32_t *)p_session;
+
+    lifetime_get(p_lifetime);
+
+    CRITICAL_REGION_ENTER();
+    for (uint32_t i = 0; i < RTT_STATS_COUNTERS; i++)
+    {
+        p_diff[i] = p_now[i] - p_start[i];
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+uint16_t rtt_stats_encode(uint8_t role, rtt_stats_t const * p_session, rtt_stats_t const * p_lifetime, uint8_t * p_buf)
+{
+    uint32_t const * p_counters[] = {(uint32_t const *)p_session, (uint32_t const *)p_lifetime};
+    uint16_t         len          = 0;
+
+    p_buf[len++] = role;
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(p_counters); i++)
+    {
+        for (uint32_t j = 0; j < RTT_STATS_COUNTERS; j++)
+        {
+            len += uint32_encode(p_counters[i][j], &p_buf[len]);
+        }
+    }
+
+    return len;
+}
@@ -0,0 +1,89 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTT_STATS_H__
+#define RTT_STATS_H__
+
+#include <stdint.h>
+
+/**@brief Ranging statistics
+ *
+ * @details Both roles count the same structure, once since the start of the session and once
+ *          since start-up. A snapshot is exchanged over the Statistics characteristic of the
+ *          Ranging Service and written to the binary stream, encoded as RTT_STATS_ENCODED_LEN
+ *          bytes, little endian:
+ *
+ *          | Offset | Size | Field                                      |
+ *          |--------|------|--------------------------------------------|
+ *          | 0      | 1    | Role, RTT_STATS_ROLE_*                     |
+ *          | 1      | 32   | Counters since the start of the session    |
+ *          | 33     | 32   | Counters since start-up                    |
+ *
+ *          The counters are 32-bit, in the order of rtt_stats_t. The packet error rate is
+ *          1 - (rx_crc_ok - rx_ignored) / tx on the initiator.
+ */
+typedef struct
+{
+    uint32_t bursts;          /**< Initiator: bursts run. Responder: listening windows. */
+    uint32_t tx;              /**< Packets sent. */
+    uint32_t rx_crc_ok;       /**< Packets received with a valid CRC. */
+    uint32_t rx_crc_error;    /**< Packets received with a CRC error. */
+    uint32_t rx_ignored;      /**< Initiator: responses with a valid CRC and the wrong sequence number. Responder: requests to another responder. */
+    uint32_t rx_timeouts;     /**< Initiator: exchanges without a response. Responder: listening windows without a valid packet. */
+    uint32_t slots_requested; /**< Timeslots requested. */
+    uint32_t slots_granted;   /**< Timeslots granted. */
+} rtt_stats_t;
+
+#define RTT_STATS_ROLE_INITIATOR 0
+#define RTT_STATS_ROLE_RESPONDER 1
+
+#define RTT_STATS_COUNTERS      (sizeof(rtt_stats_t) / sizeof(uint32_t))
+#define RTT_STATS_ENCODED_LEN   65 /**< Length of an encoded snapshot. */
+
+
+/**@brief Start counting a new session.
+ */
+void rtt_stats_session_start(void);
+
+
+/**@brief Get the statistics. Can be called from any context.
+ *
+ * @param[out] p_session  Counters since the start of the session.
+ * @param[out] p_lifetime Counters since start-up.
+ */
+void rtt_stats_get(rtt_stats_t * p_session, rtt_stats_t * p_lifetime);
+
+
+/**@brief Encode a snapshot of the statistics.
+ *
+ * @param[in]  role       RTT_STATS_ROLE_* of this device.
+ * @param[in]  p_session  Counters since the start of the session.
+ * @param[in]  p_lifetime Counters since start-up.
+ * @param[out] p_buf      Buffer of at least RTT_STATS_ENCODED_LEN bytes.
+ *
+ * @return Length of the encoded snapshot.
+ */
+uint16_t rtt_stats_encode(uint8_t role, rtt_stats_t const * p_session, rtt_stats_t const * p_lifetime, uint8_t * p_buf);
+
+#endif // RTT_STATS_H__
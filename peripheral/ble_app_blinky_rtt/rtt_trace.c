@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2020 Martin Aalien
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "nrf.h"
+#include "app_util.h"
+#include "rtt_trace.h"
+
+#if RTT_TRACE_ENABLED
+
+#define TRACE_MASK  (RTT_TRACE_SIZE - 1)
+
+STATIC_ASSERT((RTT_TRACE_SIZE & TRACE_MASK) == 0);
+STATIC_ASSERT(RTT_TRACE_EVENTS <= 0x100);
+
+/* The ring is one object, so it can be dumped with a debugger: the head followed by the events.
+   The head runs freely and is masked when used. */
+static struct
+{
+    volatile uint32_t head;
+    uint32_t          events[RTT_TRACE_SIZE];
+} m_trace;
+
+static uint32_t m_tail = 0; /* Next event to read, only used by the main loop */
+
+
+void rtt_trace_write(rtt_trace_event_t event)
+{
+    uint32_t index;
+    uint32_t entry;
+
+    /* The RTC of app_timer is read directly, app_timer_cnt_get is too slow for every exchange */
+    do
+    {
+        index = __LDREXW(&m_trace.head);
+        entry = ((uint32_t)event << RTT_TRACE_EVENT_POS) | (NRF_RTC1->COUNTER & RTT_TRACE_TICKS_MASK);
+    } while (__STREXW(index + 1, &m_trace.head) != 0);
+
+    m_trace.events[index & TRACE_MASK] = entry;
+}
+
+
+uint32_t rtt_trace_read(uint32_t * p_events, uint32_t max_events, uint32_t * p_lost)
+{
+    uint32_t head  = m_trace.head;
+    uint32_t lost  = 0;
+    uint32_t count;
+    uint32_t overwritten;
+
+    /* The main loop runs below every writer, so all events up to the head have been written */
+    if ((head - m_tail) > RTT_TRACE_SIZE)
+    {
+        lost   = (head - m_tail) - RTT_TRACE_SIZE;
+        m_tail = head - RTT_TRACE_SIZE;
+    }
+
+    count = MIN(head - m_tail, max_events);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        p_events[i] = m_trace.events[(m_tail + i) & TRACE_MASK];
+    }
+
+    /* Events written while copying may have overwritten the oldest ones that were copied */
+    head = m_trace.head;
+    if ((head - m_tail) > RTT_TRACE_SIZE)
+    {
+        overwritten = MIN((head - m_tail) - RTT_TRACE_SIZE, count);
+        for (uint32_t i = overwritten; i < count; i++)
+        {
+            p_events[i - overwritten] = p_events[i];
+        }
+        lost   += overwritten;
+        count  -= overwritten;
+        m_tail += overwritten;
+    }
+
+    m_tail += count;
+    *p_lost = lost;
+
+    return count;
+}
+
+#endif // RTT_TRACE_ENABLED
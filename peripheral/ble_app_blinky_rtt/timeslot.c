@@ -26,6 +26,8 @@
 #include <stdbool.h>
 #include "nrf.h"
 #include "app_error.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
 #include "nrf_gpio.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
@@ -36,6 +38,9 @@
 #include "nrf_sdm.h"
 #include "radio_002.h"
 #include "rtt_parameters.h"
+#include "rtt_config.h"
+#include "rtt_initiators.h"
+#include "rtt_trace.h"
 
 #define LED3 2
 #define LED4 3
@@ -47,25 +52,109 @@ static uint32_t             m_total_timeslot_length = 0;
 
 static nrf_radio_signal_callback_return_param_t signal_callback_return_param;
 
+/* Variables for the ranging schedule */
+static timeslot_schedule_t  m_schedule = {TS_DEFAULT_RATE_HZ, TS_DEFAULT_EXCHANGES};  /* Schedule used by timeslot requests */
+static timeslot_schedule_t  m_schedule_pending;                                      /* Schedule to use from the next request */
+static volatile bool        m_schedule_pending_valid = false;
+static uint32_t             m_period_us;
+static uint32_t             m_window_length_us;
+static uint32_t             m_distance_us;
+
+/* Variables for following the initiator */
+static volatile bool        m_synced          = false;       /* Listening windows are aligned with the initiator's bursts */
+static bool                 m_slot_extending  = true;        /* The timeslot in progress listens through extensions */
+static uint32_t             m_sync_misses     = 0;           /* Consecutive windows without a packet from the initiator */
+static volatile uint32_t    m_first_rx_us     = RTT_NO_RX;   /* Time of the first packet in the timeslot in progress */
+static volatile bool        m_search_pending  = false;       /* Listen continuously from the next timeslot request */
+static volatile bool        m_preempting      = false;       /* The session is closed to take back the window requested, for a search */
+static bool                 m_search_synced   = false;       /* The timeslot in progress searches between the windows, which resume after it */
+static uint32_t             m_window_ticks;                  /* app_timer ticks at the start of the last listening window */
+static uint32_t             m_slot_ticks;                    /* app_timer ticks at the start of the timeslot in progress */
+static uint32_t             m_search_us       = 0;           /* Time listened without hearing an initiator */
+
+static volatile bool        m_running         = false; /* Ranging is wanted */
+static volatile bool        m_request_pending = false; /* A timeslot request is queued in the SoftDevice */
+static volatile bool        m_slot_active     = false; /* A timeslot is in progress */
+static volatile uint32_t    m_bursts          = 0;
+static volatile uint32_t    m_blocked         = 0;
+static volatile uint32_t    m_requests        = 0;
+static volatile uint32_t    m_grants          = 0;
+
+static void soc_evt_handler(uint32_t evt_id, void * p_context);
+
+NRF_SDH_SOC_OBSERVER(m_timeslot_soc_observer, TIMESLOT_SOC_OBSERVER_PRIO, soc_evt_handler, NULL);
+
+/**@brief Take the pending schedule into use. Must only be called when building a timeslot request.
+ *
+ * @details A configuration written by the initiator is also taken into use here. The initiator
+ *          only writes it between sessions, so this is the responder's session boundary. So are
+ *          the initiators served.
+ */
+static void schedule_apply(void)
+{
+    if (rtt_initiators_apply())
+    {
+        /* Bursts of an initiator that was not served before are not followed yet */
+        m_synced = false;
+    }
+
+    if (rtt_config_apply())
+    {
+        m_schedule.rate_hz       = rtt_config_get()->rate_hz;
+        m_schedule.exchanges     = rtt_config_get()->exchanges;
+        m_schedule_pending_valid = false;
+
+        /* The initiator ranges on another channel or schedule */
+        m_synced = false;
+    }
+
+    if (m_schedule_pending_valid)
+    {
+        m_schedule               = m_schedule_pending;
+        m_schedule_pending_valid = false;
+
+        /* The initiator's bursts have moved */
+        m_synced = false;
+    }
+
+    if (m_schedule.rate_hz != 0)
+    {
+        /* The initiator's rate counts the bursts to all its responders, this one is ranged with
+         * every period_bursts-th of them */
+        m_period_us        = (1000000UL / m_schedule.rate_hz) * rtt_config_get()->period_bursts;
+        m_window_length_us = TS_WINDOW_LENGTH_US(m_schedule.exchanges, rtt_config_get()->burst_margin_us);
+    }
+}
+
+
 /**@brief Request next timeslot event in earliest configuration
  */
 uint32_t request_next_event_earliest(void)
 {
-    m_slot_length                                  = TS_LEN_US;
-    m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_EARLIEST;
-    m_timeslot_request.params.earliest.hfclk       = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
-    m_timeslot_request.params.earliest.priority    = NRF_RADIO_PRIORITY_HIGH;
-    m_timeslot_request.params.earliest.length_us   = m_slot_length;
-    m_timeslot_request.params.earliest.timeout_us  = NRF_RADIO_EARLIEST_TIMEOUT_MAX_US;
-    return sd_radio_request(&m_timeslot_request);
+    uint32_t err_code;
+
+    schedule_apply();
+    m_synced = false;
+    configure_next_event_earliest();
+
+    err_code = sd_radio_request(&m_timeslot_request);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_request_pending = true;
+        m_requests++;
+    }
+    return err_code;
 }
 
 
 /**@brief Configure next timeslot event in earliest configuration
+ *
+ * @details Used for continuous ranging and for searching for the initiator. The timeslot
+ *          is extended for as long as the responder listens.
  */
 void configure_next_event_earliest(void)
 {
-    m_slot_length                                  = TS_LEN_EXTENSION_US;
+    m_slot_length                                  = rtt_config_get()->slot_length_us;
     m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_EARLIEST;
     m_timeslot_request.params.earliest.hfclk       = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
     m_timeslot_request.params.earliest.priority    = NRF_RADIO_PRIORITY_HIGH;
@@ -73,6 +162,130 @@ void configure_next_event_earliest(void)
     m_timeslot_request.params.earliest.timeout_us  = NRF_RADIO_EARLIEST_TIMEOUT_MAX_US;
 }
 
+
+/**@brief Configure next timeslot event in normal configuration
+ *
+ * @details Opens a listening window around the initiator's next burst. The SoftDevice only
+ *          runs the HFXO for the duration of the timeslot, so the crystal and the radio are
+ *          both off between bursts.
+ */
+void configure_next_event_normal(void)
+{
+    m_slot_length                                  = m_window_length_us;
+    m_timeslot_request.request_type                = NRF_RADIO_REQ_TYPE_NORMAL;
+    m_timeslot_request.params.normal.hfclk         = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED;
+    m_timeslot_request.params.normal.priority      = NRF_RADIO_PRIORITY_HIGH;
+    m_timeslot_request.params.normal.distance_us   = m_distance_us;
+    m_timeslot_request.params.normal.length_us     = m_slot_length;
+}
+
+
+/**@brief Configure the request following the current timeslot
+ *
+ * @details The next window is placed one period after the first packet heard in the current
+ *          timeslot, less the guard time and the initiator's catch-up delay. This keeps the
+ *          windows aligned with the initiator in spite of clock drift and grant latency.
+ *
+ *          A search requested while the windows follow the initiator is for a single-shot
+ *          burst, which the initiator runs between its scheduled bursts without moving them.
+ *          The windows resume at their own phase after the search.
+ */
+static void configure_next_event(void)
+{
+    /* Length of the timeslot now ending, including extensions */
+    uint32_t elapsed_us  = m_slot_length + m_total_timeslot_length;
+    uint32_t first_rx_us = m_first_rx_us;
+    bool     searched    = m_search_synced;
+    uint32_t offset_us;
+
+    schedule_apply();
+    m_search_synced = false;
+
+    /* The bursts of several initiators are not aligned, so the responder listens for all of
+     * them continuously instead of following one */
+    if ((m_schedule.rate_hz == 0) || (rtt_initiators_in_use() > 1))
+    {
+        m_search_pending = false;
+        m_synced         = false;
+        configure_next_event_earliest();
+        return;
+    }
+
+    if (searched && m_synced)
+    {
+        /* m_distance_us is still from the start of the last window */
+        offset_us = (uint32_t)(((uint64_t)app_timer_cnt_diff_compute(m_slot_ticks, m_window_ticks) * 1000000UL) /
+                               APP_TIMER_CLOCK_FREQ);
+        while (m_distance_us <= offset_us + elapsed_us)
+        {
+            m_distance_us += m_period_us;
+        }
+        m_distance_us -= offset_us;
+    }
+    else if (first_rx_us != RTT_NO_RX)
+    {
+        m_synced      = true;
+        m_sync_misses = 0;
+        m_distance_us = m_period_us + first_rx_us - TS_SYNC_GUARD_US - CATCH_UP_DELAY_US;
+    }
+    else if (m_synced && (++m_sync_misses < TS_SYNC_LOST_BURSTS))
+    {
+        /* Keep the phase of the previous window */
+        m_distance_us = m_period_us;
+    }
+    else
+    {
+        /* Lost the initiator, search for it again */
+        m_search_pending = false;
+        m_synced         = false;
+        configure_next_event_earliest();
+        return;
+    }
+
+    if (m_search_pending)
+    {
+        /* Listen continuously until the single-shot burst is heard, still following the
+         * initiator */
+        m_search_pending = false;
+        m_search_synced  = true;
+        configure_next_event_earliest();
+        return;
+    }
+
+    /* A normal request must start after the current timeslot has ended */
+    if (m_distance_us <= elapsed_us)
+    {
+        m_synced = false;
+        configure_next_event_earliest();
+        return;
+    }
+
+    configure_next_event_normal();
+}
+
+/**@brief Account the timeslot now ending to the search for an initiator
+ *
+ * @details Only extended timeslots count, those of continuous ranging and of searching. A
+ *          listening window that misses the initiator leads to a search first.
+ *
+ * @return True if no initiator has been heard for TS_SEARCH_TIMEOUT_US of listening.
+ */
+static bool search_expired(void)
+{
+    if (m_first_rx_us != RTT_NO_RX)
+    {
+        m_search_us = 0;
+        return false;
+    }
+
+    if (m_slot_extending)
+    {
+        m_search_us += m_slot_length + m_total_timeslot_length;
+    }
+
+    return (m_search_us >= TS_SEARCH_TIMEOUT_US);
+}
+
 /**@brief Timeslot signal handler
  */
 void nrf_evt_signal_handler(uint32_t evt_id)
@@ -85,22 +298,66 @@ void nrf_evt_signal_handler(uint32_t evt_id)
             /* No implementation needed */
             break;
         case NRF_EVT_RADIO_SESSION_IDLE:
-            /* No implementation needed */
+            /* Ranging may have been started again while the last timeslot was ending */
+            if (m_running && !m_request_pending && !m_slot_active && !m_preempting)
+            {
+                err_code = request_next_event_earliest();
+                APP_ERROR_CHECK(err_code);
+            }
             break;
         case NRF_EVT_RADIO_SESSION_CLOSED:
-            /* No implementation needed, session ended */
+            if (!m_preempting)
+            {
+                /* No implementation needed, session ended */
+                break;
+            }
+
+            /* Closed by timeslot_search(): the window requested is taken back, search in its
+             * place */
+            m_preempting      = false;
+            m_request_pending = false;
+            err_code = sd_radio_session_open(radio_callback);
+            APP_ERROR_CHECK(err_code);
+            if (m_running)
+            {
+                m_search_pending = false;
+                m_search_synced  = m_synced;
+                configure_next_event_earliest();
+                err_code = sd_radio_request(&m_timeslot_request);
+                APP_ERROR_CHECK(err_code);
+                m_request_pending = true;
+                m_requests++;
+            }
             break;
         case NRF_EVT_RADIO_BLOCKED:
             /* Fall through */
         case NRF_EVT_RADIO_CANCELED:
-            err_code = request_next_event_earliest();
-            APP_ERROR_CHECK(err_code);
+            m_request_pending = false;
+            if (m_preempting)
+            {
+                /* The request taken back by closing the session */
+                break;
+            }
+            m_blocked++;
+            if (m_running)
+            {
+                err_code = request_next_event_earliest();
+                APP_ERROR_CHECK(err_code);
+            }
             break;
         default:
             break;
     }
 }
 
+
+/**@brief SoftDevice SoC event handler
+ */
+static void soc_evt_handler(uint32_t evt_id, void * p_context)
+{
+    nrf_evt_signal_handler(evt_id);
+}
+
 /**@brief Timeslot event handler
  */
 nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
@@ -108,7 +365,26 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
     switch(signal_type)
     {
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_START:
-            nrf_gpio_pin_set(DATAPIN_1);
+            m_request_pending = false;
+            m_grants++;
+
+            if (!m_running)
+            {
+                /* Ranging was stopped after this timeslot was requested */
+                signal_callback_return_param.params.request.p_next = NULL;
+                signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
+                break;
+            }
+
+            m_slot_active    = true;
+            m_slot_extending = (m_schedule.rate_hz == 0) || !m_synced || m_search_synced;
+            m_slot_ticks     = app_timer_cnt_get();
+            if (!m_slot_extending)
+            {
+                m_window_ticks = m_slot_ticks;
+            }
+            m_first_rx_us    = RTT_NO_RX;
+            RTT_TRACE(RTT_TRACE_SLOT_START);
 
             /* TIMER0 is pre-configured for 1Mhz. */
             NRF_TIMER0->TASKS_STOP          = 1;
@@ -116,12 +392,22 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             NRF_TIMER0->MODE                = (TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos);
             NRF_TIMER0->EVENTS_COMPARE[0]   = 0;
             NRF_TIMER0->EVENTS_COMPARE[1]   = 0;
-    
-            NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos) | 
-                                   (TIMER_INTENSET_COMPARE1_Set << TIMER_INTENSET_COMPARE1_Pos);
 
-            NRF_TIMER0->CC[0]               = (TS_LEN_US - TS_SAFETY_MARGIN_US);
-            NRF_TIMER0->CC[1]               = (TS_LEN_US - TS_EXTEND_MARGIN_US);
+            if (m_slot_extending)
+            {
+                /* Continuous ranging or searching: extend the timeslot until TS_TOT_EXT_LENGTH_US */
+                NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos) | 
+                                       (TIMER_INTENSET_COMPARE1_Set << TIMER_INTENSET_COMPARE1_Pos);
+            }
+            else
+            {
+                /* Listening window: a single timeslot without extensions */
+                NRF_TIMER0->INTENCLR = (TIMER_INTENCLR_COMPARE1_Clear << TIMER_INTENCLR_COMPARE1_Pos);
+                NRF_TIMER0->INTENSET = (TIMER_INTENSET_COMPARE0_Set << TIMER_INTENSET_COMPARE0_Pos);
+            }
+
+            NRF_TIMER0->CC[0]               = (m_slot_length - TS_SAFETY_MARGIN_US);
+            NRF_TIMER0->CC[1]               = (m_slot_length - TS_EXTEND_MARGIN_US);
             NRF_TIMER0->BITMODE             = (TIMER_BITMODE_BITMODE_24Bit << TIMER_BITMODE_BITMODE_Pos);
             NRF_TIMER0->TASKS_START         = 1;
     
@@ -131,6 +417,8 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
+
+            TIMESLOT_BEGIN_EGU->TASKS_TRIGGER[0] = 1;
             break;
 
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO:
@@ -143,45 +431,63 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             if (NRF_TIMER0->EVENTS_COMPARE[0] &&
                (NRF_TIMER0->INTENSET & (TIMER_INTENSET_COMPARE0_Enabled << TIMER_INTENCLR_COMPARE0_Pos)))
             {
-                /* End margin reached. End current timeslot and request new one. */
-                m_timeslot_request.params.earliest.length_us   = TS_LEN_US;
-                m_slot_length                                  = TS_LEN_US;
-
                 NRF_TIMER0->TASKS_STOP  = 1;
                 NRF_TIMER0->EVENTS_COMPARE[0] = 0;
                 (void)NRF_TIMER0->EVENTS_COMPARE[0];
 
-                /* Schedule next timeslot */
-                signal_callback_return_param.params.request.p_next = &m_timeslot_request;
-                signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+                if (m_running && search_expired())
+                {
+                    /* The initiators have gone without stopping ranging, stop listening for them */
+                    m_running = false;
+                }
+
+                if (m_running)
+                {
+                    /* End margin reached. End current timeslot and request the next one. */
+                    configure_next_event();
+
+                    signal_callback_return_param.params.request.p_next = &m_timeslot_request;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+                    m_request_pending = true;
+                    m_requests++;
+                }
+                else
+                {
+                    /* Ranging stopped. End current timeslot and let the session go idle. */
+                    signal_callback_return_param.params.request.p_next = NULL;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
+                }
+                m_slot_active = false;
 
                 TIMESLOT_END_EGU->TASKS_TRIGGER[0] = 1;
 
-                nrf_gpio_pin_clear(DATAPIN_1);
+                RTT_TRACE(RTT_TRACE_SLOT_END);
                 bsp_board_led_off(LED3);
             }
             else if (NRF_TIMER0->EVENTS_COMPARE[1] &&
                (NRF_TIMER0->INTENSET & (TIMER_INTENSET_COMPARE1_Enabled << TIMER_INTENCLR_COMPARE1_Pos)))
             {
                 /* Extend margin reached. Request extension. */
-                m_timeslot_request.params.earliest.length_us   = TS_LEN_EXTENSION_US;
-                m_slot_length                                  = TS_LEN_EXTENSION_US;
-
-                configure_next_event_earliest();
-
                 NRF_TIMER0->EVENTS_COMPARE[1] = 0;
                 (void)NRF_TIMER0->EVENTS_COMPARE[1];
+
+                /* Stop searching once the initiator has been heard, the next window follows its bursts.
+                 * Several initiators are listened for continuously. */
+                bool found = (m_schedule.rate_hz != 0) && (m_first_rx_us != RTT_NO_RX) && (rtt_initiators_in_use() <= 1);
             
                 /* This is the "try to extend timeslot" timeout */
-                if (m_total_timeslot_length < (TS_TOT_EXT_LENGTH_US - 5000UL - TS_LEN_EXTENSION_US))
+                if (m_running && !found && (m_total_timeslot_length < (TS_TOT_EXT_LENGTH_US - 5000UL - rtt_config_get()->slot_length_us)))
                 {
                     /* Request timeslot extension if total length does not exceed TS_TOT_EXT_LENGTH_US */
-                    signal_callback_return_param.params.extend.length_us = TS_LEN_EXTENSION_US;
+                    signal_callback_return_param.params.extend.length_us = rtt_config_get()->slot_length_us;
                     signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND;
+                    RTT_TRACE(RTT_TRACE_EXTEND_REQUEST);
+                }
+                else
+                {
+                    signal_callback_return_param.params.request.p_next = NULL;
+                    signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
                 }
-
-                nrf_gpio_pin_set(DATAPIN_2);
-                nrf_gpio_pin_set(DATAPIN_3);
             }
             else
             {
@@ -198,17 +504,17 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             NRF_TIMER0->TASKS_STOP          = 1;
             NRF_TIMER0->EVENTS_COMPARE[0]   = 0;
             NRF_TIMER0->EVENTS_COMPARE[1]   = 0;
-            NRF_TIMER0->CC[0]               += (TS_LEN_EXTENSION_US - 25);
-            NRF_TIMER0->CC[1]               += (TS_LEN_EXTENSION_US - 25);
+            NRF_TIMER0->CC[0]               += (rtt_config_get()->slot_length_us - 25);
+            NRF_TIMER0->CC[1]               += (rtt_config_get()->slot_length_us - 25);
             NRF_TIMER0->TASKS_START         = 1;
     
             /* Keep track of total length */
-            m_total_timeslot_length += TS_LEN_EXTENSION_US;
+            m_total_timeslot_length += rtt_config_get()->slot_length_us;
             
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
 
-            nrf_gpio_pin_clear(DATAPIN_3);
+            RTT_TRACE(RTT_TRACE_EXTEND_SUCCEEDED);
             bsp_board_led_on(LED3);
 
             TIMESLOT_BEGIN_EGU->TASKS_TRIGGER[0] = 1;
@@ -218,7 +524,7 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
             signal_callback_return_param.params.request.p_next = NULL;
             signal_callback_return_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
 
-            nrf_gpio_pin_clear(DATAPIN_2);
+            RTT_TRACE(RTT_TRACE_EXTEND_FAILED);
             break;
         default:
             /* No implementation needed */
@@ -232,8 +538,6 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type)
  */
 uint32_t timeslot_sd_init()
 {
-    uint32_t err_code;
-
     TIMESLOT_BEGIN_EGU->INTENSET = (1 << 0);
     TIMESLOT_END_EGU->INTENSET = (1 << 0);
 
@@ -242,32 +546,177 @@ uint32_t timeslot_sd_init()
     NVIC_EnableIRQ(TIMESLOT_BEGIN_IRQn);
     NVIC_EnableIRQ(TIMESLOT_END_IRQn);
     
-    /* Open a session for radio timeslot requests */
-    err_code = sd_radio_session_open(radio_callback);
-    if (err_code != NRF_SUCCESS)
+    /* Open a session for radio timeslot requests. Timeslots are requested by timeslot_start(). */
+    return sd_radio_session_open(radio_callback);
+}
+
+
+/**@brief Start ranging according to the current schedule.
+ */
+uint32_t timeslot_start(void)
+{
+    uint32_t err_code;
+
+    if (m_running)
     {
-        return err_code;
+        return NRF_ERROR_INVALID_STATE;
     }
 
-    /* Request a timeslot */
-    err_code = request_next_event_earliest();
-    if (err_code != NRF_SUCCESS)
+    m_running   = true;
+    m_search_us = 0;
+
+    /* If a timeslot is still in progress, its end will request the next one, and the session
+       being closed for a search requests it when it has closed */
+    if (!m_request_pending && !m_slot_active && !m_preempting)
     {
-        (void)sd_radio_session_close();
-        return err_code;
+        err_code = request_next_event_earliest();
+        if (err_code != NRF_SUCCESS)
+        {
+            m_running = false;
+            return err_code;
+        }
     }
 
     return NRF_SUCCESS;
 }
 
+
+/**@brief Stop ranging. The timeslot in progress, if any, is completed.
+ */
+void timeslot_stop(void)
+{
+    m_running = false;
+}
+
+
+/**@brief Check whether ranging is running.
+ */
+bool timeslot_is_running(void)
+{
+    return m_running;
+}
+
+
+/**@brief Listen continuously from the next timeslot request until the initiator is heard.
+ */
+void timeslot_search(void)
+{
+    m_search_pending = true;
+
+    /* A window requested cannot be withdrawn, so the session is closed to take it back and
+       opened again */
+    if (m_running && m_synced && m_request_pending && !m_slot_active && !m_preempting)
+    {
+        m_preempting = true;
+        if (sd_radio_session_close() != NRF_SUCCESS)
+        {
+            /* The search follows the window instead */
+            m_preempting = false;
+        }
+    }
+}
+
+
+/**@brief Check whether the listening windows follow the initiator's bursts.
+ */
+bool timeslot_is_synced(void)
+{
+    return m_synced;
+}
+
+
+/**@brief Set the ranging schedule. The schedule takes effect from the next timeslot request.
+ */
+uint32_t timeslot_schedule_set(timeslot_schedule_t const * p_schedule)
+{
+    if ((p_schedule->rate_hz > TS_MAX_RATE_HZ) ||
+        (p_schedule->exchanges == 0) ||
+        (p_schedule->exchanges > TS_MAX_EXCHANGES))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* Leave at least half of each period to the BLE link */
+    if ((p_schedule->rate_hz != 0) &&
+        (2 * TS_BURST_LENGTH_US(p_schedule->exchanges, rtt_config_get()->burst_margin_us) > (1000000UL / p_schedule->rate_hz)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* The timeslot handler only reads the pending schedule while the valid flag is set */
+    m_schedule_pending_valid = false;
+    m_schedule_pending       = *p_schedule;
+    __DMB();
+    m_schedule_pending_valid = true;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Get the most recently set ranging schedule.
+ */
+void timeslot_schedule_get(timeslot_schedule_t * p_schedule)
+{
+    *p_schedule = m_schedule_pending_valid ? m_schedule_pending : m_schedule;
+}
+
+
+/**@brief Get and clear the number of served and blocked bursts since the previous call.
+ */
+void timeslot_rate_get(uint32_t * p_bursts, uint32_t * p_blocked)
+{
+    CRITICAL_REGION_ENTER();
+    *p_bursts  = m_bursts;
+    *p_blocked = m_blocked;
+    m_bursts   = 0;
+    m_blocked  = 0;
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Get the total number of timeslot requests and grants.
+ *
+ * @details The counters are updated from the timeslot callback, which cannot be masked by
+ *          the application, so they are never cleared. Callers compare successive readings.
+ */
+void timeslot_grant_stats_get(uint32_t * p_requests, uint32_t * p_grants)
+{
+    *p_requests = m_requests;
+    *p_grants   = m_grants;
+}
+
 /**
  * TIMESLOT_BEGIN SWI handler.
  */
 void TIMESLOT_BEGIN_IRQHandler(void)
 {
+    uint32_t loop_start_us;
+    uint32_t first_rx_us;
+
     TIMESLOT_BEGIN_EGU->EVENTS_TRIGGERED[0] = 0;
     bsp_board_led_on(LED4);
-    do_rtt_measurement();
+
+    /* TIMER0 counts from the start of the timeslot, also across extensions */
+    NRF_TIMER0->TASKS_CAPTURE[2] = 1;
+    loop_start_us = NRF_TIMER0->CC[2];
+
+    if (m_slot_extending)
+    {
+        first_rx_us = do_rtt_measurement(DO_RTT_LENGTH_US(rtt_config_get()->slot_length_us));
+    }
+    else
+    {
+        first_rx_us = do_rtt_measurement(m_slot_length - rtt_config_get()->burst_margin_us);
+    }
+
+    if (first_rx_us != RTT_NO_RX)
+    {
+        if (m_first_rx_us == RTT_NO_RX)
+        {
+            m_first_rx_us = loop_start_us + first_rx_us;
+        }
+        m_bursts++;
+    }
 }
 
 /**
@@ -277,4 +726,4 @@ void TIMESLOT_END_IRQHandler(void)
 {
     TIMESLOT_END_EGU->EVENTS_TRIGGERED[0] = 0;
     bsp_board_led_off(LED4);
-}
\ No newline at end of file
+}
@@ -25,6 +25,8 @@
 #ifndef TIMESLOT_H__
 #define TIMESLOT_H__
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "nrf.h"
 #include "app_error.h"
 #include "nrf_gpio.h"
@@ -42,6 +44,19 @@
 #define TIMESLOT_END_IRQn          SWI4_EGU4_IRQn
 #define TIMESLOT_END_IRQHandler    SWI4_EGU4_IRQHandler
 #define TIMESLOT_END_IRQPriority   7
+#define TIMESLOT_SOC_OBSERVER_PRIO 1
+
+/**@brief Ranging schedule
+ *
+ * @details A rate of 0 selects continuous ranging, where each timeslot is extended up to
+ *          TS_TOT_EXT_LENGTH_US and a new timeslot is requested as soon as it ends. The
+ *          schedule must match the one used by the initiator.
+ */
+typedef struct
+{
+    uint32_t rate_hz;   /**< Requested number of bursts per second. */
+    uint32_t exchanges; /**< Number of exchanges in each burst. */
+} timeslot_schedule_t;
 
 /**@brief Radio event handler
 */
@@ -77,4 +92,62 @@ nrf_radio_signal_callback_return_param_t * radio_callback(uint8_t signal_type);
  */
 uint32_t timeslot_sd_init();
 
+
+/**@brief Start ranging according to the current schedule.
+ *
+ * @retval NRF_SUCCESS             Ranging started.
+ * @retval NRF_ERROR_INVALID_STATE Ranging is already running.
+ */
+uint32_t timeslot_start(void);
+
+
+/**@brief Stop ranging. The timeslot in progress, if any, is completed.
+ */
+void timeslot_stop(void);
+
+
+/**@brief Check whether ranging is running.
+ *
+ * @details Ranging stops by itself when no initiator has been heard for TS_SEARCH_TIMEOUT_US.
+ */
+bool timeslot_is_running(void);
+
+
+/**@brief Set the ranging schedule. The schedule takes effect from the next timeslot request.
+ *
+ * @retval NRF_SUCCESS             Schedule accepted.
+ * @retval NRF_ERROR_INVALID_PARAM The bursts do not fit the requested rate.
+ */
+uint32_t timeslot_schedule_set(timeslot_schedule_t const * p_schedule);
+
+
+/**@brief Get the most recently set ranging schedule.
+ */
+void timeslot_schedule_get(timeslot_schedule_t * p_schedule);
+
+
+/**@brief Get and clear the number of served and blocked bursts since the previous call.
+ */
+void timeslot_rate_get(uint32_t * p_bursts, uint32_t * p_blocked);
+
+
+/**@brief Get the total number of timeslot requests and grants.
+ */
+void timeslot_grant_stats_get(uint32_t * p_requests, uint32_t * p_grants);
+
+
+/**@brief Listen continuously from the next timeslot request until the initiator is heard.
+ *
+ * @details Used when the initiator is about to range outside its schedule. A window already
+ *          requested is taken back by closing and opening the radio session again. Windows that
+ *          follow the initiator resume at their own phase after the search, as the initiator
+ *          keeps the phase of its bursts around a single-shot burst.
+ */
+void timeslot_search(void);
+
+
+/**@brief Check whether the listening windows follow the initiator's bursts.
+ */
+bool timeslot_is_synced(void);
+
 #endif